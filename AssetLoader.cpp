@@ -0,0 +1,284 @@
+#include "AssetLoader.h"
+#include "Graphics.h"
+#include "Jobs.h"
+#include <chrono>
+#include <cstdio>
+#include <wincodec.h>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+namespace
+{
+	double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Just the file name, for the report
+	std::string ShortName(const std::wstring& path)
+	{
+		size_t slash = path.find_last_of(L"/\\");
+		std::string name;
+		for (size_t i = slash == std::wstring::npos ? 0 : slash + 1; i < path.size(); i++)
+			name += (char)path[i]; // Our asset names are plain ASCII
+		return name;
+	}
+
+	std::string ShortName(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+}
+
+unsigned int AssetLoader::AddTexture(const std::wstring& filePath)
+{
+	TextureAsset texture = {};
+	texture.image.path = filePath;
+	textures.push_back(texture);
+	return (unsigned int)textures.size() - 1;
+}
+
+unsigned int AssetLoader::AddCubemap(const std::wstring& right, const std::wstring& left, const std::wstring& up,
+	const std::wstring& down, const std::wstring& front, const std::wstring& back)
+{
+	CubemapAsset cubemap = {};
+	const std::wstring* paths[6] = { &right, &left, &up, &down, &front, &back };
+	for (int i = 0; i < 6; i++)
+		cubemap.faces[i].path = *paths[i];
+	cubemaps.push_back(cubemap);
+	return (unsigned int)cubemaps.size() - 1;
+}
+
+unsigned int AssetLoader::AddMesh(const std::string& objFilePath, float weldEpsilon, bool occluder, bool packed, bool shadowCaster)
+{
+	meshes.emplace_back();
+	meshes.back().path = objFilePath;
+	meshes.back().weldEpsilon = weldEpsilon;
+	meshes.back().data.occluder = occluder;
+	meshes.back().data.packed = packed;
+	meshes.back().data.shadowCaster = shadowCaster;
+	return (unsigned int)meshes.size() - 1;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::GetTexture(unsigned int id) { return textures[id].srv; }
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetLoader::GetCubemap(unsigned int id) { return cubemaps[id].srv; }
+std::shared_ptr<Mesh> AssetLoader::GetMesh(unsigned int id) { return meshes[id].mesh; }
+
+// --------------------------------------------------------
+// Loads everything that's been added
+//
+// - Phase 1: every texture, cube face and mesh is its own
+//    work item on the Jobs pool (big meshes also split their
+//    parsing further, see ObjParser)
+// - Phase 2: resources are created in order on this thread;
+//    CPU-side data is freed as soon as it's on the GPU
+// --------------------------------------------------------
+void AssetLoader::LoadAll()
+{
+	// Flatten everything into one list of work
+	struct Work
+	{
+		Image* image;
+		MeshAsset* mesh;
+	};
+	std::vector<Work> work;
+	for (TextureAsset& texture : textures)
+		work.push_back({ &texture.image, 0 });
+	for (CubemapAsset& cubemap : cubemaps)
+		for (Image& face : cubemap.faces)
+			work.push_back({ &face, 0 });
+	for (MeshAsset& mesh : meshes)
+		work.push_back({ 0, &mesh });
+
+	workItems.assign(work.size(), WorkItem());
+	threadCount = Jobs::ThreadCount();
+
+	auto start = std::chrono::steady_clock::now();
+	Jobs::ParallelFor((unsigned int)work.size(), [&](unsigned int i)
+		{
+			auto itemStart = std::chrono::steady_clock::now();
+			if (work[i].image)
+			{
+				workItems[i].name = ShortName(work[i].image->path);
+				workItems[i].failed = !DecodeImage(*work[i].image);
+			}
+			else
+			{
+				workItems[i].name = ShortName(work[i].mesh->path);
+				Mesh::LoadObj(work[i].mesh->path.c_str(), work[i].mesh->weldEpsilon, work[i].mesh->data);
+			}
+			workItems[i].seconds = SecondsSince(itemStart);
+		});
+	decodeSeconds = SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	for (TextureAsset& texture : textures)
+		CreateTexture(texture);
+	for (CubemapAsset& cubemap : cubemaps)
+		CreateCubemap(cubemap);
+	for (MeshAsset& mesh : meshes)
+	{
+		mesh.mesh = std::make_shared<Mesh>(mesh.data);
+		mesh.data = MeshData();
+	}
+	createSeconds = SecondsSince(start);
+}
+
+// --------------------------------------------------------
+// Decodes an image file to 8-bit RGBA with WIC
+//
+// - Each worker needs COM, so it's initialized here; if the
+//    thread already has it (like the main thread) that call
+//    fails harmlessly and we use what's there
+// --------------------------------------------------------
+bool AssetLoader::DecodeImage(Image& image)
+{
+	HRESULT comResult = CoInitializeEx(0, COINIT_MULTITHREADED);
+
+	bool decoded = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+			SUCCEEDED(factory->CreateDecoderFromFilename(image.path.c_str(), 0, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) &&
+			SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf())) &&
+			SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf())) &&
+			SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom)) &&
+			SUCCEEDED(converter->GetSize(&image.width, &image.height)))
+		{
+			image.pixels.resize((size_t)image.width * image.height * 4);
+			decoded = SUCCEEDED(converter->CopyPixels(0, image.width * 4, (UINT)image.pixels.size(), image.pixels.data()));
+		}
+
+		// sRGB or not is decided the same way DirectXTK does it
+		Microsoft::WRL::ComPtr<IWICMetadataQueryReader> metadata;
+		GUID container = {};
+		image.srgb = false;
+		if (decoded &&
+			SUCCEEDED(frame->GetMetadataQueryReader(metadata.GetAddressOf())) &&
+			SUCCEEDED(decoder->GetContainerFormat(&container)))
+		{
+			PROPVARIANT value;
+			PropVariantInit(&value);
+			if (container == GUID_ContainerFormatPng)
+				image.srgb = SUCCEEDED(metadata->GetMetadataByName(L"/sRGB/RenderingIntent", &value)) && value.vt == VT_UI1;
+			else
+				image.srgb = SUCCEEDED(metadata->GetMetadataByName(L"System.Image.ColorSpace", &value)) && value.vt == VT_UI2 && value.uiVal == 1;
+			PropVariantClear(&value);
+		}
+	}
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+	return decoded;
+}
+
+// --------------------------------------------------------
+// Uploads mip 0 and lets the GPU generate the rest, which
+// is what CreateWICTextureFromFile() did when given a context
+// --------------------------------------------------------
+void AssetLoader::CreateTexture(TextureAsset& texture)
+{
+	Image& image = texture.image;
+	if (image.pixels.empty())
+		return;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = image.width;
+	desc.Height = image.height;
+	desc.MipLevels = 0; // Full chain
+	desc.ArraySize = 1;
+	desc.Format = image.srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET; // Render target is required for GenerateMips()
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> resource;
+	if (FAILED(Graphics::Device->CreateTexture2D(&desc, 0, resource.GetAddressOf())))
+		return;
+
+	Graphics::Context->UpdateSubresource(resource.Get(), 0, 0, image.pixels.data(), image.width * 4, 0);
+	Graphics::Device->CreateShaderResourceView(resource.Get(), 0, texture.srv.GetAddressOf());
+	Graphics::Context->GenerateMips(texture.srv.Get());
+
+	image.pixels = std::vector<unsigned char>();
+}
+
+// --------------------------------------------------------
+// Same cube as Sky::CreateCubemap(), but the faces are already
+// decoded, so they go in as the initial data of one texture
+// --------------------------------------------------------
+void AssetLoader::CreateCubemap(CubemapAsset& cubemap)
+{
+	D3D11_SUBRESOURCE_DATA faceData[6] = {};
+	for (int i = 0; i < 6; i++)
+	{
+		const Image& face = cubemap.faces[i];
+		if (face.pixels.empty() || face.width != cubemap.faces[0].width || face.height != cubemap.faces[0].height)
+			return;
+
+		faceData[i].pSysMem = face.pixels.data();
+		faceData[i].SysMemPitch = face.width * 4;
+	}
+
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	cubeDesc.Width = cubemap.faces[0].width;
+	cubeDesc.Height = cubemap.faces[0].height;
+	cubeDesc.MipLevels = 1;
+	cubeDesc.ArraySize = 6;
+	cubeDesc.Format = cubemap.faces[0].srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	cubeDesc.SampleDesc.Count = 1;
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
+	if (FAILED(Graphics::Device->CreateTexture2D(&cubeDesc, faceData, cubeMapTexture.GetAddressOf())))
+		return;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = cubeDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = 1;
+	srvDesc.TextureCube.MostDetailedMip = 0;
+	Graphics::Device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubemap.srv.GetAddressOf());
+
+	for (Image& face : cubemap.faces)
+		face.pixels = std::vector<unsigned char>();
+}
+
+// --------------------------------------------------------
+// Where the time went in the last LoadAll()
+// --------------------------------------------------------
+std::string AssetLoader::GetReport()
+{
+	double workSeconds = 0;
+	const WorkItem* slowest = 0;
+	std::string failures;
+	for (const WorkItem& item : workItems)
+	{
+		workSeconds += item.seconds;
+		if (!slowest || item.seconds > slowest->seconds)
+			slowest = &item;
+		if (item.failed)
+			failures += "  failed to decode " + item.name + "\n";
+	}
+
+	double criticalPath = (slowest ? slowest->seconds : 0) + createSeconds;
+	char report[512];
+	snprintf(report, sizeof(report),
+		"Asset loading: %.1f ms on %u threads (%zu items)\n"
+		"  decode/import: %.1f ms wall, %.1f ms of work (%.1fx parallel)\n"
+		"  resource creation: %.1f ms\n"
+		"  critical path: %.1f ms (slowest item: %s, %.1f ms)\n",
+		(decodeSeconds + createSeconds) * 1000, threadCount, workItems.size(),
+		decodeSeconds * 1000, workSeconds * 1000, decodeSeconds > 0 ? workSeconds / decodeSeconds : 0.0,
+		createSeconds * 1000,
+		criticalPath * 1000, slowest ? slowest->name.c_str() : "none", slowest ? slowest->seconds * 1000 : 0.0);
+	return report + failures;
+}
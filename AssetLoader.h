@@ -0,0 +1,89 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Loads a batch of textures, cubemaps and meshes in parallel
+//
+// - Add*() queues an asset and returns its id
+// - LoadAll() decodes images (WIC) and imports meshes on the
+//    Jobs pool, then creates the D3D resources on the calling
+//    thread, which must be the one that owns the device context
+// - GetReport() breaks down where the time went, including the
+//    critical path: the slowest single decode plus all of the
+//    (serial) resource creation.  That's as fast as LoadAll()
+//    can get, no matter how many cores there are
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	unsigned int AddTexture(const std::wstring& filePath); // Mipmaps are generated
+	unsigned int AddCubemap(const std::wstring& right, const std::wstring& left, const std::wstring& up,
+		const std::wstring& down, const std::wstring& front, const std::wstring& back); // No mipmaps, like Sky::CreateCubemap()
+	unsigned int AddMesh(const std::string& objFilePath, float weldEpsilon = 0.0f, bool occluder = false, bool packed = false, bool shadowCaster = false); // See MeshData
+
+	void LoadAll();
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTexture(unsigned int id);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetCubemap(unsigned int id);
+	std::shared_ptr<Mesh> GetMesh(unsigned int id);
+
+	std::string GetReport();
+
+private:
+	// A decoded image, always 8-bit RGBA
+	struct Image
+	{
+		std::wstring path;
+		unsigned int width;
+		unsigned int height;
+		bool srgb; // From the file's metadata, like CreateWICTextureFromFile()
+		std::vector<unsigned char> pixels;
+	};
+
+	struct TextureAsset
+	{
+		Image image;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	};
+
+	struct CubemapAsset
+	{
+		Image faces[6]; // +X, -X, +Y, -Y, +Z, -Z
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	};
+
+	struct MeshAsset
+	{
+		std::string path;
+		float weldEpsilon;
+		MeshData data;
+		std::shared_ptr<Mesh> mesh;
+	};
+
+	// One unit of worker-thread work, and what it cost
+	struct WorkItem
+	{
+		std::string name;
+		double seconds;
+		bool failed;
+	};
+
+	static bool DecodeImage(Image& image);
+	void CreateTexture(TextureAsset& texture);
+	void CreateCubemap(CubemapAsset& cubemap);
+
+	std::vector<TextureAsset> textures;
+	std::vector<CubemapAsset> cubemaps;
+	std::vector<MeshAsset> meshes;
+
+	// Timings from the last LoadAll()
+	std::vector<WorkItem> workItems;
+	double decodeSeconds = 0;
+	double createSeconds = 0;
+	unsigned int threadCount = 1;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <string>
+
+// --------------------------------------------------------
+// In-app micro-benchmarks, run from the "Benchmarks" ImGui node
+//
+// - Timings only - each returns a short summary for the UI,
+//    and whether the results are right is checked by the
+//    test runner in Tests/
+// - These are slow on purpose (big inputs), so they're only
+//    run when a button is pressed
+// --------------------------------------------------------
+namespace Benchmarks
+{
+	// Generates a grid .obj with (at least) this many triangles,
+	// then times ObjParser on it and reports MB/s and triangles/s
+	std::string ObjParse(unsigned int triangleCount);
+
+	// Same generated mesh, parsed with 1, 2, 4 ... up to every
+	// thread in the Jobs pool
+	std::string ObjParseScaling(unsigned int triangleCount);
+
+	// Shuffles a grid's triangles, then runs MeshOptimizer on it and
+	// reports the simulated ACMR/ATVR before and after
+	std::string VertexCache(unsigned int triangleCount);
+
+	// Our mesh assets imported from .obj (parse, weld, optimize,
+	// tangents) versus mapped from cooked .ggp_mesh files, with
+	// and without checksum verification
+	std::string MeshLoad();
+
+	// Mesh::CalculateTangents() on a generated grid, against the
+	// original scalar version
+	std::string TangentCalculation(unsigned int triangleCount);
+
+	// VertexCodec on random vertices: encode/decode speed and
+	// the size saved
+	std::string VertexPacking(unsigned int vertexCount);
+
+	// MeshSimplifier taking our sphere, torus and helix to 1/2,
+	// 1/4 and 1/8 of their triangles, and the LOD chain each
+	// one gets
+	std::string Simplification();
+
+	// Meshlets on a generated sphere: build time, cluster sizes,
+	// and for a few camera views how much Meshlets::Cull() keeps
+	// and how long it takes
+	std::string ClusterCulling(unsigned int triangleCount);
+
+	// FrustumCuller on this many random spheres around a camera:
+	// SIMD against scalar
+	std::string FrustumCulling(unsigned int entityCount);
+
+	// SceneIndex with this many static objects plus some moving ones:
+	// build time, per-frame refit of the moving ones, and frustum,
+	// sphere and ray queries against testing every object
+	std::string SceneIndexScaling(unsigned int staticCount, unsigned int dynamicCount);
+
+	// A city of buildings hiding this many small objects: fraction
+	// culled, and rasterize and test times
+	std::string OcclusionCulling(unsigned int objectCount);
+
+	// Packing and radix sorting this many render queue keys, against
+	// std::stable_sort, and the state changes sorting saves
+	std::string RenderQueueSort(unsigned int itemCount);
+
+	// Grouping this many draws into instanced batches, and how many
+	// draw calls that leaves
+	std::string InstanceBatching(unsigned int drawCount);
+
+	// This many draws bound through a StateCache on a mock context,
+	// against binding everything directly: the calls saved and the
+	// cache's overhead
+	std::string StateCacheCalls(unsigned int drawCount);
+
+	// Deep, wide and bushy TransformHierarchy trees of this many nodes:
+	// full, idle, one-subtree and 1%-moving updates
+	std::string TransformHierarchyUpdate(unsigned int nodeCount);
+
+	// This many transforms' world and inverse-transpose matrices from
+	// TransformSystem's SIMD batches versus a Transform each
+	std::string TransformSystemBuild(unsigned int transformCount);
+
+	// Transform's quaternion Rotate() and GetWorldMatrix() against the
+	// old pitch/yaw/roll version on this many transforms
+	std::string QuaternionRotation(unsigned int transformCount);
+
+	// Transform's closed-form inverse-transpose against the general
+	// inverse on this many random transforms
+	std::string InverseTranspose(unsigned int transformCount);
+
+	// ObjectConstants on this many entities with a varying share of them
+	// moving: the bytes uploaded per frame, and the time against streaming
+	std::string ObjectConstantsUpload(unsigned int entityCount);
+}
@@ -0,0 +1,210 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Min/max of every position, four vertices per iteration
+// so the four pairs of accumulators don't wait on each other
+// --------------------------------------------------------
+Bounds::Box Bounds::ComputeBox(const Vertex* verts, size_t count)
+{
+	Box box = {};
+	if (count == 0)
+		return box;
+
+	XMVECTOR min[4], max[4];
+	for (int k = 0; k < 4; k++)
+		min[k] = max[k] = XMLoadFloat3(&verts[0].Position);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			XMVECTOR p = XMLoadFloat3(&verts[i + k].Position);
+			min[k] = XMVectorMin(min[k], p);
+			max[k] = XMVectorMax(max[k], p);
+		}
+	}
+	for (; i < count; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[i].Position);
+		min[0] = XMVectorMin(min[0], p);
+		max[0] = XMVectorMax(max[0], p);
+	}
+
+	XMStoreFloat3(&box.min, XMVectorMin(XMVectorMin(min[0], min[1]), XMVectorMin(min[2], min[3])));
+	XMStoreFloat3(&box.max, XMVectorMax(XMVectorMax(max[0], max[1]), XMVectorMax(max[2], max[3])));
+	return box;
+}
+
+// --------------------------------------------------------
+// Ritter's bounding sphere: start from the most distant pair
+// of axis-extreme points, then grow just enough to take in
+// each point that's still outside
+// --------------------------------------------------------
+Bounds::Sphere Bounds::ComputeSphere(const Vertex* verts, size_t count, const Box& box)
+{
+	Sphere sphere = {};
+	if (count == 0)
+		return sphere;
+
+	// A vertex touching each side of the box
+	size_t extremes[6] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = verts[i].Position;
+		if (p.x == box.min.x) extremes[0] = i;
+		if (p.x == box.max.x) extremes[1] = i;
+		if (p.y == box.min.y) extremes[2] = i;
+		if (p.y == box.max.y) extremes[3] = i;
+		if (p.z == box.min.z) extremes[4] = i;
+		if (p.z == box.max.z) extremes[5] = i;
+	}
+
+	// Start with the pair that's furthest apart
+	XMVECTOR a = XMVectorZero(), b = XMVectorZero();
+	float longest = -1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&verts[extremes[axis * 2]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[extremes[axis * 2 + 1]].Position);
+		float length = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p1, p0)));
+		if (length > longest)
+		{
+			longest = length;
+			a = p0;
+			b = p1;
+		}
+	}
+	XMVECTOR center = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+	float radius = std::sqrt(longest) * 0.5f;
+
+	// Grow towards anything outside, keeping the far side where it is
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&verts[i].Position), center);
+		float distance = XMVectorGetX(XMVector3Length(offset));
+		if (distance > radius)
+		{
+			float newRadius = (radius + distance) * 0.5f;
+			center = XMVectorAdd(center, XMVectorScale(offset, (newRadius - radius) / distance));
+			radius = newRadius;
+		}
+	}
+
+	// Float error in the growth can leave a point a hair outside,
+	// so measure the actual radius around the final center
+	float ritterSquared = 0.0f, boxSquared = 0.0f;
+	XMVECTOR boxCenter = XMVectorScale(XMVectorAdd(XMLoadFloat3(&box.min), XMLoadFloat3(&box.max)), 0.5f);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[i].Position);
+		ritterSquared = std::max(ritterSquared, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, center))));
+		boxSquared = std::max(boxSquared, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, boxCenter))));
+	}
+
+	// Ritter is usually tighter, but not always (e.g. a cube)
+	if (boxSquared < ritterSquared)
+	{
+		center = boxCenter;
+		ritterSquared = boxSquared;
+	}
+	XMStoreFloat3(&sphere.center, center);
+	sphere.radius = std::sqrt(ritterSquared);
+	return sphere;
+}
+
+Bounds::Box Bounds::TransformBox(const Box& box, const XMFLOAT4X4& world)
+{
+	// New center is the transformed center, and each new half
+	// extent is the old ones through the absolute 3x3 part
+	XMMATRIX m = XMLoadFloat4x4(&world);
+	XMVECTOR center = XMVectorScale(XMVectorAdd(XMLoadFloat3(&box.min), XMLoadFloat3(&box.max)), 0.5f);
+	XMVECTOR extent = XMVectorScale(XMVectorSubtract(XMLoadFloat3(&box.max), XMLoadFloat3(&box.min)), 0.5f);
+
+	center = XMVector3Transform(center, m);
+	extent = XMVectorAdd(XMVectorAdd(
+		XMVectorMultiply(XMVectorSplatX(extent), XMVectorAbs(m.r[0])),
+		XMVectorMultiply(XMVectorSplatY(extent), XMVectorAbs(m.r[1]))),
+		XMVectorMultiply(XMVectorSplatZ(extent), XMVectorAbs(m.r[2])));
+
+	Box result;
+	XMStoreFloat3(&result.min, XMVectorSubtract(center, extent));
+	XMStoreFloat3(&result.max, XMVectorAdd(center, extent));
+	return result;
+}
+
+Bounds::Sphere Bounds::TransformSphere(const Sphere& sphere, const XMFLOAT4X4& world)
+{
+	XMMATRIX m = XMLoadFloat4x4(&world);
+	float scaleSquared = std::max(XMVectorGetX(XMVector3LengthSq(m.r[0])),
+		std::max(XMVectorGetX(XMVector3LengthSq(m.r[1])), XMVectorGetX(XMVector3LengthSq(m.r[2]))));
+
+	Sphere result;
+	XMStoreFloat3(&result.center, XMVector3Transform(XMLoadFloat3(&sphere.center), m));
+	result.radius = sphere.radius * std::sqrt(scaleSquared);
+	return result;
+}
+
+bool Bounds::Overlaps(const Box& a, const Box& b)
+{
+	return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+		a.min.y <= b.max.y && a.max.y >= b.min.y &&
+		a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool Bounds::Overlaps(const Box& box, const Sphere& sphere)
+{
+	// Squared distance from the center to the nearest point in the box
+	float dx = std::max(std::max(box.min.x - sphere.center.x, 0.0f), sphere.center.x - box.max.x);
+	float dy = std::max(std::max(box.min.y - sphere.center.y, 0.0f), sphere.center.y - box.max.y);
+	float dz = std::max(std::max(box.min.z - sphere.center.z, 0.0f), sphere.center.z - box.max.z);
+	return dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius;
+}
+
+bool Bounds::Contains(const Box& outer, const Box& inner)
+{
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+// --------------------------------------------------------
+// Slab test: the ray is inside the box where it's between
+// all three pairs of planes at once
+// --------------------------------------------------------
+bool Bounds::RayIntersects(const Box& box, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, float& distance)
+{
+	const float o[3] = { origin.x, origin.y, origin.z };
+	const float d[3] = { direction.x, direction.y, direction.z };
+	const float min[3] = { box.min.x, box.min.y, box.min.z };
+	const float max[3] = { box.max.x, box.max.y, box.max.z };
+
+	float enter = 0.0f;
+	float exit = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (d[axis] == 0.0f)
+		{
+			// Parallel to this slab, so it's either always in it or never
+			if (o[axis] < min[axis] || o[axis] > max[axis])
+				return false;
+			continue;
+		}
+
+		float inverse = 1.0f / d[axis];
+		float t0 = (min[axis] - o[axis]) * inverse;
+		float t1 = (max[axis] - o[axis]) * inverse;
+		if (t0 > t1) std::swap(t0, t1);
+		enter = std::max(enter, t0);
+		exit = std::min(exit, t1);
+		if (enter > exit)
+			return false;
+	}
+
+	distance = enter;
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Bounding volumes for meshes and entities
+//
+// - ComputeBox() is a SIMD min/max over the positions
+// - ComputeSphere() is Ritter's sphere (grown from the two
+//    furthest-apart extreme points), or the sphere around the
+//    box if that happens to be smaller
+// - The Transform...() functions take local bounds to world
+//    space; both stay conservative under rotation and scale
+// --------------------------------------------------------
+namespace Bounds
+{
+	struct Box
+	{
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 max;
+	};
+
+	struct Sphere
+	{
+		DirectX::XMFLOAT3 center;
+		float radius;
+	};
+
+	Box ComputeBox(const Vertex* verts, size_t count);
+	Sphere ComputeSphere(const Vertex* verts, size_t count, const Box& box); // box from ComputeBox()
+
+	// Box around the transformed box (Arvo's method)
+	Box TransformBox(const Box& box, const DirectX::XMFLOAT4X4& world);
+
+	// Radius grows by the largest axis scale in the matrix
+	Sphere TransformSphere(const Sphere& sphere, const DirectX::XMFLOAT4X4& world);
+
+	// Overlap tests (touching counts as overlapping)
+	bool Overlaps(const Box& a, const Box& b);
+	bool Overlaps(const Box& box, const Sphere& sphere);
+	bool Contains(const Box& outer, const Box& inner);
+
+	// Where a ray enters the box (0 if it starts inside), if that's
+	// within maxDistance - direction doesn't need to be normalized,
+	// distances are in multiples of it
+	bool RayIntersects(const Box& box, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, float& distance);
+}
@@ -2,25 +2,45 @@
 #include <DirectXMath.h>
 #include "Light.h"
 
+// Once per pass, in b0 - the same for every entity drawn from a camera
 struct ExtraVertexData 
 {
-	DirectX::XMFLOAT4X4 world;
-	DirectX::XMFLOAT4X4 worldInv;
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 proj;
 
 	DirectX::XMFLOAT4X4 shadowView;
 	DirectX::XMFLOAT4X4 shadowProj;
-	
 };
 
-struct ExtraShadowData 
+// Per entity, in b1 - kept on the GPU while the entity isn't
+// moving (see ObjectConstants.h)
+struct ObjectVertexData
 {
 	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInv;
+
+	// Only read by PackedVertexShader - the mesh's bounds, to
+	// unpack quantized positions (xyz used, w is padding)
+	DirectX::XMFLOAT4 positionScale;
+	DirectX::XMFLOAT4 positionOffset;
+};
+
+// The world matrix is the entity's ObjectVertexData, in b1
+struct ExtraShadowData 
+{
 	DirectX::XMFLOAT4X4 lightView;
 	DirectX::XMFLOAT4X4 lightProj;
 };
 
+// For the instanced shaders, in b1 - b0 is the same per-pass
+// block the regular ones get, and the per-entity matrices are
+// in the instance buffer instead (see InstanceBatcher.h)
+struct InstanceBatchData
+{
+	unsigned int firstInstance; // The batch's first instance in the buffer
+	DirectX::XMFLOAT3 padding;
+};
+
 struct ExtraSkyVertexData
 {
 	DirectX::XMFLOAT4X4 view;
@@ -28,21 +48,29 @@ struct ExtraSkyVertexData
 
 };
 
+// Once per pass, in b0
 struct ExtraPixelData 
 {
-	DirectX::XMFLOAT4 colourTint;
-	
-	DirectX::XMFLOAT2 scale;
-	DirectX::XMFLOAT2 offset;
-	
 	DirectX::XMFLOAT3 worldPos;
 	float totalTime;
 
-	int IsMetal;
 	DirectX::XMFLOAT3 ambientColor; 
+	float padding;
 
 	Light lights[5]; // Array of exactly 5 lights
 
 	
 	
 };
+
+// Per entity, in b1 - its material's part
+struct ObjectPixelData
+{
+	DirectX::XMFLOAT4 colourTint;
+
+	DirectX::XMFLOAT2 scale;
+	DirectX::XMFLOAT2 offset;
+
+	int IsMetal;
+	DirectX::XMFLOAT3 padding;
+};
@@ -56,4 +56,5 @@ void Camera::Update(float dt)
 	UpdateViewMatrix();
 }
 
-DirectX::XMFLOAT3 Camera::GetPos() { return transform.GetPosition(); }
\ No newline at end of file
+DirectX::XMFLOAT3 Camera::GetPos() { return transform.GetPosition(); }
+float Camera::GetFarClip() { return farClip; }
\ No newline at end of file
@@ -12,6 +12,7 @@ public:
 	//Getters
 	DirectX::XMFLOAT4X4 GetProj(), GetView();
 	DirectX::XMFLOAT3 GetPos();
+	float GetFarClip();
 
 	void Update(float dt);
 
@@ -1,8 +1,20 @@
 #include "Entity.h"
+#include <algorithm>
+#include <cmath>
+
+// How far past the pixel error limit an LOD has to be before we
+// switch (0.25 = coarser below 75% of the limit, finer above 125%)
+const float lodHysteresis = 0.25f;
+
 Entity::Entity(std::shared_ptr<Mesh> meshIn, std::shared_ptr<Material> materialIn) 
 {
 	mesh = meshIn;
 	material = materialIn;
+	lod = 0;
+	clusterCulled = false;
+	occluder = false;
+	boundsVersion = 0;
+	boundsValid = false;
 }
 
 Transform* Entity::GetTransform() 
@@ -12,14 +24,153 @@ Transform* Entity::GetTransform()
 
 void Entity::Draw() 
 {
-	Graphics::Context->VSSetShader(material->GetVS().Get(), 0, 0);
-	Graphics::Context->PSSetShader(material->GetPS().Get(), 0, 0);
-	mesh->Draw();
+	BindShaders(nullptr);
+	DrawGeometry(false, true);
+}
+
+void Entity::DrawPacked(Microsoft::WRL::ComPtr<ID3D11VertexShader> packedVS)
+{
+	BindShaders(packedVS);
+	DrawGeometry(true, true);
+}
+
+void Entity::BindShaders(Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader)
+{
+	Graphics::State.SetVertexShader(vertexShader ? vertexShader.Get() : material->GetVS().Get());
+	Graphics::State.SetPixelShader(material->GetPS().Get());
+}
+
+void Entity::DrawGeometry(bool packed, bool bindBuffers)
+{
+	if (clusterCulled && lod == 0) { mesh->DrawRanges(visibleRanges.data(), visibleRanges.size(), packed, bindBuffers); }
+	else if (packed) { mesh->DrawPacked(lod, bindBuffers); }
+	else { mesh->Draw(lod, bindBuffers); }
 }
 
 void Entity::DrawShadow() 
 {
-	mesh->Draw();
+	mesh->DrawPositionsOnly(lod);
+}
+
+std::shared_ptr<Mesh> Entity::GetMesh()
+{
+	return mesh;
+}
+
+std::shared_ptr<Material> Entity::GetMaterial()
+{
+	return material;
+}
+
+void Entity::UpdateWorldBounds()
+{
+	if (boundsValid && boundsVersion == transform.GetVersion())
+		return;
+
+	DirectX::XMFLOAT4X4 world = transform.GetWorldMatrix();
+	worldBox = Bounds::TransformBox(mesh->GetBoundingBox(), world);
+	worldSphere = Bounds::TransformSphere(mesh->GetBoundingSphere(), world);
+	boundsVersion = transform.GetVersion();
+	boundsValid = true;
+}
+
+Bounds::Box Entity::GetWorldBoundingBox()
+{
+	UpdateWorldBounds();
+	return worldBox;
+}
+
+Bounds::Sphere Entity::GetWorldBoundingSphere()
+{
+	UpdateWorldBounds();
+	return worldSphere;
+}
+
+void Entity::SelectLod(DirectX::XMFLOAT3 cameraPos, float projectionScale, float screenHeight, float maxPixelError)
+{
+	// Bounding sphere in world space
+	DirectX::XMFLOAT3 scale = transform.GetScale();
+	float worldScale = std::max(std::fabs(scale.x), std::max(std::fabs(scale.y), std::fabs(scale.z)));
+	Bounds::Sphere sphere = GetWorldBoundingSphere();
+	DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&sphere.center);
+	float radius = sphere.radius;
+
+	// Pixels per world unit at the sphere's nearest point
+	// (inside the sphere means full detail)
+	float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(center, DirectX::XMLoadFloat3(&cameraPos)))) - radius;
+	if (distance <= 0.0f)
+	{
+		lod = 0;
+		return;
+	}
+	float pixelsPerUnit = projectionScale * screenHeight * 0.5f / distance;
+
+	// LOD errors only grow along the chain
+	auto pixelError = [&](int i) { return mesh->GetLod(i).error * worldScale * pixelsPerUnit; };
+	int coarsest = 0;
+	for (int i = 1; i < mesh->GetLodCount(); i++)
+		if (pixelError(i) <= maxPixelError * (1.0f - lodHysteresis))
+			coarsest = i;
+
+	if (coarsest > lod)
+	{
+		lod = coarsest;
+	}
+	else if (pixelError(lod) > maxPixelError * (1.0f + lodHysteresis))
+	{
+		// Too coarse now, go back to the coarsest one that's good enough
+		int finer = 0;
+		for (int i = 1; i < lod; i++)
+			if (pixelError(i) <= maxPixelError)
+				finer = i;
+		lod = finer;
+	}
+}
+
+void Entity::SetLod(int lodIndex)
+{
+	lod = std::clamp(lodIndex, 0, mesh->GetLodCount() - 1);
+}
+
+int Entity::GetLod()
+{
+	return lod;
+}
+
+void Entity::CullClusters(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 proj, DirectX::XMFLOAT3 cameraPos)
+{
+	const std::vector<Meshlets::Meshlet>& meshlets = mesh->GetMeshlets();
+	visibleRanges.clear();
+	Meshlets::Cull(meshlets.data(), meshlets.size(), transform.GetWorldMatrix(), view, proj, cameraPos, visibleRanges);
+	clusterCulled = true;
+}
+
+void Entity::ClearClusterCulling()
+{
+	clusterCulled = false;
+}
+
+int Entity::GetVisibleIndexCount()
+{
+	if (!clusterCulled || lod != 0)
+		return (int)mesh->GetLod(lod).indexCount;
+
+	int count = 0;
+	for (const Meshlets::IndexRange& range : visibleRanges)
+		count += range.indexCount;
+	return count;
+}
+
+void Entity::SetOccluder(bool isOccluder)
+{
+	if (isOccluder && !mesh->IsOccluder())
+		throw std::invalid_argument("Error: Entity's mesh has no CPU copy to draw as an occluder");
+	occluder = isOccluder;
+}
+
+bool Entity::IsOccluder()
+{
+	return occluder;
 }
 
 int Entity::GetMeshIndexCount() 
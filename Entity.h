@@ -1,6 +1,8 @@
 #pragma once
 #include <memory>
+#include <vector>
 #include "Mesh.h"
+#include "Bounds.h"
 #include "Transform.h"
 #include "Material.h"
 #include "Graphics.h"
@@ -10,7 +12,44 @@ public:
 	Entity(std::shared_ptr<Mesh> meshIn, std::shared_ptr<Material> materialIn);
 	Transform* GetTransform();
 	void Draw();
+	void DrawPacked(Microsoft::WRL::ComPtr<ID3D11VertexShader> packedVS); // Material's pixel shader, mesh's PackedVertex buffer
 	void DrawShadow();
+
+	// Draw() in two pieces, for drawing in RenderQueue order: draws that
+	// share shaders or a mesh with the one before can skip binding them
+	// - A null vertexShader means the material's own
+	void BindShaders(Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader);
+	void DrawGeometry(bool packed, bool bindBuffers);
+
+	std::shared_ptr<Mesh> GetMesh();
+	std::shared_ptr<Material> GetMaterial();
+
+	// The mesh's bounds in world space - recomputed only
+	// after the transform has changed
+	Bounds::Box GetWorldBoundingBox();
+	Bounds::Sphere GetWorldBoundingSphere();
+
+	// Picks the coarsest LOD whose error covers no more than maxPixelError
+	// pixels on screen (projectionScale is proj._22), with some hysteresis
+	// so it doesn't flicker between two LODs at the boundary
+	void SelectLod(DirectX::XMFLOAT3 cameraPos, float projectionScale, float screenHeight, float maxPixelError);
+	void SetLod(int lodIndex); // Clamped to the mesh's LODs
+	int GetLod();
+
+	// Finds which of LOD 0's meshlets may be visible from this camera,
+	// so Draw()/DrawPacked() only draw those (until ClearClusterCulling())
+	// - Only used while the entity is at LOD 0, since coarser LODs
+	//    are already cheap
+	void CullClusters(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 proj, DirectX::XMFLOAT3 cameraPos);
+	void ClearClusterCulling();
+	int GetVisibleIndexCount(); // What the next Draw() will draw
+
+	// Occluders are drawn into the CPU occlusion buffer (see
+	// OcclusionCuller.h) to hide other entities - worth it for
+	// big, solid things only, and the mesh has to have been
+	// loaded as an occluder (see MeshData)
+	void SetOccluder(bool isOccluder);
+	bool IsOccluder();
 	int GetMeshIndexCount();
 	DirectX::XMFLOAT4 GetTint();
 	DirectX::XMFLOAT2 GetScale();
@@ -22,5 +61,15 @@ private:
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
 	Transform transform;
+	int lod;
+	bool clusterCulled;
+	bool occluder;
+	std::vector<Meshlets::IndexRange> visibleRanges;
+
+	void UpdateWorldBounds();
+	Bounds::Box worldBox;
+	Bounds::Sphere worldSphere;
+	unsigned int boundsVersion; // Transform version the world bounds are from
+	bool boundsValid;
 };
 
@@ -0,0 +1,277 @@
+#include "FrustumCuller.h"
+#include <bit>
+#include <cfloat>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace FrustumCuller
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Tests 8 spheres against the 6 planes (broadcast once up front)
+		// and returns a bit per sphere that's inside all of them
+		// - The distance is summed as (x*nx + y*ny) + (z*nz + w) in
+		//    every version, so they agree to the bit with CullScalar()
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define FRUSTUM_CULLER_AVX2
+		struct Avx2Tester
+		{
+			__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+
+			Avx2Tester(const Frustum& frustum)
+			{
+				for (int p = 0; p < 6; p++)
+				{
+					planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+					planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+					planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+					planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+				}
+			}
+
+			unsigned int Test(const float* xs, const float* ys, const float* zs, const float* rs) const
+			{
+				__m256 x = _mm256_loadu_ps(xs);
+				__m256 y = _mm256_loadu_ps(ys);
+				__m256 z = _mm256_loadu_ps(zs);
+				__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(rs));
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (int p = 0; p < 6; p++)
+				{
+					__m256 distance = _mm256_add_ps(
+						_mm256_add_ps(_mm256_mul_ps(x, planeX[p]), _mm256_mul_ps(y, planeY[p])),
+						_mm256_add_ps(_mm256_mul_ps(z, planeZ[p]), planeW[p]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+				}
+				return (unsigned int)_mm256_movemask_ps(inside);
+			}
+		};
+#endif
+
+		struct SseTester
+		{
+			__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+
+			SseTester(const Frustum& frustum)
+			{
+				for (int p = 0; p < 6; p++)
+				{
+					planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+					planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+					planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+					planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+				}
+			}
+
+			// Same as the AVX2 version, as two halves of 4
+			unsigned int Test(const float* xs, const float* ys, const float* zs, const float* rs) const
+			{
+				unsigned int mask = 0;
+				for (int half = 0; half < 8; half += 4)
+				{
+					__m128 x = _mm_loadu_ps(xs + half);
+					__m128 y = _mm_loadu_ps(ys + half);
+					__m128 z = _mm_loadu_ps(zs + half);
+					__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(rs + half));
+
+					__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+					for (int p = 0; p < 6; p++)
+					{
+						__m128 distance = _mm_add_ps(
+							_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+							_mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+					}
+					mask |= (unsigned int)_mm_movemask_ps(inside) << half;
+				}
+				return mask;
+			}
+		};
+
+		// AVX2 needs the CPU to have it and the OS to save the
+		// wider registers (MSVC lets us use the intrinsics either way)
+		bool HasAvx2()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuid(info, 1);
+			bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			return osSavesAvx && (info[1] & (1 << 5));
+#elif defined(__AVX2__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		const bool useAvx2 = HasAvx2();
+
+		template<typename Tester>
+		size_t CullBatches(const Frustum& frustum, const SphereList& spheres, std::vector<unsigned int>& visible)
+		{
+			size_t count = spheres.Count();
+			visible.resize(count);
+			unsigned int* out = visible.data();
+			size_t visibleCount = 0;
+
+			Tester tester(frustum);
+			for (size_t i = 0; i < count; i += 8)
+			{
+				unsigned int mask = tester.Test(spheres.X() + i, spheres.Y() + i, spheres.Z() + i, spheres.Radius() + i);
+
+				// The padding at the end of the last batch isn't real
+				if (count - i < 8)
+					mask &= (1u << (count - i)) - 1;
+
+				while (mask)
+				{
+					out[visibleCount++] = (unsigned int)i + std::countr_zero(mask);
+					mask &= mask - 1;
+				}
+			}
+
+			visible.resize(visibleCount);
+			return visibleCount;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Gribb & Hartmann: with row vectors, clip = v * M, so each
+// plane is a sum/difference of M's columns (D3D's z goes 0 to w)
+// --------------------------------------------------------
+FrustumCuller::Frustum FrustumCuller::ExtractPlanes(const XMFLOAT4X4& m)
+{
+	XMVECTOR columns[4] =
+	{
+		XMVectorSet(m._11, m._21, m._31, m._41),
+		XMVectorSet(m._12, m._22, m._32, m._42),
+		XMVectorSet(m._13, m._23, m._33, m._43),
+		XMVectorSet(m._14, m._24, m._34, m._44),
+	};
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(columns[3], columns[0]),		// Left
+		XMVectorSubtract(columns[3], columns[0]),	// Right
+		XMVectorAdd(columns[3], columns[1]),		// Bottom
+		XMVectorSubtract(columns[3], columns[1]),	// Top
+		columns[2],									// Near
+		XMVectorSubtract(columns[3], columns[2]),	// Far
+	};
+
+	Frustum frustum;
+	for (int p = 0; p < 6; p++)
+		XMStoreFloat4(&frustum.planes[p], XMPlaneNormalize(planes[p]));
+	return frustum;
+}
+
+FrustumCuller::Frustum FrustumCuller::FromCamera(const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj)));
+	return ExtractPlanes(viewProj);
+}
+
+void FrustumCuller::RemovePlane(Frustum& frustum, Plane plane)
+{
+	// No direction, and every distance is huge
+	frustum.planes[plane] = XMFLOAT4(0.0f, 0.0f, 0.0f, FLT_MAX);
+}
+
+FrustumCuller::Containment FrustumCuller::ClassifyBox(const Frustum& frustum, const Bounds::Box& box)
+{
+	Containment result = Inside;
+	for (int p = 0; p < 6; p++)
+	{
+		// The corners furthest along the plane's normal and against it
+		const XMFLOAT4& plane = frustum.planes[p];
+		float farX = plane.x >= 0.0f ? box.max.x : box.min.x, nearX = plane.x >= 0.0f ? box.min.x : box.max.x;
+		float farY = plane.y >= 0.0f ? box.max.y : box.min.y, nearY = plane.y >= 0.0f ? box.min.y : box.max.y;
+		float farZ = plane.z >= 0.0f ? box.max.z : box.min.z, nearZ = plane.z >= 0.0f ? box.min.z : box.max.z;
+
+		if ((farX * plane.x + farY * plane.y) + (farZ * plane.z + plane.w) < 0.0f)
+			return Outside;
+		if ((nearX * plane.x + nearY * plane.y) + (nearZ * plane.z + plane.w) < 0.0f)
+			result = Intersecting;
+	}
+	return result;
+}
+
+FrustumCuller::SphereList::SphereList() : count(0) {}
+
+void FrustumCuller::SphereList::Clear()
+{
+	x.clear(); y.clear(); z.clear(); radius.clear();
+	count = 0;
+}
+
+void FrustumCuller::SphereList::Add(const Bounds::Sphere& sphere)
+{
+	// Grow a whole batch at a time, so Cull() never reads past the end
+	if (count % 8 == 0)
+	{
+		x.resize(count + 8, 0.0f);
+		y.resize(count + 8, 0.0f);
+		z.resize(count + 8, 0.0f);
+		radius.resize(count + 8, 0.0f);
+	}
+	x[count] = sphere.center.x;
+	y[count] = sphere.center.y;
+	z[count] = sphere.center.z;
+	radius[count] = sphere.radius;
+	count++;
+}
+
+size_t FrustumCuller::SphereList::Count() const { return count; }
+const float* FrustumCuller::SphereList::X() const { return x.data(); }
+const float* FrustumCuller::SphereList::Y() const { return y.data(); }
+const float* FrustumCuller::SphereList::Z() const { return z.data(); }
+const float* FrustumCuller::SphereList::Radius() const { return radius.data(); }
+
+// --------------------------------------------------------
+// 8 spheres at a time against all 6 planes, then the bits
+// of the inside mask become indices in visible (the AVX2 or
+// SSE tester, whichever this CPU can run)
+// --------------------------------------------------------
+size_t FrustumCuller::Cull(const Frustum& frustum, const SphereList& spheres, std::vector<unsigned int>& visible)
+{
+#if defined(FRUSTUM_CULLER_AVX2)
+	if (useAvx2)
+		return CullBatches<Avx2Tester>(frustum, spheres, visible);
+#endif
+	return CullBatches<SseTester>(frustum, spheres, visible);
+}
+
+size_t FrustumCuller::CullScalar(const Frustum& frustum, const SphereList& spheres, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	for (size_t i = 0; i < spheres.Count(); i++)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			const XMFLOAT4& plane = frustum.planes[p];
+			float distance = (spheres.X()[i] * plane.x + spheres.Y()[i] * plane.y) + (spheres.Z()[i] * plane.z + plane.w);
+			inside = distance >= -spheres.Radius()[i];
+		}
+		if (inside)
+			visible.push_back((unsigned int)i);
+	}
+	return visible.size();
+}
+
+const char* FrustumCuller::InstructionSet()
+{
+	return useAvx2 ? "AVX2" : "SSE";
+}
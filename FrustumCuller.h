@@ -0,0 +1,66 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Bounds.h"
+
+// --------------------------------------------------------
+// Frustum culling for lots of bounding spheres at once
+//
+// - Spheres are kept as structure-of-arrays (x[], y[], z[],
+//    radius[]) so 8 of them can be tested per plane at once
+// - Cull() uses AVX2 when the CPU has it (checked once at
+//    startup), otherwise two SSE halves per batch of 8
+// - CullScalar() is the plain version, for checking against
+// --------------------------------------------------------
+namespace FrustumCuller
+{
+	// Planes point inwards: a point p is inside a plane
+	// when dot(plane.xyz, p) + plane.w >= 0
+	struct Frustum
+	{
+		DirectX::XMFLOAT4 planes[6];
+	};
+	enum Plane { Left, Right, Bottom, Top, Near, Far };
+
+	// Left, right, bottom, top, near, far planes of a (row-vector)
+	// matrix - view * proj gives world-space planes, and
+	// world * view * proj gives object-space ones
+	Frustum ExtractPlanes(const DirectX::XMFLOAT4X4& matrix);
+	Frustum FromCamera(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+
+	// Makes one plane pass everything, e.g. dropping a light's near
+	// plane so casters between it and the light aren't culled
+	void RemovePlane(Frustum& frustum, Plane plane);
+
+	// Single box test, for tree traversals (see SceneIndex) - Inside
+	// means every point of the box is inside, so nothing under it
+	// needs testing
+	enum Containment { Outside, Intersecting, Inside };
+	Containment ClassifyBox(const Frustum& frustum, const Bounds::Box& box);
+
+	// World-space spheres, padded to a multiple of 8 entries
+	class SphereList
+	{
+	public:
+		SphereList();
+		void Clear();
+		void Add(const Bounds::Sphere& sphere);
+		size_t Count() const;
+
+		const float* X() const;
+		const float* Y() const;
+		const float* Z() const;
+		const float* Radius() const;
+
+	private:
+		std::vector<float> x, y, z, radius;
+		size_t count;
+	};
+
+	// Clears visible, then fills it with the index of every sphere that
+	// touches the frustum, in order, and returns how many there were
+	size_t Cull(const Frustum& frustum, const SphereList& spheres, std::vector<unsigned int>& visible);
+	size_t CullScalar(const Frustum& frustum, const SphereList& spheres, std::vector<unsigned int>& visible);
+
+	const char* InstructionSet(); // Which one Cull() is using
+}
@@ -8,6 +8,17 @@
 #include "BufferStructs.h"
 #include "Camera.h"
 #include "Material.h"
+#include "Benchmarks.h"
+#include "AssetLoader.h"
+#include "FrustumCuller.h"
+#include "SceneIndex.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "TransformHierarchy.h"
+#include "TransformSystem.h"
+#include "ObjectConstants.h"
+#include "InstanceSlots.h"
+#include <algorithm>
 #include <WICTextureLoader.h>
 #include <DirectXMath.h>
 
@@ -46,12 +57,54 @@ int cameraChoice = 0;
 bool displaySkybox = true;
 int shadowMapResolution = 1024;
 int blurRadius = 0;
+int objBenchmarkMillions = 50;
+std::string benchmarkResults;
+std::string assetLoadReport;
+const bool usePackedVertices = false; // Chosen at load - meshes only get the vertex stream they're drawn with
+float lodPixelError = 1.0f;
+int forcedLod = -1;
+bool useClusterCulling = false;
+bool useFrustumCulling = true;
+FrustumCuller::SphereList entityBounds;
+std::vector<unsigned int> visibleEntities; // Indices into entityList, rebuilt every frame
+bool useShadowCasterCulling = true;
+std::vector<unsigned int> shadowCasters; // Same, for the shadow map
+bool useSceneIndex = true; // Cull with the BVH instead of testing every entity's sphere
+SceneIndex sceneIndex(0.25f);
+std::vector<int> entityProxies; // Each entity's leaf in sceneIndex
+int hoveredEntity = -1;
+bool useOcclusionCulling = true;
+OcclusionCuller occlusionCuller;
+std::vector<unsigned int> occluderEntities; // Visible occluders, nearest first
+std::vector<Bounds::Box> entityBoxes; // World bounds of every entity, for the occlusion test
+size_t occludedEntities = 0;
+bool useRenderQueue = true; // Draw in sorted key order, skipping binds the last draw already did
+RenderQueue renderQueue;
+RenderQueue::IdMap shaderIds, materialIds, meshIds;
+int shaderBinds = 0, materialBinds = 0, bufferBinds = 0; // Last frame's main pass
+bool useInstancing = true; // One draw call per mesh/material/LOD (not with packed vertices or cluster culling)
+InstanceBatcher instanceBatcher, shadowBatcher;
+std::vector<size_t> unbatchedItems; // Queue positions the instanced pass draws one by one
+int instancedDraws = 0, shadowDraws = 0; // Last frame's draw calls, with instancing
+StateCache::Stats stateStats = {}; // Last frame's binds, through Graphics::State
+bool useNullBackend = false; // Run frames on the CPU only - nothing but the UI reaches the GPU
+NullBackend nullBackend;
+TransformHierarchy transformHierarchy; // Every entity's transform - world matrices are updated once a frame, in Update()
+TransformSystem transformSystem; // The same entities' matrices, rebuilt in SIMD batches - what the draw loop uploads
+std::vector<TransformSystem::Handle> transformHandles; // By entityList index
+std::vector<unsigned int> transformVersions; // Transform version each handle was last given
+ObjectConstants objectConstants; // Each entity's b1 constants, by entityList index - only uploaded when its transform or material changes
+ObjectConstants::Stats objectConstantStats = {}; // Last frame's
+InstanceSlots instanceSlots; // The same for the instanced passes - each entity's instance, by entityList index
+InstanceSlots::Stats instanceSlotStats = {}; // Last frame's
+unsigned long long constantBytesUploaded = 0; // Last frame's, everything that went through the backend
+bool spinEntities = true; // Off leaves the scene static, so entity constants stay on the GPU
 
 // --------------------------------------------------------
 // The constructor is called after the window and graphics API
 // are initialized but before the game loop begins
 // --------------------------------------------------------
-Game::Game()
+Game::Game(bool headless) : headless(headless)
 {
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
@@ -60,6 +113,7 @@ Game::Game()
 	CreateShadowMap();
 	CreateBlurResources();
 	Initialize(); //Initialize ImGui
+	useNullBackend = useNullBackend || headless;
 	camera = std::make_shared<Camera>(10.0f, 0.0f, -30.0f, Window::AspectRatio());
 	secondCamera = std::make_shared<Camera>(0.0f, 0.0f, -10.0f, Window::AspectRatio());
 	
@@ -77,7 +131,7 @@ Game::Game()
 		// Ensure the pipeline knows how to interpret all the numbers stored in
 		// the vertex buffer. For this course, all of your vertices will probably
 		// have the same layout, so we can just set this once at startup.
-		Graphics::Context->IASetInputLayout(vertexInputLayout.Get());
+		Graphics::State.SetInputLayout(vertexInputLayout.Get());
 		
 	}
 }
@@ -91,6 +145,9 @@ Game::Game()
 // --------------------------------------------------------
 Game::~Game()
 {
+	if (headless)
+		return;
+
 	// ImGui clean up
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
@@ -99,6 +156,10 @@ Game::~Game()
 
 void Game::Initialize() 
 {
+	Game::showDemo = false;
+	if (headless)
+		return;
+
 	// Initialize ImGui itself & platform/renderer backends
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -108,7 +169,6 @@ void Game::Initialize()
 	ImGui::StyleColorsDark();
 	//ImGui::StyleColorsLight();
 	//ImGui::StyleColorsClassic();
-	Game::showDemo = false;
 
 	
 	
@@ -149,6 +209,48 @@ void Game::RefreshUI()
 
 		ImGui::Text("Window Client Size: %ix%i", Window::Width(), Window::Height());
 
+		ImGui::Checkbox("Frustum culling", &useFrustumCulling);
+		ImGui::Text("Entities: %d visible, %d culled (%s)", (int)visibleEntities.size(),
+			(int)(entityList.size() - visibleEntities.size()), FrustumCuller::InstructionSet());
+		ImGui::Checkbox("Shadow caster culling", &useShadowCasterCulling);
+		ImGui::Text("Shadow casters: %d of %d", (int)shadowCasters.size(), (int)entityList.size());
+		ImGui::Checkbox("Cull with scene BVH", &useSceneIndex);
+		ImGui::Text("Scene BVH: %d entities, height %d", sceneIndex.GetCount(), sceneIndex.GetHeight());
+		ImGui::Text("Transforms updated: %u of %u", transformHierarchy.GetUpdatedCount(), transformHierarchy.GetCount());
+		ImGui::Text("Matrices rebuilt: %u (%s)", transformSystem.GetUpdatedCount(), TransformSystem::InstructionSet());
+		ImGui::Text("Entity under mouse: %d", hoveredEntity);
+		ImGui::Checkbox("Occlusion culling (CPU)", &useOcclusionCulling);
+		{
+			OcclusionCuller::Stats occlusion = occlusionCuller.GetStats();
+			ImGui::Text("Occluded: %d of %d tested (%.0f%%), %d occluder triangles",
+				(int)occlusion.culled, (int)occlusion.tested,
+				occlusion.tested > 0 ? 100.0 * occlusion.culled / occlusion.tested : 0.0, (int)occlusion.rasterizedTriangles);
+			ImGui::Text("Occlusion time: raster %.3f ms, test %.3f ms", occlusion.rasterizeMilliseconds, occlusion.testMilliseconds);
+		}
+		ImGui::Checkbox("Sorted render queue", &useRenderQueue);
+		ImGui::Text("Draws: %d, binds: %d shader, %d material, %d buffer", (int)renderQueue.Count(), shaderBinds, materialBinds, bufferBinds);
+		ImGui::Checkbox("Hardware instancing", &useInstancing);
+		ImGui::Text("Draw calls: %d main, %d shadow", instancedDraws, shadowDraws);
+		ImGui::Text("State calls: %u submitted, %u elided", stateStats.submitted, stateStats.Elided());
+		ImGui::Checkbox("Spin entities", &spinEntities);
+		ImGui::Text("Constants and instances uploaded: %.1f KB per frame", constantBytesUploaded / 1024.0);
+		ImGui::Text("D3D11.1 constant buffer offsetting: %s, partial updates: %s",
+			Graphics::ConstantBufferOffsetting ? "yes" : "no (a buffer per slot)",
+			Graphics::ConstantBufferPartialUpdate ? "yes" : "no (a buffer per block)");
+		ImGui::Text("Entity constants: %u already on the GPU, %u written to blocks, %u streamed",
+			objectConstantStats.persistentBinds, objectConstantStats.persistentUploads, objectConstantStats.streamedUploads);
+		ImGui::Text("Entity instances: %u already on the GPU, %u written (in %u copies)",
+			instanceSlotStats.current, instanceSlotStats.written, instanceSlotStats.copies);
+		ImGui::Checkbox("Null backend (CPU only)", &useNullBackend);
+		if (useNullBackend)
+		{
+			ImGui::Text("Null backend: %u calls, %u draws, %llu triangles, %u errors", nullBackend.GetTotalCount(),
+				nullBackend.GetCount(NullBackend::DrawCall) + nullBackend.GetCount(NullBackend::DrawIndexedCall) + nullBackend.GetCount(NullBackend::DrawIndexedInstancedCall),
+				nullBackend.GetTriangleCount(), nullBackend.GetErrorCount());
+			if (!nullBackend.GetErrors().empty())
+				ImGui::TextUnformatted(nullBackend.GetErrors()[0].c_str());
+		}
+
 		ImGui::ColorEdit4("RGBA color editor", &lightsColorIntensity[5*4+4]);
 
 		// Feature 2 - Drag and change
@@ -274,6 +376,119 @@ void Game::RefreshUI()
 	}
 	
 
+	if (ImGui::TreeNode("Asset Loading"))
+	{
+		ImGui::TextWrapped("%s", assetLoadReport.c_str());
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Meshes"))
+	{
+		const char* meshNames[] = { "Cube", "Cylinder", "Helix", "Quad", "Double-Sided Quad", "Sphere", "Torus" };
+		std::shared_ptr<Mesh> meshes[] = { cubeMesh, cylinderMesh, helixMesh, quadMesh, quadDoubleMesh, sphereMesh, torusMesh };
+		for (int i = 0; i < 7; i++)
+		{
+			int before = meshes[i]->GetSourceVertexCount();
+			int after = meshes[i]->GetVertexCount();
+			ImGui::Text("%s: %d -> %d verts (%.1fx fewer), %d indices",
+				meshNames[i], before, after, (float)before / after, meshes[i]->GetIndexCount());
+
+			MeshOptimizer::CacheStats source = meshes[i]->GetSourceCacheStats();
+			MeshOptimizer::CacheStats optimized = meshes[i]->GetCacheStats();
+			ImGui::Text("    ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+				source.acmr, optimized.acmr, source.atvr, optimized.atvr);
+
+			ImGui::Text("    Vertex streams: full %.1f KB, positions %.1f KB, packed %.1f KB",
+				meshes[i]->GetVertexBufferBytes() / 1024.0f, meshes[i]->GetPositionBufferBytes() / 1024.0f,
+				meshes[i]->GetPackedVertexBufferBytes() / 1024.0f);
+
+			Bounds::Box box = meshes[i]->GetBoundingBox();
+			Bounds::Sphere sphere = meshes[i]->GetBoundingSphere();
+			ImGui::Text("    Bounds: box %.2f x %.2f x %.2f, sphere radius %.3f at (%.2f, %.2f, %.2f)",
+				box.max.x - box.min.x, box.max.y - box.min.y, box.max.z - box.min.z,
+				sphere.radius, sphere.center.x, sphere.center.y, sphere.center.z);
+
+			VertexCodec::ErrorStats packedError = meshes[i]->GetPackedError();
+			ImGui::Text("    Packed error: pos %.2g, normal %.3f deg, tangent %.3f deg, uv %.2g",
+				packedError.maxPositionError, packedError.maxNormalDegrees, packedError.maxTangentDegrees, packedError.maxUVError);
+
+			// Triangles and error of each LOD
+			std::string lodText = "    LODs:";
+			for (int l = 0; l < meshes[i]->GetLodCount(); l++)
+			{
+				MeshSimplifier::Lod lod = meshes[i]->GetLod(l);
+				char lodLine[48];
+				snprintf(lodLine, sizeof(lodLine), " %u tris (%.3g)", lod.indexCount / 3, lod.error);
+				lodText += lodLine;
+			}
+			ImGui::TextUnformatted(lodText.c_str());
+		}
+		ImGui::Text("Vertex stream: %s (chosen at load)", usePackedVertices ? "packed" : "full");
+		ImGui::DragFloat("LOD pixel error", &lodPixelError, 0.05f, 0.1f, 50.0f);
+		ImGui::SliderInt("Force LOD (-1 = auto)", &forcedLod, -1, MeshSimplifier::MaxLods - 1);
+
+		std::string entityLods = "Entity LODs:";
+		for (int i = 0; i < entityList.size(); i++)
+			entityLods += " " + std::to_string(entityList[i].GetLod());
+		ImGui::TextUnformatted(entityLods.c_str());
+
+		// Triangles actually drawn, after frustum culling, LODs and cluster culling
+		ImGui::Checkbox("Cluster culling (LOD 0 only)", &useClusterCulling);
+		int drawnTriangles = 0, fullTriangles = 0;
+		for (int i = 0; i < entityList.size(); i++)
+			fullTriangles += entityList[i].GetMeshIndexCount() / 3;
+		for (unsigned int i : visibleEntities)
+			drawnTriangles += entityList[i].GetVisibleIndexCount() / 3;
+		ImGui::Text("Triangles drawn: %d of %d", drawnTriangles, fullTriangles);
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Benchmarks"))
+	{
+		ImGui::DragInt("OBJ Triangles (millions)", &objBenchmarkMillions, 0.2f, 1, 100, "%d", ImGuiSliderFlags_None);
+		if (ImGui::Button("Run OBJ Parse Benchmark"))
+			benchmarkResults = Benchmarks::ObjParse(objBenchmarkMillions * 1000000u);
+		if (ImGui::Button("Run OBJ Thread Scaling Benchmark"))
+			benchmarkResults = Benchmarks::ObjParseScaling(objBenchmarkMillions * 1000000u);
+		if (ImGui::Button("Run Vertex Cache Benchmark"))
+			benchmarkResults = Benchmarks::VertexCache(1000000);
+		if (ImGui::Button("Run Mesh Load Benchmark"))
+			benchmarkResults = Benchmarks::MeshLoad();
+		if (ImGui::Button("Run Tangent Benchmark"))
+			benchmarkResults = Benchmarks::TangentCalculation(4000000);
+		if (ImGui::Button("Run Vertex Packing Benchmark"))
+			benchmarkResults = Benchmarks::VertexPacking(4000000);
+		if (ImGui::Button("Run Simplifier Benchmark"))
+			benchmarkResults = Benchmarks::Simplification();
+		if (ImGui::Button("Run Cluster Culling Benchmark"))
+			benchmarkResults = Benchmarks::ClusterCulling(1000000);
+		if (ImGui::Button("Run Frustum Culling Benchmark"))
+			benchmarkResults = Benchmarks::FrustumCulling(100000);
+		if (ImGui::Button("Run Scene Index Benchmark"))
+			benchmarkResults = Benchmarks::SceneIndexScaling(1000000, 10000);
+		if (ImGui::Button("Run Occlusion Culling Benchmark"))
+			benchmarkResults = Benchmarks::OcclusionCulling(100000);
+		if (ImGui::Button("Run Render Queue Benchmark"))
+			benchmarkResults = Benchmarks::RenderQueueSort(100000);
+		if (ImGui::Button("Run Instancing Benchmark"))
+			benchmarkResults = Benchmarks::InstanceBatching(100000);
+		if (ImGui::Button("Run State Cache Benchmark"))
+			benchmarkResults = Benchmarks::StateCacheCalls(100000);
+		if (ImGui::Button("Run Transform Hierarchy Benchmark"))
+			benchmarkResults = Benchmarks::TransformHierarchyUpdate(1000000);
+		if (ImGui::Button("Run Transform System Benchmark"))
+			benchmarkResults = Benchmarks::TransformSystemBuild(1000000);
+		if (ImGui::Button("Run Quaternion Rotation Benchmark"))
+			benchmarkResults = Benchmarks::QuaternionRotation(100000);
+		if (ImGui::Button("Run Inverse-Transpose Benchmark"))
+			benchmarkResults = Benchmarks::InverseTranspose(1000000);
+		if (ImGui::Button("Run Object Constants Benchmark"))
+			benchmarkResults = Benchmarks::ObjectConstantsUpload(20000);
+
+		ImGui::TextWrapped("%s", benchmarkResults.c_str());
+		ImGui::TreePop();
+	}
+
 	const char* visibility = "Hide ImGui Demo Window";
 
 	if (!Game::showDemo)
@@ -401,6 +616,97 @@ void Game::LoadPPVertexShader(std::wstring path)
 	}
 }
 
+void Game::LoadPackedVertexShader(std::wstring path)
+{
+	vertexShaders.push_back(Microsoft::WRL::ComPtr<ID3D11VertexShader>());
+	ID3DBlob* vertexShaderBlob;
+
+	D3DReadFileToBlob(path.c_str(), &vertexShaderBlob);
+
+	Graphics::Device->CreateVertexShader(
+		vertexShaderBlob->GetBufferPointer(),
+		vertexShaderBlob->GetBufferSize(),
+		0,
+		vertexShaders[vertexShaders.size() - 1].GetAddressOf());
+
+	// Input layout for PackedVertex (Vertex.h)
+	//  - Same semantics as the regular layout, but the formats do the
+	//     unpacking: UNORM/SNORM become 0-1/-1-1 floats, halves become floats
+	{
+		D3D11_INPUT_ELEMENT_DESC inputElements[4] = {};
+
+		// Position - 4 unsigned 16-bit fractions of the mesh's bounds (w unused)
+		inputElements[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+		inputElements[0].SemanticName = "POSITION";
+		inputElements[0].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+		// UV - 2 half floats
+		inputElements[1].Format = DXGI_FORMAT_R16G16_FLOAT;
+		inputElements[1].SemanticName = "TEXCOORD";
+		inputElements[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+		// Normal - octahedral, 2 signed 16-bit fractions
+		inputElements[2].Format = DXGI_FORMAT_R16G16_SNORM;
+		inputElements[2].SemanticName = "NORMAL";
+		inputElements[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+		// Tangent - octahedral, same as the normal
+		inputElements[3].Format = DXGI_FORMAT_R16G16_SNORM;
+		inputElements[3].SemanticName = "TANGENT";
+		inputElements[3].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+		Graphics::Device->CreateInputLayout(
+			inputElements,
+			4,
+			vertexShaderBlob->GetBufferPointer(),
+			vertexShaderBlob->GetBufferSize(),
+			packedInputLayout.GetAddressOf());
+	}
+}
+
+void Game::LoadPositionVertexShader(std::wstring path)
+{
+	vertexShaders.push_back(Microsoft::WRL::ComPtr<ID3D11VertexShader>());
+	ID3DBlob* vertexShaderBlob;
+
+	D3DReadFileToBlob(path.c_str(), &vertexShaderBlob);
+
+	Graphics::Device->CreateVertexShader(
+		vertexShaderBlob->GetBufferPointer(),
+		vertexShaderBlob->GetBufferSize(),
+		0,
+		vertexShaders[vertexShaders.size() - 1].GetAddressOf());
+
+	// Input layout for Mesh's position buffer - one float3, nothing else
+	{
+		D3D11_INPUT_ELEMENT_DESC inputElements[1] = {};
+		inputElements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		inputElements[0].SemanticName = "POSITION";
+		inputElements[0].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+		Graphics::Device->CreateInputLayout(
+			inputElements,
+			1,
+			vertexShaderBlob->GetBufferPointer(),
+			vertexShaderBlob->GetBufferSize(),
+			positionInputLayout.GetAddressOf());
+	}
+}
+
+void Game::LoadInstancedVertexShader(std::wstring path)
+{
+	vertexShaders.push_back(Microsoft::WRL::ComPtr<ID3D11VertexShader>());
+	ID3DBlob* vertexShaderBlob;
+
+	D3DReadFileToBlob(path.c_str(), &vertexShaderBlob);
+
+	Graphics::Device->CreateVertexShader(
+		vertexShaderBlob->GetBufferPointer(),
+		vertexShaderBlob->GetBufferSize(),
+		0,
+		vertexShaders[vertexShaders.size() - 1].GetAddressOf());
+}
+
 void Game::LoadPixelShader(std::wstring path) 
 {
 	pixelShaders.push_back(Microsoft::WRL::ComPtr<ID3D11PixelShader>());
@@ -431,35 +737,87 @@ void Game::CreateGeometry()
 		metallicMetal, nonMetal;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
 
-	//  -- TEXTURES -- 
+	// -- LOADING ASSETS --
+	// Images are decoded and meshes imported on worker threads, then
+	// the D3D resources are created here (see AssetLoader)
+	AssetLoader loader;
+	unsigned int skyCubemap, skyMesh;
 	{
-		
-		// Load textures as SRVs
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/amal_k_brick.png").c_str(), nullptr, brick.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/charloette_b_volcanic_herringbone.png").c_str(), nullptr, volcanic.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/charloette_b_crosswalk.png").c_str(), nullptr, crosswalk.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/rocks22.png").c_str(), nullptr, rocks.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/metallic.png").c_str(), nullptr, metallic.GetAddressOf());
-
-		// Load Normal Maps as SRVs
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/amal_k_brick_normal.png").c_str(), nullptr, brickNormal.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/charloette_b_volcanic_herringbone_normal.png").c_str(), nullptr, volcanicNormal.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/charloette_b_crosswalk_normal.png").c_str(), nullptr, crosswalkNormal.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/rocks22_normal.png").c_str(), nullptr, rocksNormal.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/metallic_normal.png").c_str(), nullptr, metallicNormal.GetAddressOf());
-
-		// Load Roughness Maps as SRVs
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/amal_k_brick_roughness.png").c_str(), nullptr, brickRough.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/charloette_b_volcanic_herringbone_roughness.png").c_str(), nullptr, volcanicRough.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/charloette_b_crosswalk_roughness.png").c_str(), nullptr, crosswalkRough.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/rocks22_roughness.png").c_str(), nullptr, rocksRough.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/metallic_roughness.png").c_str(), nullptr, metallicRough.GetAddressOf());
-
-		// Load Metalness Maps as SRVs
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/metallic_metalness.png").c_str(), nullptr, metallicMetal.GetAddressOf());
-		CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(), FixPath(L"../../Assets/Textures/no_metalness.png").c_str(), nullptr, nonMetal.GetAddressOf());
+		struct TextureFile { Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>* srv; const wchar_t* file; };
+		TextureFile textureFiles[] =
+		{
+			// Albedo
+			{ &brick, L"amal_k_brick.png" },
+			{ &volcanic, L"charloette_b_volcanic_herringbone.png" },
+			{ &crosswalk, L"charloette_b_crosswalk.png" },
+			{ &rocks, L"rocks22.png" },
+			{ &metallic, L"metallic.png" },
+
+			// Normal maps
+			{ &brickNormal, L"amal_k_brick_normal.png" },
+			{ &volcanicNormal, L"charloette_b_volcanic_herringbone_normal.png" },
+			{ &crosswalkNormal, L"charloette_b_crosswalk_normal.png" },
+			{ &rocksNormal, L"rocks22_normal.png" },
+			{ &metallicNormal, L"metallic_normal.png" },
+
+			// Roughness maps
+			{ &brickRough, L"amal_k_brick_roughness.png" },
+			{ &volcanicRough, L"charloette_b_volcanic_herringbone_roughness.png" },
+			{ &crosswalkRough, L"charloette_b_crosswalk_roughness.png" },
+			{ &rocksRough, L"rocks22_roughness.png" },
+			{ &metallicRough, L"metallic_roughness.png" },
+
+			// Metalness maps
+			{ &metallicMetal, L"metallic_metalness.png" },
+			{ &nonMetal, L"no_metalness.png" },
+		};
+
+		// Our assets repeat some uv/normal values under different indices,
+		// so also merge verts that are (practically) identical
+		const float weldEpsilon = 0.00001f;
+		// Only meshes that entities use as occluders (see below)
+		// keep a CPU copy of their triangles, and only the ones
+		// entities use at all get a position stream for the shadow map
+		struct ObjFile { std::shared_ptr<Mesh>* mesh; const char* file; bool occluder; bool shadowCaster; };
+		ObjFile meshFiles[] =
+		{
+			{ &cubeMesh, "cube.ggp_obj", true, true },
+			{ &cylinderMesh, "cylinder.ggp_obj", true, true },
+			{ &helixMesh, "helix.ggp_obj", false, true },
+			{ &quadMesh, "quad.ggp_obj", false, false },
+			{ &quadDoubleMesh, "quad_double_sided.ggp_obj", true, true },
+			{ &sphereMesh, "sphere.ggp_obj", true, true },
+			{ &torusMesh, "torus.ggp_obj", true, true },
+		};
 
+		std::vector<unsigned int> textureIds, meshIds;
+		for (TextureFile& t : textureFiles)
+			textureIds.push_back(loader.AddTexture(FixPath(std::wstring(L"../../Assets/Textures/") + t.file)));
+		for (ObjFile& m : meshFiles)
+			meshIds.push_back(loader.AddMesh(FixPath(std::string("../../Assets/Meshes/") + m.file), weldEpsilon, m.occluder, usePackedVertices, m.shadowCaster));
+
+		// The sky draws its cube with the full Vertex layout, so it needs
+		// a copy of its own when the rest are packed
+		skyMesh = usePackedVertices ? loader.AddMesh(FixPath("../../Assets/Meshes/cube.ggp_obj"), weldEpsilon) : meshIds[0];
+		skyCubemap = loader.AddCubemap(
+			FixPath(L"../../Assets/Textures/clouds_pink/right.png"),
+			FixPath(L"../../Assets/Textures/clouds_pink/left.png"),
+			FixPath(L"../../Assets/Textures/clouds_pink/up.png"),
+			FixPath(L"../../Assets/Textures/clouds_pink/down.png"),
+			FixPath(L"../../Assets/Textures/clouds_pink/front.png"),
+			FixPath(L"../../Assets/Textures/clouds_pink/back.png"));
+
+		loader.LoadAll();
+		assetLoadReport = loader.GetReport();
+
+		for (size_t i = 0; i < textureIds.size(); i++)
+			*textureFiles[i].srv = loader.GetTexture(textureIds[i]);
+		for (size_t i = 0; i < meshIds.size(); i++)
+			*meshFiles[i].mesh = loader.GetMesh(meshIds[i]);
+	}
 
+	//  -- TEXTURE SAMPLER -- 
+	{
 		// Once the textures have been loaded, create a sampler state(ID3D11SamplerState) and its description (ID3D11SamplerStateDesc)
 
 		
@@ -481,8 +839,11 @@ void Game::CreateGeometry()
 	// Load shaders, create materials
 	{
 		LoadVertexShader(FixPath(L"VertexShader.cso"));
-		LoadVertexShader(FixPath(L"ShadowMapVertex.cso"));
+		LoadPositionVertexShader(FixPath(L"ShadowMapVertex.cso")); // 1
 		LoadPPVertexShader(FixPath(L"PostProcessVertex.cso")); // 2
+		LoadPackedVertexShader(FixPath(L"PackedVertexShader.cso")); // 3
+		LoadInstancedVertexShader(FixPath(L"InstancedVertexShader.cso")); // 4
+		LoadInstancedVertexShader(FixPath(L"InstancedShadowVertex.cso")); // 5
 
 		LoadPixelShader(FixPath(L"PixelShader.cso"));
 		LoadPixelShader(FixPath(L"DebugUVs.cso"));
@@ -614,44 +975,8 @@ void Game::CreateGeometry()
 		}
 	}
 
-
-	// Create the buffers to feed external data to the GPU
-	{
-		// 1. Define the constant buffer description - eData(external Data), eb(external data buffer)
-		unsigned int eDataSize = ((sizeof(ExtraVertexData) + 15) / 16) * 16;
-		D3D11_BUFFER_DESC eb = {};
-		eb.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		eb.ByteWidth = eDataSize;
-		eb.Usage = D3D11_USAGE_DYNAMIC;
-		eb.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
-		eb.MiscFlags = 0;
-		eb.StructureByteStride = 0;
-
-		unsigned int pDataSize = ((sizeof(ExtraPixelData) + 15) / 16) * 16;
-		D3D11_BUFFER_DESC p = {};
-		p.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		p.ByteWidth = pDataSize;
-		p.Usage = D3D11_USAGE_DYNAMIC;
-		p.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
-		p.MiscFlags = 0;
-		p.StructureByteStride = 0;
-
-		//2. Create the constant buffer
-		Graphics::Device->CreateBuffer(&eb, 0, vsConstBuffer.GetAddressOf());
-		Graphics::Device->CreateBuffer(&p, 0, psConstBuffer.GetAddressOf());
-	}
-
 	
 
-	cubeMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/cube.ggp_obj").c_str());
-	cylinderMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/cylinder.ggp_obj").c_str());
-	helixMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/helix.ggp_obj").c_str());
-	quadMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/quad.ggp_obj").c_str());
-	quadDoubleMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/quad_double_sided.ggp_obj").c_str());
-	sphereMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/sphere.ggp_obj").c_str());
-	torusMesh = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/torus.ggp_obj").c_str());
-
-
 	// Now to create entities using the meshes
 
 	entityList.push_back(Entity(cubeMesh, materials[4]));
@@ -669,14 +994,29 @@ void Game::CreateGeometry()
 	entityList[5].GetTransform()->SetScale(20.0f, 1.0f, 20.0f);
 	entityList[5].GetTransform()->MoveAbsolute(8.0f, -6.0f, 1.0f);
 
+	// The solid ones (and the floor) hide things behind them - the
+	// helix is too see-through to be worth rasterizing
+	for (unsigned int i : { 0, 1, 3, 4, 5 })
+		entityList[i].SetOccluder(true);
+
+	// entityList doesn't change size from here on, so the
+	// hierarchy can hold on to the transforms
+	for (unsigned int i = 0; i < entityList.size(); i++)
+		transformHierarchy.Add(entityList[i].GetTransform());
+	transformHierarchy.Update();
+
+	// And a handle each for the matrices the draw loop uploads
+	for (unsigned int i = 0; i < entityList.size(); i++)
+		transformHandles.push_back(transformSystem.Create());
+	transformVersions.assign(entityList.size(), 0);
+	SyncTransformSystem();
+
+	// Index them by their world bounds, for culling and picking
+	for (unsigned int i = 0; i < entityList.size(); i++)
+		entityProxies.push_back(sceneIndex.Insert(entityList[i].GetWorldBoundingBox(), i));
+
 	// Create sky using cube mesh
-	sky = std::make_shared<Sky>(cubeMesh, 
-		FixPath(L"../../Assets/Textures/clouds_pink/right.png").c_str(),
-		FixPath(L"../../Assets/Textures/clouds_pink/left.png").c_str(),
-		FixPath(L"../../Assets/Textures/clouds_pink/up.png").c_str(),
-		FixPath(L"../../Assets/Textures/clouds_pink/down.png").c_str(),
-		FixPath(L"../../Assets/Textures/clouds_pink/front.png").c_str(),
-		FixPath(L"../../Assets/Textures/clouds_pink/back.png").c_str(), 
+	sky = std::make_shared<Sky>(loader.GetMesh(skyMesh), loader.GetCubemap(skyCubemap),
 		FixPath(L"SkyVertex.cso").c_str(), FixPath(L"SkyPixel.cso").c_str());
 
 }
@@ -701,10 +1041,31 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
-	Game::UpdateImGui(deltaTime);
+	if (!headless) { Game::UpdateImGui(deltaTime); }
 	if (cameraChoice == 0) { camera->Update(deltaTime); }
 	else { secondCamera->Update(deltaTime); }
 
+	// Spin everything but the floor - done here rather than in Draw()
+	// so transforms are final before anything culls against them
+	// (twice deltaTime, since the shadow and main passes used to
+	// each turn them once a frame)
+	for (int i = 0; i < entityList.size(); i++)
+	{
+		if (i != 5 && spinEntities)
+			entityList[i].GetTransform()->Rotate(0.0f, deltaTime * 2.0f, 0.0f);
+	}
+
+	// World matrices (and so bounds) are only current after this
+	transformHierarchy.Update();
+	SyncTransformSystem();
+	for (int i = 0; i < entityList.size(); i++)
+	{
+		if (i != 5)
+			sceneIndex.Update(entityProxies[i], entityList[i].GetWorldBoundingBox());
+	}
+
+	hoveredEntity = PickEntity(Input::GetMouseX(), Input::GetMouseY());
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
@@ -764,30 +1125,64 @@ void Game::CreateShadowMap()
 
 }
 
+// --------------------------------------------------------
+// Casts a ray from the active camera through a pixel and
+// returns the entity whose box it enters first
+// --------------------------------------------------------
+int Game::PickEntity(int mouseX, int mouseY)
+{
+	std::shared_ptr<Camera> activeCamera = cameraChoice == 0 ? camera : secondCamera;
+	XMFLOAT4X4 view = activeCamera->GetView();
+	XMFLOAT4X4 proj = activeCamera->GetProj();
+	XMMATRIX inverseViewProj = XMMatrixInverse(0, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj));
+
+	// The pixel on the near and far planes, back in world space
+	float x = 2.0f * mouseX / Window::Width() - 1.0f;
+	float y = 1.0f - 2.0f * mouseY / Window::Height();
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), inverseViewProj);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), inverseViewProj);
+
+	// Direction is the whole near-to-far span, so distance 1 is the far plane
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, XMVectorSubtract(farPoint, nearPoint));
+
+	std::vector<SceneIndex::RayHit> hits;
+	sceneIndex.QueryRay(origin, direction, 1.0f, hits);
+
+	int nearest = -1;
+	float nearestDistance = 2.0f;
+	for (const SceneIndex::RayHit& hit : hits)
+	{
+		if (hit.distance < nearestDistance)
+		{
+			nearest = (int)hit.userData;
+			nearestDistance = hit.distance;
+		}
+	}
+	return nearest;
+}
+
 void Game::DrawToShadowMap(float deltaTime, float totalTime, Light light) 
 {
 	// Clear the shadow map's resources
-	Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	Graphics::Backend->ClearDepth(shadowDSV.Get(), 1.0f);
 
-	ID3D11RenderTargetView* noView = {};
 	// Set the render target to null, and write to only depth buffer in this case
-	Graphics::Context->OMSetRenderTargets(0, 0, shadowDSV.Get());
+	Graphics::Backend->SetRenderTargets(0, 0, shadowDSV.Get());
 
 	// Grab the correct shaders
 	
-	Graphics::Context->PSSetShader(0, 0, 0);
+	Graphics::State.SetPixelShader(0);
 
 	//Set the correct viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width = (float)shadowMapResolution;
-	viewport.Height = (float)shadowMapResolution;
-	viewport.MaxDepth = 1.0f;
-	Graphics::Context->RSSetViewports(1, &viewport);
-	Graphics::Context->RSSetState(shadowRasterizer.Get());
+	Graphics::Backend->SetViewport((float)shadowMapResolution, (float)shadowMapResolution);
+	Graphics::State.SetRasterizerState(shadowRasterizer.Get());
 
-	Graphics::Context->VSSetShader(vertexShaders[1].Get(), 0, 0);
+	Graphics::State.SetVertexShader(vertexShaders[1].Get());
 
-	
+	// Depth only, so just the positions (see Mesh::DrawPositionsOnly)
+	Graphics::State.SetInputLayout(positionInputLayout.Get());
 
 	// Calculate the light's view and projection matrices
 	DirectX::XMVECTOR lightDir = DirectX::XMLoadFloat3(&(light.Direction));
@@ -801,24 +1196,74 @@ void Game::DrawToShadowMap(float deltaTime, float totalTime, Light light)
 	XMStoreFloat4x4(&(sData.lightProj), lightProj);
 
 
-	for (int i = 0; i < entityList.size(); i++)
+	// Only entities inside the light's box can cast into the shadow map,
+	// but the box is extended back towards the light (no near plane)
+	// since anything between the light and the box still shadows it
+	if (useShadowCasterCulling)
 	{
-		if(i != 5){ entityList[i].GetTransform()->Rotate(0.0f, deltaTime, 0.0f); }
-		
+		XMFLOAT4X4 lightViewProj;
+		XMStoreFloat4x4(&lightViewProj, lightView * lightProj);
+		FrustumCuller::Frustum lightVolume = FrustumCuller::ExtractPlanes(lightViewProj);
+		FrustumCuller::RemovePlane(lightVolume, FrustumCuller::Near);
+		if (useSceneIndex)
+		{
+			shadowCasters.clear();
+			sceneIndex.QueryFrustum(lightVolume, shadowCasters);
+		}
+		else { FrustumCuller::Cull(lightVolume, entityBounds, shadowCasters); }
+	}
+	else
+	{
+		shadowCasters.resize(entityList.size());
+		for (int i = 0; i < entityList.size(); i++)
+			shadowCasters[i] = i;
+	}
 
-		sData.world = entityList[i].GetTransform()->GetWorldMatrix();
-		Graphics::FillAndBindNextConstantBuffer(&sData, sizeof(sData), D3D11_VERTEX_SHADER, 0);
+	// Meshes created without a position stream don't cast shadows
+	shadowCasters.erase(std::remove_if(shadowCasters.begin(), shadowCasters.end(),
+		[&](unsigned int i) { return !entityList[i].GetMesh()->IsShadowCaster(); }), shadowCasters.end());
 
+	// Casters off screen still cast on screen, so their LOD comes from
+	// the same camera (and is picked again, the same, for visible ones)
+	SelectLods(shadowCasters, cameraChoice == 0 ? *camera : *secondCamera);
 
-		entityList[i].DrawShadow();
+	// Depth only, so casters sharing a mesh and LOD are one draw
+	if (useInstancing)
+	{
+		shadowBatcher.Clear();
+		for (unsigned int i : shadowCasters)
+			shadowBatcher.Add(InstanceBatcher::MakeKey(0, 0, meshIds.Get(entityList[i].GetMesh().get()), entityList[i].GetLod()), i);
+		shadowBatcher.Build();
+		UploadInstances(shadowBatcher);
+
+		// The light's matrices once - each batch only binds its offset
+		Graphics::State.SetVertexShader(vertexShaders[5].Get());
+		Graphics::FillAndBindNextConstantBuffer(&sData, sizeof(sData), D3D11_VERTEX_SHADER, 0);
+		for (const InstanceBatcher::Batch& batch : shadowBatcher.GetBatches())
+		{
+			Entity& first = entityList[shadowBatcher.GetIndices()[batch.firstInstance]];
+			SetInstanceBatchData(batch.firstInstance);
+			first.GetMesh()->DrawPositionsOnlyInstanced(first.GetLod(), batch.instanceCount);
+		}
+		shadowDraws = (int)shadowBatcher.GetBatches().size();
+	}
+	else
+	{
+		// The light's matrices once - each caster's world matrix is
+		// the same b1 block the main pass uses
+		Graphics::FillAndBindNextConstantBuffer(&sData, sizeof(sData), D3D11_VERTEX_SHADER, 0);
+		for (unsigned int i : shadowCasters)
+		{
+			SetObjectVertexData(i);
+			entityList[i].DrawShadow();
+		}
+		shadowDraws = (int)shadowCasters.size();
 	}
 
 	// Set to render the world now
-	viewport.Width = (float)Window::Width();
-	viewport.Height = (float)Window::Height();
-	Graphics::Context->RSSetViewports(1, &viewport);
-	Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(),Graphics::DepthBufferDSV.Get());
-	Graphics::Context->RSSetState(0);
+	Graphics::Backend->SetViewport((float)Window::Width(), (float)Window::Height());
+	Graphics::Backend->SetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
+	Graphics::State.SetRasterizerState(0);
 
 
 }
@@ -879,23 +1324,113 @@ void Game::Draw(float deltaTime, float totalTime)
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
 	{
-		Graphics::Context->IASetInputLayout(vertexInputLayout.Get());
+		// The state cache starts each frame knowing nothing - other code
+		// (ImGui, Present) shares the context, and setting a render target
+		// quietly unbinds it as a shader resource (SetBackend invalidates)
+		stateStats = Graphics::State.GetStats();
+		Graphics::State.ResetStats();
+		objectConstantStats = objectConstants.GetStats();
+		instanceSlotStats = instanceSlots.GetStats();
+		constantBytesUploaded = Graphics::Backend == &nullBackend ? nullBackend.GetConstantBytes() : Graphics::ConstantBytesUploaded;
+		Graphics::ConstantBytesUploaded = 0;
+		nullBackend.Reset();
+		Graphics::SetBackend(useNullBackend ? &nullBackend : 0);
+		objectConstants.BeginFrame(Graphics::Backend);
+		instanceSlots.BeginFrame(Graphics::Backend, (unsigned int)entityList.size());
+
+		Graphics::State.SetInputLayout(vertexInputLayout.Get());
+
+		// Without the BVH, both the camera and the shadow map
+		// test every one of these
+		if (!useSceneIndex)
+		{
+			entityBounds.Clear();
+			for (int i = 0; i < entityList.size(); i++)
+				entityBounds.Add(entityList[i].GetWorldBoundingSphere());
+		}
+
+		// Find the entities the active camera can see
+		std::shared_ptr<Camera> activeCamera = cameraChoice == 0 ? camera : secondCamera;
+		if (useFrustumCulling)
+		{
+			FrustumCuller::Frustum frustum = FrustumCuller::FromCamera(activeCamera->GetView(), activeCamera->GetProj());
+			if (useSceneIndex)
+			{
+				// Sorted so entities draw in the same order either way
+				visibleEntities.clear();
+				sceneIndex.QueryFrustum(frustum, visibleEntities);
+				std::sort(visibleEntities.begin(), visibleEntities.end());
+			}
+			else { FrustumCuller::Cull(frustum, entityBounds, visibleEntities); }
+		}
+		else
+		{
+			visibleEntities.resize(entityList.size());
+			for (int i = 0; i < entityList.size(); i++)
+				visibleEntities[i] = i;
+		}
+
+		// Drop entities hidden behind the occluders, using a small
+		// depth buffer drawn on the CPU (see OcclusionCuller.h)
+		occludedEntities = 0;
+		if (useOcclusionCulling)
+		{
+			XMFLOAT4X4 view = activeCamera->GetView();
+			XMFLOAT4X4 proj = activeCamera->GetProj();
+			XMFLOAT4X4 viewProj;
+			XMStoreFloat4x4(&viewProj, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj));
+			occlusionCuller.Begin(viewProj);
+
+			// Nearest first, so the near ones fill the buffer in before
+			// the far ones get merged in behind them
+			XMFLOAT3 cameraPosition = activeCamera->GetPos();
+			XMVECTOR cameraPos = XMLoadFloat3(&cameraPosition);
+			auto distance = [&](unsigned int e)
+			{
+				XMFLOAT3 center = entityList[e].GetWorldBoundingSphere().center;
+				return XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&center), cameraPos)));
+			};
+			occluderEntities.clear();
+			for (unsigned int i : visibleEntities)
+				if (entityList[i].IsOccluder())
+					occluderEntities.push_back(i);
+			std::sort(occluderEntities.begin(), occluderEntities.end(),
+				[&](unsigned int a, unsigned int b) { return distance(a) < distance(b); });
+
+			for (unsigned int i : occluderEntities)
+			{
+				std::shared_ptr<Mesh> mesh = entityList[i].GetMesh();
+				occlusionCuller.AddOccluder(mesh->GetOccluderPositions().data(), mesh->GetOccluderPositions().size(),
+					mesh->GetOccluderIndices().data(), mesh->GetOccluderIndices().size(), entityList[i].GetTransform()->GetWorldMatrix());
+			}
+			occlusionCuller.Rasterize();
+
+			entityBoxes.resize(entityList.size());
+			for (unsigned int i : visibleEntities)
+				entityBoxes[i] = entityList[i].GetWorldBoundingBox();
+			occludedEntities = occlusionCuller.Cull(entityBoxes.data(), visibleEntities);
+		}
+
+		// Pick each visible entity's LOD, before any pass draws them
+		// (the shadow map picks its casters' too)
+		SelectLods(visibleEntities, *activeCamera);
 
 		// Plot the shadow map each frame, BEFORE drawing entities
 		Game::DrawToShadowMap(deltaTime, totalTime, lights[0]);
 
+		Window::SetStatsText(L"    Visible: " + std::to_wstring(visibleEntities.size()) +
+			L"    Culled: " + std::to_wstring(entityList.size() - visibleEntities.size()) +
+			L"    Occluded: " + std::to_wstring(occludedEntities) +
+			L"    Shadow casters: " + std::to_wstring(shadowCasters.size()));
+
 		// Clear the back buffer (erase what's on screen) and depth buffer
-		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	&lightsColorIntensity[5*4+3]);
-		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		Graphics::Backend->ClearRenderTarget(Graphics::BackBufferRTV.Get(), &lightsColorIntensity[5*4+3]);
+		Graphics::Backend->ClearDepth(Graphics::DepthBufferDSV.Get(), 1.0f);
 
 		// Clear the final post process render target
-		Graphics::Context->ClearRenderTargetView(blurRTV.Get(), &lightsColorIntensity[5*4+3]);
+		Graphics::Backend->ClearRenderTarget(blurRTV.Get(), &lightsColorIntensity[5*4+3]);
 		// Set rendering to the post process render target
-		Graphics::Context->OMSetRenderTargets(1, blurRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
-
-		// Bind the constant buffers
-		Graphics::Context->VSSetConstantBuffers(0, 1, vsConstBuffer.GetAddressOf());
-		Graphics::Context->PSSetConstantBuffers(0, 1, psConstBuffer.GetAddressOf());
+		Graphics::Backend->SetRenderTargets(1, blurRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
 	}
 
 	
@@ -925,23 +1460,122 @@ void Game::Draw(float deltaTime, float totalTime)
 	{
 
 		
+		// The shadow pass above left the position-only layout bound
+		Graphics::State.SetInputLayout(usePackedVertices ? packedInputLayout.Get() : vertexInputLayout.Get());
+
 		float offset = sin(totalTime)/2;
-		for (int i = 0; i < entityList.size(); i++) 
+		std::shared_ptr<Camera> drawCamera = cameraChoice == 0 ? camera : secondCamera;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> packedVS = usePackedVertices ? vertexShaders[3] : nullptr;
+
+		// Queue the visible entities by what they need bound (see
+		// RenderQueue.h), nearest first among ones that share it all
 		{
-			entityList[i].BindTexturesSamplers();
-			if (i != 5) { entityList[i].GetTransform()->Rotate(0.0f, deltaTime, 0.0f); }
+			XMFLOAT4X4 view = drawCamera->GetView();
+			float farClip = drawCamera->GetFarClip();
+			renderQueue.Clear();
+			for (unsigned int i : visibleEntities)
+			{
+				std::shared_ptr<Material> material = entityList[i].GetMaterial();
+				XMFLOAT3 center = entityList[i].GetWorldBoundingSphere().center;
+				float viewDepth = center.x * view._13 + center.y * view._23 + center.z * view._33 + view._43;
+				uint64_t key = RenderQueue::MakeKey(RenderQueue::Opaque,
+					shaderIds.Get(packedVS ? packedVS.Get() : material->GetVS().Get(), material->GetPS().Get()),
+					materialIds.Get(material.get()),
+					meshIds.Get(entityList[i].GetMesh().get()),
+					viewDepth / farClip);
+				renderQueue.Add(key, i);
+			}
+			if (useRenderQueue) { renderQueue.Sort(); }
+		}
 
-			if (cameraChoice == 0)
+		// Only bind what changed since the last draw (everything,
+		// every draw, with the queue turned off)
+		const void* lastVS = 0;
+		const void* lastPS = 0;
+		const Material* lastMaterial = 0;
+		const Mesh* lastMesh = 0;
+		shaderBinds = materialBinds = bufferBinds = 0;
+
+		// The per-pass constants once - each draw (or batch) only binds its own b1
+		SetExternalData(totalTime, drawCamera->GetPos(), drawCamera->GetView(), drawCamera->GetProj());
+
+		// Instanced: the queue, grouped into one draw per shaders,
+		// material, mesh and LOD (in the same order, since the batch
+		// keys are the queue's keys with the LOD in place of depth)
+		// - InstancedVertexShader only stands in for the default
+		//    VertexShader, so materials with a vertex shader of their
+		//    own are left to the regular draws below
+		bool instanced = useInstancing && !usePackedVertices && !useClusterCulling;
+		unbatchedItems.clear();
+		if (instanced)
+		{
+			instanceBatcher.Clear();
+			for (size_t q = 0; q < renderQueue.Count(); q++)
 			{
-				SetExternalData(totalTime, camera->GetPos(), camera->GetView(), camera->GetProj(), entityList[i]);
+				uint64_t key = renderQueue.Items()[q].key;
+				unsigned int i = renderQueue.Items()[q].index;
+				if (entityList[i].GetMaterial()->GetVS() != vertexShaders[0]) { unbatchedItems.push_back(q); continue; }
+
+				entityList[i].ClearClusterCulling();
+				instanceBatcher.Add(InstanceBatcher::MakeKey(RenderQueue::GetShader(key), RenderQueue::GetMaterial(key), RenderQueue::GetMesh(key), entityList[i].GetLod()), i);
 			}
-			else
+			instanceBatcher.Build();
+			UploadInstances(instanceBatcher);
+
+			for (const InstanceBatcher::Batch& batch : instanceBatcher.GetBatches())
 			{
-				SetExternalData(totalTime, secondCamera->GetPos(), secondCamera->GetView(), secondCamera->GetProj(), entityList[i]);
+				unsigned int firstIndex = instanceBatcher.GetIndices()[batch.firstInstance];
+				Entity& first = entityList[firstIndex];
+				std::shared_ptr<Material> material = first.GetMaterial();
+				bool newShaders = vertexShaders[4].Get() != lastVS || material->GetPS().Get() != lastPS;
+				bool newMaterial = material.get() != lastMaterial;
+				bool newMesh = first.GetMesh().get() != lastMesh;
+				lastVS = vertexShaders[4].Get();
+				lastPS = material->GetPS().Get();
+				lastMaterial = material.get();
+				lastMesh = first.GetMesh().get();
+
+				if (newShaders) { first.BindShaders(vertexShaders[4]); shaderBinds++; }
+				if (newMaterial) { first.BindTexturesSamplers(); materialBinds++; }
+				bufferBinds += newMesh;
+
+				SetInstanceBatchData(batch.firstInstance);
+				SetObjectPixelData(firstIndex);
+				first.GetMesh()->DrawInstanced(first.GetLod(), batch.instanceCount, newMesh);
 			}
+			instancedDraws = (int)(instanceBatcher.GetBatches().size() + unbatchedItems.size());
+		}
+		else { instancedDraws = (int)renderQueue.Count(); }
 
-			entityList[i].Draw();
+		size_t drawCount = instanced ? unbatchedItems.size() : renderQueue.Count();
+		for (size_t d = 0; d < drawCount; d++) 
+		{
+			size_t q = instanced ? unbatchedItems[d] : d;
+			unsigned int i = renderQueue.Items()[q].index;
+			std::shared_ptr<Material> material = entityList[i].GetMaterial();
+			const void* vs = packedVS ? packedVS.Get() : material->GetVS().Get();
+			bool newShaders = !useRenderQueue || vs != lastVS || material->GetPS().Get() != lastPS;
+			bool newMaterial = !useRenderQueue || material.get() != lastMaterial;
+			bool newMesh = !useRenderQueue || entityList[i].GetMesh().get() != lastMesh;
+			lastVS = vs;
+			lastPS = material->GetPS().Get();
+			lastMaterial = material.get();
+			lastMesh = entityList[i].GetMesh().get();
+
+			if (newShaders) { entityList[i].BindShaders(packedVS); shaderBinds++; }
+			if (newMaterial) { entityList[i].BindTexturesSamplers(); materialBinds++; }
+			bufferBinds += newMesh;
+
+			if (useClusterCulling) { entityList[i].CullClusters(drawCamera->GetView(), drawCamera->GetProj(), drawCamera->GetPos()); }
+			else { entityList[i].ClearClusterCulling(); }
+
+			SetObjectVertexData(i);
+			SetObjectPixelData(i);
+			entityList[i].DrawGeometry(usePackedVertices, newMesh);
 		}
+
+		// The sky's mesh is drawn with the regular layout
+		Graphics::State.SetInputLayout(vertexInputLayout.Get());
 		if (displaySkybox) 
 		{
 			if (cameraChoice == 0) { sky->Draw(camera); }
@@ -954,16 +1588,16 @@ void Game::Draw(float deltaTime, float totalTime)
 
 	// POST PROCESS
 	{
-		Graphics::Context->IASetInputLayout(ppInputLayout.Get());
+		Graphics::State.SetInputLayout(ppInputLayout.Get());
 		
 		// Set rendering to back buffer
-		Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
+		Graphics::Backend->SetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
 
 		// Bind shaders and necessary resources, i.e, sampler state and SRV to sample from
-		Graphics::Context->VSSetShader(vertexShaders[2].Get(), 0, 0);
-		Graphics::Context->PSSetShader(pixelShaders[5].Get(), 0, 0);
-		Graphics::Context->PSSetShaderResources(0, 1, blurSRV.GetAddressOf());
-		Graphics::Context->PSSetSamplers(0, 1, ppSampler.GetAddressOf());
+		Graphics::State.SetVertexShader(vertexShaders[2].Get());
+		Graphics::State.SetPixelShader(pixelShaders[5].Get());
+		Graphics::State.SetShaderResources(StateCache::Pixel, 0, 1, blurSRV.GetAddressOf());
+		Graphics::State.SetSamplers(StateCache::Pixel, 0, 1, ppSampler.GetAddressOf());
 
 		struct ExtraPPData 
 		{
@@ -978,10 +1612,11 @@ void Game::Draw(float deltaTime, float totalTime)
 		eData.pixelWidth = 1.0f / Window::Width();
 		Graphics::FillAndBindNextConstantBuffer(&eData, sizeof(eData), D3D11_PIXEL_SHADER, 0);
 
-		Graphics::Context->Draw(3, 0);
+		Graphics::State.Flush();
+		Graphics::Backend->Draw(3, 0);
 
-		Graphics::Context->IASetInputLayout(ppInputLayout.Get());
-		Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
+		Graphics::State.SetInputLayout(ppInputLayout.Get());
+		Graphics::Backend->SetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
 	}
 
 	// Frame END
@@ -990,7 +1625,12 @@ void Game::Draw(float deltaTime, float totalTime)
 	{
 		// Set SRV resources to null
 		ID3D11ShaderResourceView* nullSRVs[128] = {};
-		Graphics::Context->PSSetShaderResources(0, 128, nullSRVs);
+		Graphics::State.SetShaderResources(StateCache::Pixel, 0, 128, nullSRVs);
+		Graphics::State.Flush();
+
+		// Nothing to show without a window
+		if (headless)
+			return;
 
 		// Present at the end of the frame
 		bool vsync = Graphics::VsyncState();
@@ -1001,6 +1641,8 @@ void Game::Draw(float deltaTime, float totalTime)
 			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 
 		// Re-bind back buffer and depth buffer after presenting
+		// - Straight to the context, like the UI, since it's the
+		//    swap chain's (and the UI draws here with either backend)
 		Graphics::Context->OMSetRenderTargets(
 			1,
 			Graphics::BackBufferRTV.GetAddressOf(),
@@ -1008,29 +1650,137 @@ void Game::Draw(float deltaTime, float totalTime)
 	}
 }
 
-void Game::SetExternalData(float totalTime, DirectX::XMFLOAT3 worldPos, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 proj, Entity e)
+const NullBackend& Game::GetNullBackend() const { return nullBackend; }
+
+// Once per pass - the entities' own constants are in b1 (SetObjectVertexData() / SetObjectPixelData())
+void Game::SetExternalData(float totalTime, DirectX::XMFLOAT3 worldPos, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 proj)
 {
 	ExtraVertexData vsData;
-	vsData.world = e.GetTransform()->GetWorldMatrix();
-	vsData.worldInv = e.GetTransform()->GetWorldInverseTransposeMatrix();
 	vsData.view = view;
 	vsData.proj = proj;
 	XMStoreFloat4x4(&(vsData.shadowView), lightView);
 	XMStoreFloat4x4(&(vsData.shadowProj), lightProj);
 
-	ExtraPixelData psData;
-	psData.colourTint = e.GetTint();
+	Graphics::FillAndBindNextConstantBuffer(&vsData, sizeof(vsData), D3D11_VERTEX_SHADER, 0);
+	SetPixelData(totalTime, worldPos);
+}
+
+// --------------------------------------------------------
+// A batch drawn with the instanced vertex shaders only needs
+// its offset into the instance buffer - the per-pass matrices
+// are already in b0
+// --------------------------------------------------------
+void Game::SetInstanceBatchData(unsigned int firstInstance)
+{
+	InstanceBatchData vsData = {};
+	vsData.firstInstance = firstInstance;
+
+	Graphics::FillAndBindNextConstantBuffer(&vsData, sizeof(vsData), D3D11_VERTEX_SHADER, 1);
+}
+
+void Game::SetPixelData(float totalTime, DirectX::XMFLOAT3 worldPos)
+{
+	ExtraPixelData psData = {};
 	psData.totalTime = totalTime;
-	psData.scale = e.GetScale();
-	psData.offset = e.GetOffset();
-	psData.IsMetal = e.GetIsMetal();
 	psData.worldPos = worldPos; 
 	psData.ambientColor = DirectX::XMFLOAT3(&lightsColorIntensity[5*4]);
 	memcpy(&psData.lights, &lights[0], sizeof(Light) * 5);
 
-	Graphics::FillAndBindNextConstantBuffer(&vsData, sizeof(vsData), D3D11_VERTEX_SHADER, 0);
 	Graphics::FillAndBindNextConstantBuffer(&psData, sizeof(psData), D3D11_PIXEL_SHADER, 0);
 
 }
 
+// --------------------------------------------------------
+// An entity's own constants, in b1 - bound from its block on
+// the GPU while its transform (or material) version hasn't
+// moved, and only filled in and uploaded when it has
+// --------------------------------------------------------
+void Game::SetObjectVertexData(unsigned int index)
+{
+	Entity& e = entityList[index];
+	Transform* transform = e.GetTransform();
+	if (objectConstants.Bind(index, StateCache::Vertex, transform->GetVersion(), 1)) { return; }
+
+	unsigned int matrix = transformSystem.GetIndex(transformHandles[index]);
+	ObjectVertexData vsData;
+	vsData.world = transformSystem.GetWorldMatrices()[matrix];
+	vsData.worldInv = transformSystem.GetWorldInverseTransposeMatrices()[matrix];
+	VertexCodec::PositionBounds bounds = e.GetMesh()->GetPackedBounds();
+	vsData.positionScale = DirectX::XMFLOAT4(bounds.extent.x, bounds.extent.y, bounds.extent.z, 0.0f);
+	vsData.positionOffset = DirectX::XMFLOAT4(bounds.min.x, bounds.min.y, bounds.min.z, 0.0f);
+	objectConstants.Upload(index, StateCache::Vertex, 1, &vsData, sizeof(vsData));
+}
+
+void Game::SetObjectPixelData(unsigned int index)
+{
+	Entity& e = entityList[index];
+	if (objectConstants.Bind(index, StateCache::Pixel, e.GetMaterial()->GetVersion(), 1)) { return; }
+
+	ObjectPixelData psData = {};
+	psData.colourTint = e.GetTint();
+	psData.scale = e.GetScale();
+	psData.offset = e.GetOffset();
+	psData.IsMetal = e.GetIsMetal();
+	objectConstants.Upload(index, StateCache::Pixel, 1, &psData, sizeof(psData));
+}
+
+// --------------------------------------------------------
+// Picks each entity's LOD from how big it is on the viewer's
+// screen (or uses the forced one) - picking it twice in a frame
+// gives the same LOD
+// --------------------------------------------------------
+void Game::SelectLods(const std::vector<unsigned int>& entities, Camera& viewer)
+{
+	for (unsigned int i : entities)
+	{
+		if (forcedLod >= 0) { entityList[i].SetLod(forcedLod); }
+		else { entityList[i].SelectLod(viewer.GetPos(), viewer.GetProj()._22, (float)Window::Height(), lodPixelError); }
+	}
+}
+
+// --------------------------------------------------------
+// Each entity keeps its instance in its own slot, which is
+// only rewritten when its transform's version moves - a pass
+// then just sends which slots its batches draw, in order
+// --------------------------------------------------------
+static_assert(sizeof(InstanceBatcher::Instance) == RenderBackend::InstanceBytes, "Instance must match what the backend stores");
+
+void Game::UploadInstances(const InstanceBatcher& batcher)
+{
+	const DirectX::XMFLOAT4X4* worlds = transformSystem.GetWorldMatrices();
+	const DirectX::XMFLOAT4X4* worldInverseTransposes = transformSystem.GetWorldInverseTransposeMatrices();
+	const std::vector<unsigned int>& order = batcher.GetIndices();
+	for (unsigned int i : order)
+	{
+		if (instanceSlots.IsCurrent(i, entityList[i].GetTransform()->GetVersion())) { continue; }
+
+		unsigned int matrix = transformSystem.GetIndex(transformHandles[i]);
+		InstanceBatcher::Instance instance = { worlds[matrix], worldInverseTransposes[matrix] };
+		instanceSlots.Write(i, &instance);
+	}
+	instanceSlots.Submit(order);
+}
+
+// --------------------------------------------------------
+// Entities are still edited through their Transforms - the
+// ones whose version moved have their position, rotation and
+// scale copied over, and the system rebuilds only their
+// batches. Every entity is a root of transformHierarchy, so
+// its local transform is its world one
+// --------------------------------------------------------
+void Game::SyncTransformSystem()
+{
+	for (unsigned int i = 0; i < entityList.size(); i++)
+	{
+		Transform* transform = entityList[i].GetTransform();
+		if (transformVersions[i] == transform->GetVersion()) { continue; }
+
+		transformSystem.SetPosition(transformHandles[i], transform->GetPosition());
+		transformSystem.SetRotation(transformHandles[i], transform->GetRotation());
+		transformSystem.SetScale(transformHandles[i], transform->GetScale());
+		transformVersions[i] = transform->GetVersion();
+	}
+	transformSystem.Update();
+}
+
 
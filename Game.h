@@ -9,13 +9,18 @@
 #include "Camera.h"
 #include "Light.h"
 #include "Sky.h"
+#include "InstanceBatcher.h"
+#include "NullBackend.h"
 
 
 class Game
 {
 public:
 	// Basic OOP setup
-	Game();
+	// - Headless has no UI and never presents, and every frame goes to
+	//    the null backend - for running Update() and Draw() with no
+	//    window (see Main.cpp)
+	Game(bool headless = false);
 	~Game();
 	Game(const Game&) = delete; // Remove copy constructor
 	Game& operator=(const Game&) = delete; // Remove copy-assignment operator
@@ -25,7 +30,8 @@ public:
 	void Draw(float deltaTime, float totalTime);
 	void Initialize();
 	void OnResize();
-	void SetExternalData(float totalTime, DirectX::XMFLOAT3 worldPos, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 proj, Entity e);
+	void SetExternalData(float totalTime, DirectX::XMFLOAT3 worldPos, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 proj);
+	const NullBackend& GetNullBackend() const; // The calls of the last frame that used it
 
 private:
 
@@ -33,6 +39,9 @@ private:
 	// void LoadShaders();
 	void LoadVertexShader(std::wstring path);
 	void LoadPPVertexShader(std::wstring path);
+	void LoadPackedVertexShader(std::wstring path); // Creates packedInputLayout, for PackedVertex
+	void LoadPositionVertexShader(std::wstring path); // Creates positionInputLayout, for Mesh's position-only stream
+	void LoadInstancedVertexShader(std::wstring path); // No new input layout - the instanced shaders take the same vertices
 	void LoadPixelShader(std::wstring path);
 	void CreateGeometry();
 	void UpdateImGui(float deltaTime);
@@ -40,12 +49,21 @@ private:
 	void CreateShadowMap(); // Create the shadow map's required resources
 	void CreateBlurResources();
 	void DrawToShadowMap(float deltaTime, float totalTime, Light light); 
+	int PickEntity(int mouseX, int mouseY); // Nearest entity under a pixel (by its bounds), or -1
+	void SelectLods(const std::vector<unsigned int>& entities, Camera& viewer); // Before any pass draws them
+	void SetPixelData(float totalTime, DirectX::XMFLOAT3 worldPos); // The pixel shader half of SetExternalData()
+	void SetObjectVertexData(unsigned int index); // Entity's b1 constants, through objectConstants
+	void SetObjectPixelData(unsigned int index);
+	void SetInstanceBatchData(unsigned int firstInstance); // b1 of the instanced vertex shaders
+	void UploadInstances(const InstanceBatcher& batcher); // Through instanceSlots - only the entities that moved are copied
+	void SyncTransformSystem(); // Copies edited entity transforms into transformSystem and rebuilds their matrices
 	
 
 	std::shared_ptr<Camera> camera, secondCamera;
 	std::shared_ptr<Sky> sky;
 	std::shared_ptr<Mesh> cubeMesh, sphereMesh, cylinderMesh, quadMesh, quadDoubleMesh, helixMesh, torusMesh;
 
+	bool headless;
 	bool showDemo;
 	Light lights[5];
 
@@ -61,9 +79,7 @@ private:
 	// Shaders and shader-related constructs
 	//Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
 	//Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vsConstBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> psConstBuffer;
-	Microsoft::WRL::ComPtr<ID3D11InputLayout> vertexInputLayout, ppInputLayout;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> vertexInputLayout, ppInputLayout, packedInputLayout, positionInputLayout;
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
@@ -21,6 +21,334 @@ namespace Graphics
 
 		D3D_FEATURE_LEVEL featureLevel{};
 
+		// The D3D11 backend - everything goes straight to Context
+		class ContextBackend : public RenderBackend
+		{
+		public:
+			void SetVertexShader(ID3D11VertexShader* shader) override { Context->VSSetShader(shader, 0, 0); }
+			void SetPixelShader(ID3D11PixelShader* shader) override { Context->PSSetShader(shader, 0, 0); }
+			void SetInputLayout(ID3D11InputLayout* layout) override { Context->IASetInputLayout(layout); }
+			void SetRasterizerState(ID3D11RasterizerState* state) override { Context->RSSetState(state); }
+
+			void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) override
+			{
+				Context->IASetIndexBuffer(buffer, (DXGI_FORMAT)format, offset);
+			}
+
+			void SetVertexBuffers(unsigned int start, unsigned int count, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) override
+			{
+				Context->IASetVertexBuffers(start, count, buffers, strides, offsets);
+			}
+
+			void SetShaderResources(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* views) override
+			{
+				if (stage == StateCache::Vertex) { Context->VSSetShaderResources(start, count, views); }
+				else { Context->PSSetShaderResources(start, count, views); }
+			}
+
+			void SetSamplers(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* samplers) override
+			{
+				if (stage == StateCache::Vertex) { Context->VSSetSamplers(start, count, samplers); }
+				else { Context->PSSetSamplers(start, count, samplers); }
+			}
+
+			// Copies into the next free part of ConstBufferHeap and binds
+			// just that part (D3D11.1's offset binding)
+			void SetConstants(StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size) override
+			{
+				if (!ConstantBufferOffsetting)
+				{
+					SetSlotConstants(stage, slot, data, size);
+					return;
+				}
+
+				// 1. Get the size of the incoming data, and pad the size to be a multiple of 256
+				unsigned int incomingSize = ((size + 255) / 256) * 256;
+
+				// 1.5 Check if the remaining space in the buffer is sufficient to store incoming data, otherwise *circle* back around
+				if (incomingSize + cbOffsetBytes > cbSizeBytes) 
+				{
+					cbOffsetBytes = 0;
+				}
+
+				// 2. Copy the data over, by first mapping the storage size, and them using memcpy
+				// Mapping -> Specify the buffer to write into and the kind of data being written(can be disposed, should not be disposed)
+				D3D11_MAPPED_SUBRESOURCE map{};
+				Context->Map(
+					ConstBufferHeap.Get(),
+					0,
+					D3D11_MAP_WRITE_NO_OVERWRITE,
+					0,
+					&map);
+				// memcpy -> Make sure data is written into the right address, remember we just checked if the incoming data will fit, 
+				// calculations for the address to be written to still need to be done!
+				void* uploadAddress = reinterpret_cast<void*>((UINT64)map.pData + cbOffsetBytes);
+				memcpy(uploadAddress, data, size);
+
+				// UNMAP
+				Context->Unmap(ConstBufferHeap.Get(), 0);
+
+				// 3. Tell the GPU the data is ready to use, known as BINDING, by specifying byte boundaries. 
+				// This is where 11.1 version is crucial. I cannot fathom why, I have been told it is
+				// Since we work with HLSL, only 16-byte boundaries need to be taken care of.
+				unsigned int existingConstant = cbOffsetBytes/16; // How many 16 byte blocks are occupied already?
+				unsigned int incomingConstant = incomingSize/16; // How many 16 byte blocks will be occupied?
+				// Use a switch statement for the vertex and pixel shaders that follow the 16-byte boundary rule.
+				switch (stage) 
+				{
+					case StateCache::Vertex:
+						Context1->VSSetConstantBuffers1(
+							slot,
+							1,
+							ConstBufferHeap.GetAddressOf(),
+							&existingConstant,
+							&incomingConstant);
+						break;
+
+					case StateCache::Pixel:
+						Context1->PSSetConstantBuffers1(
+							slot,
+							1,
+							ConstBufferHeap.GetAddressOf(),
+							&existingConstant,
+							&incomingConstant);
+						break;
+
+				}
+
+				// 4. Update the offset value - tells the next free space to go to. 
+				cbOffsetBytes += incomingSize;
+				ConstantBytesUploaded += size;
+			}
+
+			// A default-usage buffer, so blocks are only copied when they change
+			// (UpdateSubresource1() on part of a constant buffer needs D3D11.1's
+			// partial updates, and binding one block its offsetting) - without
+			// both, each block is a buffer of its own
+			void ReservePersistentConstants(unsigned int blockCount) override
+			{
+				if (blockCount <= persistentBlockCount)
+					return;
+
+				D3D11_BUFFER_DESC desc = {};
+				desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+				desc.Usage = D3D11_USAGE_DEFAULT;
+				if (!PersistentBlocksShared())
+				{
+					desc.ByteWidth = PersistentBlockBytes;
+					PersistentConstantBlocks.resize(blockCount);
+					for (unsigned int b = persistentBlockCount; b < blockCount; b++)
+						Device->CreateBuffer(&desc, 0, PersistentConstantBlocks[b].ReleaseAndGetAddressOf());
+					persistentBlockCount = blockCount;
+					return;
+				}
+
+				desc.ByteWidth = blockCount * PersistentBlockBytes;
+				Device->CreateBuffer(&desc, 0, PersistentConstantBuffer.ReleaseAndGetAddressOf());
+				persistentBlockCount = blockCount;
+			}
+
+			void UpdatePersistentConstants(unsigned int block, const void* data, unsigned int size) override
+			{
+				// Whole blocks, so the copy never has to keep part of one
+				unsigned char padded[PersistentBlockBytes] = {};
+				memcpy(padded, data, size);
+				if (PersistentBlocksShared())
+				{
+					D3D11_BOX box = { block * PersistentBlockBytes, 0, 0, (block + 1) * PersistentBlockBytes, 1, 1 };
+					Context1->UpdateSubresource1(PersistentConstantBuffer.Get(), 0, &box, padded, 0, 0, 0);
+				}
+				else { Context->UpdateSubresource(PersistentConstantBlocks[block].Get(), 0, 0, padded, 0, 0); }
+				ConstantBytesUploaded += size;
+			}
+
+			void BindPersistentConstants(StateCache::Stage stage, unsigned int slot, unsigned int block) override
+			{
+				if (!PersistentBlocksShared())
+				{
+					ID3D11Buffer* buffer = PersistentConstantBlocks[block].Get();
+					if (stage == StateCache::Vertex) { Context->VSSetConstantBuffers(slot, 1, &buffer); }
+					else { Context->PSSetConstantBuffers(slot, 1, &buffer); }
+					return;
+				}
+
+				unsigned int firstConstant = block * PersistentBlockBytes / 16;
+				unsigned int constantCount = PersistentBlockBytes / 16;
+				if (stage == StateCache::Vertex) { Context1->VSSetConstantBuffers1(slot, 1, PersistentConstantBuffer.GetAddressOf(), &firstConstant, &constantCount); }
+				else { Context1->PSSetConstantBuffers1(slot, 1, PersistentConstantBuffer.GetAddressOf(), &firstConstant, &constantCount); }
+			}
+
+			// Default usage too - a slot is only copied when its object changes,
+			// which doesn't need D3D11.1 since it isn't a constant buffer
+			void ReserveInstances(unsigned int slotCount) override
+			{
+				if (slotCount <= instanceSlotCount)
+					return;
+
+				D3D11_BUFFER_DESC desc = {};
+				desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+				desc.ByteWidth = slotCount * InstanceBytes;
+				desc.Usage = D3D11_USAGE_DEFAULT;
+				desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+				desc.StructureByteStride = InstanceBytes;
+				Device->CreateBuffer(&desc, 0, InstanceBuffer.ReleaseAndGetAddressOf());
+
+				D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+				srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+				srvDesc.Buffer.FirstElement = 0;
+				srvDesc.Buffer.NumElements = slotCount;
+				Device->CreateShaderResourceView(InstanceBuffer.Get(), &srvDesc, InstanceSRV.ReleaseAndGetAddressOf());
+				instanceSlotCount = slotCount;
+			}
+
+			void UpdateInstances(unsigned int firstSlot, unsigned int count, const void* data) override
+			{
+				D3D11_BOX box = { firstSlot * InstanceBytes, 0, 0, (firstSlot + count) * InstanceBytes, 1, 1 };
+				Context->UpdateSubresource(InstanceBuffer.Get(), 0, &box, data, 0, 0);
+				ConstantBytesUploaded += (unsigned long long)count * InstanceBytes;
+			}
+
+			// Rewritten by every pass, so it's mapped and discarded like
+			// a dynamic buffer should be (doubling when it's too small)
+			void SetInstanceOrder(const unsigned int* slots, unsigned int count) override
+			{
+				if (count > instanceOrderCapacity)
+				{
+					instanceOrderCapacity = instanceOrderCapacity * 2 > count ? instanceOrderCapacity * 2 : count;
+
+					D3D11_BUFFER_DESC desc = {};
+					desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+					desc.ByteWidth = instanceOrderCapacity * sizeof(unsigned int);
+					desc.Usage = D3D11_USAGE_DYNAMIC;
+					desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+					desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+					desc.StructureByteStride = sizeof(unsigned int);
+					Device->CreateBuffer(&desc, 0, InstanceOrderBuffer.ReleaseAndGetAddressOf());
+
+					D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+					srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+					srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+					srvDesc.Buffer.FirstElement = 0;
+					srvDesc.Buffer.NumElements = instanceOrderCapacity;
+					Device->CreateShaderResourceView(InstanceOrderBuffer.Get(), &srvDesc, InstanceOrderSRV.ReleaseAndGetAddressOf());
+				}
+
+				D3D11_MAPPED_SUBRESOURCE mapped = {};
+				Context->Map(InstanceOrderBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+				memcpy(mapped.pData, slots, count * sizeof(unsigned int));
+				Context->Unmap(InstanceOrderBuffer.Get(), 0);
+				ConstantBytesUploaded += count * sizeof(unsigned int);
+
+				ID3D11ShaderResourceView* views[2] = { InstanceSRV.Get(), InstanceOrderSRV.Get() };
+				Context->VSSetShaderResources(0, 2, views);
+			}
+
+			void ClearRenderTarget(ID3D11RenderTargetView* target, const float color[4]) override { Context->ClearRenderTargetView(target, color); }
+			void ClearDepth(ID3D11DepthStencilView* depth, float value) override { Context->ClearDepthStencilView(depth, D3D11_CLEAR_DEPTH, value, 0); }
+			void SetDepthStencilState(ID3D11DepthStencilState* state) override { Context->OMSetDepthStencilState(state, 0); }
+
+			void SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth) override
+			{
+				Context->OMSetRenderTargets(count, targets, depth);
+			}
+
+			void SetViewport(float width, float height) override
+			{
+				D3D11_VIEWPORT viewport = {};
+				viewport.Width = width;
+				viewport.Height = height;
+				viewport.MaxDepth = 1.0f;
+				Context->RSSetViewports(1, &viewport);
+			}
+
+			void Draw(unsigned int vertexCount, unsigned int firstVertex) override { Context->Draw(vertexCount, firstVertex); }
+
+			void DrawIndexed(unsigned int indexCount, unsigned int firstIndex, int baseVertex) override
+			{
+				Context->DrawIndexed(indexCount, firstIndex, baseVertex);
+			}
+
+			void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int firstIndex, int baseVertex, unsigned int firstInstance) override
+			{
+				Context->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+			}
+
+		private:
+			bool PersistentBlocksShared() const { return ConstantBufferOffsetting && ConstantBufferPartialUpdate; }
+
+			// Without offset binding, every upload goes into the slot's own
+			// dynamic buffer instead (discarded each time, so the draws
+			// already recorded keep what they saw)
+			void SetSlotConstants(StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size)
+			{
+				unsigned int incomingSize = ((size + 15) / 16) * 16;
+				Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer = SlotConstantBuffers[stage][slot];
+				if (incomingSize > slotConstantBytes[stage][slot])
+				{
+					D3D11_BUFFER_DESC desc = {};
+					desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+					desc.ByteWidth = incomingSize;
+					desc.Usage = D3D11_USAGE_DYNAMIC;
+					desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+					Device->CreateBuffer(&desc, 0, buffer.ReleaseAndGetAddressOf());
+					slotConstantBytes[stage][slot] = incomingSize;
+				}
+
+				D3D11_MAPPED_SUBRESOURCE map{};
+				Context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
+				memcpy(map.pData, data, size);
+				Context->Unmap(buffer.Get(), 0);
+
+				if (stage == StateCache::Vertex) { Context->VSSetConstantBuffers(slot, 1, buffer.GetAddressOf()); }
+				else { Context->PSSetConstantBuffers(slot, 1, buffer.GetAddressOf()); }
+				ConstantBytesUploaded += size;
+			}
+		};
+		ContextBackend contextBackend;
+
+		// --------------------------------------------------------
+		// What both kinds of initialization need once there's a
+		// device: the ring buffer (and which D3D11.1 constant buffer
+		// options it can use) and, in debug, the info queue
+		// --------------------------------------------------------
+		void CreateDeviceObjects()
+		{
+			//Ring Buffer Initialization
+			Context->QueryInterface<ID3D11DeviceContext1>(Context1.GetAddressOf());
+
+			// The ring buffer and persistent blocks need D3D11.1's constant buffer
+			// offsetting and partial updates - without them, ContextBackend
+			// falls back to a buffer per slot and per block
+			D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+			if (Context1 && SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+			{
+				ConstantBufferOffsetting = options.ConstantBufferOffsetting;
+				ConstantBufferPartialUpdate = options.ConstantBufferPartialUpdate;
+			}
+
+			cbOffsetBytes = 0;
+			cbSizeBytes = 256 * 1000; // The buffer size must be a multiple of 256, therefore...
+			cbSizeBytes = ((cbSizeBytes + 255) / 256) * 256;
+
+			D3D11_BUFFER_DESC ringBufferDesc = {};
+			ringBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			ringBufferDesc.ByteWidth = cbSizeBytes;
+			ringBufferDesc.Usage = D3D11_USAGE_DYNAMIC; // It will change over the course of the application's run
+			ringBufferDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
+			ringBufferDesc.MiscFlags = 0;
+			ringBufferDesc.StructureByteStride = 0;
+
+			Device->CreateBuffer(&ringBufferDesc, 0, ConstBufferHeap.GetAddressOf());
+
+#if defined(DEBUG) || defined(_DEBUG)
+			// If we're in debug mode, set up the info queue to
+			// get debug messages we can print to our console
+			Microsoft::WRL::ComPtr<ID3D11Debug> debug;
+			Device->QueryInterface(IID_PPV_ARGS(debug.GetAddressOf()));
+			debug->QueryInterface(IID_PPV_ARGS(InfoQueue.GetAddressOf()));
+#endif
+		}
 	}
 }
 
@@ -147,6 +475,7 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 
 	// We're set up
 	apiInitialized = true;
+	SetBackend(0);
 
 	// Call ResizeBuffers(), which will also set up the 
 	// render target view and depth stencil view for the
@@ -154,34 +483,71 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 	// will also set the appropriate viewport.
 	ResizeBuffers(windowWidth, windowHeight);
 
-	//Ring Buffer Initialization
-	Context->QueryInterface<ID3D11DeviceContext1>(Context1.GetAddressOf());
-
-	cbOffsetBytes = 0;
-	cbSizeBytes = 256 * 1000; // The buffer size must be a multiple of 256, therefore...
-	cbSizeBytes = ((cbSizeBytes + 255) / 256) * 256;
-
-	D3D11_BUFFER_DESC ringBufferDesc = {};
-	ringBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	ringBufferDesc.ByteWidth = cbSizeBytes;
-	ringBufferDesc.Usage = D3D11_USAGE_DYNAMIC; // It will change over the course of the application's run
-	ringBufferDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE;
-	ringBufferDesc.MiscFlags = 0;
-	ringBufferDesc.StructureByteStride = 0;
+	// Constant buffers and the debug layer's messages
+	CreateDeviceObjects();
+	return S_OK;
+}
 
-	Device->CreateBuffer(&ringBufferDesc, 0, ConstBufferHeap.GetAddressOf());
+// --------------------------------------------------------
+// Initializes the Graphics API without a window, to run
+// frames on the null backend (see Main.cpp)
+//
+// - Resources still need a device to be created on: the null
+//    driver (which draws nothing) or, where that isn't
+//    installed, WARP
+// - There's no swap chain, so the back buffer is a plain
+//    texture and nothing is ever presented
+// --------------------------------------------------------
+HRESULT Graphics::InitializeHeadless(unsigned int width, unsigned int height)
+{
+	// Only initialize once
+	if (apiInitialized)
+		return E_FAIL;
 
+	unsigned int deviceFlags = 0;
 #if defined(DEBUG) || defined(_DEBUG)
-	// If we're in debug mode, set up the info queue to
-	// get debug messages we can print to our console
-	Microsoft::WRL::ComPtr<ID3D11Debug> debug;
-	Device->QueryInterface(IID_PPV_ARGS(debug.GetAddressOf()));
-	debug->QueryInterface(IID_PPV_ARGS(InfoQueue.GetAddressOf()));
+	deviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
+	HRESULT hr = E_FAIL;
+	D3D_DRIVER_TYPE driverTypes[] = { D3D_DRIVER_TYPE_NULL, D3D_DRIVER_TYPE_WARP };
+	for (D3D_DRIVER_TYPE driverType : driverTypes)
+	{
+		hr = D3D11CreateDevice(
+			0,
+			driverType,
+			0,
+			deviceFlags,
+			0,
+			0,
+			D3D11_SDK_VERSION,
+			Device.ReleaseAndGetAddressOf(),
+			&featureLevel,
+			Context.ReleaseAndGetAddressOf());
+		if (SUCCEEDED(hr))
+			break;
+	}
+	if (FAILED(hr))
+		return hr;
+
+	apiInitialized = true;
+	SetBackend(0);
+	ResizeBuffers(width, height);
+	CreateDeviceObjects();
 	return S_OK;
 }
 
+
+// --------------------------------------------------------
+// Swaps where the frame's binds, constants and draws go (and
+// starts the state cache over) - null means the D3D11 backend
+// --------------------------------------------------------
+void Graphics::SetBackend(RenderBackend* backend)
+{
+	Backend = backend ? backend : &contextBackend;
+	State.SetTarget(Backend);
+}
+
 // --------------------------------------------------------
 // Called at the end of the program to clean up any
 // graphics API specific memory. 
@@ -215,20 +581,37 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	BackBufferRTV.Reset();
 	DepthBufferDSV.Reset();
 
-	// Resize the swap chain buffers
-	SwapChain->ResizeBuffers(
-		2, 
-		width, 
-		height, 
-		DXGI_FORMAT_R8G8B8A8_UNORM, 
-		supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
-
-	// Grab the references to the first buffer
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> backBufferTexture;
-	SwapChain->GetBuffer(
-		0,
-		__uuidof(ID3D11Texture2D),
-		(void**)backBufferTexture.GetAddressOf());
+	if (SwapChain)
+	{
+		// Resize the swap chain buffers
+		SwapChain->ResizeBuffers(
+			2, 
+			width, 
+			height, 
+			DXGI_FORMAT_R8G8B8A8_UNORM, 
+			supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+
+		// Grab the references to the first buffer
+		SwapChain->GetBuffer(
+			0,
+			__uuidof(ID3D11Texture2D),
+			(void**)backBufferTexture.GetAddressOf());
+	}
+	else
+	{
+		// Headless - nothing to present, so just a texture the same size
+		D3D11_TEXTURE2D_DESC backBufferDesc = {};
+		backBufferDesc.Width = width;
+		backBufferDesc.Height = height;
+		backBufferDesc.MipLevels = 1;
+		backBufferDesc.ArraySize = 1;
+		backBufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		backBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		backBufferDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+		backBufferDesc.SampleDesc.Count = 1;
+		Device->CreateTexture2D(&backBufferDesc, 0, backBufferTexture.GetAddressOf());
+	}
 
 	// Now that we have the texture, create a render target view
 	// for the back buffer so we can render into it.
@@ -279,7 +662,8 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	Context->RSSetViewports(1, &viewport);
 
 	// Are we in a fullscreen state?
-	SwapChain->GetFullscreenState(&isFullscreen, 0);
+	if (SwapChain)
+		SwapChain->GetFullscreenState(&isFullscreen, 0);
 }
 
 
@@ -340,62 +724,6 @@ void Graphics::PrintDebugMessages()
 
 void Graphics::FillAndBindNextConstantBuffer(void* data, unsigned int dataSizeInBytes, D3D11_SHADER_TYPE shaderType, unsigned int registerSlot) 
 {
-
-	// 1. Get the size of the incoming data, and pad the size to be a multiple of 256
-	unsigned int incomingSize = ((dataSizeInBytes + 255) / 256) * 256;
-
-	// 1.5 Check if the remaining space in the buffer is sufficient to store incoming data, otherwise *circle* back around
-	if (incomingSize + cbOffsetBytes > cbSizeBytes) 
-	{
-		cbOffsetBytes = 0;
-	}
-
-	// 2. Copy the data over, by first mapping the storage size, and them using memcpy
-	// Mapping -> Specify the buffer to write into and the kind of data being written(can be disposed, should not be disposed)
-	D3D11_MAPPED_SUBRESOURCE map{};
-	Context->Map(
-		ConstBufferHeap.Get(),
-		0,
-		D3D11_MAP_WRITE_NO_OVERWRITE,
-		0,
-		&map);
-	// memcpy -> Make sure data is written into the right address, remember we just checked if the incoming data will fit, 
-	// calculations for the address to be written to still need to be done!
-	void* uploadAddress = reinterpret_cast<void*>((UINT64)map.pData + cbOffsetBytes);
-	memcpy(uploadAddress, data, dataSizeInBytes);
-
-	// UNMAP
-	Context->Unmap(ConstBufferHeap.Get(), 0);
-
-	// 3. Tell the GPU the data is ready to use, known as BINDING, by specifying byte boundaries. 
-	// This is where 11.1 version is crucial. I cannot fathom why, I have been told it is
-	// Since we work with HLSL, only 16-byte boundaries need to be taken care of.
-	unsigned int existingConstant = cbOffsetBytes/16; // How many 16 byte blocks are occupied already?
-	unsigned int incomingConstant = incomingSize/16; // How many 16 byte blocks will be occupied?
-	// Use a switch statement for the vertex and pixel shaders that follow the 16-byte boundary rule.
-	switch (shaderType) 
-	{
-		case D3D11_VERTEX_SHADER:
-			Context1->VSSetConstantBuffers1(
-				registerSlot,
-				1,
-				ConstBufferHeap.GetAddressOf(),
-				&existingConstant,
-				&incomingConstant);
-			break;
-
-		case D3D11_PIXEL_SHADER:
-			Context1->PSSetConstantBuffers1(
-				registerSlot,
-				1,
-				ConstBufferHeap.GetAddressOf(),
-				&existingConstant,
-				&incomingConstant);
-			break;
-
-	}
-
-	// 4. Update the offset value - tells the next free space to go to. 
-	cbOffsetBytes += incomingSize;
-
+	// The ring buffer itself is in ContextBackend::SetConstants()
+	Backend->SetConstants(shaderType == D3D11_PIXEL_SHADER ? StateCache::Pixel : StateCache::Vertex, registerSlot, data, dataSizeInBytes);
 }
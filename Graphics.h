@@ -5,7 +5,9 @@
 #include <d3d11_1.h>
 #include <d3d11shadertracing.h>
 #include <string>
+#include <vector>
 #include <wrl/client.h>
+#include "RenderBackend.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -29,6 +31,45 @@ namespace Graphics
 	// Offset in Bytes
 	inline unsigned int cbOffsetBytes;
 
+	// Constants that stay put between frames (RenderBackend's persistent
+	// blocks), for objects that haven't changed - grown when more are reserved
+	inline Microsoft::WRL::ComPtr<ID3D11Buffer> PersistentConstantBuffer;
+	inline unsigned int persistentBlockCount = 0;
+
+	// D3D11.1 options the two buffers above rely on, which the runtime
+	// may not have even on an 11.1 device (checked in Initialize())
+	// - Offsetting binds part of a buffer (the ring buffer and blocks)
+	// - Partial updates copy into part of one (the blocks)
+	inline bool ConstantBufferOffsetting = false;
+	inline bool ConstantBufferPartialUpdate = false;
+
+	// What's used in their place without them: a small dynamic buffer
+	// per stage and slot, rewritten with every upload, and a buffer per
+	// persistent block
+	inline Microsoft::WRL::ComPtr<ID3D11Buffer> SlotConstantBuffers[StateCache::StageCount][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	inline unsigned int slotConstantBytes[StateCache::StageCount][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = {};
+	inline std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>> PersistentConstantBlocks;
+
+	// Instances that stay put between frames (RenderBackend's instance
+	// slots), and the dynamic list of which ones each pass draws
+	inline Microsoft::WRL::ComPtr<ID3D11Buffer> InstanceBuffer;
+	inline Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> InstanceSRV;
+	inline unsigned int instanceSlotCount = 0;
+	inline Microsoft::WRL::ComPtr<ID3D11Buffer> InstanceOrderBuffer;
+	inline Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> InstanceOrderSRV;
+	inline unsigned int instanceOrderCapacity = 0;
+
+	// Bytes copied into any of these buffers since this was last
+	// zeroed (Game::Draw() does once a frame)
+	inline unsigned long long ConstantBytesUploaded = 0;
+
+	// Shaders, input layout, rasterizer state, vertex/index buffers,
+	// shader resources and samplers go through this, not Context
+	inline StateCache State;
+
+	// Where State's binds, constants and draws end up (see RenderBackend.h)
+	inline RenderBackend* Backend = 0;
+
 	// Rendering buffers
 	inline Microsoft::WRL::ComPtr<ID3D11RenderTargetView> BackBufferRTV;
 	inline Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthBufferDSV;
@@ -44,9 +85,11 @@ namespace Graphics
 
 	// General functions
 	HRESULT Initialize(unsigned int windowWidth, unsigned int windowHeight, HWND windowHandle, bool vsyncIfPossible);
+	HRESULT InitializeHeadless(unsigned int width, unsigned int height); // No window or swap chain - see Graphics.cpp
 	void ShutDown();
 	void ResizeBuffers(unsigned int width, unsigned int height);
 	void FillAndBindNextConstantBuffer(void* data, unsigned int dataSizeInBytes, D3D11_SHADER_TYPE shaderType, unsigned int registerSlot);
+	void SetBackend(RenderBackend* backend); // Null for the D3D11 one
 
 	// Debug Layer
 	void PrintDebugMessages();
@@ -0,0 +1,41 @@
+#include "InstanceBatcher.h"
+
+uint64_t InstanceBatcher::MakeKey(unsigned int shader, unsigned int material, unsigned int mesh, unsigned int lod)
+{
+	return RenderQueue::MakeKey(RenderQueue::Opaque, shader, material, mesh, 0.0f) |
+		(lod & ((1ull << RenderQueue::DepthBits) - 1));
+}
+
+void InstanceBatcher::Clear()
+{
+	order.Clear();
+}
+
+void InstanceBatcher::Add(uint64_t key, unsigned int index)
+{
+	order.Add(key, index);
+}
+
+// --------------------------------------------------------
+// After sorting, batches are just runs of the same key, and
+// the sorted items' indices are the draw order
+// --------------------------------------------------------
+void InstanceBatcher::Build()
+{
+	order.Sort();
+
+	size_t count = order.Count();
+	const RenderQueue::Item* items = order.Items();
+	batches.clear();
+	indices.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (batches.empty() || batches.back().key != items[i].key)
+			batches.push_back({ items[i].key, (unsigned int)i, 0 });
+		batches.back().instanceCount++;
+		indices[i] = items[i].index;
+	}
+}
+
+const std::vector<InstanceBatcher::Batch>& InstanceBatcher::GetBatches() const { return batches; }
+const std::vector<unsigned int>& InstanceBatcher::GetIndices() const { return indices; }
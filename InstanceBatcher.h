@@ -0,0 +1,60 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "RenderQueue.h"
+
+// --------------------------------------------------------
+// Groups draws that can share one DrawIndexedInstanced call
+//
+// - Each draw comes with a key (same key = same shaders,
+//    material, mesh and LOD, so one draw call can do them all)
+//    and the caller's index for it
+// - Build() sorts by key (with RenderQueue's radix sort, so
+//    batches come out in the same state-change friendly order)
+//    and lists every batch's indices next to each other - the
+//    order to draw the instances in (their data stays in
+//    InstanceSlots, which only copies what changed)
+// - Plain CPU code, the GPU side is in Game::Draw()
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	// One instance, as the instanced shaders read it (InstanceData
+	// in InstancedVertexShader.hlsl and InstancedShadowVertex.hlsl,
+	// RenderBackend::InstanceBytes each)
+	struct Instance
+	{
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMFLOAT4X4 worldInverseTranspose;
+	};
+
+	struct Batch
+	{
+		uint64_t key;
+		unsigned int firstInstance;	// Into GetIndices()
+		unsigned int instanceCount;
+	};
+
+	// A RenderQueue key with the LOD where the depth would go (every
+	// instance in a batch is drawn together, so depth doesn't matter)
+	static uint64_t MakeKey(unsigned int shader, unsigned int material, unsigned int mesh, unsigned int lod);
+
+	void Clear();
+
+	// index is the caller's, to find the draw's mesh, material and instance again
+	void Add(uint64_t key, unsigned int index);
+
+	// Sorts and groups everything added since Clear() - draws with
+	// the same key stay in the order they were added
+	void Build();
+
+	const std::vector<Batch>& GetBatches() const;
+	const std::vector<unsigned int>& GetIndices() const; // The caller's index of each instance, batch after batch
+
+private:
+	RenderQueue order;
+
+	std::vector<Batch> batches;
+	std::vector<unsigned int> indices;
+};
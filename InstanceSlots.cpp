@@ -0,0 +1,102 @@
+#include "InstanceSlots.h"
+#include <algorithm>
+#include <cstring>
+
+InstanceSlots::InstanceSlots()
+{
+	target = 0;
+	reservedCount = 0;
+	stats = {};
+}
+
+void InstanceSlots::BeginFrame(RenderBackend* newTarget, unsigned int objectCount)
+{
+	stats = {};
+	writtenObjects.clear();
+	writtenData.clear();
+
+	if (newTarget != target)
+	{
+		target = newTarget;
+		reservedCount = 0;
+		for (Entry& entry : entries)
+			entry.current = false;
+	}
+	if (objectCount <= reservedCount)
+		return;
+
+	// Doubling, and whatever the slots held may be gone
+	unsigned int newCount = reservedCount > 0 ? reservedCount : 64;
+	while (newCount < objectCount)
+		newCount *= 2;
+	target->ReserveInstances(newCount);
+	reservedCount = newCount;
+	for (Entry& entry : entries)
+		entry.current = false;
+}
+
+bool InstanceSlots::IsCurrent(unsigned int object, unsigned int version)
+{
+	if (object >= entries.size())
+		entries.resize(object + 1, { 0, false });
+
+	Entry& entry = entries[object];
+	if (entry.version != version)
+	{
+		entry.version = version;
+		entry.current = false;
+	}
+	if (entry.current)
+		stats.current++;
+	return entry.current;
+}
+
+void InstanceSlots::Write(unsigned int object, const void* instance)
+{
+	entries[object].current = true;
+	writtenObjects.push_back(object);
+	size_t at = writtenData.size();
+	writtenData.resize(at + RenderBackend::InstanceBytes);
+	memcpy(&writtenData[at], instance, RenderBackend::InstanceBytes);
+}
+
+// --------------------------------------------------------
+// Writes come in draw order, so they're sorted by slot first
+// and each run of neighbouring slots goes over in one copy
+// --------------------------------------------------------
+void InstanceSlots::Submit(const std::vector<unsigned int>& order)
+{
+	const unsigned int instanceBytes = RenderBackend::InstanceBytes;
+	unsigned int count = (unsigned int)writtenObjects.size();
+	sorted.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		sorted[i] = i;
+	std::sort(sorted.begin(), sorted.end(), [&](unsigned int a, unsigned int b) { return writtenObjects[a] < writtenObjects[b]; });
+
+	runData.resize((size_t)count * instanceBytes);
+	unsigned int runStart = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		memcpy(&runData[(size_t)i * instanceBytes], &writtenData[(size_t)sorted[i] * instanceBytes], instanceBytes);
+
+		bool runEnds = i + 1 == count || writtenObjects[sorted[i + 1]] != writtenObjects[sorted[i]] + 1;
+		if (!runEnds)
+			continue;
+
+		target->UpdateInstances(writtenObjects[sorted[runStart]], i + 1 - runStart, &runData[(size_t)runStart * instanceBytes]);
+		stats.copies++;
+		runStart = i + 1;
+	}
+	stats.written += count;
+	stats.uploadedBytes += (unsigned long long)count * instanceBytes;
+	writtenObjects.clear();
+	writtenData.clear();
+
+	if (order.empty())
+		return;
+	target->SetInstanceOrder(order.data(), (unsigned int)order.size());
+	stats.uploadedBytes += order.size() * sizeof(unsigned int);
+}
+
+InstanceSlots::Stats InstanceSlots::GetStats() const { return stats; }
+unsigned int InstanceSlots::GetSlotCount() const { return reservedCount; }
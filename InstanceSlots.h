@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include "RenderBackend.h"
+
+// --------------------------------------------------------
+// Per-object instance data for the instanced shaders that
+// is only uploaded when it changes
+//
+// - Each object (an entity's index) owns one slot of the
+//    backend's instance storage, holding its instance as of
+//    some version (Transform::GetVersion())
+// - A pass asks which of its objects' slots are stale, writes
+//    just those, then hands over the order its batches draw
+//    them in - 4 bytes an instance, rather than the whole
+//    instance every frame
+// - Stale slots are copied as runs of neighbours, so even a
+//    scene that's all moving is a few large copies
+// - Like ObjectConstants, nothing here touches D3D11
+// --------------------------------------------------------
+class InstanceSlots
+{
+public:
+	// This frame's uploads so far
+	struct Stats
+	{
+		unsigned int current; // Already on the GPU - nothing copied
+		unsigned int written;
+		unsigned int copies; // UpdateInstances() calls the writes took
+		unsigned long long uploadedBytes; // Instances and draw orders
+	};
+
+	InstanceSlots();
+
+	// Once a frame, before any IsCurrent(), with how many objects there
+	// may be - a target other than last frame's, or more objects than
+	// it has slots for, means every slot is written again
+	void BeginFrame(RenderBackend* target, unsigned int objectCount);
+
+	// True if the object's slot holds this version. Otherwise false, and
+	// the caller passes the object's instance (RenderBackend::InstanceBytes)
+	// to Write() before the pass's Submit()
+	bool IsCurrent(unsigned int object, unsigned int version);
+	void Write(unsigned int object, const void* instance);
+
+	// Copies everything written since the last Submit(), then sets the
+	// order the pass's batches draw the objects in
+	void Submit(const std::vector<unsigned int>& order);
+
+	Stats GetStats() const;
+	unsigned int GetSlotCount() const; // Reserved on the target so far
+
+private:
+	struct Entry
+	{
+		unsigned int version;
+		bool current; // The slot holds version (or will, once submitted)
+	};
+
+	RenderBackend* target;
+	std::vector<Entry> entries;
+	unsigned int reservedCount;
+	Stats stats;
+
+	// Waiting for Submit(), in the order they were written
+	std::vector<unsigned int> writtenObjects;
+	std::vector<unsigned char> writtenData;
+
+	// Submit()'s scratch space, kept to avoid reallocating
+	std::vector<unsigned int> sorted;
+	std::vector<unsigned char> runData;
+};
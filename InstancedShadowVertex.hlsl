@@ -0,0 +1,32 @@
+#include "ShaderInclude.hlsli"
+
+// One per instance - matches InstanceBatcher::Instance
+struct InstanceData
+{
+    float4x4 world;
+    float4x4 worldInv;
+};
+
+StructuredBuffer<InstanceData> instances : register(t0);
+StructuredBuffer<uint> instanceOrder : register(t1); // Slots, batch after batch
+
+// Same as ShadowMapVertex.hlsl - once for the whole pass
+cbuffer shadowData : register(b0)
+{
+    matrix view;
+    matrix proj;
+}
+
+// Per batch, in place of ShadowMapVertex.hlsl's world matrix
+cbuffer BatchData : register(b1)
+{
+    uint firstInstance; // This batch's first entry in instanceOrder
+}
+
+
+
+float4 main( PositionOnlyVertexShaderInput input, uint instanceID : SV_InstanceID ) : SV_POSITION
+{
+    matrix wvp = mul(proj, mul(view, instances[instanceOrder[firstInstance + instanceID]].world));
+    return mul(wvp, float4(input.localPosition, 1.0f));
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "ShaderInclude.hlsli"
+
+// One per instance - matches InstanceBatcher::Instance
+struct InstanceData
+{
+    float4x4 world;
+    float4x4 worldInv;
+};
+
+// Every entity's instance, in its own slot (see InstanceSlots.h)
+StructuredBuffer<InstanceData> instances : register(t0);
+
+// The slots this pass draws, batch after batch
+StructuredBuffer<uint> instanceOrder : register(t1);
+
+//Buffer for external data
+// - The same per-pass block VertexShader.hlsl gets
+cbuffer ExternalVertexData : register(b0)
+{
+    float4x4 view			: VIEW_MATRIX;
+    float4x4 proj			: PROJECTION_MATRIX;
+    float4x4 shadowView		: LIGHT_VIEW_MATRIX;
+    float4x4 shadowProj		: LIGHT_PROJECTION_MATRIX;
+};
+
+// Per batch, in place of VertexShader.hlsl's per-entity matrices
+cbuffer BatchData : register(b1)
+{
+    uint firstInstance;		// This batch's first entry in instanceOrder
+};
+
+// --------------------------------------------------------
+// Instanced version of VertexShader.hlsl
+//
+// - SV_InstanceID counts from 0 in every draw, whatever the
+//   start instance is, so the batch's offset comes in b1
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input, uint instanceID : SV_InstanceID )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+    InstanceData instance = instances[instanceOrder[firstInstance + instanceID]];
+
+    float4x4 wvp = mul(proj, mul(view, instance.world));
+    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    output.normal = mul((float3x3)instance.worldInv, input.normal);
+    output.tangent = mul((float3x3)instance.world, input.tangent);
+    output.worldPos = mul(instance.world, float4(input.localPosition, 1.0f)).xyz;
+    output.uv = input.uv;
+
+    matrix shadowWVP = mul(shadowProj, mul(shadowView, instance.world));
+    output.shadowDepth =  mul(shadowWVP, float4(input.localPosition, 1.0f));
+
+	return output;
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "Jobs.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Jobs
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> queue;
+		std::mutex queueMutex;
+		std::condition_variable queueSignal;
+		bool stopping = false;
+
+		// Shared between the caller of ParallelFor() and its helpers.
+		// Helpers that start after the caller has finished just exit,
+		// so the caller never waits on jobs stuck in the queue.
+		struct ParallelForState
+		{
+			std::atomic<unsigned int> next = 0;
+			unsigned int count = 0;
+			const std::function<void(unsigned int)>* body = 0;
+
+			std::mutex mutex;
+			std::condition_variable finished;
+			unsigned int activeHelpers = 0;
+			bool closed = false;
+			std::exception_ptr error;
+		};
+
+		void RunIterations(ParallelForState& state)
+		{
+			for (unsigned int i = state.next++; i < state.count; i = state.next++)
+			{
+				try
+				{
+					(*state.body)(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(state.mutex);
+					if (!state.error)
+						state.error = std::current_exception();
+					state.next = state.count; // Skip whatever is left
+				}
+			}
+		}
+
+		void WorkerLoop()
+		{
+			while (true)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(queueMutex);
+					queueSignal.wait(lock, [] { return stopping || !queue.empty(); });
+					if (queue.empty())
+						return;
+
+					job = std::move(queue.front());
+					queue.pop_front();
+				}
+				job();
+			}
+		}
+	}
+}
+
+void Jobs::Initialize(unsigned int workerCount)
+{
+	// Only initialize once
+	if (!workers.empty())
+		return;
+
+	if (workerCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	stopping = false;
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back(WorkerLoop);
+}
+
+void Jobs::ShutDown()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueSignal.notify_all();
+
+	// Workers drain the queue before exiting
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+unsigned int Jobs::ThreadCount() { return (unsigned int)workers.size() + 1; }
+
+void Jobs::Submit(std::function<void()> job)
+{
+	if (workers.empty())
+	{
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(std::move(job));
+	}
+	queueSignal.notify_one();
+}
+
+void Jobs::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+{
+	if (count == 0)
+		return;
+
+	// Nothing to share - just run it here
+	if (workers.empty() || count == 1)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			body(i);
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->count = count;
+	state->body = &body;
+
+	// One helper per worker (at most), the calling thread does the rest
+	unsigned int helpers = count - 1 < workers.size() ? count - 1 : (unsigned int)workers.size();
+	for (unsigned int h = 0; h < helpers; h++)
+	{
+		Submit([state]()
+			{
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (state->closed)
+						return;
+					state->activeHelpers++;
+				}
+
+				RunIterations(*state);
+
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->activeHelpers--;
+				}
+				state->finished.notify_all();
+			});
+	}
+
+	RunIterations(*state);
+
+	// Wait for helpers that actually started, then report any failure
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->closed = true;
+	state->finished.wait(lock, [&]() { return state->activeHelpers == 0; });
+	if (state->error)
+		std::rethrow_exception(state->error);
+}
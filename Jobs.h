@@ -0,0 +1,29 @@
+#pragma once
+#include <functional>
+
+// --------------------------------------------------------
+// A small pool of worker threads for CPU-heavy work
+//
+// - Initialize() once at startup, ShutDown() at exit
+// - If the pool isn't running, everything simply runs
+//    serially on the calling thread
+// - ParallelFor() also uses the calling thread, so it is
+//    safe to call from inside another job
+// --------------------------------------------------------
+namespace Jobs
+{
+	// workerCount of 0 means "one per core, minus the main thread"
+	void Initialize(unsigned int workerCount = 0);
+	void ShutDown();
+
+	// Worker threads plus the calling thread
+	unsigned int ThreadCount();
+
+	// Fire-and-forget work on a worker thread
+	void Submit(std::function<void()> job);
+
+	// Calls body(0) ... body(count - 1) spread over the pool, and
+	// returns once they have all finished.  The first exception
+	// thrown by any body is rethrown on the calling thread.
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body);
+}
@@ -1,11 +1,17 @@
 
 #include <Windows.h>
 #include <crtdbg.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
 
 #include "Window.h"
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "Jobs.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -25,6 +31,78 @@ namespace
 		if(game)
 			game->OnResize();
 	}
+
+	// --------------------------------------------------------
+	// "-headless [frames]" on the command line: the game's own
+	// Update() and Draw(), at a fixed 60 steps a second, with no
+	// window, swap chain or UI - every bind, constant and draw
+	// goes to the null backend. Prints what the frames did and
+	// returns non-zero if the backend reported any errors
+	// --------------------------------------------------------
+	int RunHeadless(const char* frameArgument)
+	{
+		unsigned int frameCount = atoi(frameArgument) > 0 ? (unsigned int)atoi(frameArgument) : 300;
+
+		Window::CreateConsoleWindow(500, 120, 32, 120);
+		Window::CreateHeadless(1280, 720);
+		HRESULT graphicsResult = Graphics::InitializeHeadless(Window::Width(), Window::Height());
+		if (FAILED(graphicsResult))
+		{
+			printf("Headless: no device could be created (0x%08x)\n", (unsigned int)graphicsResult);
+			return graphicsResult;
+		}
+
+		// Never updated, so no keys are down and the mouse stays put
+		Input::Initialize(0);
+		Jobs::Initialize();
+		game = new Game(true);
+
+		LARGE_INTEGER perfFreq{};
+		__int64 startTime = 0;
+		__int64 endTime = 0;
+		QueryPerformanceFrequency(&perfFreq);
+		QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+
+		const float deltaTime = 1.0f / 60.0f;
+		unsigned long long calls = 0, draws = 0, triangles = 0, constantBytes = 0;
+		unsigned int errorCount = 0;
+		std::vector<std::string> errors;
+		for (unsigned int frame = 0; frame < frameCount; frame++)
+		{
+			game->Update(deltaTime, frame * deltaTime);
+			game->Draw(deltaTime, frame * deltaTime);
+
+			const NullBackend& backend = game->GetNullBackend();
+			calls += backend.GetTotalCount();
+			draws += backend.GetCount(NullBackend::DrawCall) + backend.GetCount(NullBackend::DrawIndexedCall) + backend.GetCount(NullBackend::DrawIndexedInstancedCall);
+			triangles += backend.GetTriangleCount();
+			constantBytes += backend.GetConstantBytes();
+			errorCount += backend.GetErrorCount();
+			for (const std::string& error : backend.GetErrors())
+			{
+				if (errors.size() < NullBackend::MaxErrors)
+					errors.push_back("Frame " + std::to_string(frame) + ", " + error);
+			}
+		}
+		QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+		double seconds = (double)(endTime - startTime) / (double)perfFreq.QuadPart;
+
+		printf("Headless: %u frames in %.3f s (%.3f ms each)\n"
+			"  per frame: %llu calls, %llu draws, %llu triangles, %.1f KB of constants and instances\n"
+			"  %s (%u backend errors)\n",
+			frameCount, seconds, seconds * 1000 / frameCount,
+			calls / frameCount, draws / frameCount, triangles / frameCount, constantBytes / 1024.0 / frameCount,
+			errorCount == 0 ? "PASSED" : "FAILED", errorCount);
+		for (const std::string& error : errors)
+			printf("    %s\n", error.c_str());
+
+		delete game;
+		game = 0;
+		Jobs::ShutDown();
+		Input::ShutDown();
+		Graphics::ShutDown();
+		return errorCount == 0 ? 0 : 1;
+	}
 }
 
 
@@ -48,6 +126,11 @@ int WINAPI WinMain(
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
 
+	// Run frames with no window instead?
+	const char* headless = strstr(lpCmdLine, "-headless");
+	if (headless)
+		return RunHeadless(headless + strlen("-headless"));
+
 	// Set up app initialization details
 	unsigned int windowWidth = 1280;
 	unsigned int windowHeight = 720;
@@ -78,6 +161,9 @@ int WINAPI WinMain(
 	// Initalize the input system, which requires the window handle
 	Input::Initialize(Window::Handle());
 
+	// Start the worker threads before anything loads assets
+	Jobs::Initialize();
+
 	// Now the main application object itself can be initialzied
 	game = new Game();
 
@@ -139,6 +225,7 @@ int WINAPI WinMain(
 
 	// Clean up
 	delete game;
+	Jobs::ShutDown();
 	Input::ShutDown();
 	Graphics::ShutDown();
 	return (HRESULT)msg.wParam;
@@ -0,0 +1,86 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char* filePath)
+{
+	data = 0;
+	size = 0;
+	open = false;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = 0;
+
+	fileHandle = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+		return;
+	size = (size_t)fileSize.QuadPart;
+
+	// Zero-length files can't be mapped, but they are still valid (empty) files
+	open = true;
+	if (size == 0)
+		return;
+
+	mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (mappingHandle != 0)
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (data == 0)
+	{
+		size = 0;
+		open = false;
+	}
+#else
+	fileDescriptor = ::open(filePath, O_RDONLY);
+	if (fileDescriptor < 0)
+		return;
+
+	struct stat fileInfo = {};
+	if (fstat(fileDescriptor, &fileInfo) != 0)
+		return;
+	size = (size_t)fileInfo.st_size;
+
+	open = true;
+	if (size == 0)
+		return;
+
+	void* view = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		size = 0;
+		open = false;
+		return;
+	}
+
+	madvise(view, size, MADV_SEQUENTIAL);
+	data = (const char*)view;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) ::close(fileDescriptor);
+#endif
+}
+
+bool MappedFile::IsOpen() { return open; }
+const char* MappedFile::GetData() { return data; }
+size_t MappedFile::GetSize() { return size; }
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file
+//
+// - The OS pages the file in on demand, so there's no
+//    ifstream buffering or copying into our own memory
+// - GetData() stays valid until the MappedFile is destroyed
+// - An empty file is "open" but has a null data pointer
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const char* filePath);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete; // Owns OS handles, so no copying
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+	const char* data;
+	size_t size;
+	bool open;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
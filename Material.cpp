@@ -14,6 +14,7 @@ Material::Material(DirectX::XMFLOAT4 t, int metal, Microsoft::WRL::ComPtr<ID3D11
 	IsMetal = metal;
 	scale = DirectX::XMFLOAT2(1, 1);
 	offset = DirectX::XMFLOAT2(0, 0);
+	version = 0;
 	vertexShader = vs;
 	pixelShader = ps;
 	textureSRVCount = 0;
@@ -43,22 +44,42 @@ DirectX::XMFLOAT4 Material::GetTint() { return tint; }
 DirectX::XMFLOAT2 Material::GetScale() { return scale; }
 DirectX::XMFLOAT2 Material::GetOffset() { return offset; }
 int Material::GetIsMetal() { return IsMetal; }
+unsigned int Material::GetVersion() { return version; }
 
-void Material::SetTint(DirectX::XMFLOAT4 t) { tint = t; }
+// The UI sets these every frame whether they moved or not, so
+// only a real change counts as a new version
+void Material::SetTint(DirectX::XMFLOAT4 t) 
+{
+	if (t.x == tint.x && t.y == tint.y && t.z == tint.z && t.w == tint.w) { return; }
+	tint = t;
+	version++;
+}
 void Material::SetVS(Microsoft::WRL::ComPtr<ID3D11VertexShader> vs) { vertexShader = vs; }
 void Material::SetPS(Microsoft::WRL::ComPtr<ID3D11PixelShader> ps) { pixelShader = ps; }
-void Material::SetScale(DirectX::XMFLOAT2 s) { scale = s; }
-void Material::SetOffset(DirectX::XMFLOAT2 o) { offset = o; }
+void Material::SetScale(DirectX::XMFLOAT2 s) 
+{
+	if (s.x == scale.x && s.y == scale.y) { return; }
+	scale = s;
+	version++;
+}
+void Material::SetOffset(DirectX::XMFLOAT2 o) 
+{
+	if (o.x == offset.x && o.y == offset.y) { return; }
+	offset = o;
+	version++;
+}
 
+// Slot by slot - the state cache sends them as one call per
+// kind, and skips the ones the last material already bound
 void Material::BindTexturesSamplers() 
 {
 	for (unsigned int i = 0; i<textureSRVCount; i++) 
 	{
-		Graphics::Context->PSSetShaderResources(i,1,textureSRVs[i].GetAddressOf());
+		Graphics::State.SetShaderResources(StateCache::Pixel, i, 1, textureSRVs[i].GetAddressOf());
 	}
 
 	for (unsigned int i = 0; i<samplerCount; i++) 
 	{
-		Graphics::Context->PSSetSamplers(i, 1, samplers[i].GetAddressOf());
+		Graphics::State.SetSamplers(StateCache::Pixel, i, 1, samplers[i].GetAddressOf());
 	}
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ private:
 	DirectX::XMFLOAT2 scale;
 	DirectX::XMFLOAT2 offset;
 	bool IsMetal;
+	unsigned int version;
 
 	Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
@@ -35,6 +36,7 @@ public:
 	void SetTint(DirectX::XMFLOAT4 t);
 	void SetScale(DirectX::XMFLOAT2 s);
 	void SetOffset(DirectX::XMFLOAT2 o);
+	unsigned int GetVersion(); // Goes up when the tint, scale or offset really change - setting the same value again doesn't count
 	void SetVS(Microsoft::WRL::ComPtr<ID3D11VertexShader> vs);
 	void SetPS(Microsoft::WRL::ComPtr<ID3D11PixelShader> ps);
 	int GetIsMetal();
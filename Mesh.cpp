@@ -1,283 +1,192 @@
 #include "Mesh.h"
+#include "ObjParser.h"
+#include "VertexWelder.h"
+#include "Tangents.h"
+#include <algorithm>
+#include <cmath>
 
 
 Mesh::Mesh(Vertex* v, int vCount, unsigned int* i, int iCount)
 {
-	Mesh::CreateBuffers(v, vCount, i, iCount);
+	MeshData data;
+	data.verts.assign(v, v + vCount);
+	data.indices.assign(i, i + iCount);
+	data.sourceVertexCount = vCount;
+	data.sourceCacheStats = MeshOptimizer::SimulateCache(i, iCount, vCount);
+	Cook(data);
+	CreateFromData(data);
 }
 
-Mesh::Mesh(const char* objFilePath) 
+Mesh::Mesh(const char* objFilePath, float weldEpsilon, bool occluder, bool packed, bool shadowCaster) 
 {
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-
-	// *************************************
-	//      IMPLEMENTATION NOTES (1/2)
-	//
-	//  - You'll need to #include both
-	//      <fstream> and <stdexcept>
-	//
-	//  - You will need to integrate
-	//      this code into a function or
-	//      constructor of your own making
-	//
-	//  - There is MORE TO DO after pasting 
-	//      this code in - see the bottom for
-	//      what to do *after* including 
-	//      this code in your mesh class
-	//
-	// *************************************
-
-	// File input object
-		std::ifstream obj(objFilePath);
-
-		// Check for successful open
-		if (!obj.is_open())
-			throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
-
-		// Variables used while reading the file
-		std::vector<XMFLOAT3> positions;	// Positions from the file
-		std::vector<XMFLOAT3> normals;		// Normals from the file
-		std::vector<XMFLOAT2> uvs;		// UVs from the file
-		std::vector<Vertex> verts;		// Verts we're assembling
-		std::vector<UINT> indices;		// Indices of these verts
-		int vertCounter = 0;			// Count of vertices
-		int indexCounter = 0;			// Count of indices
-		char chars[100];			// String for line reading
-
-		// Still have data left?
-		while (obj.good())
-		{
-			// Get the line (100 characters should be more than enough)
-			obj.getline(chars, 100);
-
-			// Check the type of line
-			if (chars[0] == 'v' && chars[1] == 'n')
-			{
-				// Read the 3 numbers directly into an XMFLOAT3
-				XMFLOAT3 norm;
-				sscanf_s(
-					chars,
-					"vn %f %f %f",
-					&norm.x, &norm.y, &norm.z);
-
-				// Add to the list of normals
-				normals.push_back(norm);
-			}
-			else if (chars[0] == 'v' && chars[1] == 't')
-			{
-				// Read the 2 numbers directly into an XMFLOAT2
-				XMFLOAT2 uv;
-				sscanf_s(
-					chars,
-					"vt %f %f",
-					&uv.x, &uv.y);
-
-				// Add to the list of uv's
-				uvs.push_back(uv);
-			}
-			else if (chars[0] == 'v')
-			{
-				// Read the 3 numbers directly into an XMFLOAT3
-				XMFLOAT3 pos;
-				sscanf_s(
-					chars,
-					"v %f %f %f",
-					&pos.x, &pos.y, &pos.z);
-
-				// Add to the positions
-				positions.push_back(pos);
-			}
-			else if (chars[0] == 'f')
-			{
-				// Read the face indices into an array
-				// NOTE: This assumes the given obj file contains
-				//  vertex positions, uv coordinates AND normals.
-				unsigned int i[12];
-				int numbersRead = sscanf_s(
-					chars,
-					"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-					&i[0], &i[1], &i[2],
-					&i[3], &i[4], &i[5],
-					&i[6], &i[7], &i[8],
-					&i[9], &i[10], &i[11]);
-
-				// If we only got the first number, chances are the OBJ
-				// file has no UV coordinates.  This isn't great, but we
-				// still want to load the model without crashing, so we
-				// need to re-read a different pattern (in which we assume
-				// there are no UVs denoted for any of the vertices)
-				if (numbersRead == 1)
-				{
-					// Re-read with a different pattern
-					numbersRead = sscanf_s(
-						chars,
-						"f %d//%d %d//%d %d//%d %d//%d",
-						&i[0], &i[2],
-						&i[3], &i[5],
-						&i[6], &i[8],
-						&i[9], &i[11]);
-
-					// The following indices are where the UVs should 
-					// have been, so give them a valid value
-					i[1] = 1;
-					i[4] = 1;
-					i[7] = 1;
-					i[10] = 1;
-
-					// If we have no UVs, create a single UV coordinate
-					// that will be used for all vertices
-					if (uvs.size() == 0)
-						uvs.push_back(XMFLOAT2(0, 0));
-				}
-
-				// - Create the verts by looking up
-				//    corresponding data from vectors
-				// - OBJ File indices are 1-based, so
-				//    they need to be adusted
-				Vertex v1;
-				v1.Position = positions[i[0] - 1];
-				v1.UV = uvs[i[1] - 1];
-				v1.Normal = normals[i[2] - 1];
-
-				Vertex v2;
-				v2.Position = positions[i[3] - 1];
-				v2.UV = uvs[i[4] - 1];
-				v2.Normal = normals[i[5] - 1];
-
-				Vertex v3;
-				v3.Position = positions[i[6] - 1];
-				v3.UV = uvs[i[7] - 1];
-				v3.Normal = normals[i[8] - 1];
-
-				// The model is most likely in a right-handed space,
-				// especially if it came from Maya.  We want to convert
-				// to a left-handed space for DirectX.  This means we 
-				// need to:
-				//  - Invert the Z position
-				//  - Invert the normal's Z
-				//  - Flip the winding order
-				// We also need to flip the UV coordinate since DirectX
-				// defines (0,0) as the top left of the texture, and many
-				// 3D modeling packages use the bottom left as (0,0)
-
-				// Flip the UV's since they're probably "upside down"
-				v1.UV.y = 1.0f - v1.UV.y;
-				v2.UV.y = 1.0f - v2.UV.y;
-				v3.UV.y = 1.0f - v3.UV.y;
-
-				// Flip Z (LH vs. RH)
-				v1.Position.z *= -1.0f;
-				v2.Position.z *= -1.0f;
-				v3.Position.z *= -1.0f;
-
-				// Flip normal's Z
-				v1.Normal.z *= -1.0f;
-				v2.Normal.z *= -1.0f;
-				v3.Normal.z *= -1.0f;
-
-				// Add the verts to the vector (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v3);
-				verts.push_back(v2);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-
-				// Was there a 4th face?
-				// - 12 numbers read means 4 faces WITH uv's
-				// - 8 numbers read means 4 faces WITHOUT uv's
-				if (numbersRead == 12 || numbersRead == 8)
-				{
-					// Make the last vertex
-					Vertex v4;
-					v4.Position = positions[i[9] - 1];
-					v4.UV = uvs[i[10] - 1];
-					v4.Normal = normals[i[11] - 1];
-
-					// Flip the UV, Z pos and normal's Z
-					v4.UV.y = 1.0f - v4.UV.y;
-					v4.Position.z *= -1.0f;
-					v4.Normal.z *= -1.0f;
-
-					// Add a whole triangle (flipping the winding order)
-					verts.push_back(v1);
-					verts.push_back(v4);
-					verts.push_back(v3);
-					vertCounter += 3;
-
-					// Add three more indices
-					indices.push_back(indexCounter); indexCounter += 1;
-					indices.push_back(indexCounter); indexCounter += 1;
-					indices.push_back(indexCounter); indexCounter += 1;
-				}
-			}
-		}
-
-		// Close the file and create the actual buffers
-		obj.close();
-
-		// *************************************
-		//      IMPLEMENTATION NOTES (2/2)
-		//
-		// - At this point, "verts" is a std::vector 
-		//     of Vertex structs, and can be used
-		//     to create your mesh's vertex buffer
-		//
-		// - NOTE: Use &verts[0] for the address of 
-		//     the first vertx, NOT JUST &verts
-		//
-		// - The vector "indices" is similar. It's 
-		//     a std::vector of unsigned ints and
-		//     can be used to create the index 
-		//     buffer (again, &indices[0] is the 
-		//     address of the first integer)
-		//
-		// - Make sure your mesh class actually SAVES
-		//     the number of vertices and indices, or
-		//     drawing may have unintended problems.
-		//     - "vertCounter" is the number of vertices
-		//     - "indexCounter" is the number of indices
-		//
-		// - If you dig into the code, you may notice 
-		//     that  "vertCounter" and "indexCounter" 
-		//     end up being the same.  Recall that OBJs 
-		//     do not index entire vertices, making
-		//     it complex to detect duplicate vertices.
-		//     This also means an index buffer isn't
-		//     doing much for us.  We could try to 
-		//     detect duplicate vertices ourselves, 
-		//     but at that point it would be better 
-		//     to use a more sophisticated mesh loading
-		//     library like TinyOBJLoader or 
-		//     The Open Asset Importer Library, both
-		//     of which are unnecessary for now.
-		//
-		// *************************************
-
-		// Calling the Tangent calculation 
-		Mesh::CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-
-		// Creating the buffer
-		Mesh::CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	MeshData data;
+	data.occluder = occluder;
+	data.packed = packed;
+	data.shadowCaster = shadowCaster;
+	LoadObj(objFilePath, weldEpsilon, data);
+	CreateFromData(data);
 }
 
-void Mesh::CreateBuffers(Vertex* v, int vCount, unsigned int* i, int iCount) 
+Mesh::Mesh(MeshFile& cookedFile, bool occluder, bool packed, bool shadowCaster)
 {
-	vertexCount = vCount;
-	indexCount = iCount;
+	if (!cookedFile.IsValid())
+		throw std::invalid_argument("Error loading mesh: Invalid or corrupt .ggp_mesh file");
+
+	// The mapped blobs go straight to the GPU, no copies on our side
+	Mesh::CreateBuffers(cookedFile.GetContents(), occluder, packed, shadowCaster);
+}
+
+Mesh::Mesh(MeshData& data)
+{
+	CreateFromData(data);
+}
+
+void Mesh::CreateFromData(MeshData& data)
+{
+	Mesh::CreateBuffers(data.GetContents(), data.occluder, data.packed, data.shadowCaster);
+}
+
+CookedMesh MeshData::GetContents()
+{
+	if (cookedFile)
+		return cookedFile->GetContents();
+
+	CookedMesh mesh = {};
+	mesh.vertices = verts.data();
+	mesh.positions = positions.data();
+	mesh.packedVertices = packedVerts.data();
+	mesh.vertexCount = (unsigned int)verts.size();
+	mesh.indices = indices.data();
+	mesh.indexCount = (unsigned int)indices.size();
+	mesh.lods = lods.data();
+	mesh.lodCount = (unsigned int)lods.size();
+	mesh.meshlets = meshlets.data();
+	mesh.meshletCount = (unsigned int)meshlets.size();
+	mesh.boundingBox = boundingBox;
+	mesh.boundingSphere = boundingSphere;
+	mesh.packedBounds = packedBounds;
+	mesh.packedError = packedError;
+	mesh.sourceVertexCount = sourceVertexCount;
+	mesh.sourceCacheStats = sourceCacheStats;
+	mesh.cacheStats = cacheStats;
+	return mesh;
+}
+
+void Mesh::LoadObj(const char* objFilePath, float weldEpsilon, MeshData& data)
+{
+	// Use the cooked .ggp_mesh next to the .obj if it's up to date
+	std::string cookedPath = MeshFile::CookedPath(objFilePath);
+	data.cookedFile = std::make_unique<MeshFile>(cookedPath.c_str());
+	if (data.cookedFile->IsCookedFrom(objFilePath, weldEpsilon))
+		return;
+
+	// Unmap it before cooking a new one over the top
+	data.cookedFile.reset();
+	ImportObj(objFilePath, weldEpsilon, data);
+
+	// Cook it for next time (if this fails we just parse again next launch)
+	MeshFile::Write(cookedPath.c_str(), data.GetContents(), objFilePath, weldEpsilon);
+}
+
+void Mesh::ImportObj(const char* objFilePath, float weldEpsilon, MeshData& data)
+{
+	std::vector<Vertex>& verts = data.verts;
+	std::vector<unsigned int>& indices = data.indices;
+
+	// The actual .obj parsing (memory-mapped, no sscanf) lives in ObjParser
+	// - It produces the same triangles as the original
+	//    getline/sscanf_s loader by Chris Cascioli
+	// - Unlike before, corners with the same position/uv/normal
+	//    share a vertex, so there are usually far fewer verts
+	//    than indices
+	if (!ObjParser::Load(objFilePath, verts, indices))
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	// The old loader made one vertex per corner
+	data.sourceVertexCount = (int)indices.size();
+
+	// Optional lossy weld for files that duplicate vertex data
+	// instead of sharing indices (must happen before tangents)
+	if (weldEpsilon > 0.0f)
+		VertexWelder::WeldByDistance(verts, indices, weldEpsilon);
+
+	// Reorder triangles for the post-transform cache, then
+	// verts for fetch locality (the triangles don't change)
+	data.sourceCacheStats = MeshOptimizer::SimulateCache(indices.data(), indices.size(), verts.size());
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), verts.size());
+	MeshOptimizer::OptimizeVertexFetch(verts.data(), verts.size(), indices.data(), indices.size());
+
+	// Calling the Tangent calculation 
+	Mesh::CalculateTangents(verts.data(), (int)verts.size(), indices.data(), (int)indices.size());
+
+	// Simplified versions for drawing far away - these only add
+	// indices, so they go after everything that changes verts
+	MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices, data.lods);
+
+	Cook(data);
+}
+
+void Mesh::Cook(MeshData& data)
+{
+	std::vector<Vertex>& verts = data.verts;
+	if (data.lods.empty())
+		data.lods.assign(1, MeshSimplifier::Lod{ 0, (unsigned int)data.indices.size(), 0.0f });
+	const MeshSimplifier::Lod& lod0 = data.lods[0];
+
+	// Split LOD 0 into meshlets - this reorders its triangles, so
+	// the cache stats have to come after
+	unsigned int* lod0Indices = data.indices.data() + lod0.firstIndex;
+	data.meshlets = Meshlets::Build(verts.data(), verts.size(), lod0Indices, lod0.indexCount);
+	for (Meshlets::Meshlet& m : data.meshlets)
+		m.firstIndex += lod0.firstIndex;
+	data.cacheStats = MeshOptimizer::SimulateCache(lod0Indices, lod0.indexCount, verts.size());
+
+	data.boundingBox = Bounds::ComputeBox(verts.data(), verts.size());
+	data.boundingSphere = Bounds::ComputeSphere(verts.data(), verts.size(), data.boundingBox);
+
+	// Just the positions, for passes that don't need anything else
+	data.positions.resize(verts.size());
+	for (size_t i = 0; i < verts.size(); i++)
+		data.positions[i] = verts[i].Position;
+
+	// Compressed vertices, with positions relative to the bounds
+	data.packedBounds = VertexCodec::ComputeBounds(verts.data(), verts.size());
+	data.packedVerts.resize(verts.size());
+	VertexCodec::Encode(verts.data(), verts.size(), data.packedBounds, data.packedVerts.data());
+	data.packedError = VertexCodec::MeasureError(verts.data(), data.packedVerts.data(), verts.size(), data.packedBounds);
+}
+
+void Mesh::CreateBuffers(const CookedMesh& mesh, bool occluder, bool packed, bool shadowCaster)
+{
+	lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+	meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+
+	// indexCount and the cache stats are for LOD 0, but
+	// the index buffer holds every LOD
+	vertexCount = (int)mesh.vertexCount;
+	indexCount = lods[0].indexCount;
+	sourceVertexCount = mesh.sourceVertexCount;
+	sourceCacheStats = mesh.sourceCacheStats;
+	cacheStats = mesh.cacheStats;
+	boundingBox = mesh.boundingBox;
+	boundingSphere = mesh.boundingSphere;
+	packedBounds = mesh.packedBounds;
+	packedError = mesh.packedError;
+
+	// LOD 0's triangles for the occlusion culler, if this mesh is
+	// one, are all we keep of the CPU-side data
+	if (occluder)
+	{
+		occluderPositions.assign(mesh.positions, mesh.positions + vertexCount);
+		occluderIndices.assign(mesh.indices + lods[0].firstIndex, mesh.indices + lods[0].firstIndex + indexCount);
+	}
 
 	// Creating Vertex Buffer
 	// vbd - characteristics of the vertex buffer required by D3D11
 	// initialVertexData - pointer to the vertices array
 	// vertexBuffer - pointer to the buffer on the GPU
+	// - Only for meshes drawn with the full Vertex layout
+	if (!packed)
 	{
 		D3D11_BUFFER_DESC vbd = {};
 		vbd.Usage = D3D11_USAGE_IMMUTABLE;
@@ -288,12 +197,47 @@ void Mesh::CreateBuffers(Vertex* v, int vCount, unsigned int* i, int iCount)
 		vbd.StructureByteStride = 0;
 
 		D3D11_SUBRESOURCE_DATA initialVertexData = {};
-		initialVertexData.pSysMem = v; // pSysMem = Pointer to System Memory
+		initialVertexData.pSysMem = mesh.vertices; // pSysMem = Pointer to System Memory
 
 		Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
 
 	}
 
+	// Creating the Position Buffer
+	// - A second copy of just the positions, for passes that don't
+	//    need anything else (12 bytes per vertex instead of 44)
+	// - Only shadow casters are drawn in one, so only they get it
+	if (shadowCaster)
+	{
+		D3D11_BUFFER_DESC pbd = {};
+		pbd.Usage = D3D11_USAGE_IMMUTABLE;
+		pbd.ByteWidth = sizeof(XMFLOAT3) * vertexCount;
+		pbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA initialPositionData = {};
+		initialPositionData.pSysMem = mesh.positions;
+
+		Graphics::Device->CreateBuffer(&pbd, &initialPositionData, positionBuffer.GetAddressOf());
+	}
+
+	// Creating the Packed Vertex Buffer
+	// - The same vertices, compressed from 44 to 20 bytes each,
+	//    in place of the vertex buffer above
+	// - Positions are stored relative to the bounds, which
+	//    the packed vertex shader needs to undo that
+	if (packed)
+	{
+		D3D11_BUFFER_DESC vbd = {};
+		vbd.Usage = D3D11_USAGE_IMMUTABLE;
+		vbd.ByteWidth = sizeof(PackedVertex) * vertexCount;
+		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA initialVertexData = {};
+		initialVertexData.pSysMem = mesh.packedVertices;
+
+		Graphics::Device->CreateBuffer(&vbd, &initialVertexData, packedVertexBuffer.GetAddressOf());
+	}
+
 	// Creating Index Buffer
 	// ibd - characteristics of index buffer - required by D3D11
 	// initialIndexData - pointer to the index order
@@ -301,14 +245,14 @@ void Mesh::CreateBuffers(Vertex* v, int vCount, unsigned int* i, int iCount)
 	{
 		D3D11_BUFFER_DESC ibd = {};
 		ibd.Usage = D3D11_USAGE_IMMUTABLE;
-		ibd.ByteWidth = sizeof(unsigned int) * indexCount;
+		ibd.ByteWidth = sizeof(unsigned int) * mesh.indexCount;
 		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		ibd.CPUAccessFlags = 0;
 		ibd.MiscFlags = 0;
 		ibd.StructureByteStride = 0;
 
 		D3D11_SUBRESOURCE_DATA initialIndexData = {};
-		initialIndexData.pSysMem = i; // pSysMem = Pointer to System Memory
+		initialIndexData.pSysMem = mesh.indices; // pSysMem = Pointer to System Memory
 
 		// Actually create the buffer with the initial data
 		// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -316,7 +260,7 @@ void Mesh::CreateBuffers(Vertex* v, int vCount, unsigned int* i, int iCount)
 	}
 }
 
-void Mesh::Draw() 
+void Mesh::Draw(int lod, bool bindBuffers) 
 {
 	// Set buffers in the input assembler (IA) stage
 		//  - Do this ONCE PER OBJECT, since each object may have different geometry
@@ -325,8 +269,13 @@ void Mesh::Draw()
 		//     when drawing different geometry, so it's here as an example
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	if (bindBuffers)
+	{
+		Graphics::State.SetVertexBuffer(0, vertexBuffer.Get(), stride, offset);
+		Graphics::State.SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	}
+
+	Graphics::State.Flush();
 
 	// Tell Direct3D to draw
 	//  - Begins the rendering pipeline on the GPU
@@ -334,105 +283,109 @@ void Mesh::Draw()
 	//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
 	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 	//     vertices in the currently set VERTEX BUFFER
-	Graphics::Context->DrawIndexed(
-		indexCount,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
+	Graphics::Backend->DrawIndexed(
+		lods[lod].indexCount,     // The number of indices to use (we could draw a subset if we wanted)
+		lods[lod].firstIndex,     // Offset to the first index we want to use
 		0);    // Offset to add to each index when looking up vertices
 }
 
+void Mesh::DrawPacked(int lod, bool bindBuffers)
+{
+	UINT stride = sizeof(PackedVertex);
+	UINT offset = 0;
+	if (bindBuffers)
+	{
+		Graphics::State.SetVertexBuffer(0, packedVertexBuffer.Get(), stride, offset);
+		Graphics::State.SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	}
+	Graphics::State.Flush();
+	Graphics::Backend->DrawIndexed(lods[lod].indexCount, lods[lod].firstIndex, 0);
+}
+
+void Mesh::DrawPositionsOnly(int lod)
+{
+	UINT stride = sizeof(XMFLOAT3);
+	UINT offset = 0;
+	Graphics::State.SetVertexBuffer(0, positionBuffer.Get(), stride, offset);
+	Graphics::State.SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	Graphics::State.Flush();
+	Graphics::Backend->DrawIndexed(lods[lod].indexCount, lods[lod].firstIndex, 0);
+}
+
+void Mesh::DrawRanges(const Meshlets::IndexRange* ranges, size_t rangeCount, bool packed, bool bindBuffers)
+{
+	UINT stride = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	UINT offset = 0;
+	if (bindBuffers)
+	{
+		Graphics::State.SetVertexBuffer(0, packed ? packedVertexBuffer.Get() : vertexBuffer.Get(), stride, offset);
+		Graphics::State.SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	}
+
+	// One draw per range - Cull() already merged neighbouring meshlets
+	Graphics::State.Flush();
+	for (size_t r = 0; r < rangeCount; r++)
+		Graphics::Backend->DrawIndexed(ranges[r].indexCount, ranges[r].firstIndex, 0);
+}
+
+void Mesh::DrawInstanced(int lod, unsigned int instanceCount, bool bindBuffers)
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	if (bindBuffers)
+	{
+		Graphics::State.SetVertexBuffer(0, vertexBuffer.Get(), stride, offset);
+		Graphics::State.SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	}
+	Graphics::State.Flush();
+	Graphics::Backend->DrawIndexedInstanced(lods[lod].indexCount, instanceCount, lods[lod].firstIndex, 0, 0);
+}
+
+void Mesh::DrawPositionsOnlyInstanced(int lod, unsigned int instanceCount)
+{
+	UINT stride = sizeof(XMFLOAT3);
+	UINT offset = 0;
+	Graphics::State.SetVertexBuffer(0, positionBuffer.Get(), stride, offset);
+	Graphics::State.SetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	Graphics::State.Flush();
+	Graphics::Backend->DrawIndexedInstanced(lods[lod].indexCount, instanceCount, lods[lod].firstIndex, 0, 0);
+}
+
 Mesh::~Mesh() {}
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return vertexBuffer; };
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return indexBuffer; };
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetPositionBuffer() { return positionBuffer; };
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetPackedVertexBuffer() { return packedVertexBuffer; };
 int Mesh::GetIndexCount(){ return indexCount; }
 int Mesh::GetVertexCount() { return vertexCount; }
+int Mesh::GetSourceVertexCount() { return sourceVertexCount; }
+MeshOptimizer::CacheStats Mesh::GetSourceCacheStats() { return sourceCacheStats; }
+MeshOptimizer::CacheStats Mesh::GetCacheStats() { return cacheStats; }
+VertexCodec::PositionBounds Mesh::GetPackedBounds() { return packedBounds; }
+VertexCodec::ErrorStats Mesh::GetPackedError() { return packedError; }
+int Mesh::GetLodCount() { return (int)lods.size(); }
+MeshSimplifier::Lod Mesh::GetLod(int lod) { return lods[lod]; }
+Bounds::Box Mesh::GetBoundingBox() { return boundingBox; }
+Bounds::Sphere Mesh::GetBoundingSphere() { return boundingSphere; }
+const std::vector<Meshlets::Meshlet>& Mesh::GetMeshlets() { return meshlets; }
+bool Mesh::IsOccluder() { return !occluderIndices.empty(); }
+const std::vector<XMFLOAT3>& Mesh::GetOccluderPositions() { return occluderPositions; }
+const std::vector<unsigned int>& Mesh::GetOccluderIndices() { return occluderIndices; }
+bool Mesh::IsPacked() { return packedVertexBuffer != nullptr; }
+bool Mesh::IsShadowCaster() { return positionBuffer != nullptr; }
+int Mesh::GetVertexBufferBytes() { return vertexBuffer ? vertexCount * (int)sizeof(Vertex) : 0; }
+int Mesh::GetPositionBufferBytes() { return positionBuffer ? vertexCount * (int)sizeof(XMFLOAT3) : 0; }
+int Mesh::GetPackedVertexBufferBytes() { return packedVertexBuffer ? vertexCount * (int)sizeof(PackedVertex) : 0; }
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
+// Calculates the tangents of the vertices in a mesh
 //
+// - The math is Chris Cascioli's (see Tangents.cpp), now
+//    vectorized and spread over the Jobs pool
 // - Be sure to call this BEFORE creating your D3D vertex/index buffers
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
-	}
-
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+	Tangents::Calculate(verts, numVerts, indices, numIndices);
 }
@@ -3,8 +3,15 @@
 #include<wrl/client.h>
 #include "Vertex.h"
 #include "Graphics.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshFile.h"
+#include "Meshlets.h"
+#include "Bounds.h"
+#include "VertexCodec.h"
 #include <DirectXMath.h>
 #include <fstream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -23,27 +30,138 @@ o Refer to Game::Draw() to see the code necessary for setting buffers and drawin
 
 using namespace DirectX;
 
+// Everything needed to create a Mesh's buffers, without touching the GPU
+// - Mesh::LoadObj() fills this in, and is safe to run on any thread
+// - Either cookedFile is set (an up-to-date .ggp_mesh, still mapped),
+//    or the rest holds a freshly imported and cooked mesh
+// - occluder, packed and shadowCaster are up to whoever wants
+//    the mesh, set before LoadObj()
+struct MeshData
+{
+	std::unique_ptr<MeshFile> cookedFile;
+	std::vector<Vertex> verts;
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<PackedVertex> packedVerts;
+	std::vector<unsigned int> indices; // Every LOD's, one after the other
+	std::vector<MeshSimplifier::Lod> lods;
+	std::vector<Meshlets::Meshlet> meshlets;
+	Bounds::Box boundingBox;
+	Bounds::Sphere boundingSphere;
+	VertexCodec::PositionBounds packedBounds;
+	VertexCodec::ErrorStats packedError;
+	int sourceVertexCount;
+	MeshOptimizer::CacheStats sourceCacheStats;
+	MeshOptimizer::CacheStats cacheStats;
+	bool occluder = false; // Keep a CPU copy of LOD 0 for the occlusion culler
+	bool packed = false; // Create the PackedVertex stream instead of the Vertex one
+	bool shadowCaster = false; // Also create the position-only stream, for the shadow map
+
+	CookedMesh GetContents(); // Whichever of the two it holds
+};
+
 class Mesh
 {
 public:
 
 	// ~ Constructor, Copy Constructor, Copy Assignment, Destructor
 	Mesh(Vertex* v, int vCount, unsigned int* i, int iCount); // Constructor
-	Mesh(const char* objFilePath);
-	void CreateBuffers(Vertex* v, int vCount, unsigned int* i, int iCount);
+	Mesh(const char* objFilePath, float weldEpsilon = 0.0f, bool occluder = false, bool packed = false, bool shadowCaster = false); // weldEpsilon > 0 also merges nearly-identical verts
+	Mesh(MeshFile& cookedFile, bool occluder = false, bool packed = false, bool shadowCaster = false); // Straight from a mapped .ggp_mesh
+	Mesh(MeshData& data); // Only creates the buffers (see MeshData)
+	void CreateBuffers(const CookedMesh& mesh, bool occluder, bool packed, bool shadowCaster); // Nothing is rebuilt, it's all in mesh
 	//Mesh(const Mesh& other); // Copy Constructor
 	//Mesh& operator= (const Mesh& other); // Copy Assignment
 	~Mesh();
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
-	int GetIndexCount();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetPositionBuffer();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetPackedVertexBuffer();
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+
+	// Everything the .obj constructor does before creating buffers:
+	// parse, weld, optimize, calculate tangents, build the LOD chain
+	// and then Cook()
+	static void ImportObj(const char* objFilePath, float weldEpsilon, MeshData& data);
+
+	// Works out what's derived from data's verts, indices and lods:
+	// meshlets (which reorder LOD 0's triangles), the position and
+	// packed vertex streams, bounds and LOD 0's cache stats - this is what
+	// .ggp_mesh files store, so loading them never redoes it
+	static void Cook(MeshData& data);
+
+	// Maps the cooked .ggp_mesh if it's up to date, otherwise imports
+	// the .obj and cooks it for next time
+	static void LoadObj(const char* objFilePath, float weldEpsilon, MeshData& data);
+	int GetIndexCount(); // Of LOD 0
 	int GetVertexCount();
-	void Draw();
+	int GetSourceVertexCount(); // Vertex count before welding (one per triangle corner for .obj files)
+	MeshOptimizer::CacheStats GetSourceCacheStats(); // Post-transform cache stats in file order
+	MeshOptimizer::CacheStats GetCacheStats(); // Post-transform cache stats of what's in the index buffer
+	VertexCodec::PositionBounds GetPackedBounds(); // What PackedVertexShader needs to unpack positions
+	VertexCodec::ErrorStats GetPackedError(); // How far the packed vertices are from the originals
+
+	// LODs all share the vertex buffers, each is a range of the index buffer
+	int GetLodCount();
+	MeshSimplifier::Lod GetLod(int lod);
+
+	// Object-space bounds of every vertex, worked out when the mesh is
+	// cooked (Entity has the world-space versions)
+	Bounds::Box GetBoundingBox();
+	Bounds::Sphere GetBoundingSphere();
+
+	// LOD 0 is split into meshlets when it's cooked, so parts of it
+	// can be culled (see Meshlets.h)
+	const std::vector<Meshlets::Meshlet>& GetMeshlets();
+
+	// CPU copy of LOD 0, for rasterizing the mesh as an occluder (see
+	// OcclusionCuller.h) - LOD 0 since simplified LODs can poke out
+	// past the real surface and hide things that aren't hidden
+	// - Only kept for meshes created as occluders, empty otherwise
+	bool IsOccluder();
+	const std::vector<DirectX::XMFLOAT3>& GetOccluderPositions();
+	const std::vector<unsigned int>& GetOccluderIndices();
+
+	// A mesh only has the vertex stream it was created for: packed
+	// meshes need DrawPacked() (or DrawRanges() with packed = true),
+	// the rest need Draw() and DrawInstanced()
+	bool IsPacked();
+
+	// Only shadow casters get the position-only stream that
+	// DrawPositionsOnly() and DrawPositionsOnlyInstanced() need
+	bool IsShadowCaster();
+
+	// bindBuffers = false skips setting the vertex and index buffers,
+	// when the last draw already set this mesh's (see RenderQueue.h)
+	void Draw(int lod = 0, bool bindBuffers = true);
+	void DrawPacked(int lod = 0, bool bindBuffers = true); // Same, but with the PackedVertex buffer (needs the packed input layout and shader)
+	void DrawPositionsOnly(int lod = 0); // Same, but with just the positions - for depth-only passes like the shadow map
+	void DrawRanges(const Meshlets::IndexRange* ranges, size_t rangeCount, bool packed = false, bool bindBuffers = true); // Only parts of LOD 0 (from Meshlets::Cull)
+	void DrawInstanced(int lod, unsigned int instanceCount, bool bindBuffers = true); // Draw(), instanceCount times in one call
+	void DrawPositionsOnlyInstanced(int lod, unsigned int instanceCount); // Same, for the shadow map
+
+	// GPU memory used by each vertex stream, in bytes (0 for the
+	// ones this mesh doesn't have)
+	int GetVertexBufferBytes();
+	int GetPositionBufferBytes();
+	int GetPackedVertexBufferBytes();
 
 private:
+	void CreateFromData(MeshData& data);
+
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer; // Contains all the necessary vertices
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer; // Contains all the indices - drawn in groups of 3 (triangle drawing mode)
+	Microsoft::WRL::ComPtr<ID3D11Buffer> packedVertexBuffer; // The same vertices as PackedVertex (see VertexCodec.h)
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer; // Just the positions, tightly packed (12 bytes per vertex)
 	int indexCount, vertexCount;
+	int sourceVertexCount;
+	MeshOptimizer::CacheStats sourceCacheStats, cacheStats;
+	VertexCodec::PositionBounds packedBounds;
+	VertexCodec::ErrorStats packedError;
+	std::vector<MeshSimplifier::Lod> lods;
+	Bounds::Box boundingBox;
+	Bounds::Sphere boundingSphere;
+	std::vector<Meshlets::Meshlet> meshlets;
+	std::vector<DirectX::XMFLOAT3> occluderPositions;
+	std::vector<unsigned int> occluderIndices;
 };
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "MeshFile.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	const unsigned int meshFileMagic = 'G' | ('G' << 8) | ('P' << 16) | ('M' << 24);
+	const unsigned int meshFileVersion = 4;
+	const unsigned long long blobAlignment = 16;
+
+	// The DXGI_FORMAT values the layout needs, written out so this
+	// doesn't need the Windows SDK's dxgiformat.h
+	const unsigned int formatR32G32B32Float = 6;	// DXGI_FORMAT_R32G32B32_FLOAT
+	const unsigned int formatR32G32Float = 16;		// DXGI_FORMAT_R32G32_FLOAT
+
+	// The layout our Vertex struct (and its input layout in Game.cpp) uses
+	const MeshFileAttribute vertexLayout[4] =
+	{
+		{ "POSITION", formatR32G32B32Float, offsetof(Vertex, Position) },
+		{ "TEXCOORD", formatR32G32Float, offsetof(Vertex, UV) },
+		{ "NORMAL", formatR32G32B32Float, offsetof(Vertex, Normal) },
+		{ "TANGENT", formatR32G32B32Float, offsetof(Vertex, Tangent) },
+	};
+
+	unsigned long long AlignUp(unsigned long long value)
+	{
+		return (value + blobAlignment - 1) & ~(blobAlignment - 1);
+	}
+
+	// FNV-1a over 8-byte words (blob sizes are always multiples of 4,
+	// so the tail is at most one 4-byte word)
+	unsigned long long Checksum(const void* data, size_t bytes, unsigned long long hash)
+	{
+		const unsigned char* c = (const unsigned char*)data;
+		for (; bytes >= 8; bytes -= 8, c += 8)
+		{
+			unsigned long long word;
+			std::memcpy(&word, c, 8);
+			hash = (hash ^ word) * 0x100000001B3ull;
+		}
+		for (; bytes > 0; bytes--, c++)
+			hash = (hash ^ *c) * 0x100000001B3ull;
+		return hash;
+	}
+
+	unsigned long long BlobChecksum(const CookedMesh& mesh)
+	{
+		unsigned long long hash = 0xCBF29CE484222325ull;
+		hash = Checksum(mesh.vertices, mesh.vertexCount * sizeof(Vertex), hash);
+		hash = Checksum(mesh.positions, mesh.vertexCount * sizeof(DirectX::XMFLOAT3), hash);
+		hash = Checksum(mesh.packedVertices, mesh.vertexCount * sizeof(PackedVertex), hash);
+		hash = Checksum(mesh.indices, mesh.indexCount * sizeof(unsigned int), hash);
+		return Checksum(mesh.meshlets, mesh.meshletCount * sizeof(Meshlets::Meshlet), hash);
+	}
+
+	// Where each blob goes, in file order
+	struct BlobLayout
+	{
+		unsigned long long offset;
+		unsigned long long bytes;
+	};
+	const int blobCount = 5;
+	void GetBlobs(const MeshFileHeader& h, BlobLayout blobs[blobCount])
+	{
+		blobs[0] = { h.vertexOffset, (unsigned long long)h.vertexCount * sizeof(Vertex) };
+		blobs[1] = { h.positionOffset, (unsigned long long)h.vertexCount * sizeof(DirectX::XMFLOAT3) };
+		blobs[2] = { h.packedVertexOffset, (unsigned long long)h.vertexCount * sizeof(PackedVertex) };
+		blobs[3] = { h.indexOffset, (unsigned long long)h.indexCount * sizeof(unsigned int) };
+		blobs[4] = { h.meshletOffset, (unsigned long long)h.meshletCount * sizeof(Meshlets::Meshlet) };
+	}
+
+	// Size and modification time of the source file (zeros if it's missing)
+	void SourceStamp(const char* objFilePath, unsigned long long& size, long long& time)
+	{
+		std::error_code error;
+		size = std::filesystem::file_size(objFilePath, error);
+		if (error) size = 0;
+		auto writeTime = std::filesystem::last_write_time(objFilePath, error);
+		time = error ? 0 : (long long)writeTime.time_since_epoch().count();
+	}
+}
+
+// --------------------------------------------------------
+// Maps the file and checks it can be used as-is
+// --------------------------------------------------------
+MeshFile::MeshFile(const char* filePath, bool verify) :
+	file(filePath),
+	header(0),
+	valid(false)
+{
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+	if (!data || size < sizeof(MeshFileHeader))
+		return;
+
+	const MeshFileHeader* h = (const MeshFileHeader*)data;
+	if (h->magic != meshFileMagic ||
+		h->version != meshFileVersion ||
+		h->headerSize != sizeof(MeshFileHeader) ||
+		h->vertexStride != sizeof(Vertex) ||
+		h->attributeCount != 4 ||
+		std::memcmp(h->attributes, vertexLayout, sizeof(vertexLayout)) != 0 ||
+		h->packedVertexStride != sizeof(PackedVertex) ||
+		h->meshletStride != sizeof(Meshlets::Meshlet))
+		return;
+
+	// Blobs must be aligned, in order and inside the file
+	BlobLayout blobs[blobCount];
+	GetBlobs(*h, blobs);
+	unsigned long long blobStart = sizeof(MeshFileHeader);
+	for (const BlobLayout& blob : blobs)
+	{
+		if (blob.offset % blobAlignment != 0 || blob.offset < blobStart || blob.offset + blob.bytes > size)
+			return;
+		blobStart = blob.offset + blob.bytes;
+	}
+	if (h->indexCount % 3 != 0)
+		return;
+
+	// So must every LOD, and LOD 0 has to exist
+	if (h->lodCount < 1 || h->lodCount > MeshSimplifier::MaxLods)
+		return;
+	for (unsigned int i = 0; i < h->lodCount; i++)
+	{
+		const MeshSimplifier::Lod& lod = h->lods[i];
+		if (lod.indexCount % 3 != 0 || (unsigned long long)lod.firstIndex + lod.indexCount > h->indexCount)
+			return;
+	}
+
+	// Meshlets are drawn as ranges of LOD 0
+	const Meshlets::Meshlet* meshlets = (const Meshlets::Meshlet*)(data + h->meshletOffset);
+	unsigned long long lod0End = (unsigned long long)h->lods[0].firstIndex + h->lods[0].indexCount;
+	for (unsigned int i = 0; i < h->meshletCount; i++)
+	{
+		if (meshlets[i].indexCount % 3 != 0 || meshlets[i].firstIndex < h->lods[0].firstIndex ||
+			(unsigned long long)meshlets[i].firstIndex + meshlets[i].indexCount > lod0End)
+			return;
+	}
+
+	header = h;
+	if (verify && BlobChecksum(GetContents()) != h->checksum)
+		return;
+
+	// Meshlets, the occluder copy and the cache stats all read verts
+	// through these on the CPU, so a bad one can't get past here
+	const unsigned int* indices = GetIndices();
+	for (unsigned int i = 0; i < h->indexCount; i++)
+		if (indices[i] >= h->vertexCount)
+			return;
+
+	valid = true;
+}
+
+bool MeshFile::IsValid() { return valid; }
+const MeshFileHeader& MeshFile::GetHeader() { return *header; }
+const Vertex* MeshFile::GetVertices() { return (const Vertex*)(file.GetData() + header->vertexOffset); }
+const unsigned int* MeshFile::GetIndices() { return (const unsigned int*)(file.GetData() + header->indexOffset); }
+
+CookedMesh MeshFile::GetContents()
+{
+	const char* data = file.GetData();
+	CookedMesh mesh = {};
+	mesh.vertices = GetVertices();
+	mesh.positions = (const DirectX::XMFLOAT3*)(data + header->positionOffset);
+	mesh.packedVertices = (const PackedVertex*)(data + header->packedVertexOffset);
+	mesh.vertexCount = header->vertexCount;
+	mesh.indices = GetIndices();
+	mesh.indexCount = header->indexCount;
+	mesh.lods = header->lods;
+	mesh.lodCount = header->lodCount;
+	mesh.meshlets = (const Meshlets::Meshlet*)(data + header->meshletOffset);
+	mesh.meshletCount = header->meshletCount;
+	mesh.boundingBox = header->boundingBox;
+	mesh.boundingSphere = header->boundingSphere;
+	mesh.packedBounds = header->packedBounds;
+	mesh.packedError = header->packedError;
+	mesh.sourceVertexCount = header->sourceVertexCount;
+	mesh.sourceCacheStats = header->sourceCacheStats;
+	mesh.cacheStats = header->cacheStats;
+	return mesh;
+}
+
+bool MeshFile::IsCookedFrom(const char* objFilePath, float weldEpsilon)
+{
+	if (!valid)
+		return false;
+
+	unsigned long long size;
+	long long time;
+	SourceStamp(objFilePath, size, time);
+	return header->sourceSize == size && header->sourceTime == time && header->weldEpsilon == weldEpsilon;
+}
+
+// --------------------------------------------------------
+// Writes the header and every blob (with padding so each
+// blob starts on a 16-byte boundary)
+// --------------------------------------------------------
+bool MeshFile::Write(const char* filePath, const CookedMesh& mesh, const char* objFilePath, float weldEpsilon)
+{
+	MeshFileHeader h = {};
+	h.magic = meshFileMagic;
+	h.version = meshFileVersion;
+	h.headerSize = sizeof(MeshFileHeader);
+	h.vertexStride = sizeof(Vertex);
+	h.attributeCount = 4;
+	std::memcpy(h.attributes, vertexLayout, sizeof(vertexLayout));
+	h.packedVertexStride = sizeof(PackedVertex);
+	h.meshletStride = sizeof(Meshlets::Meshlet);
+
+	h.vertexCount = mesh.vertexCount;
+	h.indexCount = mesh.indexCount;
+	h.meshletCount = mesh.meshletCount;
+	h.vertexOffset = AlignUp(sizeof(MeshFileHeader));
+	h.positionOffset = AlignUp(h.vertexOffset + (unsigned long long)mesh.vertexCount * sizeof(Vertex));
+	h.packedVertexOffset = AlignUp(h.positionOffset + (unsigned long long)mesh.vertexCount * sizeof(DirectX::XMFLOAT3));
+	h.indexOffset = AlignUp(h.packedVertexOffset + (unsigned long long)mesh.vertexCount * sizeof(PackedVertex));
+	h.meshletOffset = AlignUp(h.indexOffset + (unsigned long long)mesh.indexCount * sizeof(unsigned int));
+	h.checksum = BlobChecksum(mesh);
+
+	// No LODs given means the whole index blob is LOD 0
+	h.lodCount = std::min(mesh.lodCount, (unsigned int)MeshSimplifier::MaxLods);
+	std::memcpy(h.lods, mesh.lods, h.lodCount * sizeof(MeshSimplifier::Lod));
+	if (h.lodCount == 0)
+	{
+		h.lodCount = 1;
+		h.lods[0] = { 0, mesh.indexCount, 0.0f };
+	}
+
+	h.boundingBox = mesh.boundingBox;
+	h.boundingSphere = mesh.boundingSphere;
+	h.packedBounds = mesh.packedBounds;
+	h.packedError = mesh.packedError;
+
+	SourceStamp(objFilePath, h.sourceSize, h.sourceTime);
+	h.weldEpsilon = weldEpsilon;
+	h.sourceVertexCount = mesh.sourceVertexCount;
+	h.sourceCacheStats = mesh.sourceCacheStats;
+	h.cacheStats = mesh.cacheStats;
+
+	// Write to a temporary file first, so a crash can't leave a half-written mesh behind
+	std::string tempPath = std::string(filePath) + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		BlobLayout blobs[blobCount];
+		GetBlobs(h, blobs);
+		const void* blobData[blobCount] = { mesh.vertices, mesh.positions, mesh.packedVertices, mesh.indices, mesh.meshlets };
+
+		const char padding[blobAlignment] = {};
+		unsigned long long written = sizeof(h);
+		out.write((const char*)&h, sizeof(h));
+		for (int b = 0; b < blobCount; b++)
+		{
+			out.write(padding, blobs[b].offset - written);
+			out.write((const char*)blobData[b], (std::streamsize)blobs[b].bytes);
+			written = blobs[b].offset + blobs[b].bytes;
+		}
+		if (!out)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+std::string MeshFile::CookedPath(const char* objFilePath)
+{
+	return std::filesystem::path(objFilePath).replace_extension(".ggp_mesh").string();
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "Vertex.h"
+#include "VertexCodec.h"
+
+// --------------------------------------------------------
+// Cooked binary meshes (.ggp_mesh)
+//
+// - Written the first time an .obj is loaded, with everything
+//    already welded, optimized, tangent-ed and split into
+//    meshlets, and the position-only and packed vertex streams
+//    already built
+// - Loading just maps the file: every blob is 16-byte aligned
+//    and goes straight to CreateBuffers, nothing is rebuilt
+// - Layout: MeshFileHeader, then vertices, positions, packed
+//    vertices, indices (every LOD's, one after the other) and
+//    LOD 0's meshlets
+// --------------------------------------------------------
+
+// A cooked mesh, as pointers to its blobs - either into a
+// freshly imported mesh (see MeshData) or into a mapped file
+struct CookedMesh
+{
+	const Vertex* vertices;
+	const DirectX::XMFLOAT3* positions;
+	const PackedVertex* packedVertices;
+	unsigned int vertexCount;
+	const unsigned int* indices;
+	unsigned int indexCount;
+	const MeshSimplifier::Lod* lods;
+	unsigned int lodCount;
+	const Meshlets::Meshlet* meshlets; // firstIndex is into indices
+	unsigned int meshletCount;
+
+	Bounds::Box boundingBox;
+	Bounds::Sphere boundingSphere;
+	VertexCodec::PositionBounds packedBounds;
+	VertexCodec::ErrorStats packedError;
+	int sourceVertexCount;
+	MeshOptimizer::CacheStats sourceCacheStats; // In file order
+	MeshOptimizer::CacheStats cacheStats; // LOD 0, as it's cooked
+};
+
+// One attribute in the vertex layout descriptor
+struct MeshFileAttribute
+{
+	char semantic[12];		// Matches the HLSL input semantic
+	unsigned int format;	// A DXGI_FORMAT
+	unsigned int offset;	// Bytes from the start of the vertex
+};
+
+struct MeshFileHeader
+{
+	unsigned int magic;				// 'GGPM'
+	unsigned int version;			// Bumped whenever anything below (or Vertex) changes
+	unsigned int headerSize;
+
+	// Vertex layout
+	unsigned int vertexStride;
+	unsigned int attributeCount;
+	MeshFileAttribute attributes[4];
+	unsigned int packedVertexStride;
+	unsigned int meshletStride;
+
+	// Blobs - offsets are from the start of the file
+	unsigned int vertexCount;		// Of the vertex, position and packed blobs
+	unsigned int indexCount;
+	unsigned int meshletCount;
+	unsigned long long vertexOffset;
+	unsigned long long positionOffset;
+	unsigned long long packedVertexOffset;
+	unsigned long long indexOffset;
+	unsigned long long meshletOffset;
+	unsigned long long checksum;	// Over every blob
+
+	// LOD 0 first, each a range of the index blob
+	unsigned int lodCount;
+	MeshSimplifier::Lod lods[MeshSimplifier::MaxLods];
+
+	// Object-space bounds
+	Bounds::Box boundingBox;
+	Bounds::Sphere boundingSphere;
+
+	// What the packed vertex shader needs to unpack positions
+	VertexCodec::PositionBounds packedBounds;
+	VertexCodec::ErrorStats packedError;
+
+	// What it was cooked from, to know when it's stale
+	unsigned long long sourceSize;
+	long long sourceTime;
+	float weldEpsilon;
+
+	// Import stats, so the UI still has them
+	unsigned int sourceVertexCount;
+	MeshOptimizer::CacheStats sourceCacheStats;
+	MeshOptimizer::CacheStats cacheStats;
+};
+
+class MeshFile
+{
+public:
+	// Maps and validates the file
+	// - The header, layout, blob sizes, every index and every
+	//    meshlet's range are always checked (the index pages get
+	//    read for the GPU anyway)
+	// - verify also checks the checksum, which means touching
+	//    every vertex page too, so it's off by default
+	MeshFile(const char* filePath, bool verify = false);
+
+	bool IsValid();
+	const MeshFileHeader& GetHeader();
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	CookedMesh GetContents(); // Everything, pointing into the mapping
+
+	// True if this was cooked from the given .obj with the same settings
+	bool IsCookedFrom(const char* objFilePath, float weldEpsilon);
+
+	// Writes a cooked file, returns false if it couldn't be written
+	static bool Write(const char* filePath, const CookedMesh& mesh, const char* objFilePath, float weldEpsilon);
+
+	// "Assets/Meshes/cube.ggp_obj" -> "Assets/Meshes/cube.ggp_mesh"
+	static std::string CookedPath(const char* objFilePath);
+
+private:
+	MappedFile file;
+	const MeshFileHeader* header;
+	bool valid;
+};
@@ -0,0 +1,265 @@
+#include "MeshOptimizer.h"
+#include <cmath>
+
+namespace MeshOptimizer
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Forsyth's tuning values - the modelled cache is a bit bigger
+		// than the real one, which makes the ordering less brittle
+		const int modelCacheSize = 32;
+		const float cacheDecayPower = 1.5f;
+		const float lastTriangleScore = 0.75f;
+		const float valenceBoostScale = 2.0f;
+		const float valenceBoostPower = 0.5f;
+		const int maxValence = 32;
+
+		const unsigned int notInCache = 0xFFFFFFFF;
+
+		// Score tables, filled in once
+		struct ScoreTables
+		{
+			float cache[modelCacheSize];
+			float valence[maxValence + 1];
+
+			ScoreTables()
+			{
+				for (int i = 0; i < modelCacheSize; i++)
+				{
+					// The three verts of the last triangle get a fixed score, so
+					// the next triangle doesn't just reuse the same edge forever
+					if (i < 3)
+						cache[i] = lastTriangleScore;
+					else
+						cache[i] = std::pow(1.0f - (float)(i - 3) / (modelCacheSize - 3), cacheDecayPower);
+				}
+
+				// Verts with few triangles left get a boost, so we finish them
+				// off instead of leaving lone triangles for the end
+				valence[0] = 0.0f;
+				for (int i = 1; i <= maxValence; i++)
+					valence[i] = valenceBoostScale * std::pow((float)i, -valenceBoostPower);
+			}
+		};
+
+		float VertexScore(const ScoreTables& tables, unsigned int cachePosition, unsigned int remainingTriangles)
+		{
+			// No triangles left, so this vertex no longer matters
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = cachePosition == notInCache ? 0.0f : tables.cache[cachePosition];
+			return score + tables.valence[remainingTriangles < (unsigned int)maxValence ? remainingTriangles : maxValence];
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Counts transforms with a FIFO post-transform cache
+// --------------------------------------------------------
+MeshOptimizer::CacheStats MeshOptimizer::SimulateCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	CacheStats stats = {};
+	if (indexCount == 0 || vertexCount == 0)
+		return stats;
+
+	// Each vertex remembers when it entered the FIFO; it's still
+	// cached as long as fewer than cacheSize misses happened since
+	std::vector<size_t> insertedAt(vertexCount, 0);
+	std::vector<bool> seen(vertexCount, false);
+	size_t misses = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (seen[v] && misses - insertedAt[v] < cacheSize)
+			continue;
+
+		seen[v] = true;
+		insertedAt[v] = misses;
+		misses++;
+	}
+
+	stats.acmr = (float)misses / (indexCount / 3);
+	stats.atvr = (float)misses / vertexCount;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Greedy triangle ordering by vertex score
+//
+// - Every vertex gets a score from its position in a modelled
+//    LRU cache and how many triangles still use it
+// - A triangle's score is the sum of its verts' scores
+// - Each step emits the best triangle touching the cache, then
+//    only rescores the triangles around the cached verts
+// - If no cached vertex has triangles left, we jump to the
+//    next unemitted triangle in the original order
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	static const ScoreTables tables;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency, packed into one array
+	std::vector<unsigned int> remaining(vertexCount, 0);	// Triangles left per vertex
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	{
+		std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+	}
+
+	// Starting scores
+	std::vector<unsigned int> cachePosition(vertexCount, notInCache);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexScore(tables, notInCache, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	unsigned int best = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* tri = &indices[t * 3];
+		triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+		if (triangleScore[t] > triangleScore[best])
+			best = (unsigned int)t;
+	}
+
+	// The modelled cache, with room for the 3 verts pushed in each step
+	unsigned int cache[modelCacheSize + 3];
+	unsigned int cacheCount = 0;
+
+	std::vector<unsigned int> output(triangleCount * 3);
+	size_t cursor = 0; // Fallback scan position for when the cache runs dry
+	for (size_t out = 0; out < triangleCount; out++)
+	{
+		if (best == notInCache)
+		{
+			while (emitted[cursor]) cursor++;
+			best = (unsigned int)cursor;
+		}
+
+		// Emit it
+		const unsigned int* tri = &indices[best * 3];
+		output[out * 3 + 0] = tri[0];
+		output[out * 3 + 1] = tri[1];
+		output[out * 3 + 2] = tri[2];
+		emitted[best] = true;
+
+		// Take it out of each vertex's live adjacency (live ones stay at the front)
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = tri[k];
+			unsigned int* list = &adjacency[adjacencyStart[v]];
+			unsigned int count = remaining[v];
+			for (unsigned int j = 0; j < count; j++)
+			{
+				if (list[j] == best)
+				{
+					list[j] = list[count - 1];
+					list[count - 1] = best;
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Push the triangle's verts to the front of the cache, keeping
+		// everything else in LRU order behind them
+		unsigned int newCache[modelCacheSize + 3];
+		unsigned int newCount = 0;
+		newCache[newCount++] = tri[0];
+		if (tri[1] != tri[0])
+			newCache[newCount++] = tri[1];
+		if (tri[2] != tri[0] && tri[2] != tri[1])
+			newCache[newCount++] = tri[2];
+		for (unsigned int c = 0; c < cacheCount; c++)
+		{
+			unsigned int v = cache[c];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Anything pushed past the end falls out of the cache
+		for (unsigned int c = 0; c < newCount; c++)
+			cachePosition[newCache[c]] = c < (unsigned int)modelCacheSize ? c : notInCache;
+
+		// Rescore the verts that moved, and their remaining triangles
+		for (unsigned int c = 0; c < newCount; c++)
+		{
+			unsigned int v = newCache[c];
+			float score = VertexScore(tables, cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+				triangleScore[list[j]] += delta;
+		}
+
+		// Best triangle around the cache for the next step
+		best = notInCache;
+		float bestScore = -1.0f;
+		cacheCount = newCount < (unsigned int)modelCacheSize ? newCount : modelCacheSize;
+		for (unsigned int c = 0; c < cacheCount; c++)
+		{
+			unsigned int v = newCache[c];
+			cache[c] = v;
+
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (triangleScore[list[j]] > bestScore)
+				{
+					bestScore = triangleScore[list[j]];
+					best = list[j];
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < output.size(); i++)
+		indices[i] = output[i];
+}
+
+// --------------------------------------------------------
+// Renumbers vertices in first-use order
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	unsigned int next = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& index = indices[i];
+		if (remap[index] == unused)
+			remap[index] = next++;
+		index = remap[index];
+	}
+
+	// Unreferenced verts keep their relative order at the back
+	for (size_t v = 0; v < vertexCount; v++)
+		if (remap[v] == unused)
+			remap[v] = next++;
+
+	std::vector<Vertex> original(verts, verts + vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		verts[remap[v]] = original[v];
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Load-time reordering of index/vertex buffers
+//
+// - OptimizeVertexCache() reorders triangles so vertices are
+//    reused while still in the GPU's post-transform cache
+//    (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+// - OptimizeVertexFetch() then renumbers vertices in the order
+//    they're first used, so vertex reads walk memory forwards
+// - SimulateCache() runs a FIFO cache model on the CPU, so we
+//    can measure both without a GPU
+//
+// Run cache then fetch - the other way round undoes the fetch order
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// ACMR: cache misses per triangle (0.5 is the best a grid can do, 3 is the worst)
+	// ATVR: cache misses per vertex (1.0 is perfect, each vertex transformed once)
+	struct CacheStats
+	{
+		float acmr;
+		float atvr;
+	};
+
+	// A FIFO of this many entries is what most GPUs roughly behave like
+	const unsigned int DefaultCacheSize = 16;
+
+	CacheStats SimulateCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DefaultCacheSize);
+
+	// Reorders triangles in place (each triangle keeps its winding)
+	void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// Reorders verts into first-use order and rewrites indices to match
+	// (vertices no triangle uses end up at the back)
+	void OptimizeVertexFetch(Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount);
+}
@@ -0,0 +1,590 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace MeshSimplifier
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// How much an open border / UV seam edge resists being moved,
+		// relative to the surface itself
+		const double borderWeight = 10.0;
+		const double seamWeight = 1.0;
+
+		// How much merging different normals / UVs costs, per unit of
+		// (squared) difference, scaled by the edge's squared length
+		const double normalWeight = 0.5;
+		const double uvWeight = 0.5;
+
+		// A collapse may rotate a triangle's normal by up to ~75 degrees
+		const double minFlipCosine = 0.25;
+
+		// LOD chain settings
+		const size_t minLodTriangles = 32;
+		const float maxLodKeptFraction = 0.85f;
+
+		enum VertexKind
+		{
+			Manifold,	// Surrounded by triangles, one set of attributes
+			Border,		// On an open edge of the mesh
+			Seam,		// On a UV/normal seam: two vertices with the same position
+			Locked		// Anything else - never moves
+		};
+
+		const unsigned int none = 0xFFFFFFFF;
+
+		// Garland & Heckbert plane quadric: sum of weight * (n.p + d)^2
+		struct Quadric
+		{
+			double a00, a11, a22, a01, a02, a12;
+			double b0, b1, b2;
+			double c;
+			double weight;
+		};
+
+		struct Vector3
+		{
+			double x, y, z;
+		};
+
+		Vector3 Subtract(const Vector3& a, const Vector3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		Vector3 Cross(const Vector3& a, const Vector3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		double Dot(const Vector3& a, const Vector3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+		void AddPlane(Quadric& q, const Vector3& n, double d, double weight)
+		{
+			q.a00 += weight * n.x * n.x;
+			q.a11 += weight * n.y * n.y;
+			q.a22 += weight * n.z * n.z;
+			q.a01 += weight * n.x * n.y;
+			q.a02 += weight * n.x * n.z;
+			q.a12 += weight * n.y * n.z;
+			q.b0 += weight * n.x * d;
+			q.b1 += weight * n.y * d;
+			q.b2 += weight * n.z * d;
+			q.c += weight * d * d;
+			q.weight += weight;
+		}
+
+		void AddQuadric(Quadric& q, const Quadric& other)
+		{
+			q.a00 += other.a00; q.a11 += other.a11; q.a22 += other.a22;
+			q.a01 += other.a01; q.a02 += other.a02; q.a12 += other.a12;
+			q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+			q.c += other.c;
+			q.weight += other.weight;
+		}
+
+		// Weighted average squared distance from p to the quadric's planes
+		double QuadricError(const Quadric& q, const Vector3& p)
+		{
+			double r = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z
+				+ 2.0 * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z)
+				+ 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z)
+				+ q.c;
+			return std::fabs(r) / (q.weight > 0.0 ? q.weight : 1.0);
+		}
+
+		// Which triangles use each vertex
+		struct Adjacency
+		{
+			std::vector<unsigned int> offsets;		// vertexCount + 1
+			std::vector<unsigned int> triangles;
+		};
+
+		void BuildAdjacency(Adjacency& adjacency, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+		{
+			adjacency.offsets.assign(vertexCount + 1, 0);
+			for (size_t i = 0; i < indexCount; i++)
+				adjacency.offsets[indices[i] + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+			std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+			adjacency.triangles.resize(indexCount);
+			for (size_t i = 0; i < indexCount; i++)
+				adjacency.triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Is there a triangle with the edge a -> b (in winding order)?
+		bool HasEdge(const Adjacency& adjacency, const unsigned int* indices, unsigned int a, unsigned int b)
+		{
+			for (unsigned int t = adjacency.offsets[a]; t < adjacency.offsets[a + 1]; t++)
+			{
+				const unsigned int* tri = indices + adjacency.triangles[t] * 3;
+				for (int k = 0; k < 3; k++)
+					if (tri[k] == a && tri[(k + 1) % 3] == b)
+						return true;
+			}
+			return false;
+		}
+
+		// Same, but any vertices at the same positions count
+		bool HasPositionEdge(const Adjacency& adjacency, const unsigned int* indices, const std::vector<unsigned int>& wedge,
+			unsigned int a, unsigned int b)
+		{
+			unsigned int wa = a;
+			do
+			{
+				unsigned int wb = b;
+				do
+				{
+					if (HasEdge(adjacency, indices, wa, wb))
+						return true;
+					wb = wedge[wb];
+				} while (wb != b);
+				wa = wedge[wa];
+			} while (wa != a);
+			return false;
+		}
+
+		// Links vertices with identical positions: remap[] is the lowest
+		// index at that position, wedge[] is a circular list through them
+		void BuildPositionRemap(const Vertex* verts, size_t vertexCount, std::vector<unsigned int>& remap, std::vector<unsigned int>& wedge)
+		{
+			std::vector<unsigned int> order(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++)
+				order[i] = (unsigned int)i;
+
+			auto less = [verts](unsigned int a, unsigned int b)
+			{
+				const DirectX::XMFLOAT3& pa = verts[a].Position;
+				const DirectX::XMFLOAT3& pb = verts[b].Position;
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				if (pa.z != pb.z) return pa.z < pb.z;
+				return a < b;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			remap.resize(vertexCount);
+			wedge.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount; )
+			{
+				// [i, end) all have the same position, order[i] is the lowest index
+				size_t end = i + 1;
+				const DirectX::XMFLOAT3& p = verts[order[i]].Position;
+				while (end < vertexCount &&
+					verts[order[end]].Position.x == p.x &&
+					verts[order[end]].Position.y == p.y &&
+					verts[order[end]].Position.z == p.z)
+					end++;
+
+				for (size_t j = i; j < end; j++)
+				{
+					remap[order[j]] = order[i];
+					wedge[order[j]] = order[j + 1 < end ? j + 1 : i];
+				}
+				i = end;
+			}
+		}
+
+		// Open edges (a -> b with no b -> a) at each vertex, for classification
+		struct OpenEdges
+		{
+			std::vector<unsigned int> outCount, inCount;		// With the exact same vertices
+			std::vector<unsigned int> outVertex, inVertex;		// The last one found
+			std::vector<unsigned int> outBorder, inBorder;		// With no vertex at those positions either
+		};
+
+		void FindOpenEdges(OpenEdges& open, const Adjacency& adjacency, const unsigned int* indices, size_t indexCount,
+			size_t vertexCount, const std::vector<unsigned int>& wedge)
+		{
+			open.outCount.assign(vertexCount, 0);
+			open.inCount.assign(vertexCount, 0);
+			open.outVertex.assign(vertexCount, none);
+			open.inVertex.assign(vertexCount, none);
+			open.outBorder.assign(vertexCount, 0);
+			open.inBorder.assign(vertexCount, 0);
+
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					unsigned int a = indices[i + k];
+					unsigned int b = indices[i + (k + 1) % 3];
+					if (HasEdge(adjacency, indices, b, a))
+						continue;
+
+					open.outCount[a]++;
+					open.inCount[b]++;
+					open.outVertex[a] = b;
+					open.inVertex[b] = a;
+
+					if (!HasPositionEdge(adjacency, indices, wedge, b, a))
+					{
+						open.outBorder[a]++;
+						open.inBorder[b]++;
+					}
+				}
+			}
+		}
+
+		void ClassifyVertices(std::vector<unsigned char>& kind, const OpenEdges& open, size_t vertexCount,
+			const std::vector<unsigned int>& remap, const std::vector<unsigned int>& wedge)
+		{
+			kind.assign(vertexCount, Locked);
+			for (unsigned int v = 0; v < vertexCount; v++)
+			{
+				unsigned int other = wedge[v];
+				if (other == v)
+				{
+					if (open.outCount[v] == 0 && open.inCount[v] == 0)
+						kind[v] = Manifold;
+					else if (open.outCount[v] == 1 && open.inCount[v] == 1 && open.outBorder[v] == 1 && open.inBorder[v] == 1)
+						kind[v] = Border;
+				}
+				else if (wedge[other] == v)
+				{
+					// Two vertices, each with one seam edge in and out, and the
+					// edges on either side lead to the same positions
+					bool seam =
+						open.outCount[v] == 1 && open.inCount[v] == 1 && open.outBorder[v] == 0 && open.inBorder[v] == 0 &&
+						open.outCount[other] == 1 && open.inCount[other] == 1 && open.outBorder[other] == 0 && open.inBorder[other] == 0 &&
+						remap[open.outVertex[v]] == remap[open.inVertex[other]] &&
+						remap[open.inVertex[v]] == remap[open.outVertex[other]];
+					if (seam)
+						kind[v] = Seam;
+				}
+			}
+		}
+
+		// Collapsing v's triangles onto t mustn't turn any of them over
+		bool FlipsTriangles(const Adjacency& adjacency, const unsigned int* indices, const std::vector<Vector3>& positions,
+			const std::vector<unsigned int>& remap, unsigned int v, unsigned int t)
+		{
+			const Vector3& target = positions[remap[t]];
+			for (unsigned int i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; i++)
+			{
+				const unsigned int* tri = indices + adjacency.triangles[i] * 3;
+				unsigned int r0 = remap[tri[0]], r1 = remap[tri[1]], r2 = remap[tri[2]];
+
+				// Triangles on the collapsing edge simply go away
+				if (r0 == remap[t] || r1 == remap[t] || r2 == remap[t])
+					continue;
+
+				Vector3 p[3] = { positions[r0], positions[r1], positions[r2] };
+				Vector3 before = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+				for (int k = 0; k < 3; k++)
+					if (tri[k] == v)
+						p[k] = target;
+				Vector3 after = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+
+				double lengths = std::sqrt(Dot(before, before) * Dot(after, after));
+				if (Dot(before, after) <= minFlipCosine * lengths)
+					return true;
+			}
+			return false;
+		}
+
+		// Drops exact repeats of a triangle (same corners, same winding)
+		// - They add nothing, and make every edge look like it has
+		//    two triangles on the same side, which locks everything
+		void RemoveDuplicateTriangles(std::vector<unsigned int>& indices)
+		{
+			struct Key
+			{
+				unsigned int corner[3];
+				unsigned int triangle;
+			};
+
+			size_t triangleCount = indices.size() / 3;
+			std::vector<Key> keys(triangleCount);
+			for (size_t i = 0; i < triangleCount; i++)
+			{
+				// Rotate so the smallest index comes first (keeps the winding)
+				const unsigned int* tri = &indices[i * 3];
+				int first = tri[0] < tri[1] ? (tri[0] < tri[2] ? 0 : 2) : (tri[1] < tri[2] ? 1 : 2);
+				keys[i] = { { tri[first], tri[(first + 1) % 3], tri[(first + 2) % 3] }, (unsigned int)i };
+			}
+
+			std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b)
+			{
+				if (a.corner[0] != b.corner[0]) return a.corner[0] < b.corner[0];
+				if (a.corner[1] != b.corner[1]) return a.corner[1] < b.corner[1];
+				if (a.corner[2] != b.corner[2]) return a.corner[2] < b.corner[2];
+				return a.triangle < b.triangle;
+			});
+
+			std::vector<unsigned char> duplicate(triangleCount, 0);
+			for (size_t i = 1; i < triangleCount; i++)
+				if (std::memcmp(keys[i].corner, keys[i - 1].corner, sizeof(keys[i].corner)) == 0)
+					duplicate[keys[i].triangle] = 1;
+
+			size_t write = 0;
+			for (size_t i = 0; i < triangleCount; i++)
+			{
+				if (duplicate[i])
+					continue;
+				for (int k = 0; k < 3; k++)
+					indices[write++] = indices[i * 3 + k];
+			}
+			indices.resize(write);
+		}
+
+		// How different two vertices' normals and UVs are
+		double AttributeDistance(const Vertex& a, const Vertex& b)
+		{
+			double nx = a.Normal.x - b.Normal.x, ny = a.Normal.y - b.Normal.y, nz = a.Normal.z - b.Normal.z;
+			double u = a.UV.x - b.UV.x, w = a.UV.y - b.UV.y;
+			return normalWeight * (nx * nx + ny * ny + nz * nz) + uvWeight * (u * u + w * w);
+		}
+
+		struct Collapse
+		{
+			unsigned int v, t;
+			float cost;
+		};
+	}
+}
+
+// --------------------------------------------------------
+// Simplifies in passes: each pass scores every edge collapse,
+// then makes the cheapest ones that don't touch each other's
+// neighbourhoods, until the target is reached or nothing can go
+// --------------------------------------------------------
+size_t MeshSimplifier::Simplify(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, unsigned int* outIndices, float* outError)
+{
+	std::vector<unsigned int> result(indices, indices + indexCount);
+	float resultError = 0.0f;
+	RemoveDuplicateTriangles(result);
+
+	// Work in a unit-sized box so the weights don't depend on the mesh's scale
+	DirectX::XMFLOAT3 min = vertexCount > 0 ? verts[0].Position : DirectX::XMFLOAT3(0, 0, 0);
+	DirectX::XMFLOAT3 max = min;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		const DirectX::XMFLOAT3& p = verts[i].Position;
+		min = DirectX::XMFLOAT3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max = DirectX::XMFLOAT3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+	double extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+	double scale = extent > 0.0 ? 1.0 / extent : 1.0;
+	double maxNormalizedError = maxError * scale;
+
+	std::vector<unsigned int> remap, wedge;
+	BuildPositionRemap(verts, vertexCount, remap, wedge);
+
+	std::vector<Vector3> positions(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const DirectX::XMFLOAT3& p = verts[i].Position;
+		positions[i] = { (p.x - min.x) * scale, (p.y - min.y) * scale, (p.z - min.z) * scale };
+	}
+
+	Adjacency adjacency;
+	OpenEdges open;
+	std::vector<unsigned char> kind;
+	BuildAdjacency(adjacency, result.data(), result.size(), vertexCount);
+	FindOpenEdges(open, adjacency, result.data(), result.size(), vertexCount, wedge);
+
+	// Quadrics live on positions (remap[v]), so seam vertices share one
+	// - Each triangle adds its plane, weighted by area
+	// - Border and seam edges add a plane through the edge, at right
+	//    angles to the triangle, so they keep their shape
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		unsigned int corner[3] = { result[i], result[i + 1], result[i + 2] };
+		const Vector3& p0 = positions[remap[corner[0]]];
+		Vector3 normal = Cross(Subtract(positions[remap[corner[1]]], p0), Subtract(positions[remap[corner[2]]], p0));
+		double length = std::sqrt(Dot(normal, normal));
+		if (length <= 0.0)
+			continue;
+
+		Vector3 n = { normal.x / length, normal.y / length, normal.z / length };
+		double area = length * 0.5;
+		for (int k = 0; k < 3; k++)
+			AddPlane(quadrics[remap[corner[k]]], n, -Dot(n, p0), area);
+
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = corner[k], b = corner[(k + 1) % 3];
+			if (HasEdge(adjacency, result.data(), b, a))
+				continue;
+
+			double weight = HasPositionEdge(adjacency, result.data(), wedge, b, a) ? seamWeight : borderWeight;
+			Vector3 edge = Subtract(positions[remap[b]], positions[remap[a]]);
+			Vector3 edgeNormal = Cross(edge, n);
+			double edgeNormalLength = std::sqrt(Dot(edgeNormal, edgeNormal));
+			if (edgeNormalLength <= 0.0)
+				continue;
+
+			Vector3 en = { edgeNormal.x / edgeNormalLength, edgeNormal.y / edgeNormalLength, edgeNormal.z / edgeNormalLength };
+			double d = -Dot(en, positions[remap[a]]);
+			AddPlane(quadrics[remap[a]], en, d, Dot(edge, edge) * weight);
+			AddPlane(quadrics[remap[b]], en, d, Dot(edge, edge) * weight);
+		}
+	}
+
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> collapseRemap(vertexCount);
+	std::vector<unsigned char> collapseLocked(vertexCount);
+
+	while (result.size() > targetIndexCount)
+	{
+		// Topology changes as we go, so classify again every pass
+		ClassifyVertices(kind, open, vertexCount, remap, wedge);
+
+		// Score every allowed collapse along every edge, in both directions
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 6; k++)
+			{
+				unsigned int v = result[i + k % 3];
+				unsigned int t = result[i + (k < 3 ? (k + 1) % 3 : (k + 2) % 3)];
+
+				// Borders and seams only slide along themselves, to another vertex
+				// of the same kind; everything else can go anywhere
+				if (kind[v] == Locked || remap[v] == remap[t])
+					continue;
+				if (kind[v] == Border || kind[v] == Seam)
+				{
+					if (kind[t] != kind[v] || (open.outVertex[v] != t && open.inVertex[v] != t))
+						continue;
+				}
+
+				double error = QuadricError(quadrics[remap[v]], positions[remap[t]]);
+				Vector3 edge = Subtract(positions[remap[t]], positions[remap[v]]);
+				double attributes = AttributeDistance(verts[v], verts[t]);
+				if (kind[v] == Seam)
+				{
+					unsigned int t2 = open.outVertex[v] == t ? open.inVertex[wedge[v]] : open.outVertex[wedge[v]];
+					if (t2 == none)
+						continue;
+					attributes = std::max(attributes, AttributeDistance(verts[wedge[v]], verts[t2]));
+				}
+
+				collapses.push_back({ v, t, (float)(error + attributes * Dot(edge, edge)) });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// Make the cheapest ones, keeping each one's neighbourhood to itself
+		for (size_t i = 0; i < vertexCount; i++)
+			collapseRemap[i] = (unsigned int)i;
+		std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+		size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+		for (const Collapse& c : collapses)
+		{
+			if (trianglesRemoved >= trianglesToRemove)
+				break;
+			if (c.cost > maxNormalizedError * maxNormalizedError)
+				break;
+
+			unsigned int v = c.v, t = c.t;
+			if (collapseLocked[remap[v]] || collapseLocked[remap[t]])
+				continue;
+
+			// The other side of a seam moves with it
+			unsigned int v2 = none, t2 = none;
+			if (kind[v] == Seam)
+			{
+				v2 = wedge[v];
+				t2 = open.outVertex[v] == t ? open.inVertex[v2] : open.outVertex[v2];
+				if (t2 == none || remap[t2] != remap[t])
+					continue;
+			}
+
+			if (FlipsTriangles(adjacency, result.data(), positions, remap, v, t) ||
+				(v2 != none && FlipsTriangles(adjacency, result.data(), positions, remap, v2, t2)))
+				continue;
+
+			// Lock everything around v, and count the triangles that go away
+			unsigned int sides[2] = { v, v2 };
+			for (unsigned int side : sides)
+			{
+				if (side == none)
+					continue;
+				for (unsigned int j = adjacency.offsets[side]; j < adjacency.offsets[side + 1]; j++)
+				{
+					const unsigned int* tri = result.data() + adjacency.triangles[j] * 3;
+					if (remap[tri[0]] == remap[t] || remap[tri[1]] == remap[t] || remap[tri[2]] == remap[t])
+						trianglesRemoved++;
+					collapseLocked[remap[tri[0]]] = 1;
+					collapseLocked[remap[tri[1]]] = 1;
+					collapseLocked[remap[tri[2]]] = 1;
+				}
+			}
+
+			collapseRemap[v] = t;
+			if (v2 != none)
+				collapseRemap[v2] = t2;
+			AddQuadric(quadrics[remap[t]], quadrics[remap[v]]);
+
+			resultError = std::max(resultError, (float)(std::sqrt((double)c.cost) * extent));
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// Apply, dropping triangles that now have two corners in one place
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = collapseRemap[result[i]];
+			unsigned int b = collapseRemap[result[i + 1]];
+			unsigned int c = collapseRemap[result[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+
+		BuildAdjacency(adjacency, result.data(), result.size(), vertexCount);
+		FindOpenEdges(open, adjacency, result.data(), result.size(), vertexCount, wedge);
+	}
+
+	if (!result.empty())
+		std::memcpy(outIndices, result.data(), result.size() * sizeof(unsigned int));
+	if (outError)
+		*outError = resultError;
+	return result.size();
+}
+
+// --------------------------------------------------------
+// LOD 0 is the mesh as-is, each LOD after it is simplified
+// from the one before (so errors add up along the chain)
+// --------------------------------------------------------
+void MeshSimplifier::BuildLodChain(const Vertex* verts, size_t vertexCount, std::vector<unsigned int>& indices, std::vector<Lod>& lods)
+{
+	lods.clear();
+	lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+	std::vector<unsigned int> simplified;
+	while (lods.size() < (size_t)MaxLods)
+	{
+		Lod previous = lods.back();
+		if (previous.indexCount / 3 <= minLodTriangles)
+			break;
+
+		size_t target = previous.indexCount / 6 * 3;
+		simplified.resize(previous.indexCount);
+		float error = 0.0f;
+		size_t count = Simplify(verts, vertexCount, indices.data() + previous.firstIndex, previous.indexCount,
+			target, FLT_MAX, simplified.data(), &error);
+
+		// Not worth another LOD if it barely got smaller
+		if (count == 0 || count > previous.indexCount * maxLodKeptFraction)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(simplified.data(), count, vertexCount);
+		lods.push_back({ (unsigned int)indices.size(), (unsigned int)count, previous.error + error });
+		indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Quadric error mesh simplification, and LOD chains built with it
+//
+// - Edge collapses onto existing vertices, cheapest first, using
+//    Garland & Heckbert's quadric error metric on positions plus
+//    a penalty for merging different normals/UVs
+// - Only the index buffer changes, so every LOD shares the
+//    mesh's vertex buffers (full, position-only and packed)
+// - Open borders only collapse along themselves, and UV/normal
+//    seams collapse both sides together, so neither tears open
+// - Anything more tangled than that (e.g. poles where many
+//    UV islands meet, hard edges) is left where it is, which can
+//    stop a mesh short of its target
+// --------------------------------------------------------
+namespace MeshSimplifier
+{
+	// Most LODs a mesh can have, including the original (LOD 0)
+	const int MaxLods = 6;
+
+	// One LOD: a range of the mesh's index buffer
+	struct Lod
+	{
+		unsigned int firstIndex;
+		unsigned int indexCount;
+		float error;	// Object-space distance this LOD may be off from LOD 0 by (an estimate, not exact)
+	};
+
+	// Writes a simplified copy of indices to outIndices (which needs room for indexCount)
+	// and returns how many indices it wrote
+	// - Stops at targetIndexCount, or before any collapse worse than maxError
+	// - outError (optional) is the error of the worst collapse made
+	size_t Simplify(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		size_t targetIndexCount, float maxError, unsigned int* outIndices, float* outError = 0);
+
+	// Treats indices as LOD 0 and appends coarser LODs after it, each
+	// roughly half the triangles of the one before, until the mesh
+	// is tiny, stops shrinking or MaxLods is reached
+	// - Each new LOD is reordered for the vertex cache
+	void BuildLodChain(const Vertex* verts, size_t vertexCount, std::vector<unsigned int>& indices, std::vector<Lod>& lods);
+}
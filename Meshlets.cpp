@@ -0,0 +1,284 @@
+#include "Meshlets.h"
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace Meshlets
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		const unsigned int none = 0xFFFFFFFF;
+
+		// Outward facing (un-normalized) normal of a triangle
+		// - Our meshes are wound clockwise in a left-handed space
+		//    (see ObjParser.h), so this points out of the front face
+		XMVECTOR TriangleNormal(const Vertex* verts, const unsigned int* tri)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&verts[tri[0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&verts[tri[1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&verts[tri[2]].Position);
+			return XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		}
+
+		// Sphere around the box around the meshlet's vertices, and its cone
+		void ComputeBounds(Meshlet& meshlet, const Vertex* verts, const unsigned int* indices)
+		{
+			const unsigned int* tris = indices + meshlet.firstIndex;
+			XMVECTOR min = XMLoadFloat3(&verts[tris[0]].Position);
+			XMVECTOR max = min;
+			for (unsigned int i = 1; i < meshlet.indexCount; i++)
+			{
+				XMVECTOR p = XMLoadFloat3(&verts[tris[i]].Position);
+				min = XMVectorMin(min, p);
+				max = XMVectorMax(max, p);
+			}
+
+			XMVECTOR center = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+			float radiusSquared = 0.0f;
+			for (unsigned int i = 0; i < meshlet.indexCount; i++)
+			{
+				XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&verts[tris[i]].Position), center);
+				radiusSquared = std::max(radiusSquared, XMVectorGetX(XMVector3LengthSq(offset)));
+			}
+			XMStoreFloat3(&meshlet.center, center);
+			meshlet.radius = std::sqrt(radiusSquared);
+
+			// Cone axis is the average triangle direction, and the cone
+			// is as wide as the triangle furthest from that
+			XMVECTOR axis = XMVectorZero();
+			for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+				axis = XMVectorAdd(axis, XMVector3Normalize(TriangleNormal(verts, tris + i)));
+			axis = XMVector3Normalize(axis);
+
+			float minDot = 1.0f;
+			for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+			{
+				XMVECTOR normal = TriangleNormal(verts, tris + i);
+				if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+					minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMVector3Normalize(normal))));
+			}
+
+			XMStoreFloat3(&meshlet.coneAxis, axis);
+			XMStoreFloat3(&meshlet.coneApex, center);
+			if (minDot <= 0.0f || XMVectorGetX(XMVector3LengthSq(axis)) == 0.0f)
+			{
+				// Some triangle faces sideways (or further), no cone can help
+				meshlet.coneCutoff = 2.0f;
+				return;
+			}
+
+			// Move the apex back along the axis until it's behind every
+			// triangle's plane, so the test works from any distance
+			float maxT = 0.0f;
+			for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+			{
+				XMVECTOR normal = XMVector3Normalize(TriangleNormal(verts, tris + i));
+				XMVECTOR p0 = XMLoadFloat3(&verts[tris[i]].Position);
+				float toPlane = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), normal));
+				float along = XMVectorGetX(XMVector3Dot(axis, normal));
+				if (along > 0.0f)
+					maxT = std::max(maxT, toPlane / along);
+			}
+			XMStoreFloat3(&meshlet.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+
+			// The view direction has to be within (90 degrees - spread) of the axis
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Greedy growth: start from a seed triangle, keep adding the
+// neighbouring triangle that brings in the fewest new vertices
+// (nearest to the meshlet's middle on ties) until it's full
+// --------------------------------------------------------
+std::vector<Meshlets::Meshlet> Meshlets::Build(const Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return meshlets;
+
+	// Triangles using each vertex
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+	std::vector<unsigned int> adjacency(indexCount);
+	{
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<XMFLOAT3> centroids(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		XMVECTOR sum = XMVectorAdd(XMLoadFloat3(&verts[indices[t * 3]].Position),
+			XMVectorAdd(XMLoadFloat3(&verts[indices[t * 3 + 1]].Position), XMLoadFloat3(&verts[indices[t * 3 + 2]].Position)));
+		XMStoreFloat3(&centroids[t], XMVectorScale(sum, 1.0f / 3.0f));
+	}
+
+	std::vector<unsigned char> used(triangleCount, 0);
+	std::vector<unsigned int> vertexMeshlet(vertexCount, none);	// Which meshlet last used each vertex
+	std::vector<unsigned int> ordered;
+	ordered.reserve(indexCount);
+	std::vector<unsigned int> candidates;
+	size_t scan = 0;
+	unsigned int seed = none;
+
+	while (ordered.size() < indexCount)
+	{
+		Meshlet meshlet = {};
+		meshlet.firstIndex = (unsigned int)ordered.size();
+		unsigned int id = (unsigned int)meshlets.size();
+		XMVECTOR centroidSum = XMVectorZero();
+		candidates.clear();
+
+		// Seed with the best leftover candidate from the last meshlet,
+		// otherwise the first unused triangle in the original order
+		if (seed == none || used[seed])
+		{
+			while (used[scan]) scan++;
+			seed = (unsigned int)scan;
+		}
+
+		unsigned int next = seed;
+		seed = none;
+		while (next != none)
+		{
+			// Add it
+			used[next] = 1;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[next * 3 + k];
+				ordered.push_back(v);
+				if (vertexMeshlet[v] != id)
+				{
+					vertexMeshlet[v] = id;
+					meshlet.vertexCount++;
+				}
+				for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++)
+					if (!used[adjacency[a]])
+						candidates.push_back(adjacency[a]);
+			}
+			meshlet.indexCount += 3;
+			centroidSum = XMVectorAdd(centroidSum, XMLoadFloat3(&centroids[next]));
+
+			// Pick the next one, dropping candidates that got used along the way
+			XMVECTOR middle = XMVectorScale(centroidSum, 3.0f / meshlet.indexCount);
+			unsigned int best = none;
+			unsigned int bestNew = 4;
+			float bestDistance = 0.0f;
+			size_t write = 0;
+			for (size_t c = 0; c < candidates.size(); c++)
+			{
+				unsigned int t = candidates[c];
+				if (used[t])
+					continue;
+				candidates[write++] = t;
+
+				unsigned int newVertices = 0;
+				for (int k = 0; k < 3; k++)
+					newVertices += vertexMeshlet[indices[t * 3 + k]] != id;
+				float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&centroids[t]), middle)));
+				if (newVertices < bestNew || (newVertices == bestNew && distance < bestDistance))
+				{
+					best = t;
+					bestNew = newVertices;
+					bestDistance = distance;
+				}
+			}
+			candidates.resize(write);
+
+			// Full? Then the best candidate seeds the next meshlet
+			if (best != none && (meshlet.vertexCount + bestNew > MaxVertices || meshlet.indexCount / 3 + 1 > MaxTriangles))
+			{
+				seed = best;
+				best = none;
+			}
+			next = best;
+
+			// Ran out of neighbours (end of an island) - carry on with
+			// the next unused triangle if there's room for any triangle
+			if (next == none && seed == none && ordered.size() < indexCount &&
+				meshlet.vertexCount + 3 <= MaxVertices && meshlet.indexCount / 3 < MaxTriangles)
+			{
+				while (used[scan]) scan++;
+				next = (unsigned int)scan;
+			}
+		}
+
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices);
+	for (Meshlet& meshlet : meshlets)
+		ComputeBounds(meshlet, verts, indices);
+	return meshlets;
+}
+
+// --------------------------------------------------------
+// Frustum test against planes pulled straight out of the
+// world-view-projection matrix (so they're in object space),
+// then the backface cone test with the camera in object space
+// --------------------------------------------------------
+size_t Meshlets::Cull(const Meshlet* meshlets, size_t meshletCount, const XMFLOAT4X4& world,
+	const XMFLOAT4X4& view, const XMFLOAT4X4& proj, XMFLOAT3 cameraPos,
+	std::vector<IndexRange>& visible)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMFLOAT4X4 wvp;
+	XMStoreFloat4x4(&wvp, worldMatrix * XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj));
+
+	// World * view * proj gives the planes in object space
+	FrustumCuller::Frustum frustum = FrustumCuller::ExtractPlanes(wvp);
+	XMVECTOR planes[6];
+	for (int p = 0; p < 6; p++)
+		planes[p] = XMLoadFloat4(&frustum.planes[p]);
+
+	// Cone angles only survive uniform scaling, so skip the cone
+	// test for anything stretched (or mirrored, which flips the winding)
+	float scaleX = XMVectorGetX(XMVector3Length(worldMatrix.r[0]));
+	float scaleY = XMVectorGetX(XMVector3Length(worldMatrix.r[1]));
+	float scaleZ = XMVectorGetX(XMVector3Length(worldMatrix.r[2]));
+	bool uniformScale = std::fabs(scaleX - scaleY) <= scaleX * 0.001f && std::fabs(scaleX - scaleZ) <= scaleX * 0.001f;
+
+	XMVECTOR determinant;
+	XMMATRIX inverseWorld = XMMatrixInverse(&determinant, worldMatrix);
+	XMVECTOR camera = XMVector3Transform(XMLoadFloat3(&cameraPos), inverseWorld);
+	bool coneTest = uniformScale && XMVectorGetX(determinant) > 0.0f;
+
+	size_t visibleCount = 0;
+	for (size_t m = 0; m < meshletCount; m++)
+	{
+		const Meshlet& meshlet = meshlets[m];
+
+		XMVECTOR center = XMLoadFloat3(&meshlet.center);
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+			outside = XMVectorGetX(XMPlaneDotCoord(planes[p], center)) < -meshlet.radius;
+		if (outside)
+			continue;
+
+		if (coneTest && meshlet.coneCutoff <= 1.0f)
+		{
+			XMVECTOR toApex = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&meshlet.coneApex), camera));
+			if (XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff)
+				continue;
+		}
+
+		// Merge with the previous range if they touch
+		if (!visible.empty() && visible.back().firstIndex + visible.back().indexCount == meshlet.firstIndex)
+			visible.back().indexCount += meshlet.indexCount;
+		else
+			visible.push_back({ meshlet.firstIndex, meshlet.indexCount });
+		visibleCount++;
+	}
+	return visibleCount;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Meshlets: small clusters of a mesh's triangles that can be
+// culled on their own
+//
+// - Build() regroups triangles so each meshlet is one
+//    contiguous range of the index buffer, grown outwards from
+//    a seed triangle so the clusters stay compact
+// - Each meshlet has a bounding sphere (frustum culling) and a
+//    normal cone (culls it when every triangle faces away)
+// - Cull() is plain CPU code - it only needs matrices, not a GPU
+// --------------------------------------------------------
+namespace Meshlets
+{
+	const unsigned int MaxVertices = 64;
+	const unsigned int MaxTriangles = 124;
+
+	struct Meshlet
+	{
+		unsigned int firstIndex;
+		unsigned int indexCount;
+		unsigned int vertexCount;		// Unique vertices used
+
+		// Object-space bounding sphere
+		DirectX::XMFLOAT3 center;
+		float radius;
+
+		// Backface cone: if the direction from the camera to the apex
+		// is within acos(coneCutoff) of the axis, every triangle faces away
+		// - coneCutoff > 1 means the normals are too spread out to ever cull
+		DirectX::XMFLOAT3 coneApex;
+		float coneCutoff;
+		DirectX::XMFLOAT3 coneAxis;
+	};
+
+	// A run of indices to draw - neighbouring visible meshlets are merged
+	struct IndexRange
+	{
+		unsigned int firstIndex;
+		unsigned int indexCount;
+	};
+
+	// Reorders the triangles in indices (in place) into meshlets, and
+	// returns them - firstIndex is relative to indices
+	std::vector<Meshlet> Build(const Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+	// Appends the ranges of meshlets that may be visible to visible,
+	// and returns how many meshlets that was
+	// - Matrices are the usual row-vector ones (what Transform/Camera give us)
+	// - Conservative: it never drops a meshlet with a visible triangle in it
+	size_t Cull(const Meshlet* meshlets, size_t meshletCount, const DirectX::XMFLOAT4X4& world,
+		const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj, DirectX::XMFLOAT3 cameraPos,
+		std::vector<IndexRange>& visible);
+}
@@ -0,0 +1,294 @@
+#include "NullBackend.h"
+
+NullBackend::NullBackend()
+{
+	recording = false;
+	Reset();
+}
+
+void NullBackend::SetRecording(bool record)
+{
+	recording = record;
+}
+
+void NullBackend::Reset()
+{
+	calls.clear();
+	for (unsigned int& count : counts)
+		count = 0;
+	triangles = 0;
+	constantBytes = 0;
+	errorCount = 0;
+	errors.clear();
+
+	vertexShaderBound = false;
+	inputLayoutBound = false;
+	indexBufferBound = false;
+	vertexBufferBound = false;
+}
+
+unsigned int NullBackend::GetCount(CallType type) const { return counts[type]; }
+unsigned long long NullBackend::GetTriangleCount() const { return triangles; }
+unsigned long long NullBackend::GetConstantBytes() const { return constantBytes; }
+const std::vector<NullBackend::Call>& NullBackend::GetCalls() const { return calls; }
+unsigned int NullBackend::GetErrorCount() const { return errorCount; }
+const std::vector<std::string>& NullBackend::GetErrors() const { return errors; }
+
+unsigned int NullBackend::GetTotalCount() const
+{
+	unsigned int total = 0;
+	for (unsigned int count : counts)
+		total += count;
+	return total;
+}
+
+const char* NullBackend::CallName(CallType type)
+{
+	static const char* names[CallTypeCount] =
+	{
+		"VertexShader", "PixelShader", "InputLayout", "RasterizerState", "IndexBuffer",
+		"VertexBuffers", "ShaderResources", "Samplers", "Constants",
+		"UpdatePersistent", "BindPersistent", "UpdateInstances", "InstanceOrder",
+		"ClearRenderTarget", "ClearDepth", "RenderTargets", "Viewport", "DepthStencilState",
+		"Draw", "DrawIndexed", "DrawIndexedInstanced"
+	};
+	return type < CallTypeCount ? names[type] : "?";
+}
+
+void NullBackend::Record(CallType type, unsigned int stage, unsigned int first, unsigned int count, unsigned int extra)
+{
+	counts[type]++;
+	if (recording)
+		calls.push_back({ type, stage, first, count, extra });
+}
+
+void NullBackend::Error(const std::string& message)
+{
+	errorCount++;
+	if (errors.size() < MaxErrors)
+		errors.push_back("Call " + std::to_string(GetTotalCount()) + ": " + message);
+}
+
+void NullBackend::CheckDraw(CallType type, bool indexed)
+{
+	if (!vertexShaderBound)
+		Error(std::string(CallName(type)) + " with no vertex shader");
+	if (indexed && !indexBufferBound)
+		Error(std::string(CallName(type)) + " with no index buffer");
+	if (indexed && !vertexBufferBound)
+		Error(std::string(CallName(type)) + " with no vertex buffer in slot 0");
+	if (indexed && !inputLayoutBound)
+		Error(std::string(CallName(type)) + " with no input layout");
+}
+
+void NullBackend::SetVertexShader(ID3D11VertexShader* shader)
+{
+	Record(VertexShaderCall, StateCache::Vertex, 0, 1, 0);
+	vertexShaderBound = shader != 0;
+}
+
+// Null is fine here - the shadow pass draws depth only
+void NullBackend::SetPixelShader(ID3D11PixelShader* /*shader*/)
+{
+	Record(PixelShaderCall, StateCache::Pixel, 0, 1, 0);
+}
+
+void NullBackend::SetInputLayout(ID3D11InputLayout* layout)
+{
+	Record(InputLayoutCall, 0, 0, 1, 0);
+	inputLayoutBound = layout != 0;
+}
+
+void NullBackend::SetRasterizerState(ID3D11RasterizerState* /*state*/)
+{
+	Record(RasterizerStateCall, 0, 0, 1, 0);
+}
+
+void NullBackend::SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	Record(IndexBufferCall, 0, offset, 1, format);
+	indexBufferBound = buffer != 0;
+}
+
+void NullBackend::SetVertexBuffers(unsigned int start, unsigned int count, ID3D11Buffer* const* buffers, const unsigned int* /*strides*/, const unsigned int* /*offsets*/)
+{
+	Record(VertexBuffersCall, 0, start, count, 0);
+	if (start > StateCache::MaxVertexBuffers || count > StateCache::MaxVertexBuffers - start)
+	{
+		Error("VertexBuffers past slot " + std::to_string(StateCache::MaxVertexBuffers - 1));
+		return;
+	}
+	if (start == 0 && count > 0)
+		vertexBufferBound = buffers[0] != 0;
+}
+
+void NullBackend::SetShaderResources(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* /*views*/)
+{
+	Record(ShaderResourcesCall, stage, start, count, 0);
+	if (start > StateCache::MaxShaderResources || count > StateCache::MaxShaderResources - start)
+		Error("ShaderResources past slot " + std::to_string(StateCache::MaxShaderResources - 1));
+}
+
+void NullBackend::SetSamplers(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* /*samplers*/)
+{
+	Record(SamplersCall, stage, start, count, 0);
+	if (start > StateCache::MaxSamplers || count > StateCache::MaxSamplers - start)
+		Error("Samplers past slot " + std::to_string(StateCache::MaxSamplers - 1));
+}
+
+void NullBackend::SetConstants(StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size)
+{
+	Record(ConstantsCall, stage, slot, 1, size);
+	constantBytes += size;
+	if (slot >= MaxConstantBuffers)
+		Error("Constants in slot " + std::to_string(slot) + ", past " + std::to_string(MaxConstantBuffers - 1));
+	if (data == 0 || size == 0)
+		Error("Constants with no data");
+	if (size > MaxConstantBytes)
+		Error("Constants of " + std::to_string(size) + " bytes, over " + std::to_string(MaxConstantBytes));
+}
+
+// Growing loses what was in the blocks, as it would on the GPU
+void NullBackend::ReservePersistentConstants(unsigned int blockCount)
+{
+	if (blockCount <= persistentWritten.size())
+		return;
+	persistentWritten.assign(blockCount, false);
+}
+
+void NullBackend::UpdatePersistentConstants(unsigned int block, const void* data, unsigned int size)
+{
+	Record(UpdatePersistentCall, 0, block, 1, size);
+	constantBytes += size;
+	if (block >= persistentWritten.size())
+	{
+		Error("UpdatePersistent of block " + std::to_string(block) + ", only " + std::to_string(persistentWritten.size()) + " reserved");
+		return;
+	}
+	if (data == 0 || size == 0)
+		Error("UpdatePersistent with no data");
+	if (size > PersistentBlockBytes)
+		Error("UpdatePersistent of " + std::to_string(size) + " bytes, over " + std::to_string(PersistentBlockBytes));
+	persistentWritten[block] = true;
+}
+
+void NullBackend::BindPersistentConstants(StateCache::Stage stage, unsigned int slot, unsigned int block)
+{
+	Record(BindPersistentCall, stage, slot, 1, block);
+	if (slot >= MaxConstantBuffers)
+		Error("BindPersistent in slot " + std::to_string(slot) + ", past " + std::to_string(MaxConstantBuffers - 1));
+	if (block >= persistentWritten.size())
+		Error("BindPersistent of block " + std::to_string(block) + ", only " + std::to_string(persistentWritten.size()) + " reserved");
+	else if (!persistentWritten[block])
+		Error("BindPersistent of block " + std::to_string(block) + ", which was never written");
+}
+
+// Same as the persistent blocks - growing loses what was there
+void NullBackend::ReserveInstances(unsigned int slotCount)
+{
+	if (slotCount <= instanceWritten.size())
+		return;
+	instanceWritten.assign(slotCount, false);
+}
+
+void NullBackend::UpdateInstances(unsigned int firstSlot, unsigned int count, const void* data)
+{
+	Record(UpdateInstancesCall, 0, firstSlot, count, count * InstanceBytes);
+	constantBytes += (unsigned long long)count * InstanceBytes;
+	if (firstSlot > instanceWritten.size() || count > instanceWritten.size() - firstSlot)
+	{
+		Error("UpdateInstances of slots " + std::to_string(firstSlot) + " to " + std::to_string(firstSlot + count - 1) +
+			", only " + std::to_string(instanceWritten.size()) + " reserved");
+		return;
+	}
+	if (data == 0 || count == 0)
+		Error("UpdateInstances with no data");
+	for (unsigned int i = 0; i < count; i++)
+		instanceWritten[firstSlot + i] = true;
+}
+
+void NullBackend::SetInstanceOrder(const unsigned int* slots, unsigned int count)
+{
+	Record(InstanceOrderCall, StateCache::Vertex, 0, count, count * sizeof(unsigned int));
+	constantBytes += (unsigned long long)count * sizeof(unsigned int);
+	if (slots == 0 || count == 0)
+	{
+		Error("InstanceOrder with no slots");
+		return;
+	}
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (slots[i] >= instanceWritten.size())
+		{
+			Error("InstanceOrder draws slot " + std::to_string(slots[i]) + ", only " + std::to_string(instanceWritten.size()) + " reserved");
+			return;
+		}
+		if (!instanceWritten[slots[i]])
+		{
+			Error("InstanceOrder draws slot " + std::to_string(slots[i]) + ", which was never written");
+			return;
+		}
+	}
+}
+
+void NullBackend::ClearRenderTarget(ID3D11RenderTargetView* target, const float color[4])
+{
+	Record(ClearRenderTargetCall, 0, 0, 1, 0);
+	if (target == 0)
+		Error("ClearRenderTarget with no target");
+	if (color == 0)
+		Error("ClearRenderTarget with no color");
+}
+
+void NullBackend::ClearDepth(ID3D11DepthStencilView* depth, float value)
+{
+	Record(ClearDepthCall, 0, 0, 1, 0);
+	if (depth == 0)
+		Error("ClearDepth with no depth buffer");
+	if (value < 0.0f || value > 1.0f)
+		Error("ClearDepth to " + std::to_string(value) + ", outside 0 to 1");
+}
+
+// No targets is fine (the shadow pass writes depth only), and
+// so is no depth buffer (the post process has none)
+void NullBackend::SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* /*depth*/)
+{
+	Record(RenderTargetsCall, 0, 0, count, 0);
+	if (count > MaxRenderTargets)
+		Error("RenderTargets of " + std::to_string(count) + ", over " + std::to_string(MaxRenderTargets));
+	if (count > 0 && targets == 0)
+		Error("RenderTargets with no array of targets");
+}
+
+void NullBackend::SetViewport(float width, float height)
+{
+	Record(ViewportCall, 0, 0, 1, 0);
+	if (!(width > 0.0f && height > 0.0f))
+		Error("Viewport of " + std::to_string(width) + " x " + std::to_string(height));
+}
+
+void NullBackend::SetDepthStencilState(ID3D11DepthStencilState* /*state*/)
+{
+	Record(DepthStencilStateCall, 0, 0, 1, 0);
+}
+
+void NullBackend::Draw(unsigned int vertexCount, unsigned int firstVertex)
+{
+	Record(DrawCall, 0, firstVertex, vertexCount, 1);
+	CheckDraw(DrawCall, false);
+	triangles += vertexCount / 3;
+}
+
+void NullBackend::DrawIndexed(unsigned int indexCount, unsigned int firstIndex, int /*baseVertex*/)
+{
+	Record(DrawIndexedCall, 0, firstIndex, indexCount, 1);
+	CheckDraw(DrawIndexedCall, true);
+	triangles += indexCount / 3;
+}
+
+void NullBackend::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int firstIndex, int /*baseVertex*/, unsigned int /*firstInstance*/)
+{
+	Record(DrawIndexedInstancedCall, 0, firstIndex, indexCount, instanceCount);
+	CheckDraw(DrawIndexedInstancedCall, true);
+	triangles += (unsigned long long)(indexCount / 3) * instanceCount;
+}
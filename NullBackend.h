@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "RenderBackend.h"
+
+// --------------------------------------------------------
+// A RenderBackend that draws nothing - it checks each call
+// against what D3D11 would need and keeps count instead
+//
+// - Every call is counted by type; with recording on, each
+//    one is also kept (in order) for tests to compare against
+// - Validation mirrors the debug layer's common complaints:
+//    drawing without a vertex shader, an indexed draw without
+//    an index buffer / vertex buffer / input layout, slots
+//    past D3D11's limits and oversized constant buffers,
+//    persistent constant blocks and instance slots that were
+//    never reserved or never written, clearing nothing and
+//    empty viewports
+// - Problems are reported, not thrown, so a whole frame can
+//    run and show everything that went wrong in it
+// --------------------------------------------------------
+class NullBackend : public RenderBackend
+{
+public:
+	enum CallType
+	{
+		VertexShaderCall, PixelShaderCall, InputLayoutCall, RasterizerStateCall, IndexBufferCall,
+		VertexBuffersCall, ShaderResourcesCall, SamplersCall, ConstantsCall,
+		UpdatePersistentCall, BindPersistentCall, UpdateInstancesCall, InstanceOrderCall,
+		ClearRenderTargetCall, ClearDepthCall, RenderTargetsCall, ViewportCall, DepthStencilStateCall,
+		DrawCall, DrawIndexedCall, DrawIndexedInstancedCall,
+		CallTypeCount
+	};
+
+	// What each field means depends on the type - slot / start,
+	// count, and size in bytes or instance count where they apply
+	struct Call
+	{
+		CallType type;
+		unsigned int stage;
+		unsigned int first;
+		unsigned int count;
+		unsigned int extra;
+	};
+
+	static const unsigned int MaxConstantBuffers = 14; // D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+	static const unsigned int MaxRenderTargets = 8; // D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT
+	static const unsigned int MaxConstantBytes = 4096 * 16;
+	static const size_t MaxErrors = 32; // Only the first few are kept, all are counted
+
+	NullBackend();
+
+	void SetRecording(bool record);
+	void Reset(); // Counts, recorded calls, errors and bound state - persistent blocks stay, like a buffer would
+
+	unsigned int GetCount(CallType type) const;
+	unsigned int GetTotalCount() const;
+	unsigned long long GetTriangleCount() const; // Over every draw, instances included
+	unsigned long long GetConstantBytes() const; // Streamed and persistent, instances and their order included
+	const std::vector<Call>& GetCalls() const;
+	unsigned int GetErrorCount() const;
+	const std::vector<std::string>& GetErrors() const;
+
+	static const char* CallName(CallType type);
+
+	// RenderBackend
+	void SetVertexShader(ID3D11VertexShader* shader) override;
+	void SetPixelShader(ID3D11PixelShader* shader) override;
+	void SetInputLayout(ID3D11InputLayout* layout) override;
+	void SetRasterizerState(ID3D11RasterizerState* state) override;
+	void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) override;
+	void SetVertexBuffers(unsigned int start, unsigned int count, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) override;
+	void SetShaderResources(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* views) override;
+	void SetSamplers(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* samplers) override;
+	void SetConstants(StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size) override;
+	void ReservePersistentConstants(unsigned int blockCount) override;
+	void UpdatePersistentConstants(unsigned int block, const void* data, unsigned int size) override;
+	void BindPersistentConstants(StateCache::Stage stage, unsigned int slot, unsigned int block) override;
+	void ReserveInstances(unsigned int slotCount) override;
+	void UpdateInstances(unsigned int firstSlot, unsigned int count, const void* data) override;
+	void SetInstanceOrder(const unsigned int* slots, unsigned int count) override;
+	void ClearRenderTarget(ID3D11RenderTargetView* target, const float color[4]) override;
+	void ClearDepth(ID3D11DepthStencilView* depth, float value) override;
+	void SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth) override;
+	void SetViewport(float width, float height) override;
+	void SetDepthStencilState(ID3D11DepthStencilState* state) override;
+	void Draw(unsigned int vertexCount, unsigned int firstVertex) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int firstIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int firstIndex, int baseVertex, unsigned int firstInstance) override;
+
+private:
+	void Record(CallType type, unsigned int stage, unsigned int first, unsigned int count, unsigned int extra);
+	void Error(const std::string& message);
+	void CheckDraw(CallType type, bool indexed);
+
+	bool recording;
+	std::vector<Call> calls;
+	unsigned int counts[CallTypeCount];
+	unsigned long long triangles;
+	unsigned long long constantBytes;
+	unsigned int errorCount;
+	std::vector<std::string> errors;
+
+	// Just enough of what's bound to validate draws
+	bool vertexShaderBound;
+	bool inputLayoutBound;
+	bool indexBufferBound;
+	bool vertexBufferBound; // Slot 0
+
+	std::vector<bool> persistentWritten; // One per reserved block
+	std::vector<bool> instanceWritten; // One per reserved slot
+};
@@ -0,0 +1,498 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Jobs.h"
+#include "VertexWelder.h"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DirectX;
+
+// Based on the original .OBJ loading code by Chris Cascioli,
+// which read each line with getline() and sscanf_s().  This
+// version works directly on the mapped bytes instead.
+
+namespace ObjParser
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Every power of ten up to 1e10 is exactly representable as a float
+		const float powersOfTen[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+		// Digits beyond this no longer fit in the 64-bit mantissa
+		const unsigned long long mantissaLimit = 100000000000000000ULL;
+
+		// One "p/t/n" group of a face line, as written in the file
+		// - 0 means the index was left out (e.g. "p//n")
+		struct FaceCorner
+		{
+			int position;
+			int uv;
+			int normal;
+		};
+
+		inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+		inline const char* SkipSpaces(const char* c, const char* end)
+		{
+			while (c < end && (*c == ' ' || *c == '\t'))
+				c++;
+			return c;
+		}
+
+		inline const char* NextLine(const char* c, const char* end)
+		{
+			const char* newLine = (const char*)memchr(c, '\n', end - c);
+			return newLine ? newLine + 1 : end;
+		}
+
+		// Reads "p", "p/t", "p//n" or "p/t/n"
+		const char* ParseCorner(const char* c, const char* end, FaceCorner& corner)
+		{
+			c = ParseInt(c, end, corner.position);
+			if (!c)
+				return 0;
+
+			corner.uv = 0;
+			corner.normal = 0;
+			if (c < end && *c == '/')
+			{
+				c++;
+				if (c < end && *c != '/')
+				{
+					const char* next = ParseInt(c, end, corner.uv);
+					if (next) c = next;
+				}
+
+				if (c < end && *c == '/')
+				{
+					c++;
+					const char* next = ParseInt(c, end, corner.normal);
+					if (next) c = next;
+				}
+			}
+			return c;
+		}
+
+		// Which indices of a ChunkCorner count back from a point inside the chunk
+		enum RelativeFlags
+		{
+			RelativePosition = 1,
+			RelativeUV = 2,
+			RelativeNormal = 4
+		};
+
+		// A triangle corner as seen from inside one chunk
+		// - Positive OBJ indices are already global, so they are just made 0-based
+		// - Negative OBJ indices count back from wherever the face is, which
+		//    we only know relative to the chunk's start - these get a flag
+		// - -1 without a flag means the index was left out
+		struct ChunkCorner
+		{
+			int position;
+			int uv;
+			int normal;
+			unsigned char relative;
+		};
+
+		// Everything one thread parses out of its slice of the file
+		struct ObjChunk
+		{
+			const char* begin;
+			const char* end;
+			std::vector<XMFLOAT3> positions;
+			std::vector<XMFLOAT3> normals;
+			std::vector<XMFLOAT2> uvs;
+			std::vector<ChunkCorner> corners; // Three per triangle, winding already flipped
+
+			// Where this chunk's elements start globally (prefix sums)
+			size_t positionBase;
+			size_t uvBase;
+			size_t normalBase;
+			size_t cornerBase;
+		};
+
+		// Chunks smaller than this aren't worth a thread
+		const size_t minimumChunkBytes = 256 * 1024;
+
+		inline int ToChunkIndex(int index, size_t countSoFar, unsigned char flag, unsigned char& relative)
+		{
+			if (index > 0) return index - 1;
+			if (index == 0) return -1;
+			relative |= flag;
+			return (int)countSoFar + index;
+		}
+
+		// Turns a chunk index into a global one, checking it's in range
+		inline size_t ResolveIndex(int index, bool relative, size_t chunkBase, size_t count)
+		{
+			long long resolved = relative ? (long long)chunkBase + index : (long long)index;
+			if (resolved < 0 || resolved >= (long long)count)
+				throw std::invalid_argument("Error parsing OBJ: Face references an element that does not exist");
+			return (size_t)resolved;
+		}
+
+		// --------------------------------------------------------
+		// Parses one chunk of lines
+		//
+		// - A quick first pass counts each kind of line so every
+		//    vector is reserved exactly once
+		// - The second pass tokenizes each line in place
+		// --------------------------------------------------------
+		void ParseChunk(ObjChunk& chunk)
+		{
+			const char* end = chunk.end;
+
+			size_t positionCount = 0, uvCount = 0, normalCount = 0, faceCount = 0;
+			for (const char* line = chunk.begin; line < end; line = NextLine(line, end))
+			{
+				const char* c = SkipSpaces(line, end);
+				if (end - c < 2) continue;
+
+				if (c[0] == 'f') faceCount++;
+				else if (c[0] == 'v')
+				{
+					if (c[1] == 'n') normalCount++;
+					else if (c[1] == 't') uvCount++;
+					else positionCount++;
+				}
+			}
+
+			chunk.positions.reserve(positionCount);
+			chunk.normals.reserve(normalCount);
+			chunk.uvs.reserve(uvCount);
+			chunk.corners.reserve(faceCount * 3);
+
+			std::vector<ChunkCorner> faceCorners; // Corners of the current face
+			for (const char* line = chunk.begin; line < end; line = NextLine(line, end))
+			{
+				const char* c = SkipSpaces(line, end);
+				if (end - c < 2) continue;
+
+				if (c[0] == 'v' && c[1] == 'n')
+				{
+					XMFLOAT3 norm = XMFLOAT3(0, 0, 0);
+					const char* n = ParseFloat(c + 2, end, norm.x);
+					if (n) n = ParseFloat(n, end, norm.y);
+					if (n) n = ParseFloat(n, end, norm.z);
+					chunk.normals.push_back(norm);
+				}
+				else if (c[0] == 'v' && c[1] == 't')
+				{
+					XMFLOAT2 uv = XMFLOAT2(0, 0);
+					const char* n = ParseFloat(c + 2, end, uv.x);
+					if (n) n = ParseFloat(n, end, uv.y);
+					chunk.uvs.push_back(uv);
+				}
+				else if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t'))
+				{
+					XMFLOAT3 pos = XMFLOAT3(0, 0, 0);
+					const char* n = ParseFloat(c + 1, end, pos.x);
+					if (n) n = ParseFloat(n, end, pos.y);
+					if (n) n = ParseFloat(n, end, pos.z);
+					chunk.positions.push_back(pos);
+				}
+				else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t'))
+				{
+					// Gather every corner on the line
+					faceCorners.clear();
+					FaceCorner fc;
+					for (const char* n = ParseCorner(c + 1, end, fc); n; n = ParseCorner(n, end, fc))
+					{
+						ChunkCorner corner = {};
+						corner.position = ToChunkIndex(fc.position, chunk.positions.size(), RelativePosition, corner.relative);
+						corner.uv = ToChunkIndex(fc.uv, chunk.uvs.size(), RelativeUV, corner.relative);
+						corner.normal = ToChunkIndex(fc.normal, chunk.normals.size(), RelativeNormal, corner.relative);
+						faceCorners.push_back(corner);
+					}
+
+					// Fan triangulation (0, i, i-1), which flips the winding order:
+					// a triangle becomes (1,3,2) and a quad adds (1,4,3), like the original loader
+					for (size_t i = 2; i < faceCorners.size(); i++)
+					{
+						chunk.corners.push_back(faceCorners[0]);
+						chunk.corners.push_back(faceCorners[i]);
+						chunk.corners.push_back(faceCorners[i - 1]);
+					}
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Parses a float without sscanf/strtof
+//
+// - Digits are accumulated into an integer mantissa and a
+//    base-10 exponent
+// - If both fit exactly in a float, a single multiply or
+//    divide gives the correctly rounded answer - the same
+//    bits sscanf would have produced
+// - Anything else (very long numbers, huge exponents) falls
+//    back to std::from_chars, which is also locale-free
+// --------------------------------------------------------
+const char* ObjParser::ParseFloat(const char* c, const char* end, float& out)
+{
+	c = SkipSpaces(c, end);
+	const char* start = c;
+
+	bool negative = false;
+	if (c < end && (*c == '-' || *c == '+'))
+	{
+		negative = *c == '-';
+		c++;
+	}
+	const char* digitsStart = c;
+
+	unsigned long long mantissa = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	bool exact = true;
+
+	// Whole part
+	for (; c < end && IsDigit(*c); c++)
+	{
+		anyDigits = true;
+		if (mantissa < mantissaLimit) { mantissa = mantissa * 10 + (*c - '0'); }
+		else { exponent++; exact &= *c == '0'; }
+	}
+
+	// Fractional part
+	if (c < end && *c == '.')
+	{
+		for (c++; c < end && IsDigit(*c); c++)
+		{
+			anyDigits = true;
+			if (mantissa < mantissaLimit) { mantissa = mantissa * 10 + (*c - '0'); exponent--; }
+			else { exact &= *c == '0'; }
+		}
+	}
+
+	if (!anyDigits)
+		return 0;
+
+	// Optional exponent - only consumed if it actually has digits
+	if (c < end && (*c == 'e' || *c == 'E'))
+	{
+		const char* e = c + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			e++;
+		}
+
+		if (e < end && IsDigit(*e))
+		{
+			int explicitExponent = 0;
+			for (; e < end && IsDigit(*e); e++)
+			{
+				if (explicitExponent < 10000)
+					explicitExponent = explicitExponent * 10 + (*e - '0');
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			c = e;
+		}
+	}
+
+	// Trailing zeros ("1.500000") shouldn't push us off the fast path
+	while (mantissa > (1ULL << 24) && exponent < 0 && mantissa % 10 == 0)
+	{
+		mantissa /= 10;
+		exponent++;
+	}
+
+	if (exact && mantissa <= (1ULL << 24) && exponent >= -10 && exponent <= 10)
+	{
+		float value = (float)mantissa;
+		value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+		out = negative ? -value : value;
+		return c;
+	}
+
+	// Slow path - from_chars doesn't accept a leading '+'
+	float value = 0.0f;
+	std::from_chars(*start == '+' ? digitsStart : start, c, value);
+	out = value;
+	return c;
+}
+
+// --------------------------------------------------------
+// Parses a (possibly negative) base-10 integer, and throws
+// if it doesn't fit in an int
+// --------------------------------------------------------
+const char* ObjParser::ParseInt(const char* c, const char* end, int& out)
+{
+	c = SkipSpaces(c, end);
+
+	bool negative = false;
+	if (c < end && (*c == '-' || *c == '+'))
+	{
+		negative = *c == '-';
+		c++;
+	}
+
+	if (c >= end || !IsDigit(*c))
+		return 0;
+
+	// Anything past INT_MAX can't be an index into a real file
+	int value = 0;
+	for (; c < end && IsDigit(*c); c++)
+	{
+		int digit = *c - '0';
+		if (value > (INT_MAX - digit) / 10)
+			throw std::invalid_argument("Error parsing OBJ: Index is too large");
+		value = value * 10 + digit;
+	}
+
+	out = negative ? -value : value;
+	return c;
+}
+
+// --------------------------------------------------------
+// Parses an in-memory .obj file
+//
+// - The bytes are split into line-aligned chunks, one per
+//    thread, and each chunk parses its own v/vt/vn/f lines
+// - Face indices are kept relative to their chunk until
+//    prefix sums over the per-chunk counts tell us where
+//    every chunk's elements land in the global arrays
+// - Chunks are then stitched together in file order and
+//    corners with the same index triple are welded into one
+//    vertex, so the output is identical for any threadCount
+// --------------------------------------------------------
+void ObjParser::Parse(const char* begin, const char* end, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, unsigned int threadCount)
+{
+	// Split into line-aligned chunks (small files stay in one piece)
+	size_t bytes = end - begin;
+	size_t chunkCount = threadCount > 0 ? threadCount : 1;
+	if (chunkCount > bytes / minimumChunkBytes) chunkCount = bytes / minimumChunkBytes;
+	if (chunkCount < 1) chunkCount = 1;
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* chunkBegin = i == 0 ? begin : chunks[i - 1].end;
+		const char* chunkEnd = i == chunkCount - 1 ? end : begin + bytes * (i + 1) / chunkCount;
+		if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+		if (chunkEnd > begin && chunkEnd < end && chunkEnd[-1] != '\n')
+			chunkEnd = NextLine(chunkEnd, end);
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+	}
+
+	// Parse every chunk on its own
+	Jobs::ParallelFor((unsigned int)chunkCount, [&](unsigned int i) { ParseChunk(chunks[i]); });
+
+	// Prefix sums give each chunk's offset into the global arrays
+	size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.positionBase = positionCount;
+		chunk.uvBase = uvCount;
+		chunk.normalBase = normalCount;
+		chunk.cornerBase = cornerCount;
+		positionCount += chunk.positions.size();
+		uvCount += chunk.uvs.size();
+		normalCount += chunk.normals.size();
+		cornerCount += chunk.corners.size();
+	}
+
+	// Gather the elements themselves (a single chunk can just hand them over)
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;			// UVs from the file
+	if (chunkCount == 1)
+	{
+		positions.swap(chunks[0].positions);
+		normals.swap(chunks[0].normals);
+		uvs.swap(chunks[0].uvs);
+	}
+	else
+	{
+		positions.resize(positionCount);
+		normals.resize(normalCount);
+		uvs.resize(uvCount);
+		Jobs::ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+			{
+				ObjChunk& chunk = chunks[i];
+				std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase);
+				std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + chunk.uvBase);
+			});
+	}
+
+	// Resolve every corner to its global (position, uv, normal) triple
+	std::vector<VertexWelder::CornerKey> keys(cornerCount);
+	Jobs::ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+		{
+			const ObjChunk& chunk = chunks[i];
+			for (size_t k = 0; k < chunk.corners.size(); k++)
+			{
+				const ChunkCorner& corner = chunk.corners[k];
+				VertexWelder::CornerKey& key = keys[chunk.cornerBase + k];
+				key.position = (unsigned int)ResolveIndex(corner.position, corner.relative & RelativePosition, chunk.positionBase, positions.size());
+				key.uv = corner.uv >= 0 || (corner.relative & RelativeUV) ?
+					(unsigned int)ResolveIndex(corner.uv, corner.relative & RelativeUV, chunk.uvBase, uvs.size()) : VertexWelder::NoIndex;
+				key.normal = corner.normal >= 0 || (corner.relative & RelativeNormal) ?
+					(unsigned int)ResolveIndex(corner.normal, corner.relative & RelativeNormal, chunk.normalBase, normals.size()) : VertexWelder::NoIndex;
+			}
+		});
+
+	// Identical triples become one vertex (this is what gives the index buffer a purpose)
+	size_t firstVert = verts.size();
+	size_t firstIndex = indices.size();
+	indices.resize(firstIndex + cornerCount);
+	std::vector<unsigned int> uniqueCorners;
+	VertexWelder::WeldCorners(keys.data(), cornerCount, indices.data() + firstIndex, uniqueCorners);
+	for (size_t i = firstIndex; i < indices.size(); i++)
+		indices[i] += (unsigned int)firstVert;
+
+	// - Create the verts by looking up corresponding data
+	// - Missing UVs become (0,0), missing normals become zero
+	// - Flip the UV's V, the position's Z and the normal's Z
+	//    to go from right-handed (Maya, Blender) to left-handed
+	size_t uniqueCount = uniqueCorners.size();
+	verts.resize(firstVert + uniqueCount);
+	Jobs::ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+		{
+			size_t start = uniqueCount * i / chunkCount;
+			size_t stop = uniqueCount * (i + 1) / chunkCount;
+			for (size_t u = start; u < stop; u++)
+			{
+				const VertexWelder::CornerKey& key = keys[uniqueCorners[u]];
+				Vertex v = {};
+				v.Position = positions[key.position];
+				v.UV = key.uv != VertexWelder::NoIndex ? uvs[key.uv] : XMFLOAT2(0, 0);
+				v.Normal = key.normal != VertexWelder::NoIndex ? normals[key.normal] : XMFLOAT3(0, 0, 0);
+				v.Tangent = XMFLOAT3(0, 0, 0);
+
+				v.UV.y = 1.0f - v.UV.y;
+				v.Position.z *= -1.0f;
+				v.Normal.z *= -1.0f;
+
+				verts[firstVert + u] = v;
+			}
+		});
+}
+
+// --------------------------------------------------------
+// Maps the file and parses it
+// --------------------------------------------------------
+bool ObjParser::Load(const char* filePath, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, unsigned int threadCount)
+{
+	MappedFile file(filePath);
+	if (!file.IsOpen())
+		return false;
+
+	if (threadCount == 0)
+		threadCount = Jobs::ThreadCount();
+
+	Parse(file.GetData(), file.GetData() + file.GetSize(), verts, indices, threadCount);
+	return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Fast .obj (and .ggp_obj) loading
+//
+// - The file is memory-mapped and tokenized in place with
+//    hand-written number parsers (no sscanf, no locale)
+// - Vertex data matches the original getline/sscanf_s loader:
+//    Z and normal Z are flipped, V is flipped and the winding
+//    order is reversed for our left-handed setup
+// - Unlike that loader, corners that share a position/uv/normal
+//    triple share one vertex (see VertexWelder.h)
+// - Faces may be v/vt/vn or v//vn, with any number of corners
+// - Big files are parsed by several threads (see Jobs.h)
+// --------------------------------------------------------
+namespace ObjParser
+{
+	// Loads a whole file, returns false if it could not be opened
+	// - threadCount of 0 means "every thread in the Jobs pool"
+	bool Load(const char* filePath, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, unsigned int threadCount = 0);
+
+	// Parses an in-memory .obj, appending to verts/indices
+	// - Large inputs are split into up to threadCount chunks that are
+	//    parsed in parallel; the output doesn't depend on the count
+	void Parse(const char* begin, const char* end, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, unsigned int threadCount = 1);
+
+	// Number parsers - return the character after the number, or null if there was no number
+	const char* ParseFloat(const char* c, const char* end, float& out);
+	const char* ParseInt(const char* c, const char* end, int& out);
+}
@@ -0,0 +1,94 @@
+#include "ObjectConstants.h"
+
+ObjectConstants::ObjectConstants()
+{
+	target = 0;
+	frame = 0;
+	blockCount = 0;
+	reservedCount = 0;
+	stats = {};
+}
+
+void ObjectConstants::BeginFrame(RenderBackend* newTarget)
+{
+	frame++;
+	stats = {};
+	if (newTarget == target)
+		return;
+
+	target = newTarget;
+	reservedCount = 0;
+	for (std::vector<Entry>& stageEntries : entries)
+		for (Entry& entry : stageEntries)
+			entry.blockCurrent = false;
+}
+
+ObjectConstants::Entry& ObjectConstants::GetEntry(unsigned int object, StateCache::Stage stage)
+{
+	// New objects start out changing, like anything just created
+	std::vector<Entry>& stageEntries = entries[stage];
+	if (object >= stageEntries.size())
+		stageEntries.resize(object + 1, { 0, frame, -1, false });
+	return stageEntries[object];
+}
+
+bool ObjectConstants::Bind(unsigned int object, StateCache::Stage stage, unsigned int version, unsigned int slot)
+{
+	Entry& entry = GetEntry(object, stage);
+	if (entry.version != version)
+	{
+		entry.version = version;
+		entry.changedFrame = frame;
+		entry.blockCurrent = false;
+	}
+	if (!entry.blockCurrent)
+		return false;
+
+	target->BindPersistentConstants(stage, slot, entry.block);
+	stats.persistentBinds++;
+	return true;
+}
+
+void ObjectConstants::Upload(unsigned int object, StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size)
+{
+	Entry& entry = GetEntry(object, stage);
+	stats.uploadedBytes += size;
+
+	// Still moving - stream it, rather than rewrite a block every frame
+	if (frame - entry.changedFrame < StaticFrames || size > RenderBackend::PersistentBlockBytes)
+	{
+		target->SetConstants(stage, slot, data, size);
+		stats.streamedUploads++;
+		return;
+	}
+
+	if (entry.block < 0)
+		entry.block = (int)blockCount++;
+	if ((unsigned int)entry.block >= reservedCount)
+	{
+		// Doubling, and whatever the blocks held may be gone
+		unsigned int newCount = reservedCount > 0 ? reservedCount : 64;
+		while (newCount < blockCount)
+			newCount *= 2;
+		target->ReservePersistentConstants(newCount);
+		reservedCount = newCount;
+		for (std::vector<Entry>& stageEntries : entries)
+			for (Entry& other : stageEntries)
+				other.blockCurrent = false;
+	}
+
+	target->UpdatePersistentConstants(entry.block, data, size);
+	target->BindPersistentConstants(stage, slot, entry.block);
+	entry.blockCurrent = true;
+	stats.persistentUploads++;
+}
+
+void ObjectConstants::Clear()
+{
+	for (std::vector<Entry>& stageEntries : entries)
+		stageEntries.clear();
+	blockCount = 0;
+}
+
+ObjectConstants::Stats ObjectConstants::GetStats() const { return stats; }
+unsigned int ObjectConstants::GetBlockCount() const { return blockCount; }
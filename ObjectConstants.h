@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include "RenderBackend.h"
+
+// --------------------------------------------------------
+// Per-object constants that are only uploaded when they
+// change
+//
+// - Each object (an index the caller picks, like an entity's)
+//    has constants per stage, with a version that goes up when
+//    they'd change (Transform::GetVersion(), Material's, ...)
+// - Once an object's version has held still for StaticFrames
+//    frames it gets a persistent block on the GPU, written
+//    once and then just bound each draw until the version
+//    moves again
+// - Objects that keep changing stream through the ring buffer
+//    (RenderBackend::SetConstants()) as before, so a block is
+//    never rewritten every frame
+// - Nothing here touches D3D11 - it works on any RenderBackend
+// --------------------------------------------------------
+class ObjectConstants
+{
+public:
+	static const unsigned int StaticFrames = 8;
+
+	// This frame's uploads so far
+	struct Stats
+	{
+		unsigned int persistentBinds; // Already on the GPU - nothing copied
+		unsigned int persistentUploads;
+		unsigned int streamedUploads;
+		unsigned long long uploadedBytes;
+	};
+
+	ObjectConstants();
+
+	// Once a frame, before any Bind() - a target other than last
+	// frame's doesn't have the blocks, so they'll all be sent again
+	void BeginFrame(RenderBackend* target);
+
+	// Binds the object's constants for the stage to slot from its block
+	// and returns true if that block has this version. Otherwise returns
+	// false, and the caller fills them in and passes them to Upload()
+	bool Bind(unsigned int object, StateCache::Stage stage, unsigned int version, unsigned int slot);
+	void Upload(unsigned int object, StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size);
+
+	void Clear(); // Forget every object - their blocks are reused
+
+	Stats GetStats() const;
+	unsigned int GetBlockCount() const; // Handed out so far (objects that have stayed still)
+
+private:
+	struct Entry
+	{
+		unsigned int version;
+		unsigned int changedFrame; // When version last moved
+		int block; // -1 for none yet
+		bool blockCurrent; // Holds version
+	};
+	Entry& GetEntry(unsigned int object, StateCache::Stage stage);
+
+	RenderBackend* target;
+	std::vector<Entry> entries[StateCache::StageCount];
+	unsigned int frame;
+	unsigned int blockCount;
+	unsigned int reservedCount;
+	Stats stats;
+};
@@ -0,0 +1,451 @@
+#include "OcclusionCuller.h"
+#include "Jobs.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <immintrin.h>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Rows are split into this many bands, each rasterized by one job
+	const int bandCount = 8;
+
+	// Below this many boxes Cull() isn't worth spreading over threads
+	const size_t parallelCullThreshold = 256;
+
+	// Bits lo ... hi of a tile row (either may be off the tile)
+	unsigned int RowMask(int lo, int hi)
+	{
+		lo = std::max(lo, 0);
+		hi = std::min(hi, OcclusionCuller::TileWidth - 1);
+		if (lo > hi)
+			return 0;
+		return (0xFFFFFFFFu << lo) & (0xFFFFFFFFu >> (OcclusionCuller::TileWidth - 1 - hi));
+	}
+
+	// Clip space to pixels (y down) and depth
+	XMFLOAT3 ToScreen(const XMFLOAT4& clip)
+	{
+		float invW = 1.0f / clip.w;
+		return XMFLOAT3(
+			(clip.x * invW * 0.5f + 0.5f) * OcclusionCuller::Width,
+			(0.5f - clip.y * invW * 0.5f) * OcclusionCuller::Height,
+			clip.z * invW);
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+OcclusionCuller::OcclusionCuller() :
+	tiles(TilesX * TilesY),
+	occluderCount(0),
+	stats{}
+{
+	XMStoreFloat4x4(&viewProj, XMMatrixIdentity());
+	for (Tile& tile : tiles)
+		tile = { 1.0f, 0.0f, { 0, 0, 0, 0 } };
+}
+
+void OcclusionCuller::Begin(const XMFLOAT4X4& viewProj)
+{
+	this->viewProj = viewProj;
+	for (Tile& tile : tiles)
+		tile = { 1.0f, 0.0f, { 0, 0, 0, 0 } };
+	occluderCount = 0;
+	stats = {};
+}
+
+void OcclusionCuller::AddOccluder(const XMFLOAT3* positions, size_t vertexCount,
+	const unsigned int* indices, size_t indexCount, const XMFLOAT4X4& world)
+{
+	if (occluderCount == occluders.size())
+		occluders.emplace_back();
+
+	Occluder& occluder = occluders[occluderCount++];
+	occluder.positions = positions;
+	occluder.vertexCount = vertexCount;
+	occluder.indices = indices;
+	occluder.indexCount = indexCount;
+	XMStoreFloat4x4(&occluder.worldViewProj, XMLoadFloat4x4(&world) * XMLoadFloat4x4(&viewProj));
+	stats.occluderTriangles += indexCount / 3;
+}
+
+// --------------------------------------------------------
+// Triangle setup for each occluder (in parallel), then each
+// band of rows walks every triangle in the order they were
+// added (also in parallel - bands never share a tile)
+// --------------------------------------------------------
+void OcclusionCuller::Rasterize()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Jobs::ParallelFor((unsigned int)occluderCount, [&](unsigned int o) { SetupTriangles(occluders[o]); });
+	for (size_t o = 0; o < occluderCount; o++)
+		stats.rasterizedTriangles += occluders[o].triangles.size();
+
+	const int rowsPerBand = TilesY / bandCount;
+	Jobs::ParallelFor(bandCount, [&](unsigned int band)
+	{
+		RasterizeBand(band * rowsPerBand, (band + 1) * rowsPerBand - 1);
+	});
+
+	stats.rasterizeMilliseconds += MillisecondsSince(start);
+}
+
+void OcclusionCuller::SetupTriangles(Occluder& occluder)
+{
+	// Every vertex to clip space once
+	occluder.clipPositions.resize(occluder.vertexCount);
+	XMMATRIX wvp = XMLoadFloat4x4(&occluder.worldViewProj);
+	for (size_t v = 0; v < occluder.vertexCount; v++)
+		XMStoreFloat4(&occluder.clipPositions[v], XMVector3Transform(XMLoadFloat3(&occluder.positions[v]), wvp));
+
+	occluder.triangles.clear();
+	for (size_t i = 0; i + 2 < occluder.indexCount; i += 3)
+	{
+		XMFLOAT4 clip[3] = {
+			occluder.clipPositions[occluder.indices[i]],
+			occluder.clipPositions[occluder.indices[i + 1]],
+			occluder.clipPositions[occluder.indices[i + 2]] };
+
+		// Entirely in front of the camera and off one side of the screen?
+		if (clip[0].z >= 0.0f && clip[1].z >= 0.0f && clip[2].z >= 0.0f &&
+			((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+			(clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+			(clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+			(clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w)))
+			continue;
+
+		AddTriangle(clip, occluder.triangles);
+	}
+}
+
+// --------------------------------------------------------
+// Clips a clip-space triangle to the near plane (z >= 0),
+// which leaves up to 4 corners, and sets up the 1 or 2
+// front-facing screen triangles that come out of it
+// --------------------------------------------------------
+void OcclusionCuller::AddTriangle(const XMFLOAT4* clip, std::vector<ScreenTriangle>& triangles)
+{
+	XMFLOAT4 polygon[4];
+	int corners = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& a = clip[i];
+		const XMFLOAT4& b = clip[(i + 1) % 3];
+		if (a.z >= 0.0f)
+			polygon[corners++] = a;
+		if ((a.z >= 0.0f) != (b.z >= 0.0f))
+		{
+			float t = a.z / (a.z - b.z);
+			polygon[corners++] = XMFLOAT4(
+				a.x + (b.x - a.x) * t,
+				a.y + (b.y - a.y) * t,
+				0.0f,
+				a.w + (b.w - a.w) * t);
+		}
+	}
+
+	XMFLOAT3 screen[4];
+	for (int i = 0; i < corners; i++)
+		screen[i] = ToScreen(polygon[i]);
+
+	for (int fan = 1; fan + 1 < corners; fan++)
+	{
+		const XMFLOAT3& s0 = screen[0];
+		const XMFLOAT3& s1 = screen[fan];
+		const XMFLOAT3& s2 = screen[fan + 1];
+
+		// Clockwise on screen (y down) is front facing, like D3D's default -
+		// slivers are skipped too, since their depth planes are unreliable
+		float area = (s1.x - s0.x) * (s2.y - s0.y) - (s1.y - s0.y) * (s2.x - s0.x);
+		if (!(area > 0.001f))
+			continue;
+
+		// Pixels whose centers (x + 0.5) might be inside
+		float minX = std::min({ s0.x, s1.x, s2.x });
+		float maxX = std::max({ s0.x, s1.x, s2.x });
+		float minY = std::min({ s0.y, s1.y, s2.y });
+		float maxY = std::max({ s0.y, s1.y, s2.y });
+		ScreenTriangle triangle;
+		triangle.minX = (int)std::ceil(std::clamp(minX - 0.5f, -1.0f, (float)Width));
+		triangle.maxX = (int)std::floor(std::clamp(maxX - 0.5f, -1.0f, (float)Width));
+		triangle.minY = (int)std::ceil(std::clamp(minY - 0.5f, -1.0f, (float)Height));
+		triangle.maxY = (int)std::floor(std::clamp(maxY - 0.5f, -1.0f, (float)Height));
+		triangle.minX = std::max(triangle.minX, 0);
+		triangle.maxX = std::min(triangle.maxX, Width - 1);
+		triangle.minY = std::max(triangle.minY, 0);
+		triangle.maxY = std::min(triangle.maxY, Height - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			continue;
+
+		// Edge a -> b, positive on the inside
+		const XMFLOAT3* corner[3] = { &s0, &s1, &s2 };
+		for (int e = 0; e < 3; e++)
+		{
+			const XMFLOAT3& a = *corner[e];
+			const XMFLOAT3& b = *corner[(e + 1) % 3];
+			triangle.edgeA[e] = a.y - b.y;
+			triangle.edgeB[e] = b.x - a.x;
+			triangle.edgeC[e] = -(triangle.edgeA[e] * a.x + triangle.edgeB[e] * a.y);
+		}
+
+		// z / w is linear across the screen, so depth is a plane
+		triangle.x0 = s0.x;
+		triangle.y0 = s0.y;
+		triangle.z0 = s0.z;
+		triangle.dzdx = ((s1.z - s0.z) * (s2.y - s0.y) - (s1.y - s0.y) * (s2.z - s0.z)) / area;
+		triangle.dzdy = ((s1.x - s0.x) * (s2.z - s0.z) - (s1.z - s0.z) * (s2.x - s0.x)) / area;
+		triangle.zMax = std::max({ s0.z, s1.z, s2.z });
+		triangles.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::RasterizeBand(int firstTileRow, int lastTileRow)
+{
+	for (size_t o = 0; o < occluderCount; o++)
+		for (const ScreenTriangle& triangle : occluders[o].triangles)
+			RasterizeTriangle(triangle, firstTileRow, lastTileRow);
+}
+
+// --------------------------------------------------------
+// For each tile row, works out each pixel row's span with
+// SSE (a lane per row), turns the spans into coverage masks,
+// and merges them into the tiles along with the farthest
+// depth the triangle can have there
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, int firstTileRow, int lastTileRow)
+{
+	int startRow = std::max(triangle.minY / TileHeight, firstTileRow);
+	int endRow = std::min(triangle.maxY / TileHeight, lastTileRow);
+	int startColumn = triangle.minX / TileWidth;
+	int endColumn = triangle.maxX / TileWidth;
+
+	// Keeps the float -> int conversions below on positive numbers,
+	// where truncating is the same as flooring
+	const __m128 offset = _mm_set1_ps((float)(Width + 2));
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 rowCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 empty = _mm_set1_ps((float)(Width + 1));
+
+	for (int tileRow = startRow; tileRow <= endRow; tileRow++)
+	{
+		int tileY = tileRow * TileHeight;
+		__m128 y = _mm_add_ps(_mm_set1_ps((float)tileY), rowCenters);
+
+		// Each edge bounds x on one side, depending on its slope
+		__m128 left = _mm_set1_ps(triangle.minX + 0.5f);
+		__m128 right = _mm_set1_ps(triangle.maxX + 0.5f);
+		for (int e = 0; e < 3; e++)
+		{
+			__m128 rest = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeB[e]), y), _mm_set1_ps(triangle.edgeC[e]));
+			if (triangle.edgeA[e] > 0.0f)
+				left = _mm_max_ps(left, _mm_mul_ps(rest, _mm_set1_ps(-1.0f / triangle.edgeA[e])));
+			else if (triangle.edgeA[e] < 0.0f)
+				right = _mm_min_ps(right, _mm_mul_ps(rest, _mm_set1_ps(-1.0f / triangle.edgeA[e])));
+			else
+			{
+				// Horizontal edge: whole rows are in or out
+				__m128 outside = _mm_cmplt_ps(rest, _mm_setzero_ps());
+				left = _mm_or_ps(_mm_and_ps(outside, empty), _mm_andnot_ps(outside, left));
+			}
+		}
+		left = _mm_min_ps(left, empty);
+		right = _mm_max_ps(right, _mm_set1_ps(-1.0f));
+
+		// Covered pixels: ceil(left - 0.5) ... floor(right - 0.5)
+		alignas(16) int first[TileHeight], last[TileHeight];
+		_mm_store_si128((__m128i*)first, _mm_sub_epi32(_mm_cvttps_epi32(offset),
+			_mm_cvttps_epi32(_mm_sub_ps(offset, _mm_sub_ps(left, half)))));
+		_mm_store_si128((__m128i*)last, _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_sub_ps(right, half), offset)),
+			_mm_cvttps_epi32(offset)));
+
+		int rowLow = std::max(tileY, triangle.minY);
+		int rowHigh = std::min(tileY + TileHeight - 1, triangle.maxY);
+		for (int column = startColumn; column <= endColumn; column++)
+		{
+			int tileX = column * TileWidth;
+			unsigned int coverage[TileHeight];
+			unsigned int any = 0;
+			for (int r = 0; r < TileHeight; r++)
+			{
+				coverage[r] = RowMask(first[r] - tileX, last[r] - tileX);
+				any |= coverage[r];
+			}
+			if (any == 0)
+				continue;
+
+			// Farthest the depth plane gets over the pixel centers of this
+			// tile that the triangle's box covers (and never past its corners)
+			float x0 = std::max(tileX, triangle.minX) + 0.5f;
+			float x1 = std::min(tileX + TileWidth - 1, triangle.maxX) + 0.5f;
+			float y0 = rowLow + 0.5f;
+			float y1 = rowHigh + 0.5f;
+			float zFar = triangle.z0 + triangle.dzdx * (x0 - triangle.x0) + triangle.dzdy * (y0 - triangle.y0) +
+				std::max(triangle.dzdx * (x1 - x0), 0.0f) + std::max(triangle.dzdy * (y1 - y0), 0.0f);
+			UpdateTile(tiles[tileRow * TilesX + column], coverage, std::min(zFar, triangle.zMax));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// The masked occlusion culling merge: the triangle joins the
+// masked layer (which takes the farther of the two depths),
+// and once that layer covers the whole tile it becomes the
+// tile's depth
+// --------------------------------------------------------
+void OcclusionCuller::UpdateTile(Tile& tile, const unsigned int* coverage, float zTriangle)
+{
+	if (zTriangle >= tile.zMax0)
+		return;
+
+	bool layerEmpty = (tile.mask[0] | tile.mask[1] | tile.mask[2] | tile.mask[3]) == 0;
+
+	// A triangle much farther than the masked layer would drag the whole
+	// layer back with it, so start the layer over from this triangle
+	if (!layerEmpty && zTriangle - tile.zMax1 > tile.zMax0 - tile.zMax1)
+	{
+		for (int r = 0; r < TileHeight; r++)
+			tile.mask[r] = 0;
+		tile.zMax1 = 0.0f;
+	}
+
+	tile.zMax1 = std::max(tile.zMax1, zTriangle);
+	bool full = true;
+	for (int r = 0; r < TileHeight; r++)
+	{
+		tile.mask[r] |= coverage[r];
+		full &= tile.mask[r] == 0xFFFFFFFFu;
+	}
+
+	if (full)
+	{
+		tile.zMax0 = tile.zMax1;
+		tile.zMax1 = 0.0f;
+		for (int r = 0; r < TileHeight; r++)
+			tile.mask[r] = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Screen rectangle and nearest depth of the box's corners,
+// then each tile under it: hidden there only if every pixel
+// of the rectangle is behind the tile's depth, or is in the
+// masked layer and behind that
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(const Bounds::Box& box) const
+{
+	XMMATRIX matrix = XMLoadFloat4x4(&viewProj);
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (int c = 0; c < 8; c++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(c & 1) ? box.max.x : box.min.x,
+			(c & 2) ? box.max.y : box.min.y,
+			(c & 4) ? box.max.z : box.min.z, 1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, matrix));
+
+		// Reaches the near plane - can't be behind anything
+		if (clip.z < 0.0f)
+			return true;
+
+		XMFLOAT3 screen = ToScreen(clip);
+		minX = std::min(minX, screen.x);
+		maxX = std::max(maxX, screen.x);
+		minY = std::min(minY, screen.y);
+		maxY = std::max(maxY, screen.y);
+		minZ = std::min(minZ, screen.z);
+	}
+
+	// Off screen is the frustum culler's business
+	if (maxX < 0.0f || minX >= Width || maxY < 0.0f || minY >= Height)
+		return true;
+
+	// Every pixel the rectangle touches
+	int pixelMinX = std::max((int)std::floor(minX), 0);
+	int pixelMaxX = std::min((int)std::floor(maxX), Width - 1);
+	int pixelMinY = std::max((int)std::floor(minY), 0);
+	int pixelMaxY = std::min((int)std::floor(maxY), Height - 1);
+
+	const __m128i rowIndex = _mm_setr_epi32(0, 1, 2, 3);
+	for (int tileRow = pixelMinY / TileHeight; tileRow <= pixelMaxY / TileHeight; tileRow++)
+	{
+		// Rows of this tile inside the rectangle
+		int tileY = tileRow * TileHeight;
+		__m128i rows = _mm_and_si128(
+			_mm_cmpgt_epi32(rowIndex, _mm_set1_epi32(pixelMinY - tileY - 1)),
+			_mm_cmplt_epi32(rowIndex, _mm_set1_epi32(pixelMaxY - tileY + 1)));
+
+		for (int column = pixelMinX / TileWidth; column <= pixelMaxX / TileWidth; column++)
+		{
+			const Tile& tile = tiles[tileRow * TilesX + column];
+			if (minZ > tile.zMax0)
+				continue;
+
+			int tileX = column * TileWidth;
+			__m128i rectangle = _mm_and_si128(rows, _mm_set1_epi32((int)RowMask(pixelMinX - tileX, pixelMaxX - tileX)));
+			__m128i outsideLayer = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)tile.mask), rectangle);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(outsideLayer, _mm_setzero_si128())) != 0xFFFF)
+				return true;
+			if (minZ <= tile.zMax1)
+				return true;
+		}
+	}
+	return false;
+}
+
+size_t OcclusionCuller::Cull(const Bounds::Box* boxes, std::vector<unsigned int>& candidates)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<unsigned char> visible(candidates.size());
+	if (candidates.size() >= parallelCullThreshold)
+	{
+		const size_t chunk = 64;
+		Jobs::ParallelFor((unsigned int)((candidates.size() + chunk - 1) / chunk), [&](unsigned int c)
+		{
+			size_t end = std::min(candidates.size(), (c + 1) * chunk);
+			for (size_t i = c * chunk; i < end; i++)
+				visible[i] = IsVisible(boxes[candidates[i]]);
+		});
+	}
+	else
+	{
+		for (size_t i = 0; i < candidates.size(); i++)
+			visible[i] = IsVisible(boxes[candidates[i]]);
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < candidates.size(); i++)
+		if (visible[i])
+			candidates[kept++] = candidates[i];
+	size_t culled = candidates.size() - kept;
+	candidates.resize(kept);
+
+	stats.tested += visible.size();
+	stats.culled += culled;
+	stats.testMilliseconds += MillisecondsSince(start);
+	return culled;
+}
+
+float OcclusionCuller::GetDepth(int x, int y) const
+{
+	const Tile& tile = tiles[(y / TileHeight) * TilesX + x / TileWidth];
+	bool masked = (tile.mask[y % TileHeight] >> (x % TileWidth)) & 1;
+	return masked ? std::min(tile.zMax0, tile.zMax1) : tile.zMax0;
+}
+
+OcclusionCuller::Stats OcclusionCuller::GetStats() const
+{
+	return stats;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Bounds.h"
+
+// --------------------------------------------------------
+// CPU occlusion culling against a small software depth buffer
+//
+// - Occluders (big, solid meshes) are rasterized into a 256x128
+//    buffer, then the bounding boxes of everything else are
+//    tested against it before they're drawn
+// - The buffer is masked occlusion culling style: tiles of
+//    32x4 pixels, each with a coverage mask (a bit per pixel)
+//    and two depths - the farthest depth of the whole tile, and
+//    the farthest depth of just the masked pixels - instead of
+//    a depth per pixel
+// - Coverage is found 4 rows at a time with SSE, and the
+//    buffer is split into bands of rows that rasterize in
+//    parallel on the job system (see Jobs.h)
+// - Conservative: a box is only culled if every pixel it
+//    touches is covered by an occluder that's nearer than all
+//    of it (pixels count as covered when their center is)
+// - CPU only - it just needs matrices and positions
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	static const int Width = 256;
+	static const int Height = 128;
+	static const int TileWidth = 32;	// One bit per pixel in an unsigned int
+	static const int TileHeight = 4;	// One SSE lane per row
+	static const int TilesX = Width / TileWidth;
+	static const int TilesY = Height / TileHeight;
+
+	// What the last frame cost, and what it got us
+	struct Stats
+	{
+		size_t occluderTriangles;		// Triangles handed in
+		size_t rasterizedTriangles;		// Ones left after clipping and backface culling
+		size_t tested;
+		size_t culled;
+		double rasterizeMilliseconds;	// Rasterize(), including triangle setup
+		double testMilliseconds;		// Every Cull() since Begin()
+	};
+
+	OcclusionCuller();
+
+	// Clears the buffer and forgets last frame's occluders - viewProj
+	// is the usual row-vector view * proj
+	void Begin(const DirectX::XMFLOAT4X4& viewProj);
+
+	// Queues an occluder for Rasterize() - the pointers must stay valid
+	// until then.  Triangles facing away from the camera are skipped, so
+	// add closed meshes (or double-sided ones), nearest first
+	void AddOccluder(const DirectX::XMFLOAT3* positions, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount, const DirectX::XMFLOAT4X4& world);
+
+	// Draws every queued occluder into the buffer
+	void Rasterize();
+
+	// Whether any of a world-space box might be visible
+	bool IsVisible(const Bounds::Box& box) const;
+
+	// Removes the entries of candidates (indices into boxes) whose box
+	// is hidden, keeping the rest in order, and returns how many went
+	size_t Cull(const Bounds::Box* boxes, std::vector<unsigned int>& candidates);
+
+	// The depth the buffer promises nothing is behind at a pixel (1 is
+	// the far plane, i.e. nothing there) - for checking and debugging
+	float GetDepth(int x, int y) const;
+
+	Stats GetStats() const;
+
+private:
+	struct Tile
+	{
+		float zMax0;				// Farthest depth of anything in the tile
+		float zMax1;				// Farthest depth of the masked pixels
+		unsigned int mask[TileHeight];	// Bit x of row y: pixel covered by the zMax1 layer
+	};
+
+	// A clipped, projected triangle with its edge and depth equations
+	// - Inside means A * x + B * y + C >= 0 for all three edges
+	struct ScreenTriangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float x0, y0, z0, dzdx, dzdy;	// Depth plane through the first corner
+		float zMax;						// Farthest corner
+		int minX, maxX, minY, maxY;		// Pixels whose centers may be inside
+	};
+
+	struct Occluder
+	{
+		const DirectX::XMFLOAT3* positions;
+		size_t vertexCount;
+		const unsigned int* indices;
+		size_t indexCount;
+		DirectX::XMFLOAT4X4 worldViewProj;
+
+		// Filled in by Rasterize() (kept to reuse the memory)
+		std::vector<DirectX::XMFLOAT4> clipPositions;
+		std::vector<ScreenTriangle> triangles;
+	};
+
+	static void SetupTriangles(Occluder& occluder);
+	static void AddTriangle(const DirectX::XMFLOAT4* clip, std::vector<ScreenTriangle>& triangles);
+	void RasterizeBand(int firstTileRow, int lastTileRow);
+	void RasterizeTriangle(const ScreenTriangle& triangle, int firstTileRow, int lastTileRow);
+	static void UpdateTile(Tile& tile, const unsigned int* coverage, float zTriangle);
+
+	DirectX::XMFLOAT4X4 viewProj;
+	std::vector<Tile> tiles;		// TilesX * TilesY, row by row
+	std::vector<Occluder> occluders;
+	size_t occluderCount;			// occluders is only ever grown
+	Stats stats;
+};
@@ -0,0 +1,47 @@
+#include "ShaderInclude.hlsli"
+
+//Buffer for external data
+// - Same as VertexShader.hlsl, plus the mesh's bounds for
+//   turning the quantized position back into object space
+cbuffer ExternalVertexData : register(b0)
+{
+    float4x4 view			: VIEW_MATRIX;
+    float4x4 proj			: PROJECTION_MATRIX;
+    float4x4 shadowView		: LIGHT_VIEW_MATRIX;
+    float4x4 shadowProj		: LIGHT_PROJECTION_MATRIX;
+};
+
+cbuffer ObjectVertexData : register(b1)
+{
+    float4x4 world			: WORLD_MATRIX;
+    float4x4 worldInv		: WORLD_INVERSE_MATRIX;
+    float4 positionScale;	// Bounds extent (xyz)
+    float4 positionOffset;	// Bounds min (xyz)
+};
+
+// --------------------------------------------------------
+// Vertex shader for PackedVertex (see VertexCodec.h)
+//
+// - Unpacks the vertex, then does exactly what VertexShader.hlsl does
+// --------------------------------------------------------
+VertexToPixel main( PackedVertexShaderInput input )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+    float3 localPosition = input.localPosition.xyz * positionScale.xyz + positionOffset.xyz;
+    float3 normal = OctDecode(input.normal);
+    float3 tangent = OctDecode(input.tangent);
+
+    float4x4 wvp = mul(proj, mul(view, world));
+    output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+    output.normal = mul((float3x3)worldInv, normal);
+    output.tangent = mul((float3x3)world, tangent);
+    output.worldPos = mul(world, float4(localPosition, 1.0f)).xyz;
+    output.uv = input.uv;
+
+    matrix shadowWVP = mul(shadowProj, mul(shadowView, world));
+    output.shadowDepth =  mul(shadowWVP, float4(localPosition, 1.0f));
+
+	return output;
+}
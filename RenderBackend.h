@@ -0,0 +1,62 @@
+#pragma once
+#include "StateCache.h"
+
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11DepthStencilState;
+
+// --------------------------------------------------------
+// Everything a frame asks of the graphics API once the
+// resources exist: binds (through StateCache's Target part),
+// constants, render targets, clears and draws
+//
+// - Graphics::Backend points at one of these - the D3D11 one
+//    by default (in Graphics.cpp), or a NullBackend to run the
+//    frame without a GPU (see NullBackend.h)
+// - Creating resources stays on Graphics::Device, since that
+//    happens at load time - Game::Draw() itself never touches
+//    Graphics::Context, only presenting the frame and the UI do
+// - Like StateCache.h, no D3D11 headers here, so code written
+//    against it builds anywhere
+// --------------------------------------------------------
+class RenderBackend : public StateCache::Target
+{
+public:
+	// Copies size bytes into constant buffer slot for the stage
+	// (what Graphics::FillAndBindNextConstantBuffer() forwards to)
+	virtual void SetConstants(StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size) = 0;
+
+	// Constants that stay on the GPU between frames, in blocks of
+	// PersistentBlockBytes (see ObjectConstants.h)
+	// - Reserving more blocks than before may lose what's in them
+	// - size is at most PersistentBlockBytes
+	static const unsigned int PersistentBlockBytes = 256; // D3D11.1 binds constant buffers in 256-byte steps
+	virtual void ReservePersistentConstants(unsigned int blockCount) = 0;
+	virtual void UpdatePersistentConstants(unsigned int block, const void* data, unsigned int size) = 0;
+	virtual void BindPersistentConstants(StateCache::Stage stage, unsigned int slot, unsigned int block) = 0;
+
+	// Instances that stay on the GPU between frames, one slot per
+	// object (see InstanceSlots.h), and the order a pass's batches
+	// draw them in
+	// - The instanced vertex shaders read the slots at t0 and the
+	//    order at t1 - SetInstanceOrder() binds both itself (nothing
+	//    else uses those two, so StateCache doesn't track them)
+	// - Reserving more slots than before may lose what's in them
+	static const unsigned int InstanceBytes = 128; // InstanceBatcher::Instance - two 4x4 float matrices
+	virtual void ReserveInstances(unsigned int slotCount) = 0;
+	virtual void UpdateInstances(unsigned int firstSlot, unsigned int count, const void* data) = 0;
+	virtual void SetInstanceOrder(const unsigned int* slots, unsigned int count) = 0;
+
+	// Once a pass or so, so not worth caching - the viewport starts
+	// at the top left and covers depth 0 to 1, and a null depth-stencil
+	// state is the default one
+	virtual void ClearRenderTarget(ID3D11RenderTargetView* target, const float color[4]) = 0;
+	virtual void ClearDepth(ID3D11DepthStencilView* depth, float value) = 0;
+	virtual void SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth) = 0;
+	virtual void SetViewport(float width, float height) = 0;
+	virtual void SetDepthStencilState(ID3D11DepthStencilState* state) = 0;
+
+	virtual void Draw(unsigned int vertexCount, unsigned int firstVertex) = 0;
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int firstIndex, int baseVertex) = 0;
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int firstIndex, int baseVertex, unsigned int firstInstance) = 0;
+};
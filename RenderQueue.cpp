@@ -0,0 +1,114 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const int DepthShift = 0;
+	const int MeshShift = DepthShift + RenderQueue::DepthBits;
+	const int MaterialShift = MeshShift + RenderQueue::MeshBits;
+	const int ShaderShift = MaterialShift + RenderQueue::MaterialBits;
+	const int PassShift = ShaderShift + RenderQueue::ShaderBits;
+
+	uint64_t Field(uint64_t value, int bits, int shift)
+	{
+		return (value & ((1ull << bits) - 1)) << shift;
+	}
+
+	unsigned int Extract(uint64_t key, int bits, int shift)
+	{
+		return (unsigned int)((key >> shift) & ((1ull << bits) - 1));
+	}
+}
+
+uint64_t RenderQueue::MakeKey(Pass pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth)
+{
+	// Written so NaN ends up at 0 too
+	depth = depth > 0.0f ? std::min(depth, 1.0f) : 0.0f;
+	if (pass == Transparent)
+		depth = 1.0f - depth;
+
+	const uint64_t depthMax = (1ull << DepthBits) - 1;
+	uint64_t quantized = std::min((uint64_t)((double)depth * depthMax), depthMax);
+
+	return Field(pass, PassBits, PassShift) |
+		Field(shader, ShaderBits, ShaderShift) |
+		Field(material, MaterialBits, MaterialShift) |
+		Field(mesh, MeshBits, MeshShift) |
+		Field(quantized, DepthBits, DepthShift);
+}
+
+RenderQueue::Pass RenderQueue::GetPass(uint64_t key) { return (Pass)Extract(key, PassBits, PassShift); }
+unsigned int RenderQueue::GetShader(uint64_t key) { return Extract(key, ShaderBits, ShaderShift); }
+unsigned int RenderQueue::GetMaterial(uint64_t key) { return Extract(key, MaterialBits, MaterialShift); }
+unsigned int RenderQueue::GetMesh(uint64_t key) { return Extract(key, MeshBits, MeshShift); }
+unsigned int RenderQueue::GetDepth(uint64_t key) { return Extract(key, DepthBits, DepthShift); }
+
+void RenderQueue::Clear()
+{
+	items.clear();
+}
+
+void RenderQueue::Add(uint64_t key, unsigned int index)
+{
+	items.push_back({ key, index });
+}
+
+// --------------------------------------------------------
+// Counts every byte of every key in one go, then scatters by
+// each byte from the lowest up - each pass is stable, so the
+// result is sorted by the whole key
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	size_t count = items.size();
+	if (count < 2)
+		return;
+	scratch.resize(count);
+
+	size_t histograms[8][256] = {};
+	for (const Item& item : items)
+		for (int b = 0; b < 8; b++)
+			histograms[b][(item.key >> (b * 8)) & 0xFF]++;
+
+	Item* from = items.data();
+	Item* to = scratch.data();
+	for (int b = 0; b < 8; b++)
+	{
+		int shift = b * 8;
+		size_t* histogram = histograms[b];
+
+		// Every key has the same byte here - nothing to do
+		if (histogram[(from[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		size_t offsets[256];
+		size_t sum = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			offsets[i] = sum;
+			sum += histogram[i];
+		}
+
+		for (size_t i = 0; i < count; i++)
+			to[offsets[(from[i].key >> shift) & 0xFF]++] = from[i];
+		std::swap(from, to);
+	}
+
+	if (from != items.data())
+		items.swap(scratch);
+}
+
+const RenderQueue::Item* RenderQueue::Items() const { return items.data(); }
+size_t RenderQueue::Count() const { return items.size(); }
+
+unsigned int RenderQueue::IdMap::Get(const void* a, const void* b)
+{
+	return ids.emplace(std::make_pair(a, b), (unsigned int)ids.size()).first->second;
+}
+
+void RenderQueue::IdMap::Clear()
+{
+	ids.clear();
+}
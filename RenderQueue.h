@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// A list of draws, sorted by a 64-bit key each frame
+//
+// - The key packs, from the most significant bits down:
+//    pass | shader | material | mesh | depth
+//    so sorting groups draws by the state they need (changing
+//    shaders costs the most, so it's the highest) and, within
+//    the same state, puts them nearest first
+// - Sort() is an LSD radix sort on the keys - 8 passes of a
+//    byte each, skipping bytes that are the same for every key
+//    (common, since there are only a few shaders and passes)
+// - Plain CPU code: the queue only holds keys and indices,
+//    what they mean is up to whoever fills it (see Game::Draw)
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	// Bits for each part of the key (they add up to 64)
+	static const int PassBits = 4;
+	static const int ShaderBits = 10;
+	static const int MaterialBits = 12;
+	static const int MeshBits = 14;
+	static const int DepthBits = 24;
+
+	// Drawn in this order
+	enum Pass { Opaque = 0, Transparent = 1 };
+
+	struct Item
+	{
+		uint64_t key;
+		unsigned int index;	// Whatever the caller needs to find the draw again
+	};
+
+	// Ids over the field's bits are wrapped, and depth is clamped to
+	// 0 (nearest) ... 1 (farthest) - transparent draws flip it so
+	// they come out back to front
+	static uint64_t MakeKey(Pass pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth);
+
+	static Pass GetPass(uint64_t key);
+	static unsigned int GetShader(uint64_t key);
+	static unsigned int GetMaterial(uint64_t key);
+	static unsigned int GetMesh(uint64_t key);
+	static unsigned int GetDepth(uint64_t key); // Quantized
+
+	void Clear();
+	void Add(uint64_t key, unsigned int index);
+	void Sort(); // Stable, so equal keys stay in the order they were added
+
+	const Item* Items() const;
+	size_t Count() const;
+
+	// Small ids for pointers (shaders, materials, meshes) in the order
+	// they're first seen, since the key only has a few bits for each
+	class IdMap
+	{
+	public:
+		unsigned int Get(const void* a, const void* b = nullptr);
+		void Clear();
+
+	private:
+		std::map<std::pair<const void*, const void*>, unsigned int> ids;
+	};
+
+private:
+	std::vector<Item> items;
+	std::vector<Item> scratch; // Radix sort ping-pongs between the two
+};
@@ -0,0 +1,484 @@
+#include "SceneIndex.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+	const int nullNode = -1;
+
+	// Balanced trees of a few million leaves are ~30 levels deep,
+	// and a depth-first walk never holds more than depth + 1 nodes
+	const int maxStack = 256;
+
+	Bounds::Box Union(const Bounds::Box& a, const Bounds::Box& b)
+	{
+		return {
+			XMFLOAT3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+			XMFLOAT3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)) };
+	}
+
+	// Half the surface area (the constant doesn't matter for comparisons)
+	float Area(const Bounds::Box& box)
+	{
+		float x = box.max.x - box.min.x;
+		float y = box.max.y - box.min.y;
+		float z = box.max.z - box.min.z;
+		return x * y + y * z + z * x;
+	}
+}
+
+SceneIndex::SceneIndex(float margin) :
+	root(nullNode),
+	freeList(nullNode),
+	count(0),
+	margin(margin)
+{
+}
+
+int SceneIndex::AllocateNode()
+{
+	int node;
+	if (freeList != nullNode)
+	{
+		node = freeList;
+		freeList = nodes[node].parent;
+	}
+	else
+	{
+		node = (int)nodes.size();
+		nodes.emplace_back();
+	}
+
+	Node& n = nodes[node];
+	n.parent = nullNode;
+	n.child1 = nullNode;
+	n.child2 = nullNode;
+	n.height = 0;
+	n.userData = 0;
+	return node;
+}
+
+void SceneIndex::FreeNode(int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+int SceneIndex::Insert(const Bounds::Box& box, unsigned int userData)
+{
+	int leaf = AllocateNode();
+	nodes[leaf].box = {
+		XMFLOAT3(box.min.x - margin, box.min.y - margin, box.min.z - margin),
+		XMFLOAT3(box.max.x + margin, box.max.y + margin, box.max.z + margin) };
+	nodes[leaf].userData = userData;
+	InsertLeaf(leaf);
+	count++;
+	return leaf;
+}
+
+void SceneIndex::InsertMany(const Bounds::Box* boxes, const unsigned int* userData, size_t count, int* proxies)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		int leaf = AllocateNode();
+		nodes[leaf].box = {
+			XMFLOAT3(boxes[i].min.x - margin, boxes[i].min.y - margin, boxes[i].min.z - margin),
+			XMFLOAT3(boxes[i].max.x + margin, boxes[i].max.y + margin, boxes[i].max.z + margin) };
+		nodes[leaf].userData = userData[i];
+		nodes[leaf].parent = nullNode;
+		proxies[i] = leaf;
+	}
+	this->count += (int)count;
+	Rebuild();
+}
+
+void SceneIndex::Rebuild()
+{
+	// Keep the leaves (they're the proxy ids), free everything else
+	std::vector<int> leaves;
+	leaves.reserve(count);
+	for (int i = 0; i < (int)nodes.size(); i++)
+	{
+		if (nodes[i].height < 0)
+			continue;
+		if (nodes[i].child1 == nullNode)
+			leaves.push_back(i);
+		else
+			FreeNode(i);
+	}
+
+	root = leaves.empty() ? nullNode : BuildRange(leaves.data(), leaves.size());
+	if (root != nullNode)
+		nodes[root].parent = nullNode;
+}
+
+// --------------------------------------------------------
+// Top-down build: split the leaves at the median of their
+// centers along the longest axis, and recurse on both halves
+// --------------------------------------------------------
+int SceneIndex::BuildRange(int* leaves, size_t count)
+{
+	if (count == 1)
+		return leaves[0];
+
+	// Spread of the leaf centers (doubled, which doesn't matter)
+	auto center = [&](int leaf, int axis)
+	{
+		const Bounds::Box& box = nodes[leaf].box;
+		return axis == 0 ? box.min.x + box.max.x : axis == 1 ? box.min.y + box.max.y : box.min.z + box.max.z;
+	};
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float c = center(leaves[i], axis);
+			low[axis] = std::min(low[axis], c);
+			high[axis] = std::max(high[axis], c);
+		}
+	}
+	int axis = 0;
+	for (int a = 1; a < 3; a++)
+		if (high[a] - low[a] > high[axis] - low[axis])
+			axis = a;
+
+	size_t half = count / 2;
+	std::nth_element(leaves, leaves + half, leaves + count,
+		[&](int a, int b) { return center(a, axis) < center(b, axis); });
+
+	int child1 = BuildRange(leaves, half);
+	int child2 = BuildRange(leaves + half, count - half);
+
+	int node = AllocateNode();
+	nodes[node].child1 = child1;
+	nodes[node].child2 = child2;
+	nodes[node].box = Union(nodes[child1].box, nodes[child2].box);
+	nodes[node].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+	nodes[child1].parent = node;
+	nodes[child2].parent = node;
+	return node;
+}
+
+void SceneIndex::Remove(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	count--;
+}
+
+void SceneIndex::Clear()
+{
+	nodes.clear();
+	root = nullNode;
+	freeList = nullNode;
+	count = 0;
+}
+
+bool SceneIndex::Update(int proxy, const Bounds::Box& box)
+{
+	if (Bounds::Contains(nodes[proxy].box, box))
+		return false;
+
+	RemoveLeaf(proxy);
+	nodes[proxy].box = {
+		XMFLOAT3(box.min.x - margin, box.min.y - margin, box.min.z - margin),
+		XMFLOAT3(box.max.x + margin, box.max.y + margin, box.max.z + margin) };
+	InsertLeaf(proxy);
+	return true;
+}
+
+unsigned int SceneIndex::GetUserData(int proxy) const { return nodes[proxy].userData; }
+Bounds::Box SceneIndex::GetFatBox(int proxy) const { return nodes[proxy].box; }
+int SceneIndex::GetCount() const { return count; }
+int SceneIndex::GetHeight() const { return root == nullNode ? 0 : nodes[root].height + 1; }
+
+// --------------------------------------------------------
+// Walks down to the cheapest sibling for the new leaf:
+// the cost of pairing with a node is the area of the new
+// parent, plus the area every ancestor grows by on the way
+// --------------------------------------------------------
+void SceneIndex::InsertLeaf(int leaf)
+{
+	if (root == nullNode)
+	{
+		root = leaf;
+		nodes[leaf].parent = nullNode;
+		return;
+	}
+
+	Bounds::Box leafBox = nodes[leaf].box;
+	int index = root;
+	while (nodes[index].child1 != nullNode)
+	{
+		const Node& node = nodes[index];
+		float area = Area(node.box);
+		float combinedArea = Area(Union(node.box, leafBox));
+
+		// Cost of making a new parent for this node and the leaf,
+		// and what pushing the leaf further down adds to every level
+		float cost = 2.0f * combinedArea;
+		float inheritance = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](int child)
+		{
+			const Node& c = nodes[child];
+			float grown = Area(Union(leafBox, c.box));
+			return (c.child1 == nullNode ? grown : grown - Area(c.box)) + inheritance;
+		};
+		float cost1 = descendCost(node.child1);
+		float cost2 = descendCost(node.child2);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	// New parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = Union(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent == nullNode)
+		root = newParent;
+	else if (nodes[oldParent].child1 == sibling)
+		nodes[oldParent].child1 = newParent;
+	else
+		nodes[oldParent].child2 = newParent;
+
+	FixUpwards(nodes[leaf].parent);
+}
+
+void SceneIndex::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = nullNode;
+		return;
+	}
+
+	// The sibling takes the parent's place
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grandParent == nullNode)
+	{
+		root = sibling;
+		nodes[sibling].parent = nullNode;
+		FreeNode(parent);
+		return;
+	}
+
+	if (nodes[grandParent].child1 == parent)
+		nodes[grandParent].child1 = sibling;
+	else
+		nodes[grandParent].child2 = sibling;
+	nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	FixUpwards(grandParent);
+}
+
+void SceneIndex::FixUpwards(int node)
+{
+	while (node != nullNode)
+	{
+		node = Balance(node);
+
+		Node& n = nodes[node];
+		n.height = 1 + std::max(nodes[n.child1].height, nodes[n.child2].height);
+		n.box = Union(nodes[n.child1].box, nodes[n.child2].box);
+		node = n.parent;
+	}
+}
+
+// --------------------------------------------------------
+// If one child of a is 2+ levels taller than the other, that
+// child is rotated up to take a's place, and returns the new
+// root of this subtree
+// --------------------------------------------------------
+int SceneIndex::Balance(int a)
+{
+	Node& A = nodes[a];
+	if (A.child1 == nullNode || A.height < 2)
+		return a;
+
+	int b = A.child1;
+	int c = A.child2;
+	Node& B = nodes[b];
+	Node& C = nodes[c];
+	int balance = C.height - B.height;
+
+	// Rotate whichever child is taller up, taking its taller
+	// child with it and giving its shorter one to a
+	auto rotateUp = [&](int up, Node& Up, int other, bool upIsChild2)
+	{
+		int f = Up.child1;
+		int g = Up.child2;
+		Node& F = nodes[f];
+		Node& G = nodes[g];
+
+		Up.child1 = a;
+		Up.parent = A.parent;
+		A.parent = up;
+
+		if (Up.parent == nullNode)
+			root = up;
+		else if (nodes[Up.parent].child1 == a)
+			nodes[Up.parent].child1 = up;
+		else
+			nodes[Up.parent].child2 = up;
+
+		int keep = F.height > G.height ? f : g;
+		int give = keep == f ? g : f;
+		Up.child2 = keep;
+		if (upIsChild2) A.child2 = give;
+		else A.child1 = give;
+		nodes[give].parent = a;
+
+		A.box = Union(nodes[other].box, nodes[give].box);
+		A.height = 1 + std::max(nodes[other].height, nodes[give].height);
+		Up.box = Union(A.box, nodes[keep].box);
+		Up.height = 1 + std::max(A.height, nodes[keep].height);
+		return up;
+	};
+
+	if (balance > 1)
+		return rotateUp(c, C, b, true);
+	if (balance < -1)
+		return rotateUp(b, B, c, false);
+	return a;
+}
+
+void SceneIndex::CollectLeaves(int node, std::vector<unsigned int>& results) const
+{
+	int stack[maxStack];
+	int top = 0;
+	stack[top++] = node;
+	while (top > 0)
+	{
+		const Node& n = nodes[stack[--top]];
+		if (n.child1 == nullNode)
+		{
+			results.push_back(n.userData);
+			continue;
+		}
+		stack[top++] = n.child1;
+		stack[top++] = n.child2;
+	}
+}
+
+// --------------------------------------------------------
+// Queries: depth-first, skipping any subtree whose box fails
+// --------------------------------------------------------
+void SceneIndex::QueryFrustum(const FrustumCuller::Frustum& frustum, std::vector<unsigned int>& results) const
+{
+	if (root == nullNode)
+		return;
+
+	int stack[maxStack];
+	int top = 0;
+	stack[top++] = root;
+	while (top > 0)
+	{
+		int index = stack[--top];
+		const Node& n = nodes[index];
+		FrustumCuller::Containment containment = FrustumCuller::ClassifyBox(frustum, n.box);
+		if (containment == FrustumCuller::Outside)
+			continue;
+
+		if (n.child1 == nullNode)
+			results.push_back(n.userData);
+		else if (containment == FrustumCuller::Inside)
+			CollectLeaves(index, results); // Everything under it is inside too
+		else
+		{
+			stack[top++] = n.child1;
+			stack[top++] = n.child2;
+		}
+	}
+}
+
+void SceneIndex::QuerySphere(const Bounds::Sphere& sphere, std::vector<unsigned int>& results) const
+{
+	if (root == nullNode)
+		return;
+
+	int stack[maxStack];
+	int top = 0;
+	stack[top++] = root;
+	while (top > 0)
+	{
+		const Node& n = nodes[stack[--top]];
+		if (!Bounds::Overlaps(n.box, sphere))
+			continue;
+
+		if (n.child1 == nullNode)
+			results.push_back(n.userData);
+		else
+		{
+			stack[top++] = n.child1;
+			stack[top++] = n.child2;
+		}
+	}
+}
+
+void SceneIndex::QueryBox(const Bounds::Box& box, std::vector<unsigned int>& results) const
+{
+	if (root == nullNode)
+		return;
+
+	int stack[maxStack];
+	int top = 0;
+	stack[top++] = root;
+	while (top > 0)
+	{
+		const Node& n = nodes[stack[--top]];
+		if (!Bounds::Overlaps(n.box, box))
+			continue;
+
+		if (n.child1 == nullNode)
+			results.push_back(n.userData);
+		else
+		{
+			stack[top++] = n.child1;
+			stack[top++] = n.child2;
+		}
+	}
+}
+
+void SceneIndex::QueryRay(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, std::vector<RayHit>& results) const
+{
+	if (root == nullNode)
+		return;
+
+	int stack[maxStack];
+	int top = 0;
+	stack[top++] = root;
+	while (top > 0)
+	{
+		const Node& n = nodes[stack[--top]];
+		float distance;
+		if (!Bounds::RayIntersects(n.box, origin, direction, maxDistance, distance))
+			continue;
+
+		if (n.child1 == nullNode)
+			results.push_back({ n.userData, distance });
+		else
+		{
+			stack[top++] = n.child1;
+			stack[top++] = n.child2;
+		}
+	}
+}
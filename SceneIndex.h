@@ -0,0 +1,86 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Bounds.h"
+#include "FrustumCuller.h"
+
+// --------------------------------------------------------
+// Dynamic bounding volume hierarchy over the scene's boxes
+//
+// - Each object is a leaf holding a "fat" box (its box grown
+//    by a margin), so small movements don't touch the tree
+// - Insert picks the sibling that grows the tree's surface area
+//    the least, and rotations keep it balanced (AVL style), so
+//    queries stay O(log n) as things are added, removed and moved
+// - Big static scenes should go in with InsertMany(), which
+//    builds top-down (median splits) instead - incremental inserts
+//    of a whole scene in random order make a much looser tree
+// - Queries return the userData of every leaf whose fat box
+//    passes, so results can include objects just outside
+// --------------------------------------------------------
+class SceneIndex
+{
+public:
+	struct RayHit
+	{
+		unsigned int userData;
+		float distance; // Where the ray enters the fat box
+	};
+
+	SceneIndex(float margin = 0.1f);
+
+	// Returns a proxy id for Update()/Remove()
+	int Insert(const Bounds::Box& box, unsigned int userData);
+
+	// Adds lots of objects at once (proxies gets one id each), then
+	// rebuilds the whole tree - much faster, and a much better tree,
+	// than inserting a big static scene one object at a time
+	void InsertMany(const Bounds::Box* boxes, const unsigned int* userData, size_t count, int* proxies);
+
+	// Rebuilds the tree top-down from its current leaves (proxy ids
+	// don't change) - worth doing after lots of scattered inserts
+	void Rebuild();
+	void Remove(int proxy);
+	void Clear();
+
+	// Call when the object moves - returns true if its box left the
+	// fat box and it had to be re-inserted, false if nothing changed
+	bool Update(int proxy, const Bounds::Box& box);
+
+	unsigned int GetUserData(int proxy) const;
+	Bounds::Box GetFatBox(int proxy) const;
+	int GetCount() const;	// Objects in the index
+	int GetHeight() const;	// Levels in the tree (0 when empty)
+
+	// Each of these appends to results, in no particular order
+	void QueryFrustum(const FrustumCuller::Frustum& frustum, std::vector<unsigned int>& results) const;
+	void QuerySphere(const Bounds::Sphere& sphere, std::vector<unsigned int>& results) const;
+	void QueryBox(const Bounds::Box& box, std::vector<unsigned int>& results) const;
+	void QueryRay(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, std::vector<RayHit>& results) const;
+
+private:
+	struct Node
+	{
+		Bounds::Box box;
+		int parent;		// Next free node, when on the free list
+		int child1;		// -1 for leaves
+		int child2;
+		int height;		// 0 for leaves, -1 when free
+		unsigned int userData;
+	};
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int node);
+	void FixUpwards(int node); // Rebalances and refits from node to the root
+	void CollectLeaves(int node, std::vector<unsigned int>& results) const;
+	int BuildRange(int* leaves, size_t count);
+
+	std::vector<Node> nodes;
+	int root;
+	int freeList;
+	int count;
+	float margin;
+};
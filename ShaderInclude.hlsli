@@ -17,6 +17,36 @@ struct VertexShaderInput
     float3 tangent: TANGENT; // TANGENT FOR NORMAL MAPPING
 };
 
+// Just the position, for depth-only passes like the shadow map
+// - Matches Mesh's position buffer and positionInputLayout
+struct PositionOnlyVertexShaderInput
+{
+    float3 localPosition : POSITION;
+};
+
+// The compressed vertex (PackedVertex in Vertex.h)
+// - The input layout's UNORM/SNORM/FLOAT formats do the
+//    integer to float conversion before the shader sees it
+// - Position is a 0-1 fraction of the mesh's bounds
+// - Normal and tangent are octahedral-encoded, see OctDecode()
+struct PackedVertexShaderInput
+{
+    float4 localPosition : POSITION; // R16G16B16A16_UNORM, w unused
+    float2 uv : TEXCOORD; // R16G16_FLOAT
+    float2 normal : NORMAL; // R16G16_SNORM
+    float2 tangent : TANGENT; // R16G16_SNORM
+};
+
+// Unit vector from its octahedral encoding
+// - Must match VertexCodec::DecodeOctahedral()
+float3 OctDecode(float2 e)
+{
+    float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += (v.xy >= 0.0f) ? -t : t;
+    return normalize(v);
+}
+
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
 // - The name of the struct itself is unimportant
@@ -79,17 +109,12 @@ struct Light
 
 // -- PIXEL SHADER -- 
 // External Data passed at Pixel Shader level
+// - The same for every object drawn from a camera
 cbuffer ExternalPixelData : register(b0)
 {
-    float4 colorTint : TINT;
-    
-    float2 scale : SCALE;
-    float2 offset : OFFSET;
-    
     float3 camWorldPos : CAMERA_WORLD_POS;
     float totalTime : TIME;
     
-    int isMetal : ISMETAL;
     float3 ambientColor : AMBIENT_COLOR;
     
     Light lights[5];
@@ -97,6 +122,17 @@ cbuffer ExternalPixelData : register(b0)
     
 };
 
+// Per object (its material's) - only sent again when it changes
+cbuffer ObjectPixelData : register(b1)
+{
+    float4 colorTint : TINT;
+    
+    float2 scale : SCALE;
+    float2 offset : OFFSET;
+    
+    int isMetal : ISMETAL;
+};
+
 // -- LIGHTING EQUATIONS --
 // -- NON PBR --
 float3 DiffuseLambertTerm(float3 surfaceNormal, float3 surfaceColor, float3 toLightNormalized, Light light)
@@ -2,14 +2,19 @@
 
 cbuffer shadowData : register(b0)
 {
-    matrix world;
     matrix view;
     matrix proj;
 }
 
+// The main pass's per-object constants (the same block, when the object isn't moving)
+cbuffer ObjectVertexData : register(b1)
+{
+    matrix world;
+}
+
 
 
-float4 main( VertexShaderInput input ) : SV_POSITION
+float4 main( PositionOnlyVertexShaderInput input ) : SV_POSITION
 {
     matrix wvp = mul(proj, mul(view, world));
     return mul(wvp, float4(input.localPosition, 1.0f));
@@ -16,6 +16,20 @@ Sky::Sky(std::shared_ptr<Mesh> meshIn,
 	// -- LOADING TEXTURE -- 
 	cubeMapSRV = CreateCubemap(right, left, up, down, front, back);
 
+	CreateStates(vertexPath, pixelPath);
+}
+
+Sky::Sky(std::shared_ptr<Mesh> meshIn, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap,
+	const wchar_t* vertexPath, const wchar_t* pixelPath)
+{
+	skyMesh = meshIn;
+	cubeMapSRV = cubeMap;
+
+	CreateStates(vertexPath, pixelPath);
+}
+
+void Sky::CreateStates(const wchar_t* vertexPath, const wchar_t* pixelPath)
+{
 	// -- CREATING SAMPLER STATE -- 
 	D3D11_SAMPLER_DESC ssDesc = {};
 	ssDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -203,14 +217,14 @@ void Sky::LoadVertexShader(const wchar_t* path)
 void Sky::Draw(std::shared_ptr<Camera> camera) 
 {
 	
-	Graphics::Context->RSSetState(rasterizerState.Get());
-	Graphics::Context->OMSetDepthStencilState(depthStencilState.Get(), 0);
+	Graphics::State.SetRasterizerState(rasterizerState.Get());
+	Graphics::Backend->SetDepthStencilState(depthStencilState.Get());
 
-	Graphics::Context->VSSetShader(skyVertexShader.Get(), 0, 0);
-	Graphics::Context->PSSetShader(skyPixelShader.Get(), 0, 0);
+	Graphics::State.SetVertexShader(skyVertexShader.Get());
+	Graphics::State.SetPixelShader(skyPixelShader.Get());
 
-	Graphics::Context->PSSetShaderResources(0, 1, cubeMapSRV.GetAddressOf());
-	Graphics::Context->PSSetSamplers(0, 1, samplerState.GetAddressOf());
+	Graphics::State.SetShaderResources(StateCache::Pixel, 0, 1, cubeMapSRV.GetAddressOf());
+	Graphics::State.SetSamplers(StateCache::Pixel, 0, 1, samplerState.GetAddressOf());
 
 	
 
@@ -223,6 +237,6 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 
 	skyMesh->Draw();
 
-	Graphics::Context->RSSetState(0);
-	Graphics::Context->OMSetDepthStencilState(0, 0);
+	Graphics::State.SetRasterizerState(0);
+	Graphics::Backend->SetDepthStencilState(0);
 }
\ No newline at end of file
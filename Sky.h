@@ -21,6 +21,10 @@ public:
 		const wchar_t* front,
 		const wchar_t* back, const wchar_t* vertexPath, const wchar_t* pixelPath);
 
+	// For a cubemap that's already been loaded (see AssetLoader)
+	Sky(std::shared_ptr<Mesh> meshIn, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap,
+		const wchar_t* vertexPath, const wchar_t* pixelPath);
+
 	// Chris Cascioli - Helper for creating a cubemap from 6 individual textures
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
 		const wchar_t* right,
@@ -38,6 +42,8 @@ public:
 
 
 private:
+	void CreateStates(const wchar_t* vertexPath, const wchar_t* pixelPath); // Sampler, shaders, rasterizer & depth states
+
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMapSRV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
@@ -0,0 +1,234 @@
+#include "StateCache.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Never a real object, so it never matches what a caller binds
+	template<typename T>
+	T* Unknown()
+	{
+		return reinterpret_cast<T*>(UINTPTR_MAX);
+	}
+
+	void CheckRange(unsigned int start, unsigned int count, unsigned int limit, const char* what)
+	{
+		if (start > limit || count > limit - start)
+			throw std::invalid_argument(std::string(what) + " slots out of range");
+	}
+}
+
+bool StateCache::VertexBuffer::operator==(const VertexBuffer& other) const
+{
+	return buffer == other.buffer && stride == other.stride && offset == other.offset;
+}
+
+bool StateCache::VertexBuffer::operator!=(const VertexBuffer& other) const { return !(*this == other); }
+
+StateCache::StateCache()
+{
+	target = 0;
+	for (VertexBuffer& slot : vertexBuffers.pending)
+		slot = { 0, 0, 0 };
+	vertexBuffers.first = MaxVertexBuffers;
+	vertexBuffers.last = 0;
+	for (int s = 0; s < StageCount; s++)
+	{
+		for (ID3D11ShaderResourceView*& view : shaderResources[s].pending)
+			view = 0;
+		shaderResources[s].first = MaxShaderResources;
+		shaderResources[s].last = 0;
+
+		for (ID3D11SamplerState*& sampler : samplers[s].pending)
+			sampler = 0;
+		samplers[s].first = MaxSamplers;
+		samplers[s].last = 0;
+	}
+	Invalidate();
+	ResetStats();
+}
+
+void StateCache::SetTarget(Target* newTarget)
+{
+	target = newTarget;
+	Invalidate();
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* shader)
+{
+	stats.requested++;
+	if (shader == vertexShader)
+		return;
+	vertexShader = shader;
+	target->SetVertexShader(shader);
+	stats.submitted++;
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	stats.requested++;
+	if (shader == pixelShader)
+		return;
+	pixelShader = shader;
+	target->SetPixelShader(shader);
+	stats.submitted++;
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	stats.requested++;
+	if (layout == inputLayout)
+		return;
+	inputLayout = layout;
+	target->SetInputLayout(layout);
+	stats.submitted++;
+}
+
+void StateCache::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	stats.requested++;
+	if (state == rasterizerState)
+		return;
+	rasterizerState = state;
+	target->SetRasterizerState(state);
+	stats.submitted++;
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	stats.requested++;
+	if (buffer == indexBuffer && format == indexFormat && offset == indexOffset)
+		return;
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+	target->SetIndexBuffer(buffer, format, offset);
+	stats.submitted++;
+}
+
+void StateCache::SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset)
+{
+	CheckRange(slot, 1, MaxVertexBuffers, "Vertex buffer");
+	VertexBuffer value = { buffer, stride, offset };
+	Record(vertexBuffers, slot, 1, &value);
+}
+
+void StateCache::SetShaderResources(Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* views)
+{
+	CheckRange(start, count, MaxShaderResources, "Shader resource");
+	Record(shaderResources[stage], start, count, views);
+}
+
+void StateCache::SetSamplers(Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* newSamplers)
+{
+	CheckRange(start, count, MaxSamplers, "Sampler");
+	Record(samplers[stage], start, count, newSamplers);
+}
+
+template<typename T, unsigned int Count>
+void StateCache::Record(Slots<T, Count>& slots, unsigned int start, unsigned int count, const T* values)
+{
+	if (count == 0)
+		return;
+	stats.requested++;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int slot = start + i;
+		slots.pending[slot] = values[i];
+		if (slots.pending[slot] == slots.bound[slot])
+			continue;
+
+		if (slots.first > slots.last) { slots.first = slots.last = slot; }
+		else if (slot < slots.first) { slots.first = slot; }
+		else if (slot > slots.last) { slots.last = slot; }
+	}
+}
+
+// --------------------------------------------------------
+// Narrows a dirty range down to the slots that really changed
+// and marks them bound - the unchanged slots between them are
+// sent again, since one call is cheaper than several
+// --------------------------------------------------------
+template<typename T, unsigned int Count>
+bool StateCache::TakeChanges(Slots<T, Count>& slots, unsigned int& start, unsigned int& end)
+{
+	start = Count;
+	end = 0;
+	for (unsigned int i = slots.first; i <= slots.last && slots.first < Count; i++)
+	{
+		if (slots.pending[i] != slots.bound[i])
+		{
+			if (start == Count) { start = i; }
+			end = i + 1;
+		}
+	}
+	slots.first = Count;
+	slots.last = 0;
+
+	if (start >= end)
+		return false;
+	for (unsigned int i = start; i < end; i++)
+		slots.bound[i] = slots.pending[i];
+	return true;
+}
+
+void StateCache::Flush()
+{
+	unsigned int start, end;
+	if (TakeChanges(vertexBuffers, start, end))
+	{
+		ID3D11Buffer* buffers[MaxVertexBuffers];
+		unsigned int strides[MaxVertexBuffers];
+		unsigned int offsets[MaxVertexBuffers];
+		for (unsigned int i = start; i < end; i++)
+		{
+			buffers[i - start] = vertexBuffers.bound[i].buffer;
+			strides[i - start] = vertexBuffers.bound[i].stride;
+			offsets[i - start] = vertexBuffers.bound[i].offset;
+		}
+		target->SetVertexBuffers(start, end - start, buffers, strides, offsets);
+		stats.submitted++;
+	}
+
+	for (int s = 0; s < StageCount; s++)
+	{
+		if (TakeChanges(shaderResources[s], start, end))
+		{
+			target->SetShaderResources((Stage)s, start, end - start, shaderResources[s].bound + start);
+			stats.submitted++;
+		}
+		if (TakeChanges(samplers[s], start, end))
+		{
+			target->SetSamplers((Stage)s, start, end - start, samplers[s].bound + start);
+			stats.submitted++;
+		}
+	}
+}
+
+void StateCache::Invalidate()
+{
+	vertexShader = Unknown<ID3D11VertexShader>();
+	pixelShader = Unknown<ID3D11PixelShader>();
+	inputLayout = Unknown<ID3D11InputLayout>();
+	rasterizerState = Unknown<ID3D11RasterizerState>();
+	indexBuffer = Unknown<ID3D11Buffer>();
+
+	// Dirty ranges are left alone - anything recorded but not
+	// flushed yet still goes out with the next Flush()
+	for (VertexBuffer& slot : vertexBuffers.bound)
+		slot = { Unknown<ID3D11Buffer>(), 0, 0 };
+	for (int s = 0; s < StageCount; s++)
+	{
+		for (ID3D11ShaderResourceView*& view : shaderResources[s].bound)
+			view = Unknown<ID3D11ShaderResourceView>();
+		for (ID3D11SamplerState*& sampler : samplers[s].bound)
+			sampler = Unknown<ID3D11SamplerState>();
+	}
+}
+
+StateCache::Stats StateCache::GetStats() const { return stats; }
+void StateCache::ResetStats() { stats = { 0, 0 }; }
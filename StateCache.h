@@ -0,0 +1,127 @@
+#pragma once
+
+// Only ever passed around and compared, never dereferenced, so
+// nothing here needs the D3D11 headers
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+struct ID3D11RasterizerState;
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+
+// --------------------------------------------------------
+// Remembers what's bound to the context and drops the calls
+// that wouldn't change anything
+//
+// - Shaders, input layout, rasterizer state and the index
+//    buffer go through straight away if they're different
+// - Shader resources, samplers and vertex buffers are only
+//    recorded per slot, then Flush() (right before a draw)
+//    sends each stage's changed slots as one range call
+// - The calls themselves go to a Target, so the same logic
+//    runs against the real context (see Graphics.cpp) or a
+//    fake one (see TEST(StateCache) in Tests/StateCacheTests.cpp)
+// - Anything that changes these behind its back has to
+//    Invalidate() - including setting a texture as a render
+//    target, which quietly unbinds it as a shader resource
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	enum Stage { Vertex = 0, Pixel = 1, StageCount = 2 };
+
+	// D3D11's limits (D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT etc.)
+	static const unsigned int MaxShaderResources = 128;
+	static const unsigned int MaxSamplers = 16;
+	static const unsigned int MaxVertexBuffers = 32;
+
+	// Where the calls that make it through end up
+	class Target
+	{
+	public:
+		virtual ~Target() = default;
+		virtual void SetVertexShader(ID3D11VertexShader* shader) = 0;
+		virtual void SetPixelShader(ID3D11PixelShader* shader) = 0;
+		virtual void SetInputLayout(ID3D11InputLayout* layout) = 0;
+		virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+		virtual void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) = 0;
+		virtual void SetVertexBuffers(unsigned int start, unsigned int count, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) = 0;
+		virtual void SetShaderResources(Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* views) = 0;
+		virtual void SetSamplers(Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* samplers) = 0;
+	};
+
+	// Calls asked for vs. calls that reached the target
+	struct Stats
+	{
+		unsigned int requested;
+		unsigned int submitted;
+		unsigned int Elided() const { return requested > submitted ? requested - submitted : 0; }
+	};
+
+	StateCache();
+
+	void SetTarget(Target* newTarget); // Also invalidates
+
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);
+
+	// Recorded until Flush() - slots past the limits throw std::invalid_argument
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset);
+	void SetShaderResources(Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* samplers);
+
+	void Flush();
+	void Invalidate(); // Forget what's bound - the next call for anything goes through
+
+	Stats GetStats() const;
+	void ResetStats();
+
+private:
+	// Recorded slots, and the range of them that might differ from
+	// what the target has (empty when first > last)
+	template<typename T, unsigned int Count>
+	struct Slots
+	{
+		T pending[Count];
+		T bound[Count];
+		unsigned int first;
+		unsigned int last;
+	};
+
+	struct VertexBuffer
+	{
+		ID3D11Buffer* buffer;
+		unsigned int stride;
+		unsigned int offset;
+		bool operator==(const VertexBuffer& other) const;
+		bool operator!=(const VertexBuffer& other) const;
+	};
+
+	// Finds the changed part of a dirty range, as [start, end)
+	template<typename T, unsigned int Count>
+	static bool TakeChanges(Slots<T, Count>& slots, unsigned int& start, unsigned int& end);
+
+	template<typename T, unsigned int Count>
+	void Record(Slots<T, Count>& slots, unsigned int start, unsigned int count, const T* values);
+
+	Target* target;
+	Stats stats;
+
+	// What the target has - after Invalidate() these (and the slots'
+	// bound values) hold a pointer nothing can be bound as
+	ID3D11VertexShader* vertexShader;
+	ID3D11PixelShader* pixelShader;
+	ID3D11InputLayout* inputLayout;
+	ID3D11RasterizerState* rasterizerState;
+	ID3D11Buffer* indexBuffer;
+	unsigned int indexFormat;
+	unsigned int indexOffset;
+
+	Slots<VertexBuffer, MaxVertexBuffers> vertexBuffers;
+	Slots<ID3D11ShaderResourceView*, MaxShaderResources> shaderResources[StageCount];
+	Slots<ID3D11SamplerState*, MaxSamplers> samplers[StageCount];
+};
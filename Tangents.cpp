@@ -0,0 +1,321 @@
+#include "Tangents.h"
+#include "Jobs.h"
+#include <vector>
+
+using namespace DirectX;
+
+namespace Tangents
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Below this, a range isn't worth the accumulator memory
+		const int minimumTrianglesPerRange = 16384;
+
+		// Positions and UVs pulled out of the Vertex structs,
+		// so gathers for a triangle only touch what they need
+		struct Staging
+		{
+			std::vector<float> x, y, z, u, v;
+		};
+
+		// One thread's running tangent sums
+		struct Accumulator
+		{
+			std::vector<float> x, y, z;
+		};
+
+		// Tangent of one triangle - the reference math, for the leftovers
+		inline void AddTriangle(const Staging& s, unsigned int i1, unsigned int i2, unsigned int i3, Accumulator& a)
+		{
+			float x1 = s.x[i2] - s.x[i1];
+			float y1 = s.y[i2] - s.y[i1];
+			float z1 = s.z[i2] - s.z[i1];
+
+			float x2 = s.x[i3] - s.x[i1];
+			float y2 = s.y[i3] - s.y[i1];
+			float z2 = s.z[i3] - s.z[i1];
+
+			float s1 = s.u[i2] - s.u[i1];
+			float t1 = s.v[i2] - s.v[i1];
+
+			float s2 = s.u[i3] - s.u[i1];
+			float t2 = s.v[i3] - s.v[i1];
+
+			float r = 1.0f / (s1 * t2 - s2 * t1);
+
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+
+			unsigned int corners[3] = { i1, i2, i3 };
+			for (unsigned int c : corners)
+			{
+				a.x[c] += tx;
+				a.y[c] += ty;
+				a.z[c] += tz;
+			}
+		}
+
+		// --------------------------------------------------------
+		// Sums the tangents of triangles [first, last) into a
+		//
+		// - Each step gathers 4 triangles into SIMD lanes, so all
+		//    of the math happens once for all 4
+		// - The scatter back into the accumulator is scalar, since
+		//    triangles in one block can share vertices
+		// --------------------------------------------------------
+		void AccumulateRange(const Staging& s, const unsigned int* indices, int first, int last, Accumulator& a)
+		{
+			int t = first;
+			for (; t + 4 <= last; t += 4)
+			{
+				// Gather: lane l holds triangle t + l
+				XMFLOAT4 px[3], py[3], pz[3], pu[3], pv[3];
+				const unsigned int* tri = &indices[t * 3];
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int i0 = tri[c], i1 = tri[3 + c], i2 = tri[6 + c], i3 = tri[9 + c];
+					px[c] = XMFLOAT4(s.x[i0], s.x[i1], s.x[i2], s.x[i3]);
+					py[c] = XMFLOAT4(s.y[i0], s.y[i1], s.y[i2], s.y[i3]);
+					pz[c] = XMFLOAT4(s.z[i0], s.z[i1], s.z[i2], s.z[i3]);
+					pu[c] = XMFLOAT4(s.u[i0], s.u[i1], s.u[i2], s.u[i3]);
+					pv[c] = XMFLOAT4(s.v[i0], s.v[i1], s.v[i2], s.v[i3]);
+				}
+
+				XMVECTOR x0 = XMLoadFloat4(&px[0]), y0 = XMLoadFloat4(&py[0]), z0 = XMLoadFloat4(&pz[0]);
+				XMVECTOR u0 = XMLoadFloat4(&pu[0]), v0 = XMLoadFloat4(&pv[0]);
+
+				// Edges relative to the first corner
+				XMVECTOR x1 = XMVectorSubtract(XMLoadFloat4(&px[1]), x0);
+				XMVECTOR y1 = XMVectorSubtract(XMLoadFloat4(&py[1]), y0);
+				XMVECTOR z1 = XMVectorSubtract(XMLoadFloat4(&pz[1]), z0);
+				XMVECTOR x2 = XMVectorSubtract(XMLoadFloat4(&px[2]), x0);
+				XMVECTOR y2 = XMVectorSubtract(XMLoadFloat4(&py[2]), y0);
+				XMVECTOR z2 = XMVectorSubtract(XMLoadFloat4(&pz[2]), z0);
+
+				XMVECTOR s1 = XMVectorSubtract(XMLoadFloat4(&pu[1]), u0);
+				XMVECTOR t1 = XMVectorSubtract(XMLoadFloat4(&pv[1]), v0);
+				XMVECTOR s2 = XMVectorSubtract(XMLoadFloat4(&pu[2]), u0);
+				XMVECTOR t2 = XMVectorSubtract(XMLoadFloat4(&pv[2]), v0);
+
+				// Same operation order as the scalar version, so the results match closely
+				XMVECTOR r = XMVectorDivide(XMVectorSplatOne(), XMVectorSubtract(XMVectorMultiply(s1, t2), XMVectorMultiply(s2, t1)));
+				XMFLOAT4 tx, ty, tz;
+				XMStoreFloat4(&tx, XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(t2, x1), XMVectorMultiply(t1, x2)), r));
+				XMStoreFloat4(&ty, XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(t2, y1), XMVectorMultiply(t1, y2)), r));
+				XMStoreFloat4(&tz, XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(t2, z1), XMVectorMultiply(t1, z2)), r));
+
+				// Scatter
+				const float* lanesX = &tx.x;
+				const float* lanesY = &ty.x;
+				const float* lanesZ = &tz.x;
+				for (int l = 0; l < 4; l++)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						unsigned int index = tri[l * 3 + c];
+						a.x[index] += lanesX[l];
+						a.y[index] += lanesY[l];
+						a.z[index] += lanesZ[l];
+					}
+				}
+			}
+
+			for (; t < last; t++)
+				AddTriangle(s, indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2], a);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Tangents in three parallel passes
+//
+// 1. Copy positions/UVs into SoA staging arrays
+// 2. Each range of triangles sums into its own accumulator
+// 3. Each range of vertices adds up the accumulators, then
+//    does Gram-Schmidt against the normal, 4 verts at a time
+// --------------------------------------------------------
+void Tangents::Calculate(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, unsigned int threadCount)
+{
+	if (numVerts <= 0)
+		return;
+
+	int numTriangles = numIndices / 3;
+	unsigned int rangeCount = threadCount > 0 ? threadCount : Jobs::ThreadCount();
+	if (rangeCount > (unsigned int)(numTriangles / minimumTrianglesPerRange))
+		rangeCount = numTriangles / minimumTrianglesPerRange;
+	if (rangeCount < 1)
+		rangeCount = 1;
+
+	// Vertex ranges for passes 1 and 3
+	auto firstVertex = [&](unsigned int range) { return (int)((long long)numVerts * range / rangeCount); };
+
+	// 1. Staging
+	Staging staging;
+	staging.x.resize(numVerts);
+	staging.y.resize(numVerts);
+	staging.z.resize(numVerts);
+	staging.u.resize(numVerts);
+	staging.v.resize(numVerts);
+	Jobs::ParallelFor(rangeCount, [&](unsigned int range)
+		{
+			for (int i = firstVertex(range); i < firstVertex(range + 1); i++)
+			{
+				staging.x[i] = verts[i].Position.x;
+				staging.y[i] = verts[i].Position.y;
+				staging.z[i] = verts[i].Position.z;
+				staging.u[i] = verts[i].UV.x;
+				staging.v[i] = verts[i].UV.y;
+			}
+		});
+
+	// 2. Per-range sums
+	std::vector<Accumulator> accumulators(rangeCount);
+	Jobs::ParallelFor(rangeCount, [&](unsigned int range)
+		{
+			Accumulator& a = accumulators[range];
+			a.x.assign(numVerts, 0.0f);
+			a.y.assign(numVerts, 0.0f);
+			a.z.assign(numVerts, 0.0f);
+
+			int first = (int)((long long)numTriangles * range / rangeCount);
+			int last = (int)((long long)numTriangles * (range + 1) / rangeCount);
+			AccumulateRange(staging, indices, first, last, a);
+		});
+
+	// 3. Merge and orthonormalize
+	Jobs::ParallelFor(rangeCount, [&](unsigned int range)
+		{
+			int first = firstVertex(range);
+			int last = firstVertex(range + 1);
+			for (int i = first; i < last; i += 4)
+			{
+				int lanes = last - i < 4 ? last - i : 4;
+
+				// Transpose 4 verts into SoA lanes (unused lanes stay zero)
+				XMFLOAT4 nx(0, 0, 0, 0), ny(0, 0, 0, 0), nz(0, 0, 0, 0), tx(0, 0, 0, 0), ty(0, 0, 0, 0), tz(0, 0, 0, 0);
+				for (int l = 0; l < lanes; l++)
+				{
+					float sumX = 0, sumY = 0, sumZ = 0;
+					for (const Accumulator& a : accumulators)
+					{
+						sumX += a.x[i + l];
+						sumY += a.y[i + l];
+						sumZ += a.z[i + l];
+					}
+					(&tx.x)[l] = sumX;
+					(&ty.x)[l] = sumY;
+					(&tz.x)[l] = sumZ;
+					(&nx.x)[l] = verts[i + l].Normal.x;
+					(&ny.x)[l] = verts[i + l].Normal.y;
+					(&nz.x)[l] = verts[i + l].Normal.z;
+				}
+
+				XMVECTOR normalX = XMLoadFloat4(&nx), normalY = XMLoadFloat4(&ny), normalZ = XMLoadFloat4(&nz);
+				XMVECTOR tangentX = XMLoadFloat4(&tx), tangentY = XMLoadFloat4(&ty), tangentZ = XMLoadFloat4(&tz);
+
+				// tangent - normal * dot(normal, tangent)
+				XMVECTOR dot = XMVectorAdd(XMVectorAdd(XMVectorMultiply(normalX, tangentX), XMVectorMultiply(normalY, tangentY)), XMVectorMultiply(normalZ, tangentZ));
+				tangentX = XMVectorSubtract(tangentX, XMVectorMultiply(normalX, dot));
+				tangentY = XMVectorSubtract(tangentY, XMVectorMultiply(normalY, dot));
+				tangentZ = XMVectorSubtract(tangentZ, XMVectorMultiply(normalZ, dot));
+
+				// Normalize, with zero-length staying zero (like XMVector3Normalize)
+				XMVECTOR length = XMVectorSqrt(XMVectorAdd(XMVectorAdd(XMVectorMultiply(tangentX, tangentX), XMVectorMultiply(tangentY, tangentY)), XMVectorMultiply(tangentZ, tangentZ)));
+				XMVECTOR nonZero = XMVectorGreater(length, XMVectorZero());
+				XMStoreFloat4(&tx, XMVectorAndInt(XMVectorDivide(tangentX, length), nonZero));
+				XMStoreFloat4(&ty, XMVectorAndInt(XMVectorDivide(tangentY, length), nonZero));
+				XMStoreFloat4(&tz, XMVectorAndInt(XMVectorDivide(tangentZ, length), nonZero));
+
+				for (int l = 0; l < lanes; l++)
+					verts[i + l].Tangent = XMFLOAT3((&tx.x)[l], (&ty.x)[l], (&tz.x)[l]);
+			}
+		});
+}
+
+// --------------------------------------------------------
+// Author: Chris Cascioli
+// Purpose: Calculates the tangents of the vertices in a mesh
+// 
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - This was Mesh::CalculateTangents(), and is kept as the
+//   reference that Calculate() is checked against
+// --------------------------------------------------------
+void Tangents::CalculateReference(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+
+{
+	// Reset tangents
+	for (int i = 0; i < numVerts; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (int i = 0; i < numIndices;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx;
+		v1->Tangent.y += ty;
+		v1->Tangent.z += tz;
+
+		v2->Tangent.x += tx;
+		v2->Tangent.y += ty;
+		v2->Tangent.z += tz;
+
+		v3->Tangent.x += tx;
+		v3->Tangent.y += ty;
+		v3->Tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (int i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+		// Use Gram-Schmidt orthonormalize to ensure
+		// the normal and tangent are exactly 90 degrees apart
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Per-vertex tangents for normal mapping
+//
+// - Calculate() is what Mesh::CalculateTangents() uses: 4
+//    triangles at a time with DirectXMath (SSE) over a SoA
+//    copy of the positions/UVs, split across the Jobs pool
+// - Each thread sums into its own accumulators, which are
+//    added up at the end, so there are no atomics
+// - CalculateReference() is the original one-triangle-at-a-
+//    time version, kept to check results against
+// --------------------------------------------------------
+namespace Tangents
+{
+	// threadCount of 0 means "every thread in the Jobs pool"
+	void Calculate(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, unsigned int threadCount = 0);
+
+	void CalculateReference(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices);
+}
@@ -0,0 +1,33 @@
+#include <DirectXMath.h>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "FrustumCuller.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Random spheres all around a camera: whichever instruction
+// set Cull() picked has to give exactly the scalar list
+// --------------------------------------------------------
+TEST(FrustumCuller)
+{
+	std::mt19937 rng(99);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 3.0f);
+	FrustumCuller::SphereList spheres;
+	for (unsigned int i = 0; i < 100003; i++)
+		spheres.Add({ XMFLOAT3(position(rng), position(rng), position(rng)), radius(rng) });
+
+	XMFLOAT4X4 view, proj;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.3f, -0.2f, 1.0f, 0.0f), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 500.0f));
+	FrustumCuller::Frustum frustum = FrustumCuller::FromCamera(view, proj);
+
+	std::vector<unsigned int> visible, scalarVisible;
+	FrustumCuller::Cull(frustum, spheres, visible);
+	FrustumCuller::CullScalar(frustum, spheres, scalarVisible);
+	CHECK(!scalarVisible.empty());
+	CHECK(visible == scalarVisible);
+}
@@ -0,0 +1,68 @@
+#include <DirectXMath.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "InstanceBatcher.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Batches cover every draw exactly once, in key order, each
+// holding only draws with its key, in the order they were added
+// --------------------------------------------------------
+TEST(InstanceBatcher)
+{
+	const unsigned int shaderCount = 4, materialCount = 32, meshCount = 64, lodCount = 4, drawCount = 100000;
+	std::mt19937 rng(18);
+	std::uniform_int_distribution<unsigned int> randomMaterial(0, materialCount - 1);
+	std::uniform_int_distribution<unsigned int> randomMesh(0, meshCount - 1);
+	std::uniform_int_distribution<unsigned int> randomLod(0, lodCount - 1);
+
+	std::vector<uint64_t> keys(drawCount);
+	InstanceBatcher batcher;
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		unsigned int material = randomMaterial(rng);
+		keys[i] = InstanceBatcher::MakeKey(material % shaderCount, material, randomMesh(rng), randomLod(rng));
+		batcher.Add(keys[i], i);
+	}
+	batcher.Build();
+
+	const std::vector<InstanceBatcher::Batch>& batches = batcher.GetBatches();
+	const std::vector<unsigned int>& indices = batcher.GetIndices();
+	CHECK(indices.size() == drawCount);
+	CHECK(batches.size() < drawCount);
+
+	unsigned int next = 0;
+	bool contiguous = true, consistent = true;
+	for (size_t b = 0; b < batches.size() && contiguous; b++)
+	{
+		const InstanceBatcher::Batch& batch = batches[b];
+		contiguous = batch.firstInstance == next && batch.instanceCount > 0 && batch.firstInstance + batch.instanceCount <= indices.size();
+		consistent = consistent && (b == 0 || batches[b - 1].key < batch.key);
+		next = batch.firstInstance + batch.instanceCount;
+		for (unsigned int i = batch.firstInstance; i < next && contiguous; i++)
+		{
+			consistent = consistent && indices[i] < drawCount && keys[indices[i]] == batch.key;
+			consistent = consistent && (i == batch.firstInstance || indices[i - 1] < indices[i]);
+		}
+	}
+	CHECK(contiguous && next == drawCount);
+	CHECK(consistent);
+
+	std::vector<bool> seen(drawCount, false);
+	bool once = true;
+	for (unsigned int index : indices)
+	{
+		once = once && index < drawCount && !seen[index];
+		if (index < drawCount) { seen[index] = true; }
+	}
+	CHECK(once);
+
+	// Nothing left over from the last frame
+	batcher.Clear();
+	batcher.Build();
+	CHECK(batcher.GetBatches().empty() && batcher.GetIndices().empty());
+}
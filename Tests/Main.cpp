@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <cstring>
+
+#include "Test.h"
+#include "Jobs.h"
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	unsigned int failures = 0;
+}
+
+std::vector<Tests::Test>& Tests::All()
+{
+	// Built on first use, so registering from other files'
+	// statics doesn't depend on their order
+	static std::vector<Test> tests;
+	return tests;
+}
+
+void Tests::Fail(const char* file, int line, const char* condition)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, condition);
+	failures++;
+}
+
+// --------------------------------------------------------
+// Runs the tests named on the command line, or all of them,
+// and returns non-zero if any check failed
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	// Several modules spread their work over the pool, so the
+	// tests run them the way the game does
+	Jobs::Initialize();
+
+	unsigned int run = 0, failed = 0;
+	for (const Tests::Test& test : Tests::All())
+	{
+		bool selected = argc < 2;
+		for (int a = 1; a < argc && !selected; a++)
+			selected = strcmp(argv[a], test.name) == 0;
+		if (!selected)
+			continue;
+
+		unsigned int failuresBefore = failures;
+		test.run();
+		run++;
+		failed += failures > failuresBefore;
+		printf("%s: %s\n", test.name, failures > failuresBefore ? "FAILED" : "passed");
+	}
+
+	Jobs::ShutDown();
+
+	if (run == 0)
+	{
+		printf("No tests with that name\n");
+		return 1;
+	}
+	printf("%u of %u tests passed\n", run - failed, run);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshFile.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	std::vector<char> ReadBytes(const std::string& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	void WriteBytes(const std::string& path, const std::vector<char>& bytes)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), (std::streamsize)bytes.size());
+	}
+}
+
+// --------------------------------------------------------
+// A cooked sphere reads back exactly as it was written, and
+// a truncated file, a bad magic or version, an index or a
+// meshlet out of range and (when verifying) a flipped byte
+// in a blob all make it invalid
+// --------------------------------------------------------
+TEST(MeshFile)
+{
+	// Everything a real import would cook
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	TestMeshes::Sphere(24, verts, indices);
+	std::vector<MeshSimplifier::Lod> lods;
+	MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices, lods);
+	std::vector<Meshlets::Meshlet> meshlets = Meshlets::Build(verts.data(), verts.size(), indices.data() + lods[0].firstIndex, lods[0].indexCount);
+	for (Meshlets::Meshlet& meshlet : meshlets)
+		meshlet.firstIndex += lods[0].firstIndex;
+
+	std::vector<XMFLOAT3> positions;
+	for (const Vertex& v : verts)
+		positions.push_back(v.Position);
+	VertexCodec::PositionBounds packedBounds = VertexCodec::ComputeBounds(verts.data(), verts.size());
+	std::vector<PackedVertex> packed(verts.size());
+	VertexCodec::Encode(verts.data(), verts.size(), packedBounds, packed.data());
+
+	CookedMesh mesh = {};
+	mesh.vertices = verts.data();
+	mesh.positions = positions.data();
+	mesh.packedVertices = packed.data();
+	mesh.vertexCount = (unsigned int)verts.size();
+	mesh.indices = indices.data();
+	mesh.indexCount = (unsigned int)indices.size();
+	mesh.lods = lods.data();
+	mesh.lodCount = (unsigned int)lods.size();
+	mesh.meshlets = meshlets.data();
+	mesh.meshletCount = (unsigned int)meshlets.size();
+	mesh.boundingBox = Bounds::ComputeBox(verts.data(), verts.size());
+	mesh.boundingSphere = Bounds::ComputeSphere(verts.data(), verts.size(), mesh.boundingBox);
+	mesh.packedBounds = packedBounds;
+	mesh.sourceVertexCount = (int)indices.size();
+
+	// Round trip (the source .obj doesn't exist, so it's stamped as empty)
+	std::string path = (std::filesystem::temp_directory_path() / "MeshFileTest.ggp_mesh").string();
+	const char* source = "MeshFileTest.ggp_obj";
+	CHECK(MeshFile::Write(path.c_str(), mesh, source, 0.001f));
+	{
+		MeshFile file(path.c_str(), true);
+		CHECK(file.IsValid());
+		CHECK(file.IsCookedFrom(source, 0.001f));
+		CHECK(!file.IsCookedFrom(source, 0.0f));
+
+		CookedMesh read = file.GetContents();
+		CHECK(read.vertexCount == mesh.vertexCount && read.indexCount == mesh.indexCount);
+		CHECK(read.lodCount == mesh.lodCount && read.meshletCount == mesh.meshletCount);
+		CHECK(memcmp(read.vertices, mesh.vertices, verts.size() * sizeof(Vertex)) == 0);
+		CHECK(memcmp(read.positions, mesh.positions, positions.size() * sizeof(XMFLOAT3)) == 0);
+		CHECK(memcmp(read.packedVertices, mesh.packedVertices, packed.size() * sizeof(PackedVertex)) == 0);
+		CHECK(memcmp(read.indices, mesh.indices, indices.size() * sizeof(unsigned int)) == 0);
+		CHECK(memcmp(read.lods, mesh.lods, lods.size() * sizeof(MeshSimplifier::Lod)) == 0);
+		CHECK(memcmp(read.meshlets, mesh.meshlets, meshlets.size() * sizeof(Meshlets::Meshlet)) == 0);
+		CHECK(memcmp(&read.boundingBox, &mesh.boundingBox, sizeof(Bounds::Box)) == 0);
+		CHECK(memcmp(&read.boundingSphere, &mesh.boundingSphere, sizeof(Bounds::Sphere)) == 0);
+		CHECK(memcmp(&read.packedBounds, &mesh.packedBounds, sizeof(VertexCodec::PositionBounds)) == 0);
+		CHECK(read.sourceVertexCount == mesh.sourceVertexCount);
+	}
+
+	// Each corruption on its own copy of the file
+	const std::vector<char> bytes = ReadBytes(path);
+	MeshFileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	auto validAfter = [&](auto corrupt, bool verify)
+	{
+		std::vector<char> copy = bytes;
+		corrupt(copy);
+		WriteBytes(path, copy);
+		return MeshFile(path.c_str(), verify).IsValid();
+	};
+	auto setUint = [](std::vector<char>& copy, unsigned long long offset, unsigned int value)
+	{
+		memcpy(&copy[offset], &value, sizeof(value));
+	};
+
+	CHECK(validAfter([](std::vector<char>&) {}, true));
+	CHECK(!validAfter([](std::vector<char>& copy) { copy.resize(copy.size() - 1); }, false));
+	CHECK(!validAfter([](std::vector<char>& copy) { copy.resize(sizeof(MeshFileHeader) - 1); }, false));
+	CHECK(!validAfter([&](std::vector<char>& copy) { setUint(copy, offsetof(MeshFileHeader, magic), header.magic ^ 1); }, false));
+	CHECK(!validAfter([&](std::vector<char>& copy) { setUint(copy, offsetof(MeshFileHeader, version), header.version + 1); }, false));
+	CHECK(!validAfter([&](std::vector<char>& copy) { setUint(copy, header.indexOffset + 5 * sizeof(unsigned int), header.vertexCount); }, false));
+	CHECK(!validAfter([&](std::vector<char>& copy)
+	{
+		unsigned long long meshletIndexCount = header.meshletOffset + offsetof(Meshlets::Meshlet, indexCount);
+		setUint(copy, meshletIndexCount, header.lods[0].indexCount + 3);
+	}, false));
+
+	// Vertex data isn't looked at unless verifying
+	auto flipVertexByte = [&](std::vector<char>& copy) { copy[header.vertexOffset + 7] ^= 0x10; };
+	CHECK(validAfter(flipVertexByte, false));
+	CHECK(!validAfter(flipVertexByte, true));
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
+}
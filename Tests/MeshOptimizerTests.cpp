@@ -0,0 +1,75 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshOptimizer.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Each triangle rotated to start at its smallest index (so the
+	// winding is kept), then sorted - equal for the same triangles
+	// in any order
+	std::vector<std::vector<unsigned int>> SortedTriangles(const std::vector<unsigned int>& indices)
+	{
+		std::vector<std::vector<unsigned int>> triangles;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			const unsigned int* i = &indices[t];
+			int first = i[0] < i[1] ? (i[0] < i[2] ? 0 : 2) : (i[1] < i[2] ? 1 : 2);
+			triangles.push_back({ i[first], i[(first + 1) % 3], i[(first + 2) % 3] });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+// --------------------------------------------------------
+// Reordering a shuffled grid for the vertex cache keeps every
+// triangle and its winding and brings the miss rate down, and
+// the fetch reorder numbers vertices in first-use order
+// --------------------------------------------------------
+TEST(MeshOptimizer)
+{
+	const unsigned int n = 200;
+	std::vector<Vertex> verts = TestMeshes::BumpyGrid(n);
+	std::vector<unsigned int> indices = TestMeshes::GridIndices(n);
+
+	std::mt19937 random(1234);
+	size_t triangles = indices.size() / 3;
+	for (size_t t = triangles - 1; t > 0; t--)
+	{
+		size_t other = random() % (t + 1);
+		for (int k = 0; k < 3; k++)
+			std::swap(indices[t * 3 + k], indices[other * 3 + k]);
+	}
+	MeshOptimizer::CacheStats shuffled = MeshOptimizer::SimulateCache(indices.data(), indices.size(), verts.size());
+
+	std::vector<unsigned int> before = indices;
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), verts.size());
+	MeshOptimizer::CacheStats optimized = MeshOptimizer::SimulateCache(indices.data(), indices.size(), verts.size());
+	CHECK(SortedTriangles(indices) == SortedTriangles(before));
+	CHECK(optimized.acmr < 1.0f && optimized.acmr < shuffled.acmr * 0.5f);
+
+	// Same triangles by position, vertices used in order
+	std::vector<Vertex> fetchVerts = verts;
+	std::vector<unsigned int> fetchIndices = indices;
+	MeshOptimizer::OptimizeVertexFetch(fetchVerts.data(), fetchVerts.size(), fetchIndices.data(), fetchIndices.size());
+	bool samePositions = true, firstUseOrder = true;
+	unsigned int nextNew = 0;
+	for (size_t i = 0; i < fetchIndices.size(); i++)
+	{
+		samePositions = samePositions && memcmp(&fetchVerts[fetchIndices[i]], &verts[indices[i]], sizeof(Vertex)) == 0;
+		if (fetchIndices[i] == nextNew) { nextNew++; }
+		else { firstUseOrder = firstUseOrder && fetchIndices[i] < nextNew; }
+	}
+	CHECK(samePositions);
+	CHECK(firstUseOrder);
+}
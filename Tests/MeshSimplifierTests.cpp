@@ -0,0 +1,64 @@
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshSimplifier.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// A sphere, a torus and an open-ended helix simplified to 1/2,
+// 1/4 and 1/8 of their triangles land within 10% of each target,
+// and the LOD chains built from them shrink and point into the
+// index buffer
+// --------------------------------------------------------
+TEST(MeshSimplifier)
+{
+	const float ratios[] = { 0.5f, 0.25f, 0.125f };
+	const float tolerance = 0.1f;
+	for (int shape = 0; shape < 3; shape++)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		if (shape == 0) { TestMeshes::Sphere(32, verts, indices); }
+		else if (shape == 1) { TestMeshes::Torus(64, 24, verts, indices); }
+		else { TestMeshes::Helix(192, 16, verts, indices); }
+
+		size_t triangleCount = indices.size() / 3;
+		std::vector<unsigned int> simplified(indices.size());
+		for (float ratio : ratios)
+		{
+			size_t target = (size_t)(triangleCount * ratio) * 3;
+			float error = -1.0f;
+			size_t count = MeshSimplifier::Simplify(verts.data(), verts.size(), indices.data(), indices.size(),
+				target, FLT_MAX, simplified.data(), &error);
+			CHECK(std::fabs((float)count / target - 1.0f) <= tolerance);
+			CHECK(error >= 0.0f);
+
+			bool inRange = true;
+			for (size_t i = 0; i < count; i++)
+				inRange = inRange && simplified[i] < verts.size();
+			CHECK(inRange);
+		}
+
+		// A tiny error budget stops it early, rather than going wrong
+		size_t cautious = MeshSimplifier::Simplify(verts.data(), verts.size(), indices.data(), indices.size(),
+			0, 1e-7f, simplified.data());
+		CHECK(cautious > indices.size() / 8);
+
+		std::vector<MeshSimplifier::Lod> lods;
+		MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices, lods);
+		CHECK(lods.size() >= 3 && lods.size() <= (size_t)MeshSimplifier::MaxLods);
+		CHECK(!lods.empty() && lods[0].firstIndex == 0 && lods[0].indexCount == triangleCount * 3);
+		for (size_t l = 1; l < lods.size(); l++)
+		{
+			CHECK(lods[l].firstIndex == lods[l - 1].firstIndex + lods[l - 1].indexCount);
+			CHECK(lods[l].indexCount < lods[l - 1].indexCount);
+			CHECK(lods[l].error >= lods[l - 1].error);
+		}
+		CHECK(!lods.empty() && lods.back().firstIndex + lods.back().indexCount == indices.size());
+	}
+}
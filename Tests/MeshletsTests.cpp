@@ -0,0 +1,108 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Meshlets of a sphere stay within their limits, cover every
+// triangle once, and culling from a few views never drops a
+// front-facing triangle that's on screen
+// --------------------------------------------------------
+TEST(Meshlets)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	TestMeshes::Sphere(100, verts, indices);
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), verts.size());
+
+	std::vector<unsigned int> original = indices;
+	std::vector<Meshlets::Meshlet> meshlets = Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size());
+	CHECK(!meshlets.empty());
+
+	// Contiguous, within the limits, and the same triangles as before
+	unsigned int next = 0;
+	for (const Meshlets::Meshlet& m : meshlets)
+	{
+		CHECK(m.firstIndex == next);
+		CHECK(m.vertexCount <= Meshlets::MaxVertices);
+		CHECK(m.indexCount / 3 <= Meshlets::MaxTriangles);
+		next = m.firstIndex + m.indexCount;
+	}
+	CHECK(next == indices.size());
+	auto sortedTriangles = [](const std::vector<unsigned int>& list)
+	{
+		std::vector<std::vector<unsigned int>> triangles;
+		for (size_t t = 0; t + 2 < list.size(); t += 3)
+		{
+			// Rotated to start at the smallest index, so the winding is kept
+			size_t first = list[t] < list[t + 1] ? (list[t] < list[t + 2] ? 0 : 2) : (list[t + 1] < list[t + 2] ? 1 : 2);
+			triangles.push_back({ list[t + first], list[t + (first + 1) % 3], list[t + (first + 2) % 3] });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	};
+	CHECK(sortedTriangles(indices) == sortedTriangles(original));
+
+	// Whole sphere, close up, grazing and facing away
+	struct View { XMFLOAT3 position; XMFLOAT3 direction; };
+	const View views[] =
+	{
+		{ XMFLOAT3(0, 0, -4), XMFLOAT3(0, 0, 1) },
+		{ XMFLOAT3(0, 0, -1.3f), XMFLOAT3(0, 0, 1) },
+		{ XMFLOAT3(1.05f, 0, -1.5f), XMFLOAT3(0, 0, 1) },
+		{ XMFLOAT3(0, 0, -4), XMFLOAT3(0, 0, -1) },
+	};
+	XMFLOAT4X4 world, proj;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.01f, 100.0f));
+
+	std::vector<Meshlets::IndexRange> visible;
+	std::vector<char> triangleVisible(indices.size() / 3);
+	size_t missed = 0, dropped = 0;
+	for (const View& v : views)
+	{
+		XMFLOAT4X4 view;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&v.position), XMLoadFloat3(&v.direction), XMVectorSet(0, 1, 0, 0)));
+		visible.clear();
+		Meshlets::Cull(meshlets.data(), meshlets.size(), world, view, proj, v.position, visible);
+
+		std::fill(triangleVisible.begin(), triangleVisible.end(), 0);
+		for (const Meshlets::IndexRange& range : visible)
+			std::fill(triangleVisible.begin() + range.firstIndex / 3, triangleVisible.begin() + (range.firstIndex + range.indexCount) / 3, 1);
+
+		// Every dropped triangle must face away or be entirely
+		// outside the frustum (checked one vertex at a time, which
+		// is stricter than needed)
+		XMMATRIX viewProj = XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj);
+		XMVECTOR eye = XMLoadFloat3(&v.position);
+		for (size_t t = 0; t < triangleVisible.size(); t++)
+		{
+			if (triangleVisible[t])
+				continue;
+			dropped++;
+
+			XMVECTOR p[3];
+			bool onScreen = false;
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = XMLoadFloat3(&verts[indices[t * 3 + k]].Position);
+				XMFLOAT4 clip;
+				XMStoreFloat4(&clip, XMVector4Transform(XMVectorSetW(p[k], 1.0f), viewProj));
+				if (clip.w > 0 && std::fabs(clip.x) <= clip.w && std::fabs(clip.y) <= clip.w && clip.z >= 0 && clip.z <= clip.w)
+					onScreen = true;
+			}
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+			bool facing = XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(eye, p[0]))) > 0.0f;
+			missed += onScreen && facing;
+		}
+	}
+	CHECK(missed == 0);
+	CHECK(dropped > 0); // Or the views aren't testing anything
+}
@@ -0,0 +1,140 @@
+#include <DirectXMath.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+#include "NullBackend.h"
+#include "StateCache.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Stands in for a D3D11 object - only ever compared, never used
+	template<typename T>
+	T* FakeObject(unsigned int id)
+	{
+		return reinterpret_cast<T*>((uintptr_t)(id + 1) * 64);
+	}
+
+	enum Missing { NothingMissing, NoShader, NoInputLayout, NoIndexBuffer };
+
+	// One indexed draw set up the way Mesh::Draw() does it, through a
+	// StateCache in front of a fresh NullBackend, with one thing left out
+	std::vector<std::string> ErrorsOfDraw(Missing missing)
+	{
+		NullBackend backend;
+		StateCache state;
+		state.SetTarget(&backend);
+		if (missing != NoShader) { state.SetVertexShader(FakeObject<ID3D11VertexShader>(0)); }
+		if (missing != NoInputLayout) { state.SetInputLayout(FakeObject<ID3D11InputLayout>(1)); }
+		if (missing != NoIndexBuffer) { state.SetIndexBuffer(FakeObject<ID3D11Buffer>(2), 42, 0); }
+		state.SetVertexBuffer(0, FakeObject<ID3D11Buffer>(3), 44, 0);
+		state.Flush();
+		backend.DrawIndexed(36, 0, 0);
+		return backend.GetErrors();
+	}
+
+	bool OnlyError(const std::vector<std::string>& errors, const std::string& text)
+	{
+		return errors.size() == 1 && errors[0].find(text) != std::string::npos;
+	}
+}
+
+// --------------------------------------------------------
+// A short frame through a StateCache on a NullBackend: every
+// call, triangle and constant byte is counted, a clean frame
+// has no errors, and draws missing a shader, input layout or
+// index buffer (or slots past D3D11's limits) are reported
+// --------------------------------------------------------
+TEST(NullBackend)
+{
+	NullBackend backend;
+	StateCache state;
+	state.SetTarget(&backend);
+	backend.SetRecording(true);
+
+	ID3D11VertexShader* vs = FakeObject<ID3D11VertexShader>(0);
+	ID3D11ShaderResourceView* views[2] = { FakeObject<ID3D11ShaderResourceView>(1), FakeObject<ID3D11ShaderResourceView>(2) };
+	float constants[64] = {};
+	unsigned char instances[4 * RenderBackend::InstanceBytes] = {};
+	const unsigned int order[3] = { 2, 0, 3 };
+
+	backend.SetViewport(1280.0f, 720.0f);
+	state.SetVertexShader(vs);
+	state.SetPixelShader(FakeObject<ID3D11PixelShader>(3));
+	state.SetInputLayout(FakeObject<ID3D11InputLayout>(4));
+	state.SetIndexBuffer(FakeObject<ID3D11Buffer>(5), 42, 0);
+	state.SetVertexBuffer(0, FakeObject<ID3D11Buffer>(6), 44, 0);
+	state.SetShaderResources(StateCache::Pixel, 0, 2, views);
+	state.Flush();
+	backend.SetConstants(StateCache::Vertex, 1, constants, 128);
+	backend.DrawIndexed(36, 0, 0);
+
+	// Same everything again - the cache sends none of it
+	state.SetVertexShader(vs);
+	state.SetShaderResources(StateCache::Pixel, 0, 2, views);
+	state.Flush();
+	backend.SetConstants(StateCache::Vertex, 1, constants, 128);
+	backend.DrawIndexed(300, 36, 0);
+
+	// Persistent constants and instance slots, then a fullscreen triangle
+	backend.ReservePersistentConstants(2);
+	backend.UpdatePersistentConstants(0, constants, RenderBackend::PersistentBlockBytes);
+	backend.BindPersistentConstants(StateCache::Vertex, 1, 0);
+	backend.ReserveInstances(4);
+	backend.UpdateInstances(0, 4, instances);
+	backend.SetInstanceOrder(order, 3);
+	backend.DrawIndexedInstanced(36, 3, 0, 0, 0);
+	backend.Draw(3, 0);
+
+	CHECK(backend.GetCount(NullBackend::VertexShaderCall) == 1);
+	CHECK(backend.GetCount(NullBackend::PixelShaderCall) == 1);
+	CHECK(backend.GetCount(NullBackend::InputLayoutCall) == 1);
+	CHECK(backend.GetCount(NullBackend::IndexBufferCall) == 1);
+	CHECK(backend.GetCount(NullBackend::VertexBuffersCall) == 1);
+	CHECK(backend.GetCount(NullBackend::ShaderResourcesCall) == 1);
+	CHECK(backend.GetCount(NullBackend::ConstantsCall) == 2);
+	CHECK(backend.GetCount(NullBackend::UpdatePersistentCall) == 1);
+	CHECK(backend.GetCount(NullBackend::BindPersistentCall) == 1);
+	CHECK(backend.GetCount(NullBackend::UpdateInstancesCall) == 1);
+	CHECK(backend.GetCount(NullBackend::InstanceOrderCall) == 1);
+	CHECK(backend.GetCount(NullBackend::DrawIndexedCall) == 2);
+	CHECK(backend.GetCount(NullBackend::DrawIndexedInstancedCall) == 1);
+	CHECK(backend.GetCount(NullBackend::DrawCall) == 1);
+	CHECK(backend.GetCount(NullBackend::ViewportCall) == 1);
+	CHECK(backend.GetTotalCount() == 17);
+	CHECK(backend.GetCalls().size() == backend.GetTotalCount());
+	CHECK(backend.GetCalls().back().type == NullBackend::DrawCall);
+
+	// 12 + 100 triangles, 12 three times and the fullscreen one
+	CHECK(backend.GetTriangleCount() == 12 + 100 + 12 * 3 + 1);
+	CHECK(backend.GetConstantBytes() == 2 * 128 + RenderBackend::PersistentBlockBytes + 4 * RenderBackend::InstanceBytes + 3 * sizeof(unsigned int));
+	CHECK(backend.GetErrorCount() == 0 && backend.GetErrors().empty());
+
+	// Each missing piece on its own
+	CHECK(ErrorsOfDraw(NothingMissing).empty());
+	CHECK(OnlyError(ErrorsOfDraw(NoShader), "DrawIndexed with no vertex shader"));
+	CHECK(OnlyError(ErrorsOfDraw(NoInputLayout), "DrawIndexed with no input layout"));
+	CHECK(OnlyError(ErrorsOfDraw(NoIndexBuffer), "DrawIndexed with no index buffer"));
+
+	// Slots past the limits: reported by the backend, refused by the cache
+	backend.Reset();
+	backend.SetConstants(StateCache::Vertex, NullBackend::MaxConstantBuffers, constants, 16);
+	CHECK(OnlyError(backend.GetErrors(), "Constants in slot 14"));
+	backend.Reset();
+	backend.SetShaderResources(StateCache::Pixel, StateCache::MaxShaderResources, 1, views);
+	CHECK(OnlyError(backend.GetErrors(), "ShaderResources past slot"));
+	backend.Reset();
+	backend.BindPersistentConstants(StateCache::Vertex, 1, 5);
+	CHECK(OnlyError(backend.GetErrors(), "BindPersistent of block 5"));
+
+	bool throws = false;
+	try { state.SetShaderResources(StateCache::Pixel, StateCache::MaxShaderResources, 1, views); }
+	catch (const std::invalid_argument&) { throws = true; }
+	CHECK(throws);
+}
@@ -0,0 +1,212 @@
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+#include "ObjParser.h"
+
+using namespace DirectX;
+
+#ifndef _MSC_VER
+#define sscanf_s sscanf // Same thing when there are only numbers to read
+#endif
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// The original getline/sscanf_s loader from Mesh.cpp, kept as the
+	// reference ObjParser has to match - one vertex per face corner
+	// (no welding), with the tangent zeroed the way ObjParser leaves it
+	bool LoadBaseline(const char* objFilePath, std::vector<Vertex>& verts)
+	{
+		std::ifstream obj(objFilePath);
+		if (!obj.is_open())
+			return false;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		char chars[100];
+
+		while (obj.good())
+		{
+			obj.getline(chars, 100);
+
+			if (chars[0] == 'v' && chars[1] == 'n')
+			{
+				XMFLOAT3 norm;
+				sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+				normals.push_back(norm);
+			}
+			else if (chars[0] == 'v' && chars[1] == 't')
+			{
+				XMFLOAT2 uv;
+				sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+				uvs.push_back(uv);
+			}
+			else if (chars[0] == 'v')
+			{
+				XMFLOAT3 pos;
+				sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+				positions.push_back(pos);
+			}
+			else if (chars[0] == 'f')
+			{
+				unsigned int i[12];
+				int numbersRead = sscanf_s(
+					chars,
+					"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+					&i[0], &i[1], &i[2],
+					&i[3], &i[4], &i[5],
+					&i[6], &i[7], &i[8],
+					&i[9], &i[10], &i[11]);
+
+				// No UVs - re-read as v//vn
+				if (numbersRead == 1)
+				{
+					numbersRead = sscanf_s(
+						chars,
+						"f %d//%d %d//%d %d//%d %d//%d",
+						&i[0], &i[2],
+						&i[3], &i[5],
+						&i[6], &i[8],
+						&i[9], &i[11]);
+					i[1] = 1;
+					i[4] = 1;
+					i[7] = 1;
+					i[10] = 1;
+					if (uvs.size() == 0)
+						uvs.push_back(XMFLOAT2(0, 0));
+				}
+
+				// Flip V, Z and normal Z for our left-handed setup
+				Vertex corners[4] = {};
+				for (int c = 0; c < 4; c++)
+				{
+					if (c == 3 && numbersRead != 12 && numbersRead != 8)
+						break;
+					corners[c].Position = positions[i[c * 3] - 1];
+					corners[c].UV = uvs[i[c * 3 + 1] - 1];
+					corners[c].Normal = normals[i[c * 3 + 2] - 1];
+					corners[c].UV.y = 1.0f - corners[c].UV.y;
+					corners[c].Position.z *= -1.0f;
+					corners[c].Normal.z *= -1.0f;
+				}
+
+				// Flipping the winding order
+				verts.push_back(corners[0]);
+				verts.push_back(corners[2]);
+				verts.push_back(corners[1]);
+				if (numbersRead == 12 || numbersRead == 8)
+				{
+					verts.push_back(corners[0]);
+					verts.push_back(corners[3]);
+					verts.push_back(corners[2]);
+				}
+			}
+		}
+		return true;
+	}
+}
+
+// --------------------------------------------------------
+// The hand-written number parsing: indices past INT_MAX are
+// rejected instead of wrapping, and exponents are read
+// --------------------------------------------------------
+TEST(ObjParserNumbers)
+{
+	int value = 0;
+	const char* number = "2147483647";
+	CHECK(ObjParser::ParseInt(number, number + strlen(number), value) == number + strlen(number) && value == 2147483647);
+	number = "-42/";
+	CHECK(ObjParser::ParseInt(number, number + strlen(number), value) == number + 3 && value == -42);
+	bool throws = false;
+	number = "2147483648";
+	try { ObjParser::ParseInt(number, number + strlen(number), value); }
+	catch (const std::invalid_argument&) { throws = true; }
+	CHECK(throws);
+
+	float decimal = 0.0f;
+	number = "-1.5e2";
+	CHECK(ObjParser::ParseFloat(number, number + strlen(number), decimal) && decimal == -150.0f);
+}
+
+// --------------------------------------------------------
+// Parsing the same generated .obj with 1 to 8 threads has to
+// give exactly the same vertices and indices
+// --------------------------------------------------------
+TEST(ObjParserThreads)
+{
+	// Big enough to be split into several chunks
+	const unsigned int n = 300;
+	std::string obj;
+	char line[128];
+	for (unsigned int y = 0; y <= n; y++)
+		for (unsigned int x = 0; x <= n; x++)
+		{
+			snprintf(line, sizeof(line), "v %f %f %f\n", x * 0.01f, std::sin(x * 0.05f) * std::cos(y * 0.05f), y * 0.01f);
+			obj += line;
+		}
+	for (unsigned int y = 0; y <= n; y++)
+		for (unsigned int x = 0; x <= n; x++)
+		{
+			snprintf(line, sizeof(line), "vt %f %f\n", (float)x / n, (float)y / n);
+			obj += line;
+		}
+	obj += "vn 0 1 0\n";
+	for (unsigned int y = 0; y < n; y++)
+		for (unsigned int x = 0; x < n; x++)
+		{
+			unsigned int i0 = y * (n + 1) + x + 1, i1 = i0 + 1, i2 = i0 + n + 2, i3 = i0 + n + 1;
+			snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", i0, i0, i1, i1, i2, i2, i3, i3);
+			obj += line;
+		}
+
+	std::vector<Vertex> referenceVerts;
+	std::vector<unsigned int> referenceIndices;
+	ObjParser::Parse(obj.data(), obj.data() + obj.size(), referenceVerts, referenceIndices, 1);
+	CHECK(referenceVerts.size() == (size_t)(n + 1) * (n + 1));
+	CHECK(referenceIndices.size() == (size_t)n * n * 6);
+
+	for (unsigned int threads = 2; threads <= 8; threads *= 2)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		ObjParser::Parse(obj.data(), obj.data() + obj.size(), verts, indices, threads);
+		CHECK(indices == referenceIndices);
+		CHECK(verts.size() == referenceVerts.size() &&
+			memcmp(verts.data(), referenceVerts.data(), verts.size() * sizeof(Vertex)) == 0);
+	}
+}
+
+// --------------------------------------------------------
+// Our bundled meshes come out of ObjParser bit-identical to
+// the original loader, once the welded vertices are expanded
+// back out to one per face corner
+// --------------------------------------------------------
+TEST(ObjParserBaseline)
+{
+	const char* meshes[] = { "cube", "cylinder", "helix", "quad", "quad_double_sided", "sphere", "torus" };
+	for (const char* mesh : meshes)
+	{
+		std::string path = std::string(TEST_ASSET_DIR "Meshes/") + mesh + ".ggp_obj";
+		std::vector<Vertex> baseline;
+		CHECK(LoadBaseline(path.c_str(), baseline));
+		CHECK(!baseline.empty());
+
+		std::vector<Vertex> verts, corners;
+		std::vector<unsigned int> indices;
+		CHECK(ObjParser::Load(path.c_str(), verts, indices, 1));
+		for (unsigned int index : indices)
+			corners.push_back(verts[index]);
+		CHECK(verts.size() < corners.size());
+		CHECK(corners.size() == baseline.size() &&
+			memcmp(corners.data(), baseline.data(), corners.size() * sizeof(Vertex)) == 0);
+	}
+}
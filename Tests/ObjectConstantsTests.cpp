@@ -0,0 +1,187 @@
+#include <DirectXMath.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "NullBackend.h"
+#include "ObjectConstants.h"
+#include "InstanceSlots.h"
+#include "InstanceBatcher.h"
+#include "Transform.h"
+#include "BufferStructs.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// A NullBackend that also keeps what's in the persistent blocks and
+	// instance slots, and what's bound to constant slot 1, so each draw
+	// can be checked against the constants it should see
+	class ConstantsCheckBackend : public NullBackend
+	{
+	public:
+		std::vector<std::vector<unsigned char>> blocks;
+		std::vector<unsigned char> bound[StateCache::StageCount];
+		std::vector<unsigned char> instances;
+
+		void SetConstants(StateCache::Stage stage, unsigned int slot, const void* data, unsigned int size) override
+		{
+			NullBackend::SetConstants(stage, slot, data, size);
+			if (slot == 1)
+				bound[stage].assign((const unsigned char*)data, (const unsigned char*)data + size);
+		}
+
+		// Growing empties them, the way recreating the buffer would
+		void ReservePersistentConstants(unsigned int blockCount) override
+		{
+			NullBackend::ReservePersistentConstants(blockCount);
+			if (blockCount > blocks.size())
+				blocks.assign(blockCount, {});
+		}
+
+		void UpdatePersistentConstants(unsigned int block, const void* data, unsigned int size) override
+		{
+			NullBackend::UpdatePersistentConstants(block, data, size);
+			if (block < blocks.size())
+				blocks[block].assign((const unsigned char*)data, (const unsigned char*)data + size);
+		}
+
+		void BindPersistentConstants(StateCache::Stage stage, unsigned int slot, unsigned int block) override
+		{
+			NullBackend::BindPersistentConstants(stage, slot, block);
+			if (slot == 1 && block < blocks.size())
+				bound[stage] = blocks[block];
+		}
+
+		bool BoundMatches(StateCache::Stage stage, const void* expected, unsigned int size) const
+		{
+			return bound[stage].size() == size && memcmp(bound[stage].data(), expected, size) == 0;
+		}
+
+		void ReserveInstances(unsigned int slotCount) override
+		{
+			NullBackend::ReserveInstances(slotCount);
+			if ((size_t)slotCount * InstanceBytes > instances.size())
+				instances.assign((size_t)slotCount * InstanceBytes, 0);
+		}
+
+		void UpdateInstances(unsigned int firstSlot, unsigned int count, const void* data) override
+		{
+			NullBackend::UpdateInstances(firstSlot, count, data);
+			if ((size_t)(firstSlot + count) * InstanceBytes <= instances.size())
+				memcpy(&instances[(size_t)firstSlot * InstanceBytes], data, (size_t)count * InstanceBytes);
+		}
+
+		bool InstanceMatches(unsigned int slot, const void* expected) const
+		{
+			return (size_t)(slot + 1) * InstanceBytes <= instances.size() && memcmp(&instances[(size_t)slot * InstanceBytes], expected, InstanceBytes) == 0;
+		}
+	};
+}
+
+// --------------------------------------------------------
+// Frames of entities with none, 1%, 10% or all of them moving,
+// each draw's b1 constants (and each instance slot) checked
+// against what it should see - including a material edit and
+// an entity that moves once and stops - and by the last frame
+// only the moving entities may still be uploaded
+// --------------------------------------------------------
+TEST(ObjectConstants)
+{
+	const unsigned int entityCount = 2000, materialCount = 8;
+	struct FakeMaterial { XMFLOAT4 tint; unsigned int version; };
+	std::mt19937 rng(25);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	const int frames = 40, materialEditFrame = 20, moveOnceFrame = 25;
+	const float dynamicFractions[] = { 0.0f, 0.01f, 0.1f, 1.0f };
+	for (float fraction : dynamicFractions)
+	{
+		std::vector<Transform> transforms(entityCount);
+		std::vector<unsigned int> materialOf(entityCount);
+		for (unsigned int i = 0; i < entityCount; i++)
+		{
+			transforms[i].SetPosition(position(rng), position(rng), position(rng));
+			transforms[i].SetRotation(unit(rng), unit(rng), unit(rng));
+			materialOf[i] = i % materialCount;
+		}
+		FakeMaterial materials[materialCount];
+		for (FakeMaterial& material : materials)
+			material = { XMFLOAT4(unit(rng), unit(rng), unit(rng), 1.0f), 0 };
+		unsigned int dynamicCount = (unsigned int)(entityCount * fraction);
+
+		ConstantsCheckBackend backend, instancedBackend;
+		ObjectConstants objects;
+		InstanceSlots slots;
+		std::vector<unsigned int> order(entityCount);
+		for (unsigned int i = 0; i < entityCount; i++)
+			order[i] = i;
+		unsigned int mismatches = 0, errors = 0;
+		unsigned long long lastFrameBytes = 0, lastInstancedBytes = 0;
+		for (int f = 0; f < frames; f++)
+		{
+			for (unsigned int i = 0; i < dynamicCount; i++)
+				transforms[i].MoveAbsolute(0.01f, 0.0f, 0.0f);
+			if (f == materialEditFrame)
+			{
+				materials[0].tint.x = 1.0f - materials[0].tint.x;
+				materials[0].version++;
+			}
+			if (f == moveOnceFrame)
+				transforms[entityCount - 1].MoveAbsolute(0.0f, 1.0f, 0.0f);
+
+			// What Game::SetObjectVertexData() / SetObjectPixelData() do
+			backend.Reset();
+			objects.BeginFrame(&backend);
+			for (unsigned int i = 0; i < entityCount; i++)
+			{
+				ObjectVertexData vsData = {};
+				vsData.world = transforms[i].GetWorldMatrix();
+				vsData.worldInv = transforms[i].GetWorldInverseTransposeMatrix();
+				ObjectPixelData psData = {};
+				psData.colourTint = materials[materialOf[i]].tint;
+				psData.scale = XMFLOAT2(1, 1);
+				if (!objects.Bind(i, StateCache::Vertex, transforms[i].GetVersion(), 1))
+					objects.Upload(i, StateCache::Vertex, 1, &vsData, sizeof(vsData));
+				if (!objects.Bind(i, StateCache::Pixel, materials[materialOf[i]].version, 1))
+					objects.Upload(i, StateCache::Pixel, 1, &psData, sizeof(psData));
+				mismatches += !backend.BoundMatches(StateCache::Vertex, &vsData, sizeof(vsData));
+				mismatches += !backend.BoundMatches(StateCache::Pixel, &psData, sizeof(psData));
+			}
+			lastFrameBytes = backend.GetConstantBytes();
+			errors += backend.GetErrorCount();
+
+			// What Game::UploadInstances() does, for a pass drawing everything
+			instancedBackend.Reset();
+			slots.BeginFrame(&instancedBackend, entityCount);
+			for (unsigned int i = 0; i < entityCount; i++)
+			{
+				if (slots.IsCurrent(i, transforms[i].GetVersion()))
+					continue;
+				InstanceBatcher::Instance instance = { transforms[i].GetWorldMatrix(), transforms[i].GetWorldInverseTransposeMatrix() };
+				slots.Write(i, &instance);
+			}
+			slots.Submit(order);
+			for (unsigned int i = 0; i < entityCount; i++)
+			{
+				InstanceBatcher::Instance instance = { transforms[i].GetWorldMatrix(), transforms[i].GetWorldInverseTransposeMatrix() };
+				mismatches += !instancedBackend.InstanceMatches(i, &instance);
+			}
+			lastInstancedBytes = instancedBackend.GetConstantBytes();
+			errors += instancedBackend.GetErrorCount();
+		}
+
+		CHECK(mismatches == 0);
+		CHECK(errors == 0);
+
+		// By the last frame the material edit and the one-off move have
+		// settled, so only the moving entities' vertex constants go up
+		// (and their instances, with the draw order, instanced)
+		CHECK(lastFrameBytes == (unsigned long long)dynamicCount * sizeof(ObjectVertexData));
+		CHECK(lastInstancedBytes == (unsigned long long)dynamicCount * sizeof(InstanceBatcher::Instance) + entityCount * sizeof(unsigned int));
+	}
+}
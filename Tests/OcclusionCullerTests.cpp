@@ -0,0 +1,148 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "Bounds.h"
+#include "OcclusionCuller.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Random boxes drawn both into the occlusion buffer and into
+// a plain per-pixel depth buffer - the occlusion buffer must
+// never be nearer than the real depth, and must never cull a
+// box that isn't hidden in the real one
+// --------------------------------------------------------
+TEST(OcclusionCuller)
+{
+	const int width = OcclusionCuller::Width;
+	const int height = OcclusionCuller::Height;
+	std::vector<XMFLOAT3> boxPositions;
+	std::vector<unsigned int> boxIndices;
+	TestMeshes::Box(boxPositions, boxIndices);
+
+	std::mt19937 rng(16);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto range = [&](float low, float high) { return low + (high - low) * unit(rng); };
+
+	// Camera at the origin looking down +z, so everything below is in front of it
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)) *
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)width / height, 0.5f, 200.0f));
+	XMMATRIX viewProjMatrix = XMLoadFloat4x4(&viewProj);
+	auto toScreen = [&](XMVECTOR world)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(world, viewProjMatrix));
+		return XMFLOAT3((clip.x / clip.w * 0.5f + 0.5f) * width, (0.5f - clip.y / clip.w * 0.5f) * height, clip.z / clip.w);
+	};
+
+	OcclusionCuller culler;
+	std::vector<float> reference(width * height);
+	const int scenes = 20, occludersPerScene = 30, boxesPerScene = 200;
+	size_t nearerPixels = 0, wronglyCulled = 0, culled = 0, cullDisagrees = 0;
+	for (int scene = 0; scene < scenes; scene++)
+	{
+		culler.Begin(viewProj);
+		std::fill(reference.begin(), reference.end(), 1.0f);
+
+		for (int o = 0; o < occludersPerScene; o++)
+		{
+			XMMATRIX world = XMMatrixScaling(range(0.5f, 6.0f), range(0.5f, 6.0f), range(0.5f, 6.0f)) *
+				XMMatrixRotationRollPitchYaw(range(0, XM_2PI), range(0, XM_2PI), range(0, XM_2PI)) *
+				XMMatrixTranslation(range(-15.0f, 15.0f), range(-8.0f, 8.0f), range(8.0f, 40.0f));
+			XMFLOAT4X4 worldFloats;
+			XMStoreFloat4x4(&worldFloats, world);
+			culler.AddOccluder(boxPositions.data(), boxPositions.size(), boxIndices.data(), boxIndices.size(), worldFloats);
+
+			// Brute force: every pixel center inside every front-facing triangle
+			for (size_t i = 0; i < boxIndices.size(); i += 3)
+			{
+				XMFLOAT3 s[3];
+				for (int k = 0; k < 3; k++)
+					s[k] = toScreen(XMVector3Transform(XMLoadFloat3(&boxPositions[boxIndices[i + k]]), world));
+				double area = (double)(s[1].x - s[0].x) * (s[2].y - s[0].y) - (double)(s[1].y - s[0].y) * (s[2].x - s[0].x);
+				if (area <= 0.0)
+					continue;
+
+				int x0 = std::max(0, (int)std::floor(std::min({ s[0].x, s[1].x, s[2].x })));
+				int x1 = std::min(width - 1, (int)std::ceil(std::max({ s[0].x, s[1].x, s[2].x })));
+				int y0 = std::max(0, (int)std::floor(std::min({ s[0].y, s[1].y, s[2].y })));
+				int y1 = std::min(height - 1, (int)std::ceil(std::max({ s[0].y, s[1].y, s[2].y })));
+				for (int y = y0; y <= y1; y++)
+				{
+					for (int x = x0; x <= x1; x++)
+					{
+						double px = x + 0.5, py = y + 0.5;
+						double w[3];
+						for (int k = 0; k < 3; k++)
+						{
+							const XMFLOAT3& a = s[(k + 1) % 3];
+							const XMFLOAT3& b = s[(k + 2) % 3];
+							w[k] = ((double)b.x - a.x) * (py - a.y) - ((double)b.y - a.y) * (px - a.x);
+						}
+						if (w[0] < 0.0 || w[1] < 0.0 || w[2] < 0.0)
+							continue;
+						float depth = (float)((w[0] * s[0].z + w[1] * s[1].z + w[2] * s[2].z) / area);
+						reference[y * width + x] = std::min(reference[y * width + x], depth);
+					}
+				}
+			}
+		}
+		culler.Rasterize();
+
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+				nearerPixels += culler.GetDepth(x, y) < reference[y * width + x] - 1e-5f;
+
+		std::vector<Bounds::Box> boxes;
+		std::vector<unsigned int> visible;
+		for (int b = 0; b < boxesPerScene; b++)
+		{
+			XMFLOAT3 center(range(-30.0f, 30.0f), range(-15.0f, 15.0f), range(10.0f, 120.0f));
+			float size = range(0.1f, 1.5f);
+			Bounds::Box box = { XMFLOAT3(center.x - size, center.y - size, center.z - size), XMFLOAT3(center.x + size, center.y + size, center.z + size) };
+
+			// Hidden for real if every pixel it touches has something nearer
+			float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+			for (int c = 0; c < 8; c++)
+			{
+				XMFLOAT3 s = toScreen(XMVectorSet((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z, 1));
+				minX = std::min(minX, s.x); maxX = std::max(maxX, s.x);
+				minY = std::min(minY, s.y); maxY = std::max(maxY, s.y);
+				minZ = std::min(minZ, s.z);
+			}
+			if (maxX < 0.0f || minX >= width || maxY < 0.0f || minY >= height)
+				continue;
+
+			bool hidden = true;
+			for (int y = std::max(0, (int)std::floor(minY)); y <= std::min(height - 1, (int)std::floor(maxY)) && hidden; y++)
+				for (int x = std::max(0, (int)std::floor(minX)); x <= std::min(width - 1, (int)std::floor(maxX)) && hidden; x++)
+					hidden = reference[y * width + x] < minZ;
+
+			bool isVisible = culler.IsVisible(box);
+			culled += !isVisible;
+			wronglyCulled += !isVisible && !hidden;
+			if (isVisible)
+				visible.push_back((unsigned int)boxes.size());
+			boxes.push_back(box);
+		}
+
+		// Cull() over the whole list has to keep exactly what IsVisible() does
+		std::vector<unsigned int> candidates(boxes.size());
+		for (unsigned int b = 0; b < candidates.size(); b++)
+			candidates[b] = b;
+		culler.Cull(boxes.data(), candidates);
+		cullDisagrees += candidates != visible;
+	}
+
+	CHECK(nearerPixels == 0);
+	CHECK(wronglyCulled == 0);
+	CHECK(cullDisagrees == 0);
+	CHECK(culled > 0); // Or the scenes aren't testing anything
+}
@@ -0,0 +1,49 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "RenderQueue.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Keys give back what went into them and order passes, shaders
+// and depth the right way, and the radix sort gives exactly
+// what std::stable_sort does
+// --------------------------------------------------------
+TEST(RenderQueue)
+{
+	const unsigned int shaderCount = 16, materialCount = 256, meshCount = 1000, itemCount = 100000;
+	std::mt19937 rng(17);
+	std::uniform_int_distribution<unsigned int> randomMaterial(0, materialCount - 1);
+	std::uniform_int_distribution<unsigned int> randomMesh(0, meshCount - 1);
+	std::uniform_real_distribution<float> randomDepth(0.0f, 1.0f);
+
+	RenderQueue queue;
+	std::vector<RenderQueue::Item> expected(itemCount);
+	bool roundTrip = true;
+	for (unsigned int i = 0; i < itemCount; i++)
+	{
+		unsigned int material = randomMaterial(rng), shader = material % shaderCount, mesh = randomMesh(rng);
+		uint64_t key = RenderQueue::MakeKey(RenderQueue::Opaque, shader, material, mesh, randomDepth(rng));
+		roundTrip = roundTrip && RenderQueue::GetPass(key) == RenderQueue::Opaque && RenderQueue::GetShader(key) == shader &&
+			RenderQueue::GetMaterial(key) == material && RenderQueue::GetMesh(key) == mesh;
+		queue.Add(key, i);
+		expected[i] = { key, i };
+	}
+	CHECK(roundTrip);
+	CHECK(RenderQueue::MakeKey(RenderQueue::Opaque, 0, 0, 0, 0.25f) < RenderQueue::MakeKey(RenderQueue::Opaque, 0, 0, 0, 0.5f));
+	CHECK(RenderQueue::MakeKey(RenderQueue::Transparent, 0, 0, 0, 0.25f) > RenderQueue::MakeKey(RenderQueue::Transparent, 0, 0, 0, 0.5f));
+	CHECK(RenderQueue::MakeKey(RenderQueue::Opaque, 1, 0, 0, 0.0f) > RenderQueue::MakeKey(RenderQueue::Opaque, 0, 4095, 9999, 1.0f));
+
+	queue.Sort();
+	std::stable_sort(expected.begin(), expected.end(),
+		[](const RenderQueue::Item& a, const RenderQueue::Item& b) { return a.key < b.key; });
+	bool matches = queue.Count() == itemCount;
+	for (unsigned int i = 0; i < itemCount && matches; i++)
+		matches = queue.Items()[i].key == expected[i].key && queue.Items()[i].index == expected[i].index;
+	CHECK(matches);
+}
@@ -0,0 +1,111 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "Bounds.h"
+#include "FrustumCuller.h"
+#include "SceneIndex.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Random inserts, removes and moves, with every kind of query
+// compared now and then to testing each live object's fat box
+// --------------------------------------------------------
+TEST(SceneIndex)
+{
+	std::mt19937 rng(2024);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 5.0f);
+	auto randomBox = [&]()
+	{
+		XMFLOAT3 c(position(rng), position(rng), position(rng));
+		float s = size(rng);
+		return Bounds::Box{ XMFLOAT3(c.x - s, c.y - s, c.z - s), XMFLOAT3(c.x + s, c.y + s, c.z + s) };
+	};
+
+	SceneIndex index(0.5f);
+	std::vector<int> liveProxies;
+	std::vector<unsigned int> liveData;
+	unsigned int nextData = 0;
+
+	std::vector<unsigned int> found, expected;
+	auto sameObjects = [&]()
+	{
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		bool same = found == expected;
+		found.clear();
+		expected.clear();
+		return same;
+	};
+
+	for (int step = 0; step < 20000; step++)
+	{
+		// 40% insert, 20% remove, 40% move (small or large)
+		unsigned int op = rng() % 10;
+		if (op < 4 || liveProxies.empty())
+		{
+			liveProxies.push_back(index.Insert(randomBox(), nextData));
+			liveData.push_back(nextData++);
+		}
+		else if (op < 6)
+		{
+			size_t i = rng() % liveProxies.size();
+			index.Remove(liveProxies[i]);
+			liveProxies[i] = liveProxies.back(); liveProxies.pop_back();
+			liveData[i] = liveData.back(); liveData.pop_back();
+		}
+		else
+		{
+			size_t i = rng() % liveProxies.size();
+			Bounds::Box box = index.GetFatBox(liveProxies[i]);
+			float move = op < 8 ? 0.3f : 30.0f;
+			float dx = position(rng) / 100.0f * move;
+			box.min = XMFLOAT3(box.min.x + 0.5f + dx, box.min.y + 0.5f, box.min.z + 0.5f);
+			box.max = XMFLOAT3(box.max.x - 0.5f + dx, box.max.y - 0.5f, box.max.z - 0.5f);
+			index.Update(liveProxies[i], box);
+		}
+
+		if (step % 200 != 0)
+			continue;
+		CHECK(index.GetCount() == (int)liveProxies.size());
+
+		Bounds::Box queryBox = randomBox();
+		index.QueryBox(queryBox, found);
+		for (size_t i = 0; i < liveProxies.size(); i++)
+			if (Bounds::Overlaps(index.GetFatBox(liveProxies[i]), queryBox)) expected.push_back(liveData[i]);
+		CHECK(sameObjects());
+
+		Bounds::Sphere querySphere = { XMFLOAT3(position(rng), position(rng), position(rng)), size(rng) * 5.0f };
+		index.QuerySphere(querySphere, found);
+		for (size_t i = 0; i < liveProxies.size(); i++)
+			if (Bounds::Overlaps(index.GetFatBox(liveProxies[i]), querySphere)) expected.push_back(liveData[i]);
+		CHECK(sameObjects());
+
+		XMFLOAT4X4 view, proj;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(position(rng), position(rng), position(rng), 0),
+			XMVectorSet(position(rng), position(rng), 1.0f, 0), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(1.0f, 1.5f, 0.1f, 80.0f));
+		FrustumCuller::Frustum frustum = FrustumCuller::FromCamera(view, proj);
+		index.QueryFrustum(frustum, found);
+		for (size_t i = 0; i < liveProxies.size(); i++)
+			if (FrustumCuller::ClassifyBox(frustum, index.GetFatBox(liveProxies[i])) != FrustumCuller::Outside) expected.push_back(liveData[i]);
+		CHECK(sameObjects());
+
+		XMFLOAT3 origin(position(rng), position(rng), position(rng));
+		XMFLOAT3 direction(position(rng), position(rng), position(rng));
+		std::vector<SceneIndex::RayHit> hits;
+		index.QueryRay(origin, direction, 1.0f, hits);
+		for (const SceneIndex::RayHit& hit : hits)
+			found.push_back(hit.userData);
+		for (size_t i = 0; i < liveProxies.size(); i++)
+		{
+			float distance;
+			if (Bounds::RayIntersects(index.GetFatBox(liveProxies[i]), origin, direction, 1.0f, distance)) expected.push_back(liveData[i]);
+		}
+		CHECK(sameObjects());
+	}
+}
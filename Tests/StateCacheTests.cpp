@@ -0,0 +1,204 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "Test.h"
+#include "StateCache.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Stands in for a D3D11 object - only ever compared, never used
+	template<typename T>
+	T* FakeObject(unsigned int id)
+	{
+		return reinterpret_cast<T*>((uintptr_t)(id + 1) * 64);
+	}
+
+	// What a context would have bound after the calls a StateCache
+	// sends it (or, written to directly, after every call a naive
+	// renderer would make), plus how many calls of each kind
+	struct MockContext : public StateCache::Target
+	{
+		ID3D11VertexShader* vertexShader = 0;
+		ID3D11PixelShader* pixelShader = 0;
+		ID3D11InputLayout* inputLayout = 0;
+		ID3D11RasterizerState* rasterizerState = 0;
+		ID3D11Buffer* indexBuffer = 0;
+		unsigned int indexFormat = 0, indexOffset = 0;
+		ID3D11Buffer* vertexBuffers[StateCache::MaxVertexBuffers] = {};
+		unsigned int strides[StateCache::MaxVertexBuffers] = {};
+		unsigned int offsets[StateCache::MaxVertexBuffers] = {};
+		ID3D11ShaderResourceView* views[StateCache::StageCount][StateCache::MaxShaderResources] = {};
+		ID3D11SamplerState* samplers[StateCache::StageCount][StateCache::MaxSamplers] = {};
+
+		unsigned int calls = 0, resourceCalls = 0;
+
+		void SetVertexShader(ID3D11VertexShader* shader) override { vertexShader = shader; calls++; }
+		void SetPixelShader(ID3D11PixelShader* shader) override { pixelShader = shader; calls++; }
+		void SetInputLayout(ID3D11InputLayout* layout) override { inputLayout = layout; calls++; }
+		void SetRasterizerState(ID3D11RasterizerState* state) override { rasterizerState = state; calls++; }
+
+		void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) override
+		{
+			indexBuffer = buffer;
+			indexFormat = format;
+			indexOffset = offset;
+			calls++;
+		}
+
+		void SetVertexBuffers(unsigned int start, unsigned int count, ID3D11Buffer* const* buffers, const unsigned int* newStrides, const unsigned int* newOffsets) override
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				vertexBuffers[start + i] = buffers[i];
+				strides[start + i] = newStrides[i];
+				offsets[start + i] = newOffsets[i];
+			}
+			calls++;
+		}
+
+		void SetShaderResources(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11ShaderResourceView* const* newViews) override
+		{
+			for (unsigned int i = 0; i < count; i++)
+				views[stage][start + i] = newViews[i];
+			calls++;
+			resourceCalls++;
+		}
+
+		void SetSamplers(StateCache::Stage stage, unsigned int start, unsigned int count, ID3D11SamplerState* const* newSamplers) override
+		{
+			for (unsigned int i = 0; i < count; i++)
+				samplers[stage][start + i] = newSamplers[i];
+			calls++;
+			resourceCalls++;
+		}
+
+		bool SameBindings(const MockContext& other) const
+		{
+			return vertexShader == other.vertexShader && pixelShader == other.pixelShader &&
+				inputLayout == other.inputLayout && rasterizerState == other.rasterizerState &&
+				indexBuffer == other.indexBuffer && indexFormat == other.indexFormat && indexOffset == other.indexOffset &&
+				memcmp(vertexBuffers, other.vertexBuffers, sizeof(vertexBuffers)) == 0 &&
+				memcmp(strides, other.strides, sizeof(strides)) == 0 &&
+				memcmp(offsets, other.offsets, sizeof(offsets)) == 0 &&
+				memcmp(views, other.views, sizeof(views)) == 0 &&
+				memcmp(samplers, other.samplers, sizeof(samplers)) == 0;
+		}
+	};
+}
+
+// --------------------------------------------------------
+// A frame's worth of draws bound the way Game, Entity, Material
+// and Mesh bind them, once through a StateCache and once straight
+// to a second mock context - both have to have the same bindings
+// before every draw, with the cache making fewer calls
+// --------------------------------------------------------
+TEST(StateCache)
+{
+	const unsigned int materialCount = 24, meshCount = 40, textureCount = 5, samplerCount = 2, drawCount = 20000;
+	std::mt19937 rng(19);
+	std::uniform_int_distribution<unsigned int> randomMaterial(0, materialCount - 1);
+	std::uniform_int_distribution<unsigned int> randomMesh(0, meshCount - 1);
+	std::uniform_int_distribution<unsigned int> randomPercent(0, 99);
+
+	// Entities sorted loosely, like the render queue leaves them
+	struct Draw { unsigned int material, mesh; bool packed; };
+	std::vector<Draw> draws(drawCount);
+	for (Draw& draw : draws)
+	{
+		draw.material = randomMaterial(rng);
+		draw.mesh = randomMesh(rng);
+		draw.packed = randomPercent(rng) < 10;
+	}
+	std::sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) { return a.material / 4 < b.material / 4; });
+
+	MockContext cached, expected;
+	StateCache cache;
+	cache.SetTarget(&cached);
+
+	bool matches = true;
+	unsigned int requests = 0;
+	for (unsigned int d = 0; d < drawCount; d++)
+	{
+		// Something else clobbering the context now and then (like
+		// ImGui would) - the cache is told, and has to recover
+		if (d % 1000 == 999)
+		{
+			cached.vertexShader = 0;
+			cached.views[StateCache::Pixel][0] = 0;
+			cached.vertexBuffers[0] = 0;
+			cache.Invalidate();
+		}
+
+		const Draw& draw = draws[d];
+		unsigned int shader = draw.material % 3;
+		ID3D11InputLayout* layout = FakeObject<ID3D11InputLayout>(draw.packed ? 1 : 0);
+		ID3D11VertexShader* vertexShader = FakeObject<ID3D11VertexShader>(draw.packed ? 10 : shader);
+		ID3D11PixelShader* pixelShader = FakeObject<ID3D11PixelShader>(shader);
+		ID3D11Buffer* vertexBuffer = FakeObject<ID3D11Buffer>(draw.mesh * 2 + draw.packed);
+		ID3D11Buffer* indexBuffer = FakeObject<ID3D11Buffer>(1000 + draw.mesh);
+		unsigned int stride = draw.packed ? 16 : 44, offset = 0;
+
+		cache.SetInputLayout(layout);
+		cache.SetRasterizerState(0);
+		cache.SetVertexShader(vertexShader);
+		cache.SetPixelShader(pixelShader);
+		expected.SetInputLayout(layout);
+		expected.SetRasterizerState(0);
+		expected.SetVertexShader(vertexShader);
+		expected.SetPixelShader(pixelShader);
+		for (unsigned int t = 0; t < textureCount; t++)
+		{
+			// The last slot is the shadow map, the same for everyone
+			ID3D11ShaderResourceView* view = FakeObject<ID3D11ShaderResourceView>(t == textureCount - 1 ? 0 : 1 + draw.material * textureCount + t);
+			cache.SetShaderResources(StateCache::Pixel, t, 1, &view);
+			expected.SetShaderResources(StateCache::Pixel, t, 1, &view);
+		}
+		for (unsigned int t = 0; t < samplerCount; t++)
+		{
+			ID3D11SamplerState* sampler = FakeObject<ID3D11SamplerState>(t);
+			cache.SetSamplers(StateCache::Pixel, t, 1, &sampler);
+			expected.SetSamplers(StateCache::Pixel, t, 1, &sampler);
+		}
+		cache.SetVertexBuffer(0, vertexBuffer, stride, offset);
+		cache.SetIndexBuffer(indexBuffer, 42, 0);
+		expected.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		expected.SetIndexBuffer(indexBuffer, 42, 0);
+		cache.Flush();
+		requests += 6 + textureCount + samplerCount;
+
+		matches = matches && cached.SameBindings(expected);
+	}
+	CHECK(matches);
+
+	StateCache::Stats stats = cache.GetStats();
+	CHECK(stats.requested == requests);
+	CHECK(stats.submitted == cached.calls);
+	CHECK(cached.calls < expected.calls);
+
+	// A contiguous range set one slot at a time has to go out as one call
+	MockContext coalesced;
+	StateCache rangeCache;
+	rangeCache.SetTarget(&coalesced);
+	for (unsigned int t = 0; t < 8; t++)
+	{
+		ID3D11ShaderResourceView* view = FakeObject<ID3D11ShaderResourceView>(t);
+		rangeCache.SetShaderResources(StateCache::Vertex, t, 1, &view);
+	}
+	rangeCache.Flush();
+	CHECK(coalesced.resourceCalls == 1);
+	CHECK(coalesced.views[StateCache::Vertex][7] == FakeObject<ID3D11ShaderResourceView>(7));
+
+	bool throws = false;
+	try { rangeCache.SetSamplers(StateCache::Pixel, StateCache::MaxSamplers - 1, 2, 0); }
+	catch (const std::invalid_argument&) { throws = true; }
+	CHECK(throws);
+}
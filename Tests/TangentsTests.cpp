@@ -0,0 +1,46 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "Jobs.h"
+#include "Tangents.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The SIMD, multithreaded tangents match the original
+// one-triangle-at-a-time version at every thread count
+// --------------------------------------------------------
+TEST(Tangents)
+{
+	const unsigned int n = 300;
+	std::vector<Vertex> source = TestMeshes::BumpyGrid(n);
+	std::vector<unsigned int> indices = TestMeshes::GridIndices(n);
+	int vertexCount = (int)source.size();
+	int indexCount = (int)indices.size();
+
+	std::vector<Vertex> reference = source;
+	Tangents::CalculateReference(reference.data(), vertexCount, indices.data(), indexCount);
+
+	unsigned int maxThreads = Jobs::ThreadCount();
+	for (unsigned int threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads)
+	{
+		std::vector<Vertex> verts = source;
+		Tangents::Calculate(verts.data(), vertexCount, indices.data(), indexCount, threads);
+
+		float maxError = 0;
+		for (int i = 0; i < vertexCount; i++)
+		{
+			maxError = std::max(maxError, std::fabs(verts[i].Tangent.x - reference[i].Tangent.x));
+			maxError = std::max(maxError, std::fabs(verts[i].Tangent.y - reference[i].Tangent.y));
+			maxError = std::max(maxError, std::fabs(verts[i].Tangent.z - reference[i].Tangent.z));
+		}
+		CHECK(maxError < 1e-4f);
+
+		if (threads >= maxThreads)
+			break;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of a test framework for the CPU-only modules
+//
+// - TEST(Name) { ... } defines a test and registers it, so
+//    Main.cpp can run it by name (CMakeLists.txt lists each
+//    name for ctest)
+// - CHECK(condition) reports the file, line and condition
+//    when it's false and carries on, so one run shows every
+//    check that fails, not just the first
+// --------------------------------------------------------
+namespace Tests
+{
+	struct Test
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	std::vector<Test>& All();
+	void Fail(const char* file, int line, const char* condition);
+
+	struct Registrar
+	{
+		Registrar(const char* name, void (*run)()) { All().push_back({ name, run }); }
+	};
+}
+
+#define TEST(name) \
+	static void Test##name(); \
+	static Tests::Registrar Register##name(#name, Test##name); \
+	static void Test##name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) Tests::Fail(__FILE__, __LINE__, #condition); } while (0)
@@ -0,0 +1,148 @@
+#include "TestMeshes.h"
+#include <cmath>
+#include <utility>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Two triangles per quad of a (columns + 1) wide vertex grid
+	void AddQuads(unsigned int rows, unsigned int columns, std::vector<unsigned int>& indices)
+	{
+		indices.reserve(indices.size() + (size_t)rows * columns * 6);
+		for (unsigned int y = 0; y < rows; y++)
+		{
+			for (unsigned int x = 0; x < columns; x++)
+			{
+				unsigned int i0 = y * (columns + 1) + x;
+				unsigned int i1 = i0 + 1;
+				unsigned int i2 = i0 + columns + 2;
+				unsigned int i3 = i0 + columns + 1;
+				unsigned int quad[6] = { i0, i1, i2, i0, i2, i3 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+}
+
+std::vector<unsigned int> TestMeshes::GridIndices(unsigned int n)
+{
+	std::vector<unsigned int> indices;
+	AddQuads(n, n, indices);
+	return indices;
+}
+
+std::vector<Vertex> TestMeshes::BumpyGrid(unsigned int n)
+{
+	std::vector<Vertex> verts((size_t)(n + 1) * (n + 1));
+	for (unsigned int y = 0; y <= n; y++)
+	{
+		for (unsigned int x = 0; x <= n; x++)
+		{
+			Vertex& v = verts[(size_t)y * (n + 1) + x];
+			v.Position = XMFLOAT3(x * 0.01f, std::sin(x * 0.05f) * std::cos(y * 0.05f), y * 0.01f);
+			v.UV = XMFLOAT2((float)x / n, (float)y / n);
+			v.Normal = XMFLOAT3(0, 1, 0);
+			v.Tangent = XMFLOAT3(0, 0, 0);
+		}
+	}
+	return verts;
+}
+
+void TestMeshes::Sphere(unsigned int rings, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	unsigned int segments = rings * 2;
+	verts.clear();
+	indices.clear();
+	verts.reserve((size_t)(rings + 1) * (segments + 1));
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		float phi = XM_PI * r / rings;
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float theta = XM_2PI * s / segments;
+			Vertex v = {};
+			v.Normal = XMFLOAT3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+			v.Position = v.Normal;
+			v.UV = XMFLOAT2((float)s / segments, (float)r / rings);
+			verts.push_back(v);
+		}
+	}
+	AddQuads(rings, segments, indices);
+}
+
+void TestMeshes::Torus(unsigned int rings, unsigned int sides, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	const float major = 1.0f, minor = 0.3f;
+	verts.clear();
+	indices.clear();
+	verts.reserve((size_t)(rings + 1) * (sides + 1));
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		float theta = XM_2PI * r / rings;
+		for (unsigned int s = 0; s <= sides; s++)
+		{
+			float phi = XM_2PI * s / sides;
+			XMFLOAT3 around(std::cos(theta), 0.0f, std::sin(theta));
+			Vertex v = {};
+			v.Normal = XMFLOAT3(around.x * std::cos(phi), std::sin(phi), around.z * std::cos(phi));
+			v.Position = XMFLOAT3(around.x * major + v.Normal.x * minor, v.Normal.y * minor, around.z * major + v.Normal.z * minor);
+			v.UV = XMFLOAT2((float)r / rings, (float)s / sides);
+			verts.push_back(v);
+		}
+	}
+	AddQuads(rings, sides, indices);
+}
+
+void TestMeshes::Helix(unsigned int segments, unsigned int sides, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	const float radius = 1.0f, tube = 0.2f, rise = 0.6f, turns = 3.0f;
+	verts.clear();
+	indices.clear();
+	verts.reserve((size_t)(segments + 1) * (sides + 1));
+	for (unsigned int r = 0; r <= segments; r++)
+	{
+		// Same rings as the torus, each lifted a little higher
+		float theta = XM_2PI * turns * r / segments;
+		float height = rise * turns * r / segments;
+		for (unsigned int s = 0; s <= sides; s++)
+		{
+			float phi = XM_2PI * s / sides;
+			XMFLOAT3 around(std::cos(theta), 0.0f, std::sin(theta));
+			Vertex v = {};
+			v.Normal = XMFLOAT3(around.x * std::cos(phi), std::sin(phi), around.z * std::cos(phi));
+			v.Position = XMFLOAT3(around.x * radius + v.Normal.x * tube, height + v.Normal.y * tube, around.z * radius + v.Normal.z * tube);
+			v.UV = XMFLOAT2((float)r / segments, (float)s / sides);
+			verts.push_back(v);
+		}
+	}
+	AddQuads(segments, sides, indices);
+}
+
+void TestMeshes::Box(std::vector<XMFLOAT3>& positions, std::vector<unsigned int>& indices)
+{
+	positions.clear();
+	indices.clear();
+	for (int c = 0; c < 8; c++)
+		positions.push_back(XMFLOAT3((c & 1) ? 0.5f : -0.5f, (c & 2) ? 0.5f : -0.5f, (c & 4) ? 0.5f : -0.5f));
+
+	// Each face's corners, in order around it, flipped where
+	// needed so cross(p1 - p0, p2 - p0) points out of the box
+	const unsigned int faces[6][4] = { { 0, 2, 6, 4 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 5, 7, 6 } };
+	for (const auto& face : faces)
+	{
+		unsigned int triangles[2][3] = { { face[0], face[1], face[2] }, { face[0], face[2], face[3] } };
+		for (auto& triangle : triangles)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&positions[triangle[0]]);
+			XMVECTOR normal = XMVector3Cross(
+				XMVectorSubtract(XMLoadFloat3(&positions[triangle[1]]), p0),
+				XMVectorSubtract(XMLoadFloat3(&positions[triangle[2]]), p0));
+			if (XMVectorGetX(XMVector3Dot(normal, p0)) < 0.0f)
+				std::swap(triangle[1], triangle[2]);
+			indices.insert(indices.end(), triangle, triangle + 3);
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Generated meshes for the tests, so none of them need the
+// asset files
+//
+// - Everything is wound clockwise seen from outside, like
+//    the meshes ObjParser gives us
+// --------------------------------------------------------
+namespace TestMeshes
+{
+	// Row-order indices of an n x n grid of quads over
+	// (n + 1) x (n + 1) vertices
+	std::vector<unsigned int> GridIndices(unsigned int n);
+
+	// A bumpy grid with UVs, so tangents aren't all the same
+	std::vector<Vertex> BumpyGrid(unsigned int n);
+
+	// UV sphere of radius 1, rings x (2 * rings) quads
+	void Sphere(unsigned int rings, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Torus around y, major radius 1, minor radius 0.3
+	void Torus(unsigned int rings, unsigned int sides, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Tube of radius 0.2 winding three times around y at radius 1,
+	// rising 0.6 per turn - open at both ends, so it has boundaries
+	void Helix(unsigned int segments, unsigned int sides, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// A unit box (-0.5 to 0.5), positions only
+	void Box(std::vector<DirectX::XMFLOAT3>& positions, std::vector<unsigned int>& indices);
+}
@@ -0,0 +1,389 @@
+#include <DirectXMath.h>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Test.h"
+#include "Transform.h"
+#include "TransformHierarchy.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Largest difference between two matrices, relative to the
+	// largest entry (at least 1), since deep chains pile up rounding
+	float RelativeDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		float largest = 1.0f, difference = 0.0f;
+		for (int row = 0; row < 4; row++)
+			for (int column = 0; column < 4; column++)
+			{
+				largest = fmaxf(largest, fabsf(a.m[row][column]));
+				difference = fmaxf(difference, fabsf(a.m[row][column] - b.m[row][column]));
+			}
+		return difference / largest;
+	}
+}
+
+// --------------------------------------------------------
+// Deep, wide and bushy trees: every world matrix matches
+// composing the local transforms by hand, each Update() only
+// redoes the nodes under something that changed, and
+// reparenting into a loop is refused
+// --------------------------------------------------------
+TEST(TransformHierarchy)
+{
+	const unsigned int nodeCount = 20000;
+	const unsigned int branchings[] = { 0, 1, 4 }; // Chains of 1000, 16 roots, 4 children each
+
+	std::mt19937 rng(21);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+	std::uniform_real_distribution<float> size(0.8f, 1.25f);
+	for (unsigned int branching : branchings)
+	{
+		// Parents always come before their children here, so the
+		// reference can be worked out in one pass in this order
+		std::vector<Transform> transforms(nodeCount);
+		std::vector<int> parents(nodeCount);
+		for (unsigned int i = 0; i < nodeCount; i++)
+		{
+			if (branching == 0) { parents[i] = i % 1000 == 0 ? -1 : (int)i - 1; }
+			else if (branching == 1) { parents[i] = i < 16 ? -1 : (int)(i % 16); }
+			else { parents[i] = i == 0 ? -1 : (int)((i - 1) / branching); }
+
+			transforms[i].SetPosition(offset(rng), offset(rng), offset(rng));
+			transforms[i].SetRotation(angle(rng), angle(rng), angle(rng));
+			transforms[i].SetScale(size(rng), size(rng), size(rng));
+		}
+
+		TransformHierarchy hierarchy;
+		for (unsigned int i = 0; i < nodeCount; i++)
+			hierarchy.Add(&transforms[i], parents[i]);
+		hierarchy.Update();
+		CHECK(hierarchy.GetCount() == nodeCount);
+		CHECK(hierarchy.GetUpdatedCount() == nodeCount);
+
+		hierarchy.Update();
+		CHECK(hierarchy.GetUpdatedCount() == 0);
+
+		// Moving one node has to redo exactly its subtree
+		std::vector<unsigned int> subtreeSizes(nodeCount, 1);
+		for (unsigned int i = nodeCount; i-- > 0; )
+			if (parents[i] != -1)
+				subtreeSizes[parents[i]] += subtreeSizes[i];
+		unsigned int moved = branching == 0 ? 500 : branching == 1 ? 3 : 5;
+		transforms[moved].MoveAbsolute(0.0f, 1.0f, 0.0f);
+		hierarchy.Update();
+		CHECK(hierarchy.GetUpdatedCount() == subtreeSizes[moved]);
+
+		// 1% of the nodes moving about
+		std::uniform_int_distribution<unsigned int> randomNode(0, nodeCount - 1);
+		for (unsigned int e = 0; e < nodeCount / 100; e++)
+			transforms[randomNode(rng)].Rotate(0.0f, 0.01f, 0.0f);
+		hierarchy.Update();
+		CHECK(hierarchy.GetUpdatedCount() < nodeCount);
+
+		// Reparenting a subtree, and refusing a loop
+		if (branching > 1)
+		{
+			hierarchy.SetParent(2, 1);
+			parents[2] = 1;
+			CHECK(hierarchy.GetParent(2) == 1);
+
+			bool throws = false;
+			try { hierarchy.SetParent(1, 9); } // 9 is under 2 now
+			catch (const std::invalid_argument&) { throws = true; }
+			CHECK(throws);
+			hierarchy.Update();
+		}
+
+		// Reference: local * parent's world, by hand
+		std::vector<XMFLOAT4X4> reference(nodeCount);
+		float worst = 0.0f;
+		for (unsigned int i = 0; i < nodeCount; i++)
+		{
+			XMFLOAT3 p = transforms[i].GetPosition(), sc = transforms[i].GetScale();
+			XMFLOAT4 r = transforms[i].GetRotation();
+			XMMATRIX world = XMMatrixScaling(sc.x, sc.y, sc.z) * XMMatrixRotationQuaternion(XMLoadFloat4(&r)) * XMMatrixTranslation(p.x, p.y, p.z);
+			if (parents[i] != -1)
+				world = world * XMLoadFloat4x4(&reference[parents[i]]);
+			XMStoreFloat4x4(&reference[i], world);
+			worst = fmaxf(worst, RelativeDifference(reference[i], transforms[i].GetWorldMatrix()));
+		}
+		CHECK(worst <= 1e-4f);
+		hierarchy.Clear();
+	}
+}
+
+// --------------------------------------------------------
+// The SIMD batches build the same world and inverse-transpose
+// matrices as a Transform each, only the batches of edited
+// objects are rebuilt, and handles keep finding their object
+// after the ones around them are destroyed
+// --------------------------------------------------------
+TEST(TransformSystem)
+{
+	const unsigned int transformCount = 10003; // Not a whole number of batches
+
+	std::mt19937 rng(22);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+	std::vector<Transform> transforms(transformCount);
+	TransformSystem system;
+	std::vector<TransformSystem::Handle> handles(transformCount);
+	for (unsigned int i = 0; i < transformCount; i++)
+	{
+		transforms[i].SetPosition(position(rng), position(rng), position(rng));
+		transforms[i].SetRotation(angle(rng), angle(rng), angle(rng));
+		float x = size(rng);
+		if (i % 2 == 0) { transforms[i].SetScale(x, x, x); }
+		else { transforms[i].SetScale(x, size(rng), size(rng)); }
+
+		handles[i] = system.Create();
+		system.SetPosition(handles[i], transforms[i].GetPosition());
+		system.SetRotation(handles[i], transforms[i].GetRotation());
+		system.SetScale(handles[i], transforms[i].GetScale());
+	}
+	system.Update();
+	CHECK(system.GetCount() == transformCount);
+	CHECK(system.GetUpdatedCount() == (transformCount + TransformSystem::BatchSize - 1) / TransformSystem::BatchSize * TransformSystem::BatchSize);
+
+	// Transform's inverse-transpose is the same closed form one lane
+	// wide, so only the world matrices differ at all (by rounding)
+	auto worstDifference = [&](bool inverse)
+	{
+		float worst = 0.0f;
+		for (unsigned int i = 0; i < transformCount; i++)
+		{
+			if (handles[i] == ~0u)
+				continue;
+			unsigned int index = system.GetIndex(handles[i]);
+			XMFLOAT4X4 expected = inverse ? transforms[i].GetWorldInverseTransposeMatrix() : transforms[i].GetWorldMatrix();
+			const XMFLOAT4X4& built = inverse ? system.GetWorldInverseTransposeMatrices()[index] : system.GetWorldMatrices()[index];
+			worst = fmaxf(worst, RelativeDifference(expected, built));
+		}
+		return worst;
+	};
+	CHECK(worstDifference(false) <= 1e-5f);
+	CHECK(worstDifference(true) <= 1e-5f);
+
+	// Nothing edited, nothing rebuilt - one edit rebuilds its batch
+	system.Update();
+	CHECK(system.GetUpdatedCount() == 0);
+	transforms[17].MoveAbsolute(1.0f, 2.0f, 3.0f);
+	system.SetPosition(handles[17], transforms[17].GetPosition());
+	system.Update();
+	CHECK(system.GetUpdatedCount() == TransformSystem::BatchSize);
+	CHECK(worstDifference(false) <= 1e-5f);
+
+	// Every third one destroyed - the rest move about to stay packed
+	for (unsigned int i = 0; i < transformCount; i += 3)
+	{
+		system.Destroy(handles[i]);
+		handles[i] = ~0u;
+	}
+	system.Update();
+	CHECK(system.GetCount() == transformCount - (transformCount + 2) / 3);
+	CHECK(worstDifference(false) <= 1e-5f);
+	CHECK(worstDifference(true) <= 1e-5f);
+
+	// A destroyed handle is refused until it's handed out again, as
+	// a fresh identity transform at the end
+	bool throws = false;
+	try { system.SetPosition(0, XMFLOAT3(0.0f, 0.0f, 0.0f)); }
+	catch (const std::invalid_argument&) { throws = true; }
+	CHECK(throws);
+	TransformSystem::Handle reused = system.Create();
+	CHECK(reused % 3 == 0);
+	CHECK(system.GetIndex(reused) == system.GetCount() - 1);
+	system.Update();
+	const XMFLOAT4X4& identity = system.GetWorldMatrices()[system.GetIndex(reused)];
+	CHECK(identity._11 == 1.0f && identity._22 == 1.0f && identity._33 == 1.0f && identity._41 == 0.0f && identity._44 == 1.0f);
+}
+
+// --------------------------------------------------------
+// Quaternion Rotate() turns the same way the old pitch/yaw/roll
+// angles did (pitch and yaw only, where they mean the same
+// thing), and the Euler conversions round-trip
+// --------------------------------------------------------
+TEST(TransformRotation)
+{
+	std::mt19937 rng(23);
+	std::uniform_real_distribution<float> small(-0.05f, 0.05f);
+	float worstMatrix = 0.0f, worstAxis = 0.0f;
+	for (int i = 0; i < 1000; i++)
+	{
+		// The old version: angles added up, the matrix built from them
+		Transform transform;
+		XMFLOAT3 angles(0, 0, 0);
+		for (int turn = 0; turn < 8; turn++)
+		{
+			float pitch = small(rng), yaw = small(rng);
+			transform.Rotate(pitch, yaw, 0.0f);
+			angles.x += pitch;
+			angles.y += yaw;
+		}
+		XMMATRIX rotation = XMMatrixRotationRollPitchYaw(angles.x, angles.y, angles.z);
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, rotation);
+		worstMatrix = fmaxf(worstMatrix, RelativeDifference(expected, transform.GetWorldMatrix()));
+
+		XMFLOAT3 forward = transform.GetForward(), up = transform.GetUp();
+		worstAxis = fmaxf(worstAxis, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&forward), XMVector3TransformNormal(XMVectorSet(0, 0, 1, 0), rotation)))));
+		worstAxis = fmaxf(worstAxis, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&up), XMVector3TransformNormal(XMVectorSet(0, 1, 0, 0), rotation)))));
+	}
+	CHECK(worstMatrix < 1e-4f);
+	CHECK(worstAxis < 1e-4f);
+
+	// Angles in, angles out (pitch kept off +-90, where yaw and roll blur together)
+	std::uniform_real_distribution<float> pitch(-1.5f, 1.5f), other(-3.1f, 3.1f);
+	float worstAngle = 0.0f;
+	for (int i = 0; i < 10000; i++)
+	{
+		Transform transform;
+		XMFLOAT3 angles(pitch(rng), other(rng), other(rng));
+		transform.SetRotation(angles);
+		XMFLOAT3 back = transform.GetPitchYawRoll();
+		worstAngle = fmaxf(worstAngle, fmaxf(fabsf(back.x - angles.x), fmaxf(fabsf(back.y - angles.y), fabsf(back.z - angles.z))));
+	}
+	CHECK(worstAngle < 1e-3f);
+}
+
+// --------------------------------------------------------
+// The closed-form inverse-transpose is as precise as a general
+// XMMatrixInverse() (both against the same TRS inverted in
+// doubles) for scales from 1/100 to 100, and the product form
+// TransformHierarchy uses still inverts a skewed chain
+// --------------------------------------------------------
+TEST(TransformInverseTranspose)
+{
+	std::mt19937 rng(24);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+	std::uniform_real_distribution<float> logScale(-2.0f, 2.0f);
+
+	// The shaders only use the upper 3x3 (for normals), so that's judged
+	// on its own - the translation column carries the cancellation in
+	// -position . row for both versions alike
+	double closedError = 0.0, generalError = 0.0, closedNormalError = 0.0, generalNormalError = 0.0;
+	for (unsigned int i = 0; i < 20000; i++)
+	{
+		// The first half uniformly scaled, the rest not
+		Transform transform;
+		transform.SetPosition(position(rng), position(rng), position(rng));
+		transform.SetRotation(angle(rng), angle(rng), angle(rng));
+		float x = powf(10.0f, logScale(rng));
+		if (i < 10000) { transform.SetScale(x, x, x); }
+		else { transform.SetScale(x, powf(10.0f, logScale(rng)), powf(10.0f, logScale(rng))); }
+
+		XMFLOAT4X4 world = transform.GetWorldMatrix(), general;
+		XMStoreFloat4x4(&general, XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&world))));
+		XMFLOAT4X4 closed = transform.GetWorldInverseTransposeMatrix();
+
+		// The reference: the exact TRS built and inverted in doubles
+		// (Gauss-Jordan, so it shares nothing with either float version)
+		XMFLOAT3 p = transform.GetPosition();
+		XMFLOAT4 q = transform.GetRotation();
+		XMFLOAT3 sc = transform.GetScale();
+		double length = sqrt((double)q.x * q.x + (double)q.y * q.y + (double)q.z * q.z + (double)q.w * q.w);
+		double qx = q.x / length, qy = q.y / length, qz = q.z / length, qw = q.w / length;
+		double rotation[3][3] = {
+			{ 1 - 2 * (qy * qy + qz * qz), 2 * (qx * qy + qz * qw), 2 * (qx * qz - qy * qw) },
+			{ 2 * (qx * qy - qz * qw), 1 - 2 * (qx * qx + qz * qz), 2 * (qy * qz + qx * qw) },
+			{ 2 * (qx * qz + qy * qw), 2 * (qy * qz - qx * qw), 1 - 2 * (qx * qx + qy * qy) } };
+		double scale[3] = { sc.x, sc.y, sc.z };
+		double a[4][8] = {};
+		for (int row = 0; row < 3; row++)
+			for (int column = 0; column < 3; column++)
+				a[row][column] = rotation[row][column] * scale[row];
+		a[3][0] = p.x; a[3][1] = p.y; a[3][2] = p.z; a[3][3] = 1;
+		for (int row = 0; row < 4; row++)
+			a[row][4 + row] = 1;
+		for (int column = 0; column < 4; column++)
+		{
+			int pivot = column;
+			for (int row = column + 1; row < 4; row++)
+				if (fabs(a[row][column]) > fabs(a[pivot][column])) pivot = row;
+			for (int k = 0; k < 8; k++) std::swap(a[column][k], a[pivot][k]);
+			double divisor = a[column][column];
+			for (int k = 0; k < 8; k++) a[column][k] /= divisor;
+			for (int row = 0; row < 4; row++)
+			{
+				if (row == column) continue;
+				double factor = a[row][column];
+				for (int k = 0; k < 8; k++) a[row][k] -= factor * a[column][k];
+			}
+		}
+
+		// Inverse-transpose, so [row][column] reads the inverse's [column][row];
+		// errors relative to the matrix's largest entry
+		double largest = 0.0, closedWorst = 0.0, generalWorst = 0.0;
+		double normalLargest = 0.0, closedNormalWorst = 0.0, generalNormalWorst = 0.0;
+		for (int row = 0; row < 4; row++)
+			for (int column = 0; column < 4; column++)
+			{
+				double reference = a[column][4 + row];
+				double closedDifference = fabs(closed.m[row][column] - reference);
+				double generalDifference = fabs(general.m[row][column] - reference);
+				largest = fmax(largest, fabs(reference));
+				closedWorst = fmax(closedWorst, closedDifference);
+				generalWorst = fmax(generalWorst, generalDifference);
+				if (row < 3 && column < 3)
+				{
+					normalLargest = fmax(normalLargest, fabs(reference));
+					closedNormalWorst = fmax(closedNormalWorst, closedDifference);
+					generalNormalWorst = fmax(generalNormalWorst, generalDifference);
+				}
+			}
+		closedError = fmax(closedError, closedWorst / largest);
+		generalError = fmax(generalError, generalWorst / largest);
+		closedNormalError = fmax(closedNormalError, closedNormalWorst / normalLargest);
+		generalNormalError = fmax(generalNormalError, generalNormalWorst / normalLargest);
+	}
+
+	// Both are limited by the float rotation matrix, so "as precise" means within
+	// a factor of 2 either way rather than a strict win on every run
+	CHECK(closedNormalError <= 2 * generalNormalError);
+	CHECK(closedError <= 2 * generalError);
+
+	// A chain of rotated, non-uniformly scaled parents skews the world
+	// matrix, so it's no longer a plain TRS - transpose(inverse-transpose)
+	// * world should still be the identity
+	const unsigned int chainLength = 32;
+	std::vector<Transform> chain(chainLength);
+	TransformHierarchy hierarchy;
+	std::uniform_real_distribution<float> mildScale(0.7f, 1.4f);
+	for (unsigned int i = 0; i < chainLength; i++)
+	{
+		chain[i].SetPosition(position(rng) * 0.01f, position(rng) * 0.01f, position(rng) * 0.01f);
+		chain[i].SetRotation(angle(rng), angle(rng), angle(rng));
+		chain[i].SetScale(mildScale(rng), mildScale(rng), mildScale(rng));
+		hierarchy.Add(&chain[i], (int)i - 1);
+	}
+	hierarchy.Update();
+	float chainResidual = 0.0f;
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	for (unsigned int i = 0; i < chainLength; i++)
+	{
+		// Relative to how far the skewed scales have drifted from 1
+		XMFLOAT4X4 world = chain[i].GetWorldMatrix(), inverseTranspose = chain[i].GetWorldInverseTransposeMatrix(), product;
+		XMStoreFloat4x4(&product, XMMatrixTranspose(XMLoadFloat4x4(&inverseTranspose)) * XMLoadFloat4x4(&world));
+		float size = 1.0f;
+		for (int row = 0; row < 3; row++)
+			for (int column = 0; column < 3; column++)
+				size = fmaxf(size, fabsf(world.m[row][column]));
+		chainResidual = fmaxf(chainResidual, RelativeDifference(product, identity) / size);
+	}
+	hierarchy.Clear();
+	CHECK(chainResidual < 1e-3f);
+}
@@ -0,0 +1,64 @@
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "VertexCodec.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Random vertices round-trip through PackedVertex within the
+// precision VertexCodec.h promises
+// --------------------------------------------------------
+TEST(VertexCodec)
+{
+	// Random positions in a 20 x 6 x 2 box, random unit
+	// normals/tangents and UVs in 0-1
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+	auto randomDirection = [&]()
+	{
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVector3Normalize(XMVectorSet(random(rng), random(rng), random(rng), 0.0f)));
+		return result;
+	};
+
+	std::vector<Vertex> verts(100000);
+	for (Vertex& v : verts)
+	{
+		v.Position = XMFLOAT3(random(rng) * 10.0f, random(rng) * 3.0f, random(rng));
+		v.UV = XMFLOAT2(random(rng) * 0.5f + 0.5f, random(rng) * 0.5f + 0.5f);
+		v.Normal = randomDirection();
+		v.Tangent = randomDirection();
+	}
+
+	VertexCodec::PositionBounds bounds = VertexCodec::ComputeBounds(verts.data(), verts.size());
+	std::vector<PackedVertex> packed(verts.size());
+	VertexCodec::Encode(verts.data(), verts.size(), bounds, packed.data());
+	VertexCodec::ErrorStats error = VertexCodec::MeasureError(verts.data(), packed.data(), verts.size(), bounds);
+
+	// Half a step on each axis, at most
+	float halfSteps = std::sqrt(
+		bounds.extent.x * bounds.extent.x + bounds.extent.y * bounds.extent.y + bounds.extent.z * bounds.extent.z) / 131070.0f;
+	CHECK(error.maxPositionError <= halfSteps * 1.01f);
+	// The octahedral step is well under 0.01 degrees, but a float acos()
+	// can't tell angles that small from 0.028 (one ulp below 1)
+	CHECK(error.maxNormalDegrees < 0.05f);
+	CHECK(error.maxTangentDegrees < 0.05f);
+	CHECK(error.maxUVError <= 1.0f / 4096.0f); // Half a half-float step just below 1
+
+	// The batch encode is the single one, and the corners of the bounds are exact
+	bool sameAsSingle = true;
+	for (size_t i = 0; i < verts.size(); i += 97)
+	{
+		PackedVertex single = VertexCodec::Encode(verts[i], bounds);
+		sameAsSingle = sameAsSingle && memcmp(&single, &packed[i], sizeof(PackedVertex)) == 0;
+	}
+	CHECK(sameAsSingle);
+	CHECK(VertexCodec::QuantizeUnorm16(bounds.min.x, bounds.min.x, bounds.extent.x) == 0);
+	CHECK(VertexCodec::QuantizeUnorm16(bounds.min.x + bounds.extent.x, bounds.min.x, bounds.extent.x) == 65535);
+	CHECK(VertexCodec::DequantizeUnorm16(65535, bounds.min.x, bounds.extent.x) == bounds.min.x + bounds.extent.x);
+}
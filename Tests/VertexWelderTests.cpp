@@ -0,0 +1,173 @@
+#include <DirectXMath.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "VertexWelder.h"
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// A cube as an .obj would give it: 8 shared positions, one normal
+	// per face and the same 4 uvs on every face, two triangles per face
+	const unsigned int CubeFaces[6][4] =
+	{
+		{ 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 },
+		{ 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 },
+	};
+	const unsigned int QuadCorners[6] = { 0, 1, 2, 0, 2, 3 };
+
+	std::vector<VertexWelder::CornerKey> CubeCorners()
+	{
+		std::vector<VertexWelder::CornerKey> corners;
+		for (unsigned int face = 0; face < 6; face++)
+			for (unsigned int corner : QuadCorners)
+				corners.push_back({ CubeFaces[face][corner], corner, face });
+		return corners;
+	}
+
+	bool Near(const Vertex& a, const Vertex& b, float epsilon)
+	{
+		return
+			fabsf(a.Position.x - b.Position.x) <= epsilon && fabsf(a.Position.y - b.Position.y) <= epsilon && fabsf(a.Position.z - b.Position.z) <= epsilon &&
+			fabsf(a.UV.x - b.UV.x) <= epsilon && fabsf(a.UV.y - b.UV.y) <= epsilon &&
+			fabsf(a.Normal.x - b.Normal.x) <= epsilon && fabsf(a.Normal.y - b.Normal.y) <= epsilon && fabsf(a.Normal.z - b.Normal.z) <= epsilon;
+	}
+}
+
+// --------------------------------------------------------
+// The exact weld merges only identical index triples: a cube's
+// 36 corners become 24 vertices, since every corner is on a
+// normal seam, and a uv seam (or a missing uv) stays split too
+// --------------------------------------------------------
+TEST(VertexWelderCorners)
+{
+	std::vector<VertexWelder::CornerKey> corners = CubeCorners();
+	std::vector<unsigned int> remap(corners.size()), uniqueCorners;
+	VertexWelder::WeldCorners(corners.data(), corners.size(), remap.data(), uniqueCorners);
+	CHECK(corners.size() == 36);
+	CHECK(uniqueCorners.size() == 24);
+
+	// Each corner maps to a vertex built from the same triple, and
+	// each vertex is its first corner
+	std::vector<unsigned int> perPosition(8, 0);
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		CHECK(remap[i] < uniqueCorners.size());
+		const VertexWelder::CornerKey& first = corners[uniqueCorners[remap[i]]];
+		CHECK(first.position == corners[i].position && first.uv == corners[i].uv && first.normal == corners[i].normal);
+		CHECK(uniqueCorners[remap[i]] <= i);
+	}
+	for (unsigned int corner : uniqueCorners)
+		perPosition[corners[corner].position]++;
+	for (unsigned int count : perPosition)
+		CHECK(count == 3);
+
+	// Same position and normal, different (or no) uv
+	const VertexWelder::CornerKey seam[] =
+	{
+		{ 0, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 }, { 0, VertexWelder::NoIndex, 0 }, { 0, 1, 0 },
+	};
+	unsigned int seamRemap[5];
+	VertexWelder::WeldCorners(seam, 5, seamRemap, uniqueCorners);
+	CHECK(uniqueCorners.size() == 3);
+	CHECK(seamRemap[0] == 0 && seamRemap[1] == 1 && seamRemap[2] == 0 && seamRemap[3] == 2 && seamRemap[4] == 1);
+
+	VertexWelder::WeldCorners(seam, 0, seamRemap, uniqueCorners);
+	CHECK(uniqueCorners.empty());
+}
+
+// --------------------------------------------------------
+// The epsilon weld merges vertices only when every attribute
+// is within epsilon, rewrites the indices to match, and gets
+// an unshared, jittered cube back to 24 vertices
+// --------------------------------------------------------
+TEST(VertexWelderDistance)
+{
+	const float epsilon = 1e-3f;
+
+	// The cube again, one vertex per corner with every attribute
+	// jittered by less than half of epsilon
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> jitter(-0.4f * epsilon, 0.4f * epsilon);
+	std::vector<VertexWelder::CornerKey> corners = CubeCorners();
+	const XMFLOAT3 normals[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }, { -1, 0, 0 }, { 1, 0, 0 } };
+	const XMFLOAT2 uvs[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	for (const VertexWelder::CornerKey& corner : corners)
+	{
+		Vertex v = {};
+		v.Position = XMFLOAT3((corner.position & 1) + jitter(rng), ((corner.position >> 1) & 1) + jitter(rng), (corner.position >> 2) + jitter(rng));
+		v.UV = XMFLOAT2(uvs[corner.uv].x + jitter(rng), uvs[corner.uv].y + jitter(rng));
+		v.Normal = XMFLOAT3(normals[corner.normal].x + jitter(rng), normals[corner.normal].y + jitter(rng), normals[corner.normal].z + jitter(rng));
+		indices.push_back((unsigned int)verts.size());
+		verts.push_back(v);
+	}
+
+	std::vector<Vertex> original = verts;
+	VertexWelder::WeldByDistance(verts, indices, epsilon);
+	CHECK(verts.size() == 24);
+	CHECK(indices.size() == 36);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		CHECK(indices[i] < verts.size());
+		CHECK(Near(verts[indices[i]], original[i], epsilon));
+	}
+
+	// Two vertices that differ in one attribute: merged at half of
+	// epsilon, kept apart at twice epsilon (positions straddle a cell
+	// boundary at 0 as well)
+	for (int component = 0; component < 8; component++)
+		for (float offset : { 0.5f * epsilon, 2.0f * epsilon })
+		{
+			Vertex a = {};
+			a.Position = XMFLOAT3(-0.2f * epsilon, 0.0f, 0.0f);
+			a.Normal = XMFLOAT3(0, 1, 0);
+			Vertex b = a;
+			float* values[8] = { &b.Position.x, &b.Position.y, &b.Position.z, &b.UV.x, &b.UV.y, &b.Normal.x, &b.Normal.y, &b.Normal.z };
+			*values[component] += offset;
+
+			std::vector<Vertex> pair = { a, b };
+			std::vector<unsigned int> pairIndices = { 0, 1, 1, 0 };
+			VertexWelder::WeldByDistance(pair, pairIndices, epsilon);
+			bool merged = offset < epsilon;
+			CHECK(pair.size() == (merged ? 1u : 2u));
+			CHECK(pairIndices[0] == 0 && pairIndices[3] == 0);
+			CHECK(pairIndices[1] == (merged ? 0u : 1u) && pairIndices[2] == pairIndices[1]);
+		}
+
+	// Random clusters further apart than epsilon: every vertex stays
+	// within epsilon of the one it became, and no two kept ones are
+	std::uniform_int_distribution<int> lattice(-20, 20);
+	verts.clear();
+	indices.clear();
+	for (unsigned int i = 0; i < 5000; i++)
+	{
+		Vertex v = {};
+		v.Position = XMFLOAT3(lattice(rng) * 3.0f * epsilon + jitter(rng), lattice(rng) * 3.0f * epsilon + jitter(rng), jitter(rng));
+		v.UV = XMFLOAT2((float)(i % 2) + jitter(rng), jitter(rng));
+		v.Normal = XMFLOAT3(0, 1, 0);
+		indices.push_back(i);
+		verts.push_back(v);
+	}
+	original = verts;
+	VertexWelder::WeldByDistance(verts, indices, epsilon);
+	CHECK(verts.size() < original.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		CHECK(indices[i] < verts.size() && Near(verts[indices[i]], original[i], epsilon));
+	bool separate = true;
+	for (size_t a = 0; a < verts.size(); a++)
+		for (size_t b = a + 1; b < verts.size(); b++)
+			separate = separate && !Near(verts[a], verts[b], epsilon);
+	CHECK(separate);
+
+	// Nothing to do for no epsilon
+	std::vector<Vertex> copy = original;
+	VertexWelder::WeldByDistance(copy, indices, 0.0f);
+	CHECK(copy.size() == original.size());
+}
@@ -1,107 +1,172 @@
 #include "Transform.h"
+#include "TransformHierarchy.h"
+#include "TransformSystem.h"
+#include <cmath>
 
 Transform::Transform()
 {
+	version = 0;
+	hierarchy = 0;
+	hierarchyNode = -1;
 	SetPosition(0.0f, 0.0f, 0.0f);
 	SetScale(1.0f, 1.0f, 1.0f);
-	SetRotation(0.0f, 0.0f, 0.0f);
+	SetRotation(DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
 	DirectX::XMMATRIX initialMatrix = DirectX::XMMatrixIdentity();
 	DirectX::XMStoreFloat4x4(&world, initialMatrix);
-	DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixInverse(0, DirectX::XMMatrixTranspose(initialMatrix)));
+	DirectX::XMStoreFloat4x4(&worldInverseT, DirectX::XMMatrixInverse(0, DirectX::XMMatrixTranspose(initialMatrix)));
 	relUp = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
 	relForward = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
 	relRight = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+	orientationStale = false;
 	edited = 0;
+	inverseEdited = 0;
 }
 
-void Transform::SetPosition(float x, float y, float z) { position = DirectX::XMFLOAT3(x, y, z); edited++; };
-void Transform::SetPosition(DirectX::XMFLOAT3 pos) { position = pos; edited ++;}
-void Transform::SetRotation(float pitch, float yaw, float roll) { rotation = DirectX::XMFLOAT3(pitch, yaw, roll); edited++;}
-void Transform::SetRotation(DirectX::XMFLOAT3 ro) { rotation = ro; edited ++;} // XMFLOAT4 for quaternion
-void Transform::SetScale(float x, float y, float z) { scale = DirectX::XMFLOAT3(x, y, z); edited ++;}
-void Transform::SetScale(DirectX::XMFLOAT3 s) { scale = s; edited ++;}
+void Transform::SetPosition(float x, float y, float z) { position = DirectX::XMFLOAT3(x, y, z); Edited(); };
+void Transform::SetPosition(DirectX::XMFLOAT3 pos) { position = pos; Edited();}
+void Transform::SetRotation(float pitch, float yaw, float roll) 
+{
+	DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+	orientationStale = true; Edited();
+}
+void Transform::SetRotation(DirectX::XMFLOAT3 ro) { SetRotation(ro.x, ro.y, ro.z); }
+void Transform::SetRotation(DirectX::XMFLOAT4 quaternion) 
+{
+	DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionNormalize(DirectX::XMLoadFloat4(&quaternion)));
+	orientationStale = true; Edited();
+}
+void Transform::SetScale(float x, float y, float z) { scale = DirectX::XMFLOAT3(x, y, z); Edited();}
+void Transform::SetScale(DirectX::XMFLOAT3 s) { scale = s; Edited();}
 
 //Getters
 DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return rotation; } // XMFLOAT4 GetRotation() for quaternion
+DirectX::XMFLOAT4 Transform::GetRotation() { return rotation; }
 DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
-DirectX::XMFLOAT3 Transform::GetForward() { return relForward; }
-DirectX::XMFLOAT3 Transform::GetRight() { return relRight; }
-DirectX::XMFLOAT3 Transform::GetUp() { return relUp; }
+DirectX::XMFLOAT3 Transform::GetForward() { CalculateOrientation(); return relForward; }
+DirectX::XMFLOAT3 Transform::GetRight() { CalculateOrientation(); return relRight; }
+DirectX::XMFLOAT3 Transform::GetUp() { CalculateOrientation(); return relUp; }
+
+// Rotation is roll (z), then pitch (x), then yaw (y), so in the
+// rotation matrix row 2 is (cos p sin y, -sin p, cos p cos y),
+// and column 1 of rows 0 and 1 is (sin r cos p, cos r cos p)
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll() 
+{
+	float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+	float sinPitch = 2.0f * (w * x - y * z);
+	sinPitch = sinPitch > 1.0f ? 1.0f : sinPitch < -1.0f ? -1.0f : sinPitch;
+	return DirectX::XMFLOAT3(
+		asinf(sinPitch),
+		atan2f(2.0f * (x * z + w * y), 1.0f - 2.0f * (x * x + y * y)),
+		atan2f(2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z)));
+}
+unsigned int Transform::GetVersion() { return version; }
+
+// Every setter and movement ends here
+void Transform::Edited()
+{
+	edited++;
+	inverseEdited++;
+	version++;
+	if (hierarchy) { hierarchy->MarkDirty(hierarchyNode); }
+}
 
 
 //Movements - Simplified by performing Math and Load within the Store function
 void Transform::MoveAbsolute(float x, float y, float z) 
 {
 	DirectX::XMStoreFloat3(&position, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&position), DirectX::XMVectorSet(x, y, z, 1.0f)));
-	edited++;
+	Edited();
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
 {
 	DirectX::XMStoreFloat3(&position, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&position), DirectX::XMVectorSet(offset.x, offset.y, offset.z, 1.0f)));
-	edited++;
+	Edited();
 }
 
+// The local axes are just the rotation matrix's rows (right, up, forward)
 void Transform::CalculateOrientation() 
 {
-	DirectX::XMVECTOR quat = DirectX::XMQuaternionRotationRollPitchYawFromVector(DirectX::XMLoadFloat3(&rotation));
-	relUp = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
-	relForward = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
-	relRight = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
-	DirectX::XMStoreFloat3(&relUp, DirectX::XMVector3Rotate(DirectX::XMLoadFloat3(&relUp), quat));
-	DirectX::XMStoreFloat3(&relRight, DirectX::XMVector3Rotate(DirectX::XMLoadFloat3(&relRight), quat));
-	DirectX::XMStoreFloat3(&relForward, DirectX::XMVector3Rotate(DirectX::XMLoadFloat3(&relForward), quat));
+	if (!orientationStale) { return; }
+	DirectX::XMFLOAT4X4 axes;
+	DirectX::XMStoreFloat4x4(&axes, DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&rotation)));
+	relRight = DirectX::XMFLOAT3(axes._11, axes._12, axes._13);
+	relUp = DirectX::XMFLOAT3(axes._21, axes._22, axes._23);
+	relForward = DirectX::XMFLOAT3(axes._31, axes._32, axes._33);
+	orientationStale = false;
 }
 
+// Local pitch/roll first, then the current rotation, then world yaw - with
+// no roll that's exactly adding to the angles, so the camera can't tilt
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&rotation), DirectX::XMVectorSet(pitch, yaw, roll, 1.0f)));
-	CalculateOrientation();
-	edited++;
+	DirectX::XMVECTOR local = DirectX::XMQuaternionRotationRollPitchYaw(pitch, 0.0f, roll);
+	DirectX::XMVECTOR turned = DirectX::XMQuaternionMultiply(local, DirectX::XMLoadFloat4(&rotation));
+	if (yaw != 0.0f)
+		turned = DirectX::XMQuaternionMultiply(turned, DirectX::XMQuaternionRotationRollPitchYaw(0.0f, yaw, 0.0f));
+	DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionNormalize(turned));
+	orientationStale = true;
+	Edited();
 }
 
-void Transform::Rotate(DirectX::XMFLOAT3 ro)
+void Transform::Rotate(DirectX::XMFLOAT3 ro) { Rotate(ro.x, ro.y, ro.z); }
+
+void Transform::Rotate(DirectX::XMFLOAT4 quaternion)
 {
-	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&rotation), DirectX::XMVectorSet(ro.x, ro.y, ro.z, 1.0f)));
-	CalculateOrientation();
-	edited++;
+	DirectX::XMVECTOR turned = DirectX::XMQuaternionMultiply(DirectX::XMLoadFloat4(&rotation), DirectX::XMLoadFloat4(&quaternion));
+	DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionNormalize(turned));
+	orientationStale = true;
+	Edited();
 }
 
 // Scale needs to be multiplied!
 void Transform::Scale(float x, float y, float z)
 {
-	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorMultiply(DirectX::XMLoadFloat3(&scale), DirectX::XMVectorSet(x, y, z, 1.0f)));
-	edited++;
+	DirectX::XMStoreFloat3(&scale, DirectX::XMVectorMultiply(DirectX::XMLoadFloat3(&scale), DirectX::XMVectorSet(x, y, z, 1.0f)));
+	Edited();
 }
 
-void Transform::Scale(DirectX::XMFLOAT3 scale)
+void Transform::Scale(DirectX::XMFLOAT3 s)
 {
-	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorMultiply(DirectX::XMLoadFloat3(&scale), DirectX::XMVectorSet(scale.x, scale.y, scale.z, 1.0f)));
-	edited++;
+	DirectX::XMStoreFloat3(&scale, DirectX::XMVectorMultiply(DirectX::XMLoadFloat3(&scale), DirectX::XMLoadFloat3(&s)));
+	Edited();
+}
+
+DirectX::XMMATRIX Transform::LocalMatrix() const
+{
+	return DirectX::XMMatrixScaling(scale.x, scale.y, scale.z) * DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&rotation)) * DirectX::XMMatrixTranslation(position.x, position.y, position.z);
+}
+
+// The same as XMMatrixInverse(XMMatrixTranspose(LocalMatrix())),
+// in closed form - TransformSystem builds its batches the same way
+DirectX::XMMATRIX Transform::LocalInverseTranspose() const
+{
+	return TransformSystem::InverseTranspose(position, rotation, scale);
 }
 
 // Checks if any edits have been made using a counter. If there are edits it will recalculate, otherwise, it will return the float4x4 as is. 
+// In a hierarchy, the parents are in it too - that's worked out in TransformHierarchy::Update()
+// Each matrix has its own counter, so asking for one never pays for the other
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix() 
 { 
+	if (hierarchy) { return hierarchy->GetWorldMatrix(hierarchyNode); }
 	if (edited == 0) { return world; }
-	DirectX::XMMATRIX worldMatrix = DirectX::XMMatrixScaling(scale.x, scale.y, scale.z) * DirectX::XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) * DirectX::XMMatrixTranslation(position.x, position.y, position.z);
-	DirectX::XMStoreFloat4x4(&world, worldMatrix);
-	DirectX::XMStoreFloat4x4(&worldInverseT,
-		DirectX::XMMatrixInverse(0, DirectX::XMMatrixTranspose(worldMatrix)));
+	DirectX::XMStoreFloat4x4(&world, LocalMatrix());
 	edited = 0;
 	return world;
 }
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	if (edited == 0) { return worldInverseT; }
-	GetWorldMatrix();
-	edited = 0;
+	if (hierarchy) { return hierarchy->GetWorldInverseTransposeMatrix(hierarchyNode); }
+	if (inverseEdited == 0) { return worldInverseT; }
+	DirectX::XMStoreFloat4x4(&worldInverseT, LocalInverseTranspose());
+	inverseEdited = 0;
 	return worldInverseT;
 }
 
 void Transform::MoveRelative(DirectX::XMFLOAT3 offset) 
 {
+	CalculateOrientation();
 	DirectX::XMFLOAT3 iForward = DirectX::XMFLOAT3(relForward.x * offset.x, relForward.y * offset.x, relForward.z * offset.x);
 	DirectX::XMFLOAT3 iRight = DirectX::XMFLOAT3(relRight.x * offset.y, relRight.y * offset.y, relRight.z * offset.y);
 	DirectX::XMFLOAT3 iUp = DirectX::XMFLOAT3(relUp.x * offset.z, relUp.y * offset.z, relUp.z * offset.z);
@@ -112,11 +177,12 @@ void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
 			DirectX::XMLoadFloat3(&iRight)),
 			DirectX::XMLoadFloat3(&iUp))
 	));
-	edited++;
+	Edited();
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
+	CalculateOrientation();
 	DirectX::XMFLOAT3 iForward = DirectX::XMFLOAT3(relForward.x * x, relForward.y * x, relForward.z * x);
 	DirectX::XMFLOAT3 iRight = DirectX::XMFLOAT3(relRight.x * y, relRight.y * y, relRight.z * y);
 	DirectX::XMFLOAT3 iUp = DirectX::XMFLOAT3(relUp.x * z, relUp.y * z, relUp.z * z);
@@ -127,5 +193,5 @@ void Transform::MoveRelative(float x, float y, float z)
 			DirectX::XMLoadFloat3(&iRight)),
 			DirectX::XMLoadFloat3(&iUp))
 	));
-	edited++;
+	Edited();
 }
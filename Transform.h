@@ -1,5 +1,8 @@
 #pragma once
 #include <DirectXMath.h>
+
+class TransformHierarchy;
+
 class Transform
 {
 public:
@@ -7,37 +10,54 @@ public:
 	void SetPosition(float x, float y, float z);
 	void SetPosition(DirectX::XMFLOAT3 pos);
 	void SetRotation(float pitch, float yaw, float roll);
-	void SetRotation(DirectX::XMFLOAT3 ro);  // XMFLOAT4 for quaternion
+	void SetRotation(DirectX::XMFLOAT3 ro);  // Pitch/yaw/roll, converted to a quaternion
+	void SetRotation(DirectX::XMFLOAT4 quaternion); // Normalized on the way in
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 s);
 
 	//Getters
 	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetPitchYawRoll();  // XMFLOAT4 GetRotation() for quaternion
+	DirectX::XMFLOAT3 GetPitchYawRoll();  // Converted from the quaternion, pitch within +-90 degrees
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetScale();
-	DirectX::XMFLOAT4X4 GetWorldMatrix();
+	DirectX::XMFLOAT4X4 GetWorldMatrix(); // Parents included, if it's in a TransformHierarchy
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 	DirectX::XMFLOAT3 GetForward();
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
+	unsigned int GetVersion(); // Goes up on every change, so others can tell when their cached results are stale
 
 	//Movements
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 offset);
+	// Pitch and roll turn about the local axes and yaw about world up -
+	// the same as adding the angles, while there's no roll
 	void Rotate(float pitch, float yaw, float roll);
 	void Rotate(DirectX::XMFLOAT3 rotation);
+	void Rotate(DirectX::XMFLOAT4 quaternion); // After the current rotation
 	void Scale(float x, float y, float z);
-	void Scale(DirectX::XMFLOAT3 scale);
+	void Scale(DirectX::XMFLOAT3 s);
 	void MoveRelative(float x, float y, float z);
 	void MoveRelative(DirectX::XMFLOAT3 offset);
-	void CalculateOrientation();
+	void CalculateOrientation(); // Done for you when GetForward()/GetRight()/GetUp() need it
 
 	Transform();
 
 private:
-	DirectX::XMFLOAT3 position, scale, rotation;
+	friend class TransformHierarchy;
+	void Edited();
+	DirectX::XMMATRIX LocalMatrix() const; // Scale, rotation and position - no parents
+	DirectX::XMMATRIX LocalInverseTranspose() const; // Of LocalMatrix(), in closed form
+
+	DirectX::XMFLOAT3 position, scale;
+	DirectX::XMFLOAT4 rotation; // Quaternion, always normalized
 	DirectX::XMFLOAT3 relUp, relForward, relRight;
+	bool orientationStale; // Rotation changed since CalculateOrientation()
 	DirectX::XMFLOAT4X4 world, worldInverseT;
-	int edited;
+	int edited; // Since world was worked out
+	int inverseEdited; // Since worldInverseT was
+	unsigned int version;
+	TransformHierarchy* hierarchy; // Null unless it was added to one
+	int hierarchyNode;
 };
 
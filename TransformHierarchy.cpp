@@ -0,0 +1,239 @@
+#include "TransformHierarchy.h"
+#include "Transform.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+TransformHierarchy::TransformHierarchy()
+{
+	orderChanged = false;
+	updatedCount = 0;
+}
+
+int TransformHierarchy::Add(Transform* transform, int parent)
+{
+	if (transform == 0 || transform->hierarchy != 0)
+		throw std::invalid_argument("Transform is null or already in a hierarchy");
+	if (parent != -1)
+		CheckNode(parent, "Parent");
+
+	int node = (int)transforms.size();
+	transforms.push_back(transform);
+	parents.push_back(parent);
+	slots.push_back(-1);
+	dirty.push_back(0);
+	transform->hierarchy = this;
+	transform->hierarchyNode = node;
+
+	orderChanged = true;
+	return node;
+}
+
+void TransformHierarchy::SetParent(int node, int parent)
+{
+	CheckNode(node, "Node");
+	if (parent != -1)
+		CheckNode(parent, "Parent");
+
+	// The new parent can't be the node or anything under it
+	for (int p = parent; p != -1; p = parents[p])
+		if (p == node)
+			throw std::invalid_argument("Parenting would make a loop");
+
+	if (parents[node] == parent)
+		return;
+	parents[node] = parent;
+	orderChanged = true;
+}
+
+int TransformHierarchy::GetParent(int node) const
+{
+	CheckNode(node, "Node");
+	return parents[node];
+}
+
+void TransformHierarchy::Clear()
+{
+	for (Transform* transform : transforms)
+	{
+		transform->hierarchy = 0;
+		transform->hierarchyNode = -1;
+	}
+	transforms.clear();
+	parents.clear();
+	slots.clear();
+	dirty.clear();
+	dirtyNodes.clear();
+	slotNodes.clear();
+	slotParents.clear();
+	subtreeSizes.clear();
+	worlds.clear();
+	worldInverseTransposes.clear();
+	orderChanged = false;
+	updatedCount = 0;
+}
+
+void TransformHierarchy::MarkDirty(int node)
+{
+	if (dirty[node])
+		return;
+	dirty[node] = 1;
+	dirtyNodes.push_back(node);
+}
+
+// --------------------------------------------------------
+// Recomputes the world matrices of every dirty node and
+// everything under them - each subtree once, even if more
+// than one node in it was edited
+// --------------------------------------------------------
+void TransformHierarchy::Update()
+{
+	updatedCount = 0;
+	for (int node : dirtyNodes)
+		dirty[node] = 0;
+
+	// Nodes were added or moved - everything gets redone
+	if (orderChanged)
+	{
+		dirtyNodes.clear();
+		Rebuild();
+		UpdateRange(0, (unsigned int)slotNodes.size());
+		orderChanged = false;
+		return;
+	}
+
+	// In flattened order, so a subtree already covered by
+	// an earlier (ancestor's) range can be skipped
+	dirtySlots.clear();
+	for (int node : dirtyNodes)
+		dirtySlots.push_back(slots[node]);
+	dirtyNodes.clear();
+	std::sort(dirtySlots.begin(), dirtySlots.end());
+
+	unsigned int end = 0;
+	for (int slot : dirtySlots)
+	{
+		if ((unsigned int)slot < end)
+			continue;
+		end = slot + subtreeSizes[slot];
+		UpdateRange(slot, end);
+	}
+}
+
+// --------------------------------------------------------
+// Parents come first, so their world matrices are always
+// done by the time a child needs them
+//
+// The inverse-transpose of a product is the product of the
+// inverse-transposes, so a child's is its local one times
+// its parent's - no general inverse, even though the world
+// matrix can end up skewed by a parent's non-uniform scale
+// --------------------------------------------------------
+void TransformHierarchy::UpdateRange(unsigned int start, unsigned int end)
+{
+	for (unsigned int s = start; s < end; s++)
+	{
+		Transform* transform = transforms[slotNodes[s]];
+		DirectX::XMMATRIX world = transform->LocalMatrix();
+		DirectX::XMMATRIX inverseTranspose = transform->LocalInverseTranspose();
+		if (slotParents[s] != -1)
+		{
+			world = world * DirectX::XMLoadFloat4x4(&worlds[slotParents[s]]);
+			inverseTranspose = inverseTranspose * DirectX::XMLoadFloat4x4(&worldInverseTransposes[slotParents[s]]);
+		}
+
+		DirectX::XMStoreFloat4x4(&worlds[s], world);
+		DirectX::XMStoreFloat4x4(&worldInverseTransposes[s], inverseTranspose);
+
+		// Its world matrix changed even if only a parent was edited -
+		// anything caching on the version (like Entity's bounds) has
+		// to find out
+		transform->version++;
+	}
+	updatedCount += end - start;
+}
+
+// --------------------------------------------------------
+// Lays the nodes out depth first, children in the order
+// they were added
+// --------------------------------------------------------
+void TransformHierarchy::Rebuild()
+{
+	unsigned int count = (unsigned int)transforms.size();
+
+	// Children grouped by parent - group 0 for the roots,
+	// node + 1 for everything else
+	std::vector<unsigned int> groupStart(count + 2, 0);
+	for (unsigned int n = 0; n < count; n++)
+		groupStart[parents[n] + 2]++;
+	for (unsigned int g = 1; g < count + 2; g++)
+		groupStart[g] += groupStart[g - 1];
+
+	std::vector<unsigned int> next(groupStart.begin(), groupStart.end() - 1);
+	std::vector<int> children(count);
+	for (unsigned int n = 0; n < count; n++)
+		children[next[parents[n] + 1]++] = (int)n;
+
+	// Pushed backwards, so they come off the stack in order
+	slotNodes.clear();
+	std::vector<int> stack;
+	for (unsigned int c = groupStart[1]; c > groupStart[0]; c--)
+		stack.push_back(children[c - 1]);
+	while (!stack.empty())
+	{
+		int node = stack.back();
+		stack.pop_back();
+		slots[node] = (int)slotNodes.size();
+		slotNodes.push_back(node);
+		for (unsigned int c = groupStart[node + 2]; c > groupStart[node + 1]; c--)
+			stack.push_back(children[c - 1]);
+	}
+
+	slotParents.resize(count);
+	for (unsigned int s = 0; s < count; s++)
+		slotParents[s] = parents[slotNodes[s]] == -1 ? -1 : slots[parents[slotNodes[s]]];
+
+	// Children come after their parent, so walking backwards
+	// finishes each subtree before it's added to its parent
+	subtreeSizes.assign(count, 1);
+	for (unsigned int s = count; s-- > 0; )
+		if (slotParents[s] != -1)
+			subtreeSizes[slotParents[s]] += subtreeSizes[s];
+
+	worlds.resize(count);
+	worldInverseTransposes.resize(count);
+}
+
+void TransformHierarchy::CheckNode(int node, const char* what) const
+{
+	if (node < 0 || node >= (int)transforms.size())
+		throw std::invalid_argument(std::string(what) + " isn't in the hierarchy");
+}
+
+// Identity until the first Update() after the node was added
+DirectX::XMFLOAT4X4 TransformHierarchy::GetWorldMatrix(int node) const
+{
+	CheckNode(node, "Node");
+	if (slots[node] == -1)
+	{
+		DirectX::XMFLOAT4X4 identity;
+		DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+		return identity;
+	}
+	return worlds[slots[node]];
+}
+
+DirectX::XMFLOAT4X4 TransformHierarchy::GetWorldInverseTransposeMatrix(int node) const
+{
+	CheckNode(node, "Node");
+	if (slots[node] == -1)
+	{
+		DirectX::XMFLOAT4X4 identity;
+		DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+		return identity;
+	}
+	return worldInverseTransposes[slots[node]];
+}
+
+unsigned int TransformHierarchy::GetCount() const { return (unsigned int)transforms.size(); }
+unsigned int TransformHierarchy::GetUpdatedCount() const { return updatedCount; }
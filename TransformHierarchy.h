@@ -0,0 +1,71 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+class Transform;
+
+// --------------------------------------------------------
+// Parent/child links between Transforms, and their world
+// matrices (local * parent's world), brought up to date by
+// one pass a frame
+//
+// - Nodes are kept flattened, depth first: a parent always
+//    comes before its children and every subtree is one
+//    contiguous run, so updating one is a single forward
+//    walk over the matrices
+// - Editing a Transform only sets its node's dirty flag -
+//    Update() then redoes the dirty nodes' subtrees and
+//    nothing else, so a frame where nothing moved is free
+// - Once added, a Transform's GetWorldMatrix() returns what
+//    the last Update() worked out
+// - Holds pointers: added Transforms mustn't move (or be
+//    copied) until Clear()
+// --------------------------------------------------------
+class TransformHierarchy
+{
+public:
+	TransformHierarchy();
+
+	// Returns the new node - parent is another node, or -1 for a
+	// root; throws std::invalid_argument for a bad parent or a
+	// Transform that's already in a hierarchy
+	int Add(Transform* transform, int parent = -1);
+
+	// Keeps the node's local transform, so its world one jumps -
+	// throws std::invalid_argument if that would make a loop
+	void SetParent(int node, int parent);
+	int GetParent(int node) const;
+
+	void Clear(); // Also lets go of the Transforms
+	void MarkDirty(int node); // What Transform does whenever it's edited
+	void Update();
+
+	DirectX::XMFLOAT4X4 GetWorldMatrix(int node) const;
+	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix(int node) const;
+
+	unsigned int GetCount() const;
+	unsigned int GetUpdatedCount() const; // Nodes the last Update() recomputed
+
+private:
+	void Rebuild();
+	void UpdateRange(unsigned int start, unsigned int end);
+	void CheckNode(int node, const char* what) const;
+
+	// Per node, in the order they were added
+	std::vector<Transform*> transforms;
+	std::vector<int> parents;
+	std::vector<int> slots; // Where the node is in the flattened arrays
+	std::vector<unsigned char> dirty;
+	std::vector<int> dirtyNodes;
+
+	// Flattened, depth first - rebuilt when parents change
+	std::vector<int> slotNodes;
+	std::vector<int> slotParents; // Slot of the parent, -1 for roots
+	std::vector<unsigned int> subtreeSizes; // Including the node itself
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+
+	std::vector<int> dirtySlots; // Scratch for Update()
+	bool orderChanged;
+	unsigned int updatedCount;
+};
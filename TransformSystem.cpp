@@ -0,0 +1,418 @@
+#include "TransformSystem.h"
+#include <algorithm>
+#include <immintrin.h>
+#include <stdexcept>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Where a batch reads from and writes to
+	struct Streams
+	{
+		const float* positionX; const float* positionY; const float* positionZ;
+		const float* rotationX; const float* rotationY; const float* rotationZ; const float* rotationW;
+		const float* scaleX; const float* scaleY; const float* scaleZ;
+		XMFLOAT4X4* worlds;
+		XMFLOAT4X4* worldInverseTransposes;
+	};
+
+	// Four lanes' worth of one matrix row ends up as one row of
+	// each of four matrices
+	void TransposeAndStore(__m128 c0, __m128 c1, __m128 c2, __m128 c3, XMFLOAT4X4* matrices, int row)
+	{
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&matrices[0].m[row][0], c0);
+		_mm_storeu_ps(&matrices[1].m[row][0], c1);
+		_mm_storeu_ps(&matrices[2].m[row][0], c2);
+		_mm_storeu_ps(&matrices[3].m[row][0], c3);
+	}
+
+	// One object at a time, for Transform's own inverse-transpose
+	struct ScalarLanes
+	{
+		static const unsigned int Width = 1;
+		typedef float Vector;
+		static Vector Load(const float* p) { return *p; }
+		static Vector Set(float f) { return f; }
+		static Vector Add(Vector a, Vector b) { return a + b; }
+		static Vector Sub(Vector a, Vector b) { return a - b; }
+		static Vector Mul(Vector a, Vector b) { return a * b; }
+		static Vector Div(Vector a, Vector b) { return a / b; }
+		static void StoreRow(Vector c0, Vector c1, Vector c2, Vector c3, XMFLOAT4X4* matrices, int row)
+		{
+			matrices->m[row][0] = c0;
+			matrices->m[row][1] = c1;
+			matrices->m[row][2] = c2;
+			matrices->m[row][3] = c3;
+		}
+	};
+
+	struct SseLanes
+	{
+		static const unsigned int Width = 4;
+		typedef __m128 Vector;
+		static Vector Load(const float* p) { return _mm_loadu_ps(p); }
+		static Vector Set(float f) { return _mm_set1_ps(f); }
+		static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm_div_ps(a, b); }
+		static void StoreRow(Vector c0, Vector c1, Vector c2, Vector c3, XMFLOAT4X4* matrices, int row)
+		{
+			TransposeAndStore(c0, c1, c2, c3, matrices, row);
+		}
+	};
+
+#if defined(_MSC_VER) || defined(__AVX__)
+#define TRANSFORM_SYSTEM_AVX
+	struct AvxLanes
+	{
+		static const unsigned int Width = 8;
+		typedef __m256 Vector;
+		static Vector Load(const float* p) { return _mm256_loadu_ps(p); }
+		static Vector Set(float f) { return _mm256_set1_ps(f); }
+		static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+
+		// As two halves of four
+		static void StoreRow(Vector c0, Vector c1, Vector c2, Vector c3, XMFLOAT4X4* matrices, int row)
+		{
+			TransposeAndStore(_mm256_castps256_ps128(c0), _mm256_castps256_ps128(c1),
+				_mm256_castps256_ps128(c2), _mm256_castps256_ps128(c3), matrices, row);
+			TransposeAndStore(_mm256_extractf128_ps(c0, 1), _mm256_extractf128_ps(c1, 1),
+				_mm256_extractf128_ps(c2, 1), _mm256_extractf128_ps(c3, 1), matrices + 4, row);
+		}
+	};
+#endif
+
+	// XMMatrixRotationQuaternion()'s upper 3x3, one lane per object
+	template<typename Lanes>
+	void RotationRows(typename Lanes::Vector x, typename Lanes::Vector y, typename Lanes::Vector z, typename Lanes::Vector w,
+		typename Lanes::Vector (&r)[3][3])
+	{
+		typedef typename Lanes::Vector V;
+		V one = Lanes::Set(1.0f);
+		V two = Lanes::Set(2.0f);
+		V x2 = Lanes::Mul(x, two), y2 = Lanes::Mul(y, two), z2 = Lanes::Mul(z, two);
+		V xx = Lanes::Mul(x, x2), yy = Lanes::Mul(y, y2), zz = Lanes::Mul(z, z2);
+		V xy = Lanes::Mul(x, y2), xz = Lanes::Mul(x, z2), yz = Lanes::Mul(y, z2);
+		V wx = Lanes::Mul(w, x2), wy = Lanes::Mul(w, y2), wz = Lanes::Mul(w, z2);
+
+		r[0][0] = Lanes::Sub(one, Lanes::Add(yy, zz)); r[0][1] = Lanes::Add(xy, wz); r[0][2] = Lanes::Sub(xz, wy);
+		r[1][0] = Lanes::Sub(xy, wz); r[1][1] = Lanes::Sub(one, Lanes::Add(xx, zz)); r[1][2] = Lanes::Add(yz, wx);
+		r[2][0] = Lanes::Add(xz, wy); r[2][1] = Lanes::Sub(yz, wx); r[2][2] = Lanes::Sub(one, Lanes::Add(xx, yy));
+	}
+
+	// --------------------------------------------------------
+	// The inverse-transpose of scale * rotation * translation
+	// needs no general inverse: the 3x3 part is the rotation
+	// with each row divided by its scale, and the translation
+	// moves to the last column as -(row . position)
+	// --------------------------------------------------------
+	template<typename Lanes>
+	void StoreInverseTranspose(const typename Lanes::Vector (&r)[3][3], const typename Lanes::Vector (&inverseScale)[3],
+		const typename Lanes::Vector (&position)[3], XMFLOAT4X4* matrices)
+	{
+		typedef typename Lanes::Vector V;
+		V zero = Lanes::Set(0.0f);
+		for (int row = 0; row < 3; row++)
+		{
+			V i0 = Lanes::Mul(r[row][0], inverseScale[row]);
+			V i1 = Lanes::Mul(r[row][1], inverseScale[row]);
+			V i2 = Lanes::Mul(r[row][2], inverseScale[row]);
+			V dot = Lanes::Add(Lanes::Add(Lanes::Mul(i0, position[0]), Lanes::Mul(i1, position[1])), Lanes::Mul(i2, position[2]));
+			Lanes::StoreRow(i0, i1, i2, Lanes::Sub(zero, dot), matrices, row);
+		}
+		Lanes::StoreRow(zero, zero, zero, Lanes::Set(1.0f), matrices, 3);
+	}
+
+	// --------------------------------------------------------
+	// world = scale * rotation * translation, the same as
+	// XMMatrixScaling() * XMMatrixRotationQuaternion() *
+	// XMMatrixTranslation(), one lane per object
+	// --------------------------------------------------------
+	template<typename Lanes>
+	void BuildLanes(const Streams& s, unsigned int first)
+	{
+		typedef typename Lanes::Vector V;
+		V position[3] = { Lanes::Load(s.positionX + first), Lanes::Load(s.positionY + first), Lanes::Load(s.positionZ + first) };
+		V scale[3] = { Lanes::Load(s.scaleX + first), Lanes::Load(s.scaleY + first), Lanes::Load(s.scaleZ + first) };
+		V zero = Lanes::Set(0.0f);
+		V one = Lanes::Set(1.0f);
+
+		V r[3][3];
+		RotationRows<Lanes>(Lanes::Load(s.rotationX + first), Lanes::Load(s.rotationY + first),
+			Lanes::Load(s.rotationZ + first), Lanes::Load(s.rotationW + first), r);
+
+		XMFLOAT4X4* worlds = s.worlds + first;
+		for (int row = 0; row < 3; row++)
+			Lanes::StoreRow(Lanes::Mul(r[row][0], scale[row]), Lanes::Mul(r[row][1], scale[row]), Lanes::Mul(r[row][2], scale[row]), zero, worlds, row);
+		Lanes::StoreRow(position[0], position[1], position[2], one, worlds, 3);
+
+		V inverseScale[3] = { Lanes::Div(one, scale[0]), Lanes::Div(one, scale[1]), Lanes::Div(one, scale[2]) };
+		StoreInverseTranspose<Lanes>(r, inverseScale, position, s.worldInverseTransposes + first);
+	}
+
+	// A batch is one AVX build or two SSE ones
+	template<typename Lanes>
+	void BuildBatch(const Streams& s, unsigned int batch)
+	{
+		for (unsigned int lane = 0; lane < TransformSystem::BatchSize; lane += Lanes::Width)
+			BuildLanes<Lanes>(s, batch * TransformSystem::BatchSize + lane);
+	}
+
+	// AVX needs the CPU to have it and the OS to save the
+	// wider registers (MSVC lets us use the intrinsics either way)
+	bool HasAvx()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+#elif defined(__AVX__)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	const bool useAvx = HasAvx();
+}
+
+TransformSystem::TransformSystem()
+{
+	count = 0;
+	updatedCount = 0;
+}
+
+TransformSystem::Handle TransformSystem::Create()
+{
+	Handle handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		handle = (Handle)handleIndices.size();
+		handleIndices.push_back(-1);
+	}
+
+	// Padding is already an identity transform
+	unsigned int index = count;
+	Resize(count + 1);
+	handleIndices[handle] = (int)index;
+	indexHandles.push_back(handle);
+	MarkDirty(index);
+	return handle;
+}
+
+// --------------------------------------------------------
+// The last object moves into the hole, so the arrays stay
+// packed - the slot it leaves goes back to being identity
+// padding
+// --------------------------------------------------------
+void TransformSystem::Destroy(Handle handle)
+{
+	unsigned int index = CheckHandle(handle);
+	unsigned int last = count - 1;
+	if (index != last)
+	{
+		positionX[index] = positionX[last]; positionY[index] = positionY[last]; positionZ[index] = positionZ[last];
+		rotationX[index] = rotationX[last]; rotationY[index] = rotationY[last];
+		rotationZ[index] = rotationZ[last]; rotationW[index] = rotationW[last];
+		scaleX[index] = scaleX[last]; scaleY[index] = scaleY[last]; scaleZ[index] = scaleZ[last];
+		worlds[index] = worlds[last];
+		worldInverseTransposes[index] = worldInverseTransposes[last];
+		indexHandles[index] = indexHandles[last];
+		handleIndices[indexHandles[index]] = (int)index;
+		MarkDirty(index); // In case it was waiting to be rebuilt
+	}
+
+	positionX[last] = positionY[last] = positionZ[last] = 0.0f;
+	rotationX[last] = rotationY[last] = rotationZ[last] = 0.0f;
+	rotationW[last] = 1.0f;
+	scaleX[last] = scaleY[last] = scaleZ[last] = 1.0f;
+	indexHandles.pop_back();
+	handleIndices[handle] = -1;
+	freeHandles.push_back(handle);
+	count--;
+}
+
+void TransformSystem::Clear()
+{
+	positionX.clear(); positionY.clear(); positionZ.clear();
+	rotationX.clear(); rotationY.clear(); rotationZ.clear(); rotationW.clear();
+	scaleX.clear(); scaleY.clear(); scaleZ.clear();
+	worlds.clear();
+	worldInverseTransposes.clear();
+	dirtyBatches.clear();
+	dirtyBatchList.clear();
+	handleIndices.clear();
+	indexHandles.clear();
+	freeHandles.clear();
+	count = 0;
+	updatedCount = 0;
+}
+
+// Only ever grows, so there's always room for the padding
+void TransformSystem::Resize(unsigned int newCount)
+{
+	count = newCount;
+	size_t padded = (count + BatchSize - 1) / BatchSize * BatchSize;
+	if (padded <= positionX.size())
+		return;
+
+	positionX.resize(padded, 0.0f); positionY.resize(padded, 0.0f); positionZ.resize(padded, 0.0f);
+	rotationX.resize(padded, 0.0f); rotationY.resize(padded, 0.0f); rotationZ.resize(padded, 0.0f);
+	rotationW.resize(padded, 1.0f);
+	scaleX.resize(padded, 1.0f); scaleY.resize(padded, 1.0f); scaleZ.resize(padded, 1.0f);
+	worlds.resize(padded);
+	worldInverseTransposes.resize(padded);
+	dirtyBatches.resize(padded / BatchSize, 0);
+}
+
+unsigned int TransformSystem::CheckHandle(Handle handle) const
+{
+	if (handle >= handleIndices.size() || handleIndices[handle] == -1)
+		throw std::invalid_argument("Transform handle isn't alive");
+	return (unsigned int)handleIndices[handle];
+}
+
+void TransformSystem::MarkDirty(unsigned int index)
+{
+	unsigned int batch = index / BatchSize;
+	if (dirtyBatches[batch])
+		return;
+	dirtyBatches[batch] = 1;
+	dirtyBatchList.push_back(batch);
+}
+
+void TransformSystem::SetPosition(Handle handle, XMFLOAT3 position)
+{
+	unsigned int index = CheckHandle(handle);
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetRotation(Handle handle, XMFLOAT4 quaternion)
+{
+	unsigned int index = CheckHandle(handle);
+	XMStoreFloat4(&quaternion, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	rotationX[index] = quaternion.x;
+	rotationY[index] = quaternion.y;
+	rotationZ[index] = quaternion.z;
+	rotationW[index] = quaternion.w;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetRotation(Handle handle, float pitch, float yaw, float roll)
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+	SetRotation(handle, quaternion);
+}
+
+void TransformSystem::SetScale(Handle handle, XMFLOAT3 scale)
+{
+	unsigned int index = CheckHandle(handle);
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+	MarkDirty(index);
+}
+
+XMFLOAT3 TransformSystem::GetPosition(Handle handle) const
+{
+	unsigned int index = CheckHandle(handle);
+	return XMFLOAT3(positionX[index], positionY[index], positionZ[index]);
+}
+
+XMFLOAT4 TransformSystem::GetRotation(Handle handle) const
+{
+	unsigned int index = CheckHandle(handle);
+	return XMFLOAT4(rotationX[index], rotationY[index], rotationZ[index], rotationW[index]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(Handle handle) const
+{
+	unsigned int index = CheckHandle(handle);
+	return XMFLOAT3(scaleX[index], scaleY[index], scaleZ[index]);
+}
+
+// --------------------------------------------------------
+// Dirty batches in order, so the writes walk forward
+// through the matrix arrays
+// --------------------------------------------------------
+void TransformSystem::Update()
+{
+	updatedCount = 0;
+	if (dirtyBatchList.empty())
+		return;
+	std::sort(dirtyBatchList.begin(), dirtyBatchList.end());
+
+	Streams streams =
+	{
+		positionX.data(), positionY.data(), positionZ.data(),
+		rotationX.data(), rotationY.data(), rotationZ.data(), rotationW.data(),
+		scaleX.data(), scaleY.data(), scaleZ.data(),
+		worlds.data(), worldInverseTransposes.data()
+	};
+	for (unsigned int batch : dirtyBatchList)
+	{
+#if defined(TRANSFORM_SYSTEM_AVX)
+		if (useAvx) { BuildBatch<AvxLanes>(streams, batch); }
+		else { BuildBatch<SseLanes>(streams, batch); }
+#else
+		BuildBatch<SseLanes>(streams, batch);
+#endif
+		dirtyBatches[batch] = 0;
+	}
+	updatedCount = (unsigned int)dirtyBatchList.size() * BatchSize;
+	dirtyBatchList.clear();
+}
+
+unsigned int TransformSystem::GetCount() const { return count; }
+unsigned int TransformSystem::GetIndex(Handle handle) const { return CheckHandle(handle); }
+const XMFLOAT4X4* TransformSystem::GetWorldMatrices() const { return worlds.data(); }
+const XMFLOAT4X4* TransformSystem::GetWorldInverseTransposeMatrices() const { return worldInverseTransposes.data(); }
+unsigned int TransformSystem::GetUpdatedCount() const { return updatedCount; }
+
+const char* TransformSystem::InstructionSet()
+{
+	return useAvx ? "AVX" : "SSE";
+}
+
+// --------------------------------------------------------
+// Update()'s closed form for a single transform - with a
+// uniform scale it's only the one divide
+// --------------------------------------------------------
+XMMATRIX TransformSystem::InverseTranspose(XMFLOAT3 position, XMFLOAT4 rotation, XMFLOAT3 scale)
+{
+	float r[3][3];
+	RotationRows<ScalarLanes>(rotation.x, rotation.y, rotation.z, rotation.w, r);
+
+	float inverseX = 1.0f / scale.x;
+	float inverseScale[3] = { inverseX, inverseX, inverseX };
+	if (scale.y != scale.x || scale.z != scale.x)
+	{
+		inverseScale[1] = 1.0f / scale.y;
+		inverseScale[2] = 1.0f / scale.z;
+	}
+
+	float p[3] = { position.x, position.y, position.z };
+	XMFLOAT4X4 matrix;
+	StoreInverseTranspose<ScalarLanes>(r, inverseScale, p, &matrix);
+	return XMLoadFloat4x4(&matrix);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Position, rotation and scale for lots of objects, kept as
+// structure-of-arrays and turned into world matrices 4 or 8
+// at a time
+//
+// - Objects are addressed by handle - the arrays stay packed
+//    (removing one moves the last into its place), so a
+//    handle's index can change but the handle never does
+// - Rotation is a quaternion (normalized when set), so the
+//    matrices are built with no trig at all
+// - Edits only mark the object's batch of 8 dirty, and
+//    Update() rebuilds the dirty batches with AVX when the
+//    CPU has it (checked once at startup), otherwise SSE
+// - World and inverse-transpose matrices end up in two
+//    contiguous arrays, by index, ready to copy into a
+//    buffer as they are (Game's draw loop uploads its
+//    entities' straight from them)
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	typedef unsigned int Handle;
+	static const unsigned int BatchSize = 8;
+
+	TransformSystem();
+
+	Handle Create(); // At the origin, no rotation, scale 1
+	void Destroy(Handle handle);
+	void Clear();
+
+	// Throw std::invalid_argument for a handle that isn't alive
+	void SetPosition(Handle handle, DirectX::XMFLOAT3 position);
+	void SetRotation(Handle handle, DirectX::XMFLOAT4 quaternion);
+	void SetRotation(Handle handle, float pitch, float yaw, float roll);
+	void SetScale(Handle handle, DirectX::XMFLOAT3 scale);
+	DirectX::XMFLOAT3 GetPosition(Handle handle) const;
+	DirectX::XMFLOAT4 GetRotation(Handle handle) const;
+	DirectX::XMFLOAT3 GetScale(Handle handle) const;
+
+	void Update(); // Rebuilds the matrices of every dirty batch
+
+	unsigned int GetCount() const;
+	unsigned int GetIndex(Handle handle) const; // Into the matrix arrays
+	const DirectX::XMFLOAT4X4* GetWorldMatrices() const;
+	const DirectX::XMFLOAT4X4* GetWorldInverseTransposeMatrices() const;
+	unsigned int GetUpdatedCount() const; // Matrices the last Update() rebuilt (whole batches)
+
+	static const char* InstructionSet(); // Which one Update() is using
+
+	// The closed form Update() uses, one lane wide - Transform's
+	// inverse-transpose comes from here too, so there's only one
+	static DirectX::XMMATRIX InverseTranspose(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation, DirectX::XMFLOAT3 scale);
+
+private:
+	unsigned int CheckHandle(Handle handle) const; // Returns its index
+	void MarkDirty(unsigned int index);
+	void Resize(unsigned int count);
+
+	// Padded to a whole number of batches - the padding is
+	// an identity transform so it never makes NaNs
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+
+	std::vector<unsigned char> dirtyBatches;
+	std::vector<unsigned int> dirtyBatchList;
+
+	std::vector<int> handleIndices; // -1 once destroyed
+	std::vector<Handle> indexHandles;
+	std::vector<Handle> freeHandles;
+	unsigned int count;
+	unsigned int updatedCount;
+};
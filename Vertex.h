@@ -13,4 +13,21 @@ struct Vertex
 	DirectX::XMFLOAT2 UV;			// The UV
 	DirectX::XMFLOAT3 Normal;		// The Vertex Normal
 	DirectX::XMFLOAT3 Tangent;
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// A compressed version of Vertex - 20 bytes instead of 44
+//
+// - Position is quantized against the mesh's bounds (16 bits
+//    per axis, UNORM), the shader scales/offsets it back
+// - Normal and Tangent are octahedral-encoded (2x SNORM16)
+// - UV is two half floats
+// - See VertexCodec.h for converting to/from Vertex
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];		// R16G16B16A16_UNORM (w is padding)
+	unsigned short UV[2];			// R16G16_FLOAT
+	short Normal[2];				// R16G16_SNORM
+	short Tangent[2];				// R16G16_SNORM
+};
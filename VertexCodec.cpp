@@ -0,0 +1,200 @@
+#include "VertexCodec.h"
+#include "Bounds.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace VertexCodec
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		const float RadiansToDegrees = 57.2957795f;
+
+		// Same rules as the GPU: SNORM16 -32768 and -32767 both mean -1
+		float SnormToFloat(short value)
+		{
+			return std::max(value / 32767.0f, -1.0f);
+		}
+
+		float Sign(float value)
+		{
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		// Angle between a (any length) and b (unit length), in degrees
+		// - Zero-length originals (e.g. tangents of a mesh without UVs)
+		//    can't be wrong, so they count as 0
+		float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			float length = std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+			if (!(length > 0.0f))
+				return 0.0f;
+
+			float cosine = (a.x * b.x + a.y * b.y + a.z * b.z) / length;
+			return std::acos(std::clamp(cosine, -1.0f, 1.0f)) * RadiansToDegrees;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Min and size of the box around every position
+// --------------------------------------------------------
+VertexCodec::PositionBounds VertexCodec::ComputeBounds(const Vertex* verts, size_t count)
+{
+	PositionBounds bounds = {};
+	if (count == 0)
+		return bounds;
+
+	Bounds::Box box = Bounds::ComputeBox(verts, count);
+	bounds.min = box.min;
+	bounds.extent = XMFLOAT3(box.max.x - box.min.x, box.max.y - box.min.y, box.max.z - box.min.z);
+	return bounds;
+}
+
+unsigned short VertexCodec::QuantizeUnorm16(float value, float min, float extent)
+{
+	// A flat axis (extent of 0) decodes to min no matter what
+	float t = extent > 0.0f ? (value - min) / extent : 0.0f;
+	return (unsigned short)std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f);
+}
+
+float VertexCodec::DequantizeUnorm16(unsigned short value, float min, float extent)
+{
+	return min + (value / 65535.0f) * extent;
+}
+
+// --------------------------------------------------------
+// Octahedral encoding (Cigolle et al. 2014, "A Survey of
+// Efficient Representations for Independent Unit Vectors")
+//
+// - Projects the direction onto an octahedron, then unfolds
+//    the lower half over the corners of the upper half
+// - Rounding each component on its own isn't the closest
+//    result, so all 4 floor/ceil combinations are decoded
+//    and the best one is kept
+// --------------------------------------------------------
+void VertexCodec::EncodeOctahedral(XMFLOAT3 direction, short out[2])
+{
+	float l1 = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+	if (!(l1 > 0.0f) || !std::isfinite(l1))
+	{
+		// Nothing sensible to store, so store +Z
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+
+	float x = direction.x / l1;
+	float y = direction.y / l1;
+	if (direction.z < 0.0f)
+	{
+		float foldedX = (1.0f - std::fabs(y)) * Sign(x);
+		float foldedY = (1.0f - std::fabs(x)) * Sign(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	float scaledX = x * 32767.0f;
+	float scaledY = y * 32767.0f;
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		short candidate[2] =
+		{
+			(short)std::clamp((i & 1) ? std::ceil(scaledX) : std::floor(scaledX), -32767.0f, 32767.0f),
+			(short)std::clamp((i & 2) ? std::ceil(scaledY) : std::floor(scaledY), -32767.0f, 32767.0f)
+		};
+
+		XMFLOAT3 decoded = DecodeOctahedral(candidate);
+		float dot = decoded.x * direction.x + decoded.y * direction.y + decoded.z * direction.z;
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			out[0] = candidate[0];
+			out[1] = candidate[1];
+		}
+	}
+}
+
+XMFLOAT3 VertexCodec::DecodeOctahedral(const short in[2])
+{
+	float x = SnormToFloat(in[0]);
+	float y = SnormToFloat(in[1]);
+	float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+	// Fold the lower half back down
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = std::sqrt(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+PackedVertex VertexCodec::Encode(const Vertex& v, const PositionBounds& bounds)
+{
+	PackedVertex packed = {};
+	packed.Position[0] = QuantizeUnorm16(v.Position.x, bounds.min.x, bounds.extent.x);
+	packed.Position[1] = QuantizeUnorm16(v.Position.y, bounds.min.y, bounds.extent.y);
+	packed.Position[2] = QuantizeUnorm16(v.Position.z, bounds.min.z, bounds.extent.z);
+	packed.Position[3] = 0;
+
+	packed.UV[0] = PackedVector::XMConvertFloatToHalf(v.UV.x);
+	packed.UV[1] = PackedVector::XMConvertFloatToHalf(v.UV.y);
+
+	EncodeOctahedral(v.Normal, packed.Normal);
+	EncodeOctahedral(v.Tangent, packed.Tangent);
+	return packed;
+}
+
+Vertex VertexCodec::Decode(const PackedVertex& v, const PositionBounds& bounds)
+{
+	Vertex decoded = {};
+	decoded.Position = XMFLOAT3(
+		DequantizeUnorm16(v.Position[0], bounds.min.x, bounds.extent.x),
+		DequantizeUnorm16(v.Position[1], bounds.min.y, bounds.extent.y),
+		DequantizeUnorm16(v.Position[2], bounds.min.z, bounds.extent.z));
+
+	decoded.UV = XMFLOAT2(
+		PackedVector::XMConvertHalfToFloat(v.UV[0]),
+		PackedVector::XMConvertHalfToFloat(v.UV[1]));
+
+	decoded.Normal = DecodeOctahedral(v.Normal);
+	decoded.Tangent = DecodeOctahedral(v.Tangent);
+	return decoded;
+}
+
+void VertexCodec::Encode(const Vertex* verts, size_t count, const PositionBounds& bounds, PackedVertex* out)
+{
+	for (size_t i = 0; i < count; i++)
+		out[i] = Encode(verts[i], bounds);
+}
+
+// --------------------------------------------------------
+// Decodes every vertex and compares it to the original
+// --------------------------------------------------------
+VertexCodec::ErrorStats VertexCodec::MeasureError(const Vertex* verts, const PackedVertex* packed, size_t count, const PositionBounds& bounds)
+{
+	ErrorStats stats = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& original = verts[i];
+		Vertex decoded = Decode(packed[i], bounds);
+
+		float dx = decoded.Position.x - original.Position.x;
+		float dy = decoded.Position.y - original.Position.y;
+		float dz = decoded.Position.z - original.Position.z;
+		stats.maxPositionError = std::max(stats.maxPositionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+
+		stats.maxNormalDegrees = std::max(stats.maxNormalDegrees, AngleDegrees(original.Normal, decoded.Normal));
+		stats.maxTangentDegrees = std::max(stats.maxTangentDegrees, AngleDegrees(original.Tangent, decoded.Tangent));
+
+		stats.maxUVError = std::max(stats.maxUVError, std::fabs(decoded.UV.x - original.UV.x));
+		stats.maxUVError = std::max(stats.maxUVError, std::fabs(decoded.UV.y - original.UV.y));
+	}
+	return stats;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Converts between Vertex and the 20 byte PackedVertex
+//
+// - Positions become 16-bit fractions of the mesh's bounds,
+//    so the error is at most half a step (extent / 131070)
+// - Normals/tangents use an octahedral mapping to 2 SNORM16s,
+//    picking whichever neighbouring value decodes closest
+// - UVs are half floats, so tiling UVs far from 0 lose detail
+// - Everything here is plain CPU code, and Decode() matches
+//    what PackedVertexShader.hlsl does on the GPU
+// --------------------------------------------------------
+namespace VertexCodec
+{
+	// Decoded position = min + (quantized / 65535) * extent
+	struct PositionBounds
+	{
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 extent;
+	};
+
+	// Worst case round-trip error over a set of vertices
+	struct ErrorStats
+	{
+		float maxPositionError;		// Distance, in object space units
+		float maxNormalDegrees;		// Angle between original and decoded
+		float maxTangentDegrees;
+		float maxUVError;			// Largest difference in U or V
+	};
+
+	PositionBounds ComputeBounds(const Vertex* verts, size_t count);
+
+	PackedVertex Encode(const Vertex& v, const PositionBounds& bounds);
+	Vertex Decode(const PackedVertex& v, const PositionBounds& bounds);
+	void Encode(const Vertex* verts, size_t count, const PositionBounds& bounds, PackedVertex* out);
+
+	ErrorStats MeasureError(const Vertex* verts, const PackedVertex* packed, size_t count, const PositionBounds& bounds);
+
+	// The individual pieces, for anything that only needs one of them
+	unsigned short QuantizeUnorm16(float value, float min, float extent);
+	float DequantizeUnorm16(unsigned short value, float min, float extent);
+	void EncodeOctahedral(DirectX::XMFLOAT3 direction, short out[2]);
+	DirectX::XMFLOAT3 DecodeOctahedral(const short in[2]);
+}
@@ -1,16 +1,22 @@
 #include "ShaderInclude.hlsli"
 
 //Buffer for external data
+// - The same for every object drawn from a camera
 cbuffer ExternalVertexData : register(b0)
 {
-    float4x4 world			: WORLD_MATRIX;
-    float4x4 worldInv		: WORLD_INVERSE_MATRIX;
     float4x4 view			: VIEW_MATRIX;
     float4x4 proj			: PROJECTION_MATRIX;
     float4x4 shadowView		: LIGHT_VIEW_MATRIX;
     float4x4 shadowProj		: LIGHT_PROJECTION_MATRIX;
 };
 
+// Per object - only sent again when it changes (see ObjectConstants.h)
+cbuffer ObjectVertexData : register(b1)
+{
+    float4x4 world			: WORLD_MATRIX;
+    float4x4 worldInv		: WORLD_INVERSE_MATRIX;
+};
+
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // 
@@ -0,0 +1,159 @@
+#include "VertexWelder.h"
+#include <cmath>
+#include <unordered_map>
+
+namespace VertexWelder
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Mixes the three indices into a well-spread 32-bit hash
+		inline unsigned int HashCorner(const CornerKey& key)
+		{
+			unsigned long long h = key.position * 0x9E3779B97F4A7C15ull;
+			h ^= (key.uv + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+			h ^= (key.normal + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+			h ^= h >> 29;
+			return (unsigned int)h;
+		}
+
+		inline bool SameCorner(const CornerKey& a, const CornerKey& b)
+		{
+			return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+		}
+
+		inline bool Near(float a, float b, float epsilon)
+		{
+			return std::fabs(a - b) <= epsilon;
+		}
+
+		// Position, uv and normal all within epsilon (tangents are rebuilt later anyway)
+		bool NearVertex(const Vertex& a, const Vertex& b, float epsilon)
+		{
+			return
+				Near(a.Position.x, b.Position.x, epsilon) && Near(a.Position.y, b.Position.y, epsilon) && Near(a.Position.z, b.Position.z, epsilon) &&
+				Near(a.UV.x, b.UV.x, epsilon) && Near(a.UV.y, b.UV.y, epsilon) &&
+				Near(a.Normal.x, b.Normal.x, epsilon) && Near(a.Normal.y, b.Normal.y, epsilon) && Near(a.Normal.z, b.Normal.z, epsilon);
+		}
+
+		// Packs a grid cell's coordinates into one 64-bit key (21 bits each)
+		inline unsigned long long CellKey(long long x, long long y, long long z)
+		{
+			const unsigned long long mask = (1ull << 21) - 1;
+			return ((unsigned long long)x & mask) | (((unsigned long long)y & mask) << 21) | (((unsigned long long)z & mask) << 42);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Exact welding on index triples
+//
+// - Open addressing with linear probing; the table stores
+//    unique vertex ids and compares against their first
+//    corner, so it's just 4 bytes per slot
+// - Kept at <= 50% load so probes stay short
+// --------------------------------------------------------
+void VertexWelder::WeldCorners(const CornerKey* corners, size_t count, unsigned int* remap, std::vector<unsigned int>& uniqueCorners)
+{
+	uniqueCorners.clear();
+	if (count == 0)
+		return;
+
+	size_t capacity = 16;
+	while (capacity < count * 2) capacity *= 2;
+	size_t mask = capacity - 1;
+	std::vector<unsigned int> table(capacity, NoIndex);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const CornerKey& key = corners[i];
+		size_t slot = HashCorner(key) & mask;
+		while (true)
+		{
+			unsigned int id = table[slot];
+			if (id == NoIndex)
+			{
+				// First time we've seen this triple
+				id = (unsigned int)uniqueCorners.size();
+				table[slot] = id;
+				uniqueCorners.push_back((unsigned int)i);
+				remap[i] = id;
+				break;
+			}
+			if (SameCorner(corners[uniqueCorners[id]], key))
+			{
+				remap[i] = id;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Epsilon welding with a uniform grid
+//
+// - Each kept vertex goes into the cell its position falls in
+// - A new vertex checks its own and all 26 neighbouring cells,
+//    since anything within epsilon can be at most one cell away
+// --------------------------------------------------------
+void VertexWelder::WeldByDistance(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float epsilon)
+{
+	if (epsilon <= 0.0f || verts.empty())
+		return;
+
+	float cellSize = epsilon * 2.0f;
+	std::unordered_map<unsigned long long, unsigned int> cellHeads; // Cell -> most recent kept vertex in it
+	std::vector<unsigned int> nextInCell;	// Linked list of kept vertices per cell
+	std::vector<unsigned int> remap(verts.size());
+	cellHeads.reserve(verts.size());
+	nextInCell.reserve(verts.size());
+
+	unsigned int kept = 0;
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		const Vertex& v = verts[i];
+		long long cx = (long long)std::floor(v.Position.x / cellSize);
+		long long cy = (long long)std::floor(v.Position.y / cellSize);
+		long long cz = (long long)std::floor(v.Position.z / cellSize);
+
+		unsigned int match = NoIndex;
+		for (long long z = cz - 1; z <= cz + 1 && match == NoIndex; z++)
+			for (long long y = cy - 1; y <= cy + 1 && match == NoIndex; y++)
+				for (long long x = cx - 1; x <= cx + 1 && match == NoIndex; x++)
+				{
+					auto cell = cellHeads.find(CellKey(x, y, z));
+					if (cell == cellHeads.end())
+						continue;
+
+					for (unsigned int k = cell->second; k != NoIndex; k = nextInCell[k])
+					{
+						if (NearVertex(verts[k], v, epsilon))
+						{
+							match = k;
+							break;
+						}
+					}
+				}
+
+		if (match != NoIndex)
+		{
+			remap[i] = match;
+			continue;
+		}
+
+		// Keep it - kept vertices are compacted towards the front as we go
+		verts[kept] = v;
+		remap[i] = kept;
+
+		auto head = cellHeads.try_emplace(CellKey(cx, cy, cz), NoIndex).first;
+		nextInCell.push_back(head->second);
+		head->second = kept;
+		kept++;
+	}
+
+	verts.resize(kept);
+	for (unsigned int& index : indices)
+		index = remap[index];
+}
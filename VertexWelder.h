@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Merges duplicate vertices so meshes get a real index buffer
+//
+// - WeldCorners() is exact: it hashes the (position, uv,
+//    normal) index triple of every face corner, so two
+//    corners only merge if they'd build identical vertices
+// - WeldByDistance() is the optional, lossy pass for meshes
+//    exported by tools that duplicate vertex data instead of
+//    sharing indices - everything within epsilon merges
+// - Both keep the first occurrence of each vertex, so the
+//    results don't depend on hash table layout
+// --------------------------------------------------------
+namespace VertexWelder
+{
+	// One face corner's indices into the position/uv/normal arrays
+	// (NoIndex when the file left that element out)
+	struct CornerKey
+	{
+		unsigned int position;
+		unsigned int uv;
+		unsigned int normal;
+	};
+	const unsigned int NoIndex = 0xFFFFFFFF;
+
+	// Fills remap[i] with the unique vertex each corner maps to, and
+	// uniqueCorners with the first corner of each unique vertex
+	void WeldCorners(const CornerKey* corners, size_t count, unsigned int* remap, std::vector<unsigned int>& uniqueCorners);
+
+	// Merges vertices whose position, uv and normal are all within
+	// epsilon of each other, compacting verts and rewriting indices
+	void WeldByDistance(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float epsilon);
+}
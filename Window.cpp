@@ -27,6 +27,7 @@ namespace Window
 		unsigned int windowWidth = 0;
 		unsigned int windowHeight = 0;
 		bool windowStats = false;
+		std::wstring statsText;
 		HWND windowHandle = 0;
 		bool hasFocus = false;
 		bool isMinimized = false;
@@ -155,6 +156,18 @@ HRESULT Window::Create(
 }
 
 
+// --------------------------------------------------------
+// Sets the size Width() and Height() report without making
+// a window, so a headless game (see Main.cpp) still has a
+// frame size to render at
+// --------------------------------------------------------
+void Window::CreateHeadless(unsigned int width, unsigned int height)
+{
+	windowWidth = width;
+	windowHeight = height;
+}
+
+
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
 // per second, including:
@@ -183,7 +196,8 @@ void Window::UpdateStats(float totalTime)
 		"    Height: " << windowHeight <<
 		"    FPS: " << fpsFrameCounter <<
 		"    Frame Time: " << mspf << "ms" <<
-		"    Graphics: " << Graphics::APIName();
+		"    Graphics: " << Graphics::APIName() <<
+		statsText;
 
 	// Actually update the title bar and reset fps data
 	SetWindowText(windowHandle, output.str().c_str());
@@ -192,6 +206,11 @@ void Window::UpdateStats(float totalTime)
 }
 
 
+void Window::SetStatsText(std::wstring text)
+{
+	statsText = text;
+}
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
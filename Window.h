@@ -21,7 +21,9 @@ namespace Window
 		std::wstring titleBarText,
 		bool statsInTitleBar,
 		void (*resizeCallback)());
+	void CreateHeadless(unsigned int width, unsigned int height); // No OS window, just its size - for running frames without one
 	void UpdateStats(float totalTime);
+	void SetStatsText(std::wstring text); // Extra stats shown after the FPS in the title bar
 	void Quit();
 
 	// Helper function for allocating a console window